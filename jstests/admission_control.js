@@ -0,0 +1,86 @@
+// Admission control sorts client operations into classes with their own tickets, reports them in
+// serverStatus, and its limits can be changed with setParameter.
+
+var t = db.jstests_admission_control;
+t.drop();
+
+function status( percentiles ) {
+    var cmd = { serverStatus : 1 };
+    if ( percentiles ) {
+        cmd.admissionControl = { percentiles : percentiles };
+    }
+    var res = db.adminCommand( cmd );
+    assert.commandWorked( res );
+    return res.admissionControl;
+}
+
+function admitted( s , cls ) {
+    return s[ cls ].waitMicros.count;
+}
+
+var params = [ "admissionSharedTickets" ];
+[ "Internal" , "PointRead" , "Write" , "Scan" ].forEach( function( c ) {
+    params.push( "admission" + c + "Reserved" , "admission" + c + "Shared" );
+} );
+var getCmd = { getParameter : 1 , admissionControl : 1 };
+params.forEach( function( p ) { getCmd[ p ] = 1; } );
+var saved = db.adminCommand( getCmd );
+assert.commandWorked( saved );
+
+try {
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , admissionControl : true } ) );
+    var before = status();
+    assert( before.enabled , tojson( before ) );
+
+    for ( var i = 0; i < 10; i++ ) {
+        t.insert( { _id : i , x : i } );
+    }
+    assert.eq( null , db.getLastError() );
+    for ( var i = 0; i < 10; i++ ) {
+        assert.eq( i , t.findOne( { _id : i } ).x );
+    }
+    assert.eq( 10 , t.find( { x : { $gte : 0 } } ).itcount() );
+    assert.eq( 10 , t.count() );
+
+    var after = status();
+    assert.lte( admitted( before , "write" ) + 10 , admitted( after , "write" ) , tojson( after ) );
+    assert.lte( admitted( before , "pointRead" ) + 10 , admitted( after , "pointRead" ) , tojson( after ) );
+    assert.lte( admitted( before , "scan" ) + 2 , admitted( after , "scan" ) , tojson( after ) );
+    [ "internal" , "pointRead" , "write" , "scan" ].forEach( function( c ) {
+        assert.eq( 0 , after[ c ].queueDepth , tojson( after ) );
+        assert.lte( 0 , after[ c ].waited );
+        assert( after[ c ].waitMicros.percentiles.p99 >= 0 , tojson( after ) );
+    } );
+
+    // limits are reported as they are changed
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , admissionScanReserved : 1 ,
+                                             admissionScanShared : 0 } ) );
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , admissionSharedTickets : 8 } ) );
+    var s = status( [ 90 ] );
+    assert.eq( 1 , s.scan.reserved , tojson( s ) );
+    assert.eq( 0 , s.scan.sharedLimit , tojson( s ) );
+    assert.eq( 8 , s.shared.out , tojson( s ) );
+    assert.eq( [ "p90" ] , Object.keySet( s.scan.waitMicros.percentiles ) );
+    assert.commandFailed( db.adminCommand( { setParameter : 1 , admissionScanReserved : -1 } ) );
+
+    // with one scan ticket, a second scan queues behind a slow one, but point reads still run
+    var slowScan = startParallelShell( "db.jstests_admission_control.find( { $where : " +
+                                       "'sleep( 300 ); return true;' } ).itcount();" );
+    var otherScan = startParallelShell( "sleep( 500 ); db.jstests_admission_control.find( { $where : " +
+                                        "'sleep( 100 ); return true;' } ).itcount();" );
+    assert.soon( function() { return status().scan.queueDepth > 0; } , "second scan didn't queue" );
+    var timer = new Date();
+    assert.eq( 3 , t.findOne( { _id : 3 } ).x );
+    assert.gt( 1000 , new Date() - timer , "point read waited behind the scans" );
+    slowScan();
+    otherScan();
+    assert.lte( 1 , status().scan.waited );
+    assert.eq( 0 , status().scan.queueDepth );
+}
+finally {
+    var restore = { setParameter : 1 };
+    params.forEach( function( p ) { restore[ p ] = saved[ p ]; } );
+    assert.commandWorked( db.adminCommand( restore ) );
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , admissionControl : saved.admissionControl } ) );
+    t.drop();
+}
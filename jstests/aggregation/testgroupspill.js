@@ -0,0 +1,44 @@
+// $group with allowDiskUse spills groups to disk once it goes over
+// aggregationGroupMaxMemoryBytes, and gives the same results as in memory.
+
+c = db.groupspill;
+c.drop();
+
+var big = new Array(1024).join('x');
+for (var i = 0; i < 2000; i++) {
+    c.insert({_id: i, k: i % 500, v: i, s: big});
+}
+db.getLastError();
+
+var pipeline = [{$group: {_id: '$k',
+                          sum: {$sum: '$v'},
+                          avg: {$avg: '$v'},
+                          first: {$first: '$v'},
+                          last: {$last: '$v'},
+                          max: {$max: '$s'},
+                          pushed: {$push: '$v'},
+                          set: {$addToSet: '$k'}}},
+                {$sort: {_id: 1}}];
+
+var inMemory = db.runCommand({aggregate: c.getName(), pipeline: pipeline});
+assert.commandWorked(inMemory);
+
+var old = db.adminCommand({getParameter: 1, aggregationGroupMaxMemoryBytes: 1});
+assert.commandWorked(db.adminCommand({setParameter: 1, aggregationGroupMaxMemoryBytes: 64 * 1024}));
+
+var spilled = db.runCommand({aggregate: c.getName(), pipeline: pipeline, allowDiskUse: true});
+assert.commandWorked(spilled);
+assert.eq(500, spilled.result.length);
+assert.eq(inMemory.result, spilled.result);
+
+// So little memory that the spilled partitions have to be split again.
+assert.commandWorked(db.adminCommand({setParameter: 1, aggregationGroupMaxMemoryBytes: 4 * 1024}));
+spilled = db.runCommand({aggregate: c.getName(), pipeline: pipeline, allowDiskUse: true});
+assert.commandWorked(spilled);
+assert.eq(inMemory.result, spilled.result);
+
+// allowDiskUse must be a bool
+assert.commandFailed(db.runCommand({aggregate: c.getName(), pipeline: pipeline, allowDiskUse: 1}));
+
+assert.commandWorked(db.adminCommand({setParameter: 1,
+                                      aggregationGroupMaxMemoryBytes: old.aggregationGroupMaxMemoryBytes}));
@@ -0,0 +1,71 @@
+// Shards return their part of a sharded aggregation as cursors, so it isn't limited to one 16MB
+// reply, and mongos merges sorted shard output as it streams in.
+
+var st = new ShardingTest({ shards: 2, mongos: 1, other: { chunksize: 1 } });
+st.stopBalancer();
+
+st.adminCommand({ enablesharding: "aggCursors" });
+var db = st.getDB("aggCursors");
+var coll = db.ts;
+st.adminCommand({ shardcollection: coll.getFullName(), key: { _id: 1 } });
+
+var nItems = 40000;
+var pad = new Array(1024).join("p");
+for (var i = 0; i < nItems; i++) {
+    // x is a permutation of 0..nItems-1, spread over both shards.
+    coll.insert({ _id: i, x: (i * 7919) % nItems, y: i % 10, pad: pad });
+}
+assert.eq(null, db.getLastError());
+
+// Put half of the documents on each shard.
+st.adminCommand({ split: coll.getFullName(), middle: { _id: nItems / 2 } });
+var other = st.getOther(st.getServer("aggCursors"));
+st.adminCommand({ moveChunk: coll.getFullName(), find: { _id: 0 }, to: other.name });
+assert.lt(0, other.getDB("aggCursors").ts.count());
+
+function aggregate(pipeline) {
+    var res = db.runCommand({ aggregate: coll.getName(), pipeline: pipeline });
+    assert.commandWorked(res);
+    return res.result;
+}
+
+// Each shard sends about 20MB of sorted documents, more than fits in one reply.
+var sorted = aggregate([ { $sort: { x: 1 } }, { $project: { _id: 0, x: 1 } } ]);
+assert.eq(nItems, sorted.length);
+for (var i = 0; i < nItems; i++) {
+    assert.eq(i, sorted[i].x, "ascending merge out of order at " + i);
+}
+
+var descending = aggregate([ { $sort: { y: -1, x: 1 } }, { $project: { _id: 0, x: 1, y: 1 } } ]);
+assert.eq(nItems, descending.length);
+for (var i = 1; i < nItems; i++) {
+    var prev = descending[i - 1], cur = descending[i];
+    assert(prev.y > cur.y || (prev.y == cur.y && prev.x < cur.x),
+           "compound merge out of order at " + i + ": " + tojson(prev) + " " + tojson(cur));
+}
+
+// A limit stops the merge early; the shards' cursors are cleaned up.
+var top = aggregate([ { $sort: { x: -1 } }, { $limit: 5 }, { $project: { _id: 0, x: 1 } } ]);
+assert.eq([ { x: nItems - 1 }, { x: nItems - 2 }, { x: nItems - 3 }, { x: nItems - 4 },
+            { x: nItems - 5 } ], top);
+var skipped = aggregate([ { $sort: { x: 1 } }, { $skip: 100 }, { $limit: 3 },
+                          { $project: { _id: 0, x: 1 } } ]);
+assert.eq([ { x: 100 }, { x: 101 }, { x: 102 } ], skipped);
+
+// Unsorted shard output larger than a reply is streamed too.
+var grouped = aggregate([ { $limit: nItems },
+                          { $group: { _id: "$y", n: { $sum: 1 } } },
+                          { $sort: { _id: 1 } } ]);
+assert.eq(10, grouped.length);
+grouped.forEach(function(g) { assert.eq(nItems / 10, g.n, tojson(g)); });
+
+// No aggregation cursors are left open on the shards.
+assert.soon(function() {
+    var open = 0;
+    [ st.shard0, st.shard1 ].forEach(function(s) {
+        open += s.getDB("admin").serverStatus().cursors.totalOpen;
+    });
+    return open == 0;
+}, "shard cursors left open");
+
+st.stop();
@@ -0,0 +1,47 @@
+// Documents found through a non-clustering secondary index may be fetched
+// in sorted batches ($batchFetch or the queryBatchFetchPKs parameter); the
+// results and their order must be the same as fetching one at a time.
+
+t = db.batch_fetch;
+t.drop();
+
+// pk order is the reverse of the index order, so batches get re-sorted
+for (var i = 0; i < 5000; i++) {
+    t.insert({_id: i, a: 5000 - i, b: i % 7, m: [i % 3, (i % 3) + 10]});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1, a: -1});
+t.ensureIndex({m: 1});
+assert(!db.getLastError());
+
+function check(query, hint, sort) {
+    var plain = t.find(query).hint(hint).sort(sort || {}).toArray();
+    var batched = t.find(query).hint(hint).sort(sort || {})._addSpecial("$batchFetch", true).toArray();
+    assert.eq(plain, batched, tojson(query) + " " + tojson(hint));
+}
+
+check({a: {$gt: 100, $lt: 3000}}, {a: 1});
+check({a: {$gt: 100}}, {a: 1}, {a: -1});
+check({b: {$in: [1, 3, 5]}, a: {$gt: 2500}}, {b: 1, a: -1});
+check({b: {$in: [1, 3, 5]}, a: {$gt: 2500}, _id: {$mod: [4, 0]}}, {b: 1, a: -1});
+check({m: {$gte: 1, $lte: 11}}, {m: 1});
+// pks 7 apart are too spread out to prelock as one range, and pks 700 apart more so
+check({b: 3}, {b: 1, a: -1});
+check({b: 3, _id: {$mod: [100, 3]}}, {b: 1, a: -1});
+
+// also when turned on for every query.  Limited queries don't want the whole result, so they
+// still fetch one document at a time, with the same results.
+assert.commandWorked(db.adminCommand({setParameter: 1, queryBatchFetchPKs: true}));
+check({a: {$gt: 100, $lt: 3000}}, {a: 1});
+assert.eq(t.find({a: {$gt: 100}}).hint({a: 1}).limit(3).toArray(),
+          [{_id: 4899, a: 101, b: 4899 % 7, m: [0, 10]},
+           {_id: 4898, a: 102, b: 4898 % 7, m: [2, 12]},
+           {_id: 4897, a: 103, b: 4897 % 7, m: [1, 11]}]);
+// Updates and deletes never batch, but give the same results.
+t.update({a: {$gt: 4000}}, {$inc: {u: 1}}, false, true);
+assert(!db.getLastError());
+assert.eq(1000, t.find({u: 1}).count());
+t.remove({a: {$gt: 4990}});
+assert(!db.getLastError());
+assert.eq(4990, t.count());
+assert.commandWorked(db.adminCommand({setParameter: 1, queryBatchFetchPKs: false}));
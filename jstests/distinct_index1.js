@@ -34,16 +34,26 @@ assert.eq( 1000 , x.stats.nscannedObjects , "AC3" )
 
 t.ensureIndex( { a : 1 } )
 
+// A skip scan of the index looks at one key per value, and doesn't count documents.
 x = d( "a" );
-assert.eq( 1000 , x.stats.n , "BA1" )
-assert.eq( 1000 , x.stats.nscanned , "BA2" )
+assert.eq( "SkipScanCursor a_1" , x.stats.cursor , "BA0" )
+assert.eq( x.values.length , x.stats.nDistinct , "BA1" )
+assert.eq( x.values.length , x.stats.nscanned , "BA2" )
 assert.eq( 0 , x.stats.nscannedObjects , "BA3" )
 
 x = d( "a" , { a : { $gt : 5 } } );
-assert.eq( 398 , x.stats.n , "BB1" )
-assert.eq( 398 , x.stats.nscanned , "BB2" )
+assert.eq( [ 6 , 7 , 8 , 9 ] , x.values , "BB0" )
+assert.eq( 4 , x.stats.nDistinct , "BB1" )
+assert.eq( 4 , x.stats.nscanned , "BB2" )
 assert.eq( 0 , x.stats.nscannedObjects , "BB3" )
 
+// Without it every key is read, and n counts the documents.
+x = t.runCommand( "distinct" , { key : "a" , query : { a : { $gt : 5 } } , skipScan : false } );
+assert.eq( [ 6 , 7 , 8 , 9 ] , x.values , "BD0" )
+assert.eq( 398 , x.stats.n , "BD1" )
+assert.eq( 398 , x.stats.nscanned , "BD2" )
+assert.eq( 0 , x.stats.nscannedObjects , "BD3" )
+
 x = d( "b" , { a : { $gt : 5 } } );
 assert.eq( 398 , x.stats.n , "BC1" )
 assert.eq( 398 , x.stats.nscanned , "BC2" )
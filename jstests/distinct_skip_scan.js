@@ -0,0 +1,88 @@
+// distinct on a field leading an index, and equality queries on a later field of a compound
+// index, skip from one leading value to the next instead of reading every key.
+
+t = db.distinct_skip_scan;
+t.drop();
+
+for ( var i = 0; i < 5000; i++ ) {
+    t.insert( { a : i % 5 , b : i % 100 , c : i } );
+}
+t.insert( { b : -1 } );
+t.insert( { a : null , b : -2 } );
+t.insert( { a : 2.0 , b : -3 } );
+t.insert( { a : "x" , b : -4 } );
+t.ensureIndex( { a : 1 , b : 1 } );
+assert.eq( null , db.getLastError() );
+
+function distinct( key , query ) {
+    var res = t.runCommand( "distinct" , { key : key , query : query || {} } );
+    assert.commandWorked( res );
+    return res;
+}
+
+// The same values the documents give, read off the index.
+var res = distinct( "a" );
+assert.eq( "SkipScanCursor a_1_b_1" , res.stats.cursor );
+assert.eq( [ null , 0 , 1 , 2 , 3 , 4 , "x" ] , res.values );
+assert.eq( 7 , res.stats.nscanned );
+// only a document with a null key is read, to tell a null value from a missing field
+assert.eq( 1 , res.stats.nscannedObjects );
+// the documents aren't counted
+assert.eq( 7 , res.stats.nDistinct );
+assert.isnull( res.stats.n );
+
+// With skipScan : false every key is read, and n counts the documents.
+res = t.runCommand( "distinct" , { key : "a" , skipScan : false } );
+assert.neq( "SkipScanCursor a_1_b_1" , res.stats.cursor );
+assert.eq( 5004 , res.stats.n );
+assert.eq( [ null , 0 , 1 , 2 , 3 , 4 , "x" ] , res.values );
+
+// A document missing the field gives no value, whichever way it is read.
+t.remove( { a : null , b : -2 } );
+res = distinct( "a" );
+assert.eq( "SkipScanCursor a_1_b_1" , res.stats.cursor );
+assert.eq( [ 0 , 1 , 2 , 3 , 4 , "x" ] , res.values );
+assert.eq( 1 , res.stats.nscannedObjects );
+var tableScan = t.runCommand( "distinct" , { key : "a" , query : { c : { $not : { $type : 2 } } } } );
+assert.eq( "BasicCursor" , tableScan.stats.cursor );
+assert.eq( res.values , tableScan.values.sort() );
+t.insert( { a : null , b : -2 } );
+
+res = distinct( "a" , { a : { $gte : 2 , $lt : 4 } } );
+assert.eq( [ 2 , 3 ] , res.values );
+assert.eq( 2 , res.stats.nscanned );
+
+res = distinct( "a" , { a : { $in : [ 1 , 4 , 7 ] } } );
+assert.eq( [ 1 , 4 ] , res.values );
+
+// Queries on anything else still look at the documents.
+res = distinct( "a" , { c : { $lt : 10 } } );
+assert.neq( "SkipScanCursor a_1_b_1" , res.stats.cursor );
+assert.eq( [ 0 , 1 , 2 , 3 , 4 ] , res.values.sort() );
+res = distinct( "b" );
+assert.neq( "SkipScanCursor a_1_b_1" , res.stats.cursor );
+assert.eq( 104 , res.values.length );
+
+// A multikey index can't be skipped through.
+t.insert( { a : [ 10 , 11 ] } );
+res = distinct( "a" );
+assert.neq( "SkipScanCursor a_1_b_1" , res.stats.cursor );
+assert.eq( 9 , res.values.length );
+t.remove( { a : [ 10 , 11 ] } );
+t.dropIndexes();
+t.ensureIndex( { a : 1 , b : 1 } );
+
+// An equality on b alone races a skip scan of a_1_b_1 against a table scan.
+var explain = t.find( { b : 7 } ).explain( true );
+printjson( explain );
+assert.eq( 50 , explain.n );
+var skipScan = explain.allPlans.filter( function( p ) { return p.cursor == "IndexCursor a_1_b_1"; } );
+assert.eq( 1 , skipScan.length , tojson( explain.allPlans ) );
+assert.eq( 2 , explain.allPlans.length );
+assert.eq( 50 , t.find( { b : 7 } ).hint( { a : 1 , b : 1 } ).itcount() );
+// It seeks rather than reads each key, so it looks at few more keys than it returns.
+var hinted = t.find( { b : 7 } ).hint( { a : 1 , b : 1 } ).explain();
+assert.lt( hinted.nscanned , 100 , tojson( hinted ) );
+
+// The skip scan wins with so few values of a.
+assert.eq( "IndexCursor a_1_b_1" , t.find( { b : 7 } ).explain().cursor );
@@ -0,0 +1,58 @@
+// Hashed indexes built with {hashVersion: 1} hash with MurmurHash3 instead of md5.
+
+var t = db.jstests_hashindex_murmur;
+t.drop();
+
+function hash( v , hashVersion ) {
+    var res = db.runCommand( { _hashBSONElement : v , hashVersion : hashVersion } );
+    assert.commandWorked( res );
+    assert.eq( hashVersion , res.hashVersion );
+    return res.out;
+}
+
+// the values hashed indexes store, they must never change
+assert.eq( NumberLong( "-944302157085130861" ) , hash( 42 , 0 ) );
+assert.eq( NumberLong( "8715208212397937794" ) , hash( 42 , 1 ) );
+assert.eq( hash( NumberInt( 3 ) , 1 ) , hash( NumberLong( 3 ) , 1 ) );
+assert.eq( hash( 3 , 1 ) , hash( 3.2 , 1 ) );
+assert.commandFailed( db.runCommand( { _hashBSONElement : 42 , hashVersion : 2 } ) );
+
+// unknown hash versions are rejected
+t.ensureIndex( { a : "hashed" } , { hashVersion : 2 } );
+assert.eq( 17417 , db.getLastErrorObj().code );
+t.ensureIndex( { a : "hashed" } , { hashVersion : -1 } );
+assert.eq( 17417 , db.getLastErrorObj().code );
+assert.eq( 1 , t.getIndexes().length );
+
+var spec = { a : "hashed" };
+t.ensureIndex( spec , { hashVersion : 1 } );
+assert.eq( null , db.getLastError() );
+assert.eq( 1 , t.getIndexes().filter( function( i ) { return i.hashVersion == 1; } ).length );
+
+for ( var i = 0; i < 100; i++ ) {
+    t.insert( { a : i } );
+}
+t.insert( { a : 3.1 } );
+t.insert( { a : { b : [ 1 , 2 ] } } );
+assert.eq( null , db.getLastError() );
+
+assert.eq( "IndexCursor a_hashed" , t.find( { a : 1 } ).explain().cursor );
+assert.eq( 102 , t.find().hint( spec ).itcount() );
+for ( var i = 0; i < 100; i += 7 ) {
+    assert.eq( 1 , t.find( { a : i } ).hint( spec ).itcount() , "lookup of " + i );
+}
+assert.eq( 3.1 , t.findOne( { a : 3.1 } ).a );
+assert.eq( 2 , t.find( { a : { $in : [ 3 , 3.1 ] } } ).hint( spec ).itcount() );
+assert.eq( 1 , t.find( { a : { b : [ 1 , 2 ] } } ).hint( spec ).itcount() );
+
+// updates and removes find the murmur keys
+t.update( { a : 5 } , { $set : { a : 500 } } );
+assert.eq( null , db.getLastError() );
+assert.eq( 0 , t.find( { a : 5 } ).hint( spec ).itcount() );
+assert.eq( 1 , t.find( { a : 500 } ).hint( spec ).itcount() );
+t.remove( { a : 500 } );
+assert.eq( 0 , t.find( { a : 500 } ).hint( spec ).itcount() );
+assert.eq( t.find().itcount() , t.find().hint( spec ).itcount() );
+
+assert( t.validate().valid );
+t.drop();
@@ -0,0 +1,71 @@
+// Equality queries on fields with separate indexes race a plan intersecting the indexes' pks.
+
+t = db.jstests_index_intersection;
+t.drop();
+
+// Each status and each owner matches many documents, but few match both.
+for ( var i = 0; i < 2000; i++ ) {
+    t.insert( { _id : i , status : i % 2 , owner : Math.floor( i / 10 ) % 20 , tags : [ i % 3 , 10 ] } );
+}
+t.ensureIndex( { status : 1 } );
+t.ensureIndex( { owner : 1 } );
+assert.eq( null , db.getLastError() );
+
+function check( query ) {
+    var expected = t.find( query ).hint( { $natural : 1 } ).sort( { _id : 1 } ).toArray();
+    assert.eq( expected , t.find( query ).sort( { _id : 1 } ).toArray() , tojson( query ) );
+    assert.eq( expected.length , t.find( query ).itcount() , tojson( query ) );
+    assert.eq( expected.length , t.count( query ) , tojson( query ) );
+    return expected.length;
+}
+
+var explain = t.find( { status : 1 , owner : 3 } ).explain( true );
+printjson( explain );
+var intersection = explain.allPlans.filter( function( p ) {
+    return p.cursor == "IndexIntersectionCursor status_1,owner_1";
+} );
+assert.eq( 1 , intersection.length , tojson( explain.allPlans ) );
+assert.eq( 3 , explain.allPlans.length );
+assert.eq( 50 , explain.n );
+assert.eq( [ [ 1 , 1 ] ] , intersection[ 0 ].indexBounds.status_1.status );
+assert.eq( [ [ 3 , 3 ] ] , intersection[ 0 ].indexBounds.owner_1.owner );
+
+// It returns the same documents as the other plans.
+assert.eq( 50 , check( { status : 1 , owner : 3 } ) );
+assert.eq( 0 , check( { status : 2 , owner : 3 } ) );
+assert.eq( 0 , check( { status : 1 , owner : 30 } ) );
+assert.eq( 50 , check( { status : 0 , owner : 4 } ) );
+
+// Other fields of the query are matched against the documents.
+assert.eq( 25 , check( { status : 1 , owner : 3 , _id : { $lt : 1000 } } ) );
+
+// Multikey indexes hold each pk once per value, so they can be intersected too.
+t.ensureIndex( { tags : 1 } );
+explain = t.find( { status : 1 , owner : 3 , tags : 2 } ).explain( true );
+assert.eq( 1 , explain.allPlans.filter( function( p ) {
+    return p.cursor == "IndexIntersectionCursor status_1,owner_1,tags_1";
+} ).length , tojson( explain.allPlans ) );
+check( { status : 1 , owner : 3 , tags : 2 } );
+check( { status : 1 , tags : 10 } );
+
+// Ranges, sorts and $or clauses leave the single index plans to themselves.
+function noIntersection( cursor ) {
+    var explain = cursor.explain( true );
+    ( explain.clauses || [ explain ] ).forEach( function( c ) {
+        c.allPlans.forEach( function( p ) {
+            assert( !/^IndexIntersectionCursor/.test( p.cursor ) , tojson( explain ) );
+        } );
+    } );
+}
+noIntersection( t.find( { status : 1 , owner : { $gt : 3 } } ) );
+noIntersection( t.find( { status : 1 , owner : { $in : [ 3 , 4 ] } } ) );
+noIntersection( t.find( { status : 1 , owner : 3 } ).sort( { owner : 1 } ) );
+noIntersection( t.find( { $or : [ { status : 1 , owner : 3 } , { status : 0 , owner : 4 } ] } ) );
+assert.eq( 100 , check( { $or : [ { status : 1 , owner : 3 } , { status : 0 , owner : 4 } ] } ) );
+
+// Updates and removes find their documents through it as well.
+t.update( { status : 1 , owner : 3 } , { $set : { seen : true } } , false , true );
+assert.eq( 50 , t.count( { seen : true } ) );
+t.remove( { status : 1 , owner : 3 } );
+assert.eq( 0 , check( { status : 1 , owner : 3 } ) );
+assert.eq( 1950 , t.count() );
@@ -0,0 +1,71 @@
+// Indexes created with keyFormat 2 store memcmp-comparable keys. Other indexes
+// keep the old format, and query results must not depend on it.
+
+var t = db.index_key_format;
+t.drop();
+
+t.insert({_id: 0});
+t.ensureIndex({a: 1, b: -1}, {keyFormat: 2});
+t.ensureIndex({c: 1});
+t.ensureIndex({e: 1}, {keyFormat: 1});
+assert.eq(null, db.getLastError());
+
+var formats = {};
+t.getIndexes().forEach(function(idx) { formats[idx.name] = idx.keyFormat; });
+assert.eq(undefined, formats["_id_"]);
+assert.eq(2, formats["a_1_b_-1"]);
+assert.eq(undefined, formats["c_1"]);
+assert.eq(1, formats["e_1"]);
+
+t.ensureIndex({d: 1}, {keyFormat: 3});
+assert.neq(null, db.getLastError(), "keyFormat 3 should be rejected");
+
+// Values of every type, including ones (objects, timestamps) that
+// fall back to the old format inside a keyFormat 2 index.
+var values = [MinKey, null, -Infinity, -1e300, NumberLong(-5), -2.5, 0, NumberInt(1), 1.5,
+              NumberLong("9007199254740993"), 9007199254740992, NumberLong("9007199254740995"),
+              NumberLong("9223372036854775807"), Math.pow(2, 63), Infinity, "", "a", "a\u0000", "ab",
+              {x: 1}, BinData(0, "AAAA"), ObjectId(), false, true, new Date(-1000),
+              new Date(0), Timestamp(1, 1), MaxKey];
+t.remove({});
+for (var i = 0; i < values.length; i++) {
+    t.insert({_id: i, a: values[i], b: values.length - i, c: values[i]});
+}
+assert.eq(null, db.getLastError());
+
+assert.eq(values.length, t.count());
+
+// Both formats return the same order, which is the order without any index.
+var ids = function(cursor) { return cursor.toArray().map(function(o) { return o._id; }); };
+var unindexed = ids(t.find({}, {_id: 1}).sort({a: 1, b: -1}).hint({$natural: 1}));
+assert.eq(unindexed, ids(t.find({}, {_id: 1}).sort({a: 1, b: -1}).hint({a: 1, b: -1})));
+assert.eq(unindexed, ids(t.find({}, {_id: 1}).sort({c: 1}).hint({c: 1})));
+assert.eq(unindexed.reverse(), ids(t.find({}, {_id: 1}).sort({a: -1, b: 1}).hint({a: 1, b: -1})));
+
+// Equality and range queries agree across formats, including numbers of different types.
+[0, 1, 1.5, 9007199254740992, NumberLong("9007199254740995"), Math.pow(2, 63),
+ "a", false, {x: 1}].forEach(function(v) {
+    assert.eq(t.find({c: v}).hint({c: 1}).count(), t.find({a: v}).hint({a: 1, b: -1}).count(), tojson(v));
+});
+assert.eq(t.find({c: {$gte: -3, $lt: 2}}).hint({c: 1}).count(),
+          t.find({a: {$gte: -3, $lt: 2}}).hint({a: 1, b: -1}).count());
+assert.eq(4, t.find({a: {$gte: -3, $lt: 2}}).hint({a: 1, b: -1}).count());
+// Longs beyond 2^53 compare with doubles after rounding, in both formats.
+assert.eq(2, t.find({a: 9007199254740992}).hint({a: 1, b: -1}).count());
+assert.eq(2, t.find({a: Math.pow(2, 63)}).hint({a: 1, b: -1}).count());
+
+// Covered reads of an old format index keep the stored numeric type.
+var covered = t.find({c: NumberLong(-5)}, {_id: 0, c: 1}).hint({c: 1}).next();
+assert.eq("NumberLong(-5)", tojson(covered.c));
+
+// Unique indexes treat numerically equal values of different types as duplicates.
+t.drop();
+t.ensureIndex({u: 1}, {unique: true, keyFormat: 2});
+t.insert({u: 5});
+t.insert({u: NumberLong(5)});
+assert.neq(null, db.getLastError());
+t.insert({u: 5.0});
+assert.neq(null, db.getLastError());
+assert.eq(1, t.count());
+
+t.drop();
@@ -0,0 +1,66 @@
+// Latency percentiles per kind of operation, in serverStatus, and per collection, in top.
+
+t = db.jstests_latency_histograms;
+t.drop();
+
+function opLatency( kind , percentiles ) {
+    var cmd = { serverStatus : 1 };
+    if ( percentiles ) {
+        cmd.latency = { percentiles : percentiles };
+    }
+    var res = db.adminCommand( cmd );
+    assert.commandWorked( res );
+    return res.latency.ops[ kind ];
+}
+
+var insertsBefore = opLatency( "insert" ).count;
+for ( var i = 0; i < 100; i++ ) {
+    t.insert( { _id : i } );
+}
+assert.eq( null , db.getLastError() );
+for ( var i = 0; i < 10; i++ ) {
+    t.findOne( { _id : i } );
+}
+
+var inserts = opLatency( "insert" );
+assert.lte( insertsBefore + 100 , inserts.count , tojson( inserts ) );
+assert.lte( inserts.percentiles.p50 , inserts.percentiles.p99 , tojson( inserts ) );
+assert.lte( inserts.percentiles[ "p99.9" ] , inserts.maxMicros , tojson( inserts ) );
+assert.lte( 0 , inserts.totalMicros );
+
+// Other percentiles can be asked for.
+var custom = opLatency( "queries" , [ 10 , 99.99 ] );
+assert.eq( [ "p10" , "p99.99" ] , Object.keySet( custom.percentiles ) , tojson( custom ) );
+assert.throws( function() { opLatency( "queries" , [ 150 ] ); } );
+
+var status = db.adminCommand( { serverStatus : 1 } ).latency;
+[ "lockWait" , "storageCommit" , "oplogApply" ].forEach( function( name ) {
+    assert( status[ name ] , tojson( status ) );
+    assert.lte( 0 , status[ name ].count );
+} );
+assert.lt( 0 , status.lockWait.count , tojson( status ) );
+assert.lt( 0 , status.storageCommit.count , tojson( status ) );
+
+// top only reports them when asked.
+var top = db.adminCommand( { top : 1 } ).totals[ t.getFullName() ];
+assert( top , "not in top" );
+assert.isnull( top.latency );
+
+top = db.adminCommand( { top : 1 , latency : true } ).totals[ t.getFullName() ];
+assert.eq( 100 , top.latency.insert.count , tojson( top ) );
+assert.eq( 10 , top.latency.queries.count , tojson( top ) );
+assert.lte( 110 , top.latency.total.count , tojson( top ) );
+assert.isnull( top.latency.remove , tojson( top ) );
+assert.eq( [ "p50" , "p95" , "p99" , "p99.9" ] , Object.keySet( top.latency.insert.percentiles ) );
+
+top = db.adminCommand( { top : 1 , percentiles : [ 75 ] } ).totals[ t.getFullName() ];
+assert.eq( [ "p75" ] , Object.keySet( top.latency.total.percentiles ) , tojson( top ) );
+assert.commandFailed( db.adminCommand( { top : 1 , percentiles : "99" } ) );
+
+// Dropping the collection forgets its histograms.
+t.drop();
+t.insert( { _id : 0 } );
+assert.eq( null , db.getLastError() );
+top = db.adminCommand( { top : 1 , latency : true } ).totals[ t.getFullName() ];
+assert.eq( 1 , top.latency.insert.count , tojson( top ) );
+t.drop();
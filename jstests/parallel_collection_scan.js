@@ -0,0 +1,73 @@
+// parallelCollectionScan hands out cursors over disjoint pieces of a collection which, drained
+// together, return every document exactly once.
+
+var t = db.parallel_collection_scan;
+t.drop();
+
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName(), numCursors: 2}));
+
+var pad = new Array(1024).join("x");
+for (var i = 0; i < 5000; i++) {
+    t.insert({_id: i, pad: pad});
+}
+assert.eq(null, db.getLastError());
+
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName()}));
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName(), numCursors: 0}));
+assert.commandFailed(db.runCommand({parallelCollectionScan: t.getName(), numCursors: 10001}));
+
+var drain = function(res, n) {
+    assert.commandWorked(res);
+    assert.lte(1, res.cursors.length, tojson(res));
+    assert.gte(n, res.cursors.length, tojson(res));
+    var seen = {};
+    var total = 0;
+    res.cursors.forEach(function(c) {
+        var cursor = new DBCommandCursor(db.getMongo(), c, 100);
+        var last = null;
+        while (cursor.hasNext()) {
+            var id = cursor.next()._id;
+            assert(!seen[id], "saw " + id + " twice");
+            if (last !== null) {
+                assert.lt(last, id, "each cursor returns its range in primary key order");
+            }
+            last = id;
+            seen[id] = true;
+            total++;
+        }
+    });
+    return total;
+};
+
+[1, 2, 4, 16].forEach(function(n) {
+    assert.eq(5000, drain(db.runCommand({parallelCollectionScan: t.getName(), numCursors: n}), n));
+});
+
+// Each cursor keeps its own snapshot, taken when the command ran.
+var res = db.runCommand({parallelCollectionScan: t.getName(), numCursors: 4});
+t.insert({_id: 5000});
+t.remove({_id: 0});
+assert.eq(5000, drain(res, 4));
+
+// Partitioned collections are cut at partition boundaries.
+t.drop();
+assert.commandWorked(db.runCommand({create: t.getName(), partitioned: true}));
+for (var p = 0; p < 4; p++) {
+    for (var i = 0; i < 100; i++) {
+        t.insert({_id: p * 100 + i});
+    }
+    if (p < 3) {
+        assert.commandWorked(db.runCommand({addPartition: t.getName()}));
+    }
+}
+assert.eq(null, db.getLastError());
+
+res = db.runCommand({parallelCollectionScan: t.getName(), numCursors: 2});
+assert.eq(2, res.cursors.length, tojson(res));
+assert.eq(400, drain(res, 2));
+
+res = db.runCommand({parallelCollectionScan: t.getName(), numCursors: 10});
+assert.eq(4, res.cursors.length, tojson(res));
+assert.eq(400, drain(res, 4));
+
+t.drop();
@@ -0,0 +1,51 @@
+// planCacheListShapes reports the collection's cached plans and their statistics, and
+// planCacheClear drops all of them or the one for a single query shape.
+
+var t = db.plan_cache_shapes;
+t.drop();
+
+for (var i = 0; i < 100; i++) {
+    t.insert({a: i, b: i % 10});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1});
+assert.eq(null, db.getLastError());
+
+var shapes = function() {
+    var res = db.runCommand({planCacheListShapes: t.getName()});
+    assert.commandWorked(res);
+    return res.shapes;
+};
+
+assert.eq(0, shapes().length);
+
+// Both shapes get a plan cached, and repeating a query hits the cache.
+assert.eq(1, t.find({a: 5, b: 5}).itcount());
+assert.eq(1, t.find({a: 6, b: 6}).itcount());
+assert.eq(10, t.find({b: 3}).sort({a: 1}).itcount());
+
+var s = shapes();
+assert.eq(2, s.length, tojson(s));
+s.forEach(function(shape) {
+    assert(shape.query, tojson(shape));
+    assert(shape.plan, tojson(shape));
+    assert(shape.nscannedHistory.length > 0, tojson(shape));
+    assert.lte(0, shape.avgMicros, tojson(shape));
+});
+var eq = s.filter(function(shape) { return shape.query.a == "Equality"; })[0];
+assert.eq("Equality", eq.query.b, tojson(eq));
+assert.lte(1, eq.hits, tojson(eq));
+
+// Clearing one shape leaves the other.
+assert.commandWorked(db.runCommand({planCacheClear: t.getName(), query: {b: 1}, sort: {a: 1}}));
+s = shapes();
+assert.eq(1, s.length, tojson(s));
+assert.eq("Equality", s[0].query.a, tojson(s));
+
+// Clearing without a query drops everything.
+assert.commandWorked(db.runCommand({planCacheClear: t.getName()}));
+assert.eq(0, shapes().length);
+
+assert.commandFailed(db.runCommand({planCacheListShapes: "plan_cache_shapes_missing"}));
+
+t.drop();
@@ -0,0 +1,62 @@
+// Profile entries are written in the background, sampled by shape, and visible to the next read.
+
+var stddb = db;
+var db = db.getSisterDB( "profile_sampling" );
+
+function profilerMetrics() {
+    return db.adminCommand( { serverStatus : 1 } ).metrics.profiler;
+}
+
+try {
+    db.dropDatabase();
+    var t = db.foo;
+    t.insert( { x : 1 , y : 1 } );
+    assert.eq( null , db.getLastError() );
+
+    var before = profilerMetrics();
+    assert.lte( 0 , before.dropped , tojson( before ) );
+
+    db.setProfilingLevel( 2 );
+    for ( var i = 0; i < 20; i++ ) {
+        t.findOne( { x : i } );
+    }
+    // Reading system.profile waits for the queued entries.
+    assert.eq( 20 , db.system.profile.find( { op : "query" , ns : t.getFullName() } ).itcount() );
+    assert.eq( 20 , db.system.profile.count( { op : "query" , ns : t.getFullName() } ) );
+    assert.lte( before.written + 20 , profilerMetrics().written );
+
+    // They stay in order.
+    var entries = db.system.profile.find( { op : "query" , ns : t.getFullName() } ).toArray();
+    for ( var i = 0; i < entries.length; i++ ) {
+        assert.eq( i , entries[ i ].query.x , tojson( entries[ i ] ) );
+        assert.isnull( entries[ i ].sampleRate );
+    }
+
+    // With sampling, 1 in 10 ops of each shape is profiled, whatever the values in it are.
+    db.setProfilingLevel( 0 );
+    db.system.profile.drop();
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , profileSampleRate : 10 } ) );
+    db.setProfilingLevel( 2 );
+    for ( var i = 0; i < 100; i++ ) {
+        t.findOne( { x : i } );
+        t.findOne( { y : i , x : i } );
+    }
+    db.setProfilingLevel( 0 );
+
+    [ { x : { $exists : true } , y : { $exists : false } } ,
+      { x : { $exists : true } , y : { $exists : true } } ].forEach( function( shape ) {
+        var query = { op : "query" , ns : t.getFullName() };
+        for ( var f in shape ) {
+            query[ "query." + f ] = shape[ f ];
+        }
+        var sampled = db.system.profile.find( query ).toArray();
+        assert.gte( sampled.length , 9 , tojson( sampled ) );
+        assert.lte( sampled.length , 11 , tojson( sampled ) );
+        sampled.forEach( function( e ) { assert.eq( 10 , e.sampleRate , tojson( e ) ); } );
+    } );
+}
+finally {
+    db.adminCommand( { setParameter : 1 , profileSampleRate : 1 } );
+    db.setProfilingLevel( 0 );
+    db = stddb;
+}
@@ -0,0 +1,74 @@
+// Initial sync copies collections in parallel from one snapshot, bulk loading the ones it can.
+
+var rt = new ReplSetTest( { name : "initial_sync_parallel" , nodes: 1 } );
+rt.startSet();
+rt.initiate();
+var master = rt.getMaster();
+var md = master.getDB("d");
+
+// a bulk loadable collection with secondary indexes
+md.big.ensureIndex({a: 1});
+md.big.ensureIndex({b: 1, a: -1}, {unique: true});
+for (var i = 0; i < 20000; i++) {
+    md.big.insert({_id: i, a: i % 100, b: i});
+}
+// ones that have to be inserted row by row
+md.createCollection("capped", {capped: true, size: 100000});
+for (var i = 0; i < 100; i++) {
+    md.capped.insert({x: i});
+}
+assert.commandWorked(md.runCommand({create: "part", partitioned: true}));
+md.part.insert({_id: 0});
+assert.commandWorked(md.runCommand({addPartition: "part"}));
+md.part.insert({_id: 1});
+// and a second database
+master.getDB("e").small.insert({y: 1});
+assert.eq(null, md.getLastError());
+
+// The snapshot command hands out one cursor per collection, plus the local namespaces asked for.
+var res = master.getDB("admin").runCommand({replSetInitialSyncSnapshot: 1, namespaces: ["local.oplog.rs"]});
+assert.commandWorked(res);
+var byNs = {};
+res.collections.forEach(function(c) { byNs[c.ns] = c; });
+assert(byNs["d.big"] && byNs["d.capped"] && byNs["d.part"] && byNs["e.small"] && byNs["local.oplog.rs"], tojson(res));
+assert(!byNs["local.replInfo"], "only the local namespaces asked for");
+assert.eq(3, byNs["d.big"].indexes.length);
+assert.eq(2, byNs["d.part"].partitions.length);
+assert.eq(1, master.getDB("admin").runCommand({replSetInitialSyncSnapshot: 1, keepAlive: [byNs["d.big"].cursor]}).found);
+
+// Writes after the snapshot aren't seen by its cursors.
+md.big.remove({_id: 0});
+assert.eq(null, md.getLastError());
+var drain = function(c) {
+    return new DBCommandCursor(master, {cursor: {id: c.cursor, ns: c.ns, firstBatch: []}, ok: 1}).itcount();
+};
+assert.eq(20000, drain(byNs["d.big"]));
+assert.eq(100, drain(byNs["d.capped"]));
+res.collections.forEach(function(c) {
+    if (c.ns != "d.big" && c.ns != "d.capped") {
+        drain(c);
+    }
+});
+
+// Add a member, which syncs with the parallel cloner.
+var slave = rt.add();
+rt.reInitiate();
+rt.awaitReplication();
+slave.setSlaveOk();
+var sd = slave.getDB("d");
+
+assert.eq(md.big.count(), sd.big.count());
+assert.eq(md.big.getIndexes().length, sd.big.getIndexes().length);
+assert.eq(md.big.find({a: 5}).hint({a: 1}).count(), sd.big.find({a: 5}).hint({a: 1}).count());
+assert.eq(md.capped.find().sort({$natural: 1}).toArray(), sd.capped.find().sort({$natural: 1}).toArray());
+assert.eq(2, sd.runCommand({getPartitionInfo: "part"}).numPartitions);
+assert.eq(2, sd.part.count());
+assert.eq(1, slave.getDB("e").small.count());
+
+// The new member keeps replicating.
+md.big.insert({_id: 20000, a: 0, b: 20000});
+assert.eq(null, md.getLastError());
+rt.awaitReplication();
+assert.eq(md.big.count(), sd.big.count());
+
+rt.stopSet();
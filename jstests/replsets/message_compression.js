@@ -0,0 +1,42 @@
+/**
+ * Test that replication negotiates message compression and that compressed traffic
+ * shows up in serverStatus
+ */
+var rt = new ReplSetTest( { name : "message_compression" , nodes: 2, oplogSize: 100 } );
+rt.startSet()
+rt.initiate()
+
+var primary = rt.getMaster();
+var secondary = rt.getSecondary();
+
+// an isMaster offering compression gets one picked, and the reply is still readable
+var res = primary.getDB("admin").runCommand({ isMaster: 1, compression: ["zlib"] });
+assert.commandWorked(res);
+assert.eq(["zlib"], res.compression, tojson(res));
+
+// unknown compressors are ignored
+res = primary.getDB("admin").runCommand({ isMaster: 1, compression: ["nosuch"] });
+assert.commandWorked(res);
+assert.eq(undefined, res.compression, tojson(res));
+
+// large, repetitive documents compress well
+var pad = new Array(4096).join("x");
+var coll = primary.getDB("test").foo;
+for (var i = 0; i < 1000; i++) {
+    coll.insert({ _id: i, pad: pad });
+}
+assert.eq(null, primary.getDB("test").getLastError());
+rt.awaitReplication();
+assert.eq(1000, secondary.getDB("test").foo.count());
+
+var ss = secondary.getDB("admin").serverStatus();
+printjson(ss.network.compression);
+assert(ss.network.compression.in.messages > 0, "secondary got no compressed messages");
+assert.lt(ss.network.compression.in.compressedBytes, ss.network.compression.in.uncompressedBytes);
+assert.gt(ss.network.compression.in.ratio, 1);
+
+ss = primary.getDB("admin").serverStatus();
+printjson(ss.network.compression);
+assert(ss.network.compression.out.messages > 0, "primary sent no compressed messages");
+
+rt.stopSet();
@@ -0,0 +1,52 @@
+// A sharded aggregation read from secondaries fetches the rest of each shard's output from the
+// secondary that ran the command, where its cursor lives, not from the shard's primary.
+
+var st = new ShardingTest({ shards: 2, mongos: 1,
+                            other: { rs: true, rsOptions: { nodes: 2 } } });
+st.stopBalancer();
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var shards = mongos.getDB("config").shards.find().toArray();
+var coll = mongos.getCollection("aggSecondary.coll");
+
+assert.commandWorked(admin.runCommand({ enableSharding: "aggSecondary" }));
+printjson(admin.runCommand({ movePrimary: "aggSecondary", to: shards[0]._id }));
+assert.commandWorked(admin.runCommand({ shardCollection: coll.getFullName(), key: { _id: 1 } }));
+assert.commandWorked(admin.runCommand({ split: coll.getFullName(), middle: { _id: 0 } }));
+assert.commandWorked(admin.runCommand({ moveChunk: coll.getFullName(), find: { _id: 0 },
+                                        to: shards[1]._id }));
+
+// Well over one batch of output from each shard.
+var nItems = 4000;
+var pad = new Array(512).join("p");
+for (var i = -nItems / 2; i < nItems / 2; i++) {
+    coll.insert({ _id: i, pad: pad });
+}
+assert.eq(null, coll.getDB().getLastError());
+st.rs0.awaitReplication();
+st.rs1.awaitReplication();
+
+var conn = new Mongo(mongos.host);
+conn.setReadPref("secondary");
+var res = conn.getDB("aggSecondary").runCommand({
+    aggregate: "coll",
+    pipeline: [ { $project: { _id: 1 } }, { $sort: { _id: 1 } } ]
+});
+assert.commandWorked(res);
+assert.eq(nItems, res.result.length);
+for (var i = 0; i < nItems; i++) {
+    assert.eq(i - nItems / 2, res.result[i]._id);
+}
+
+// Every shard cursor was read to the end, on whichever member held it.
+[ st.rs0, st.rs1 ].forEach(function(rs) {
+    var secondary = rs.getSecondary();
+    secondary.setSlaveOk();
+    assert.soon(function() {
+        return secondary.getDB("admin").serverStatus().cursors.totalOpen == 0;
+    }, "cursor left open on " + secondary.host);
+    assert.eq(0, rs.getPrimary().getDB("admin").serverStatus().cursors.totalOpen);
+});
+
+st.stop();
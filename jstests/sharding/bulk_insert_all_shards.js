@@ -0,0 +1,69 @@
+//
+// Continue-on-error bulk inserts go to every shard at once, and still report errors the way a
+// shard-at-a-time insert does.
+//
+
+var st = new ShardingTest({ shards: 3, mongos: 1, other: { chunkSize: 1 } });
+st.stopBalancer();
+
+var mongos = st.s;
+var admin = mongos.getDB("admin");
+var coll = mongos.getCollection("test.bulk_all_shards");
+
+admin.runCommand({ enableSharding: "test" });
+printjson(admin.runCommand({ shardCollection: coll + "", key: { x: "hashed" }, numInitialChunks: 6 }));
+var shards = mongos.getDB("config").shards.find().toArray();
+assert.eq(3, mongos.getDB("config").chunks.distinct("shard", { ns: coll + "" }).length);
+
+var isDupKeyError = function(err) {
+    return /dup(licate)? key/.test(err + "");
+};
+
+var makeBatch = function(start, n) {
+    var docs = [];
+    for (var i = start; i < start + n; i++) {
+        docs.push({ _id: i, x: i });
+    }
+    return docs;
+};
+
+jsTest.log("Spread over every shard...");
+coll.insert(makeBatch(0, 1000), 1);
+assert.eq(null, coll.getDB().getLastError());
+assert.eq(1000, coll.find().itcount());
+shards.forEach(function(s) {
+    assert.lt(0, new Mongo(s.host).getCollection(coll + "").count(), "nothing on " + s._id);
+});
+
+jsTest.log("Duplicates in the middle don't stop the rest...");
+var batch = makeBatch(1000, 1000);
+batch[500] = { _id: 5, x: 5 };
+batch[700] = { _id: 7, x: 7 };
+coll.insert(batch, 1);
+var gle = coll.getDB().getLastErrorObj();
+printjson(gle);
+assert(isDupKeyError(gle.err), tojson(gle));
+assert.eq(1998, coll.find().itcount());
+
+jsTest.log("A mongos error wins over the shards'...");
+batch = makeBatch(2000, 100);
+batch[10] = { _id: 15, x: 15 };
+batch[50] = { _id: "no shard key" };
+coll.insert(batch, 1);
+gle = coll.getDB().getLastErrorObj();
+printjson(gle);
+assert.neq(null, gle.err);
+assert(!isDupKeyError(gle.err), tojson(gle));
+assert.eq(1998 + 98, coll.find().itcount());
+
+jsTest.log("More than 8MB for one shard takes several rounds...");
+var pad = new Array(100 * 1024).join("p");
+batch = [];
+for (var i = 3000; i < 3300; i++) {
+    batch.push({ _id: i, x: i, pad: pad });
+}
+coll.insert(batch, 1);
+assert.eq(null, coll.getDB().getLastError());
+assert.eq(1998 + 98 + 300, coll.find().itcount());
+
+st.stop();
@@ -0,0 +1,57 @@
+// Shard on a hashed key with {hashVersion: 1}, and make sure the chunks, the shard key index
+// and migrations all hash with MurmurHash3.
+
+var st = new ShardingTest( { shards : 2 , mongos : 1 } );
+var admin = st.s.getDB( "admin" );
+var config = st.s.getDB( "config" );
+var db = st.s.getDB( "test" );
+
+assert.commandWorked( admin.runCommand( { enablesharding : "test" } ) );
+st.stopBalancer();
+
+// only hashed shard keys can have a hash version, and only a valid one
+assert.commandFailed( admin.runCommand( { shardCollection : "test.ranged" , key : { a : 1 } ,
+                                          hashVersion : 1 } ) );
+assert.commandFailed( admin.runCommand( { shardCollection : "test.bad" , key : { a : "hashed" } ,
+                                          hashVersion : 7 } ) );
+
+// an existing md5 index can't back a murmur shard key
+db.md5.ensureIndex( { a : "hashed" } );
+assert.eq( null , db.getLastError() );
+assert.commandFailed( admin.runCommand( { shardCollection : "test.md5" , key : { a : "hashed" } ,
+                                          hashVersion : 1 } ) );
+
+assert.commandWorked( admin.runCommand( { shardCollection : "test.foo" , key : { a : "hashed" } ,
+                                          numInitialChunks : 4 , hashVersion : 1 } ) );
+assert.eq( 1 , config.collections.findOne( { _id : "test.foo" } ).hashVersion );
+assert.eq( 4 , config.chunks.count( { ns : "test.foo" } ) );
+var idx = db.system.indexes.findOne( { ns : "test.foo" , key : { a : "hashed" } } );
+assert.eq( 1 , idx.hashVersion , tojson( idx ) );
+
+for ( var i = 0; i < 1000; i++ ) {
+    db.foo.insert( { a : i } );
+}
+assert.eq( null , db.getLastError() );
+assert.eq( 1000 , db.foo.find().itcount() );
+
+// targeted queries land on the shard the murmur hash routes them to
+for ( var i = 0; i < 1000; i += 97 ) {
+    var explain = db.foo.find( { a : i } ).explain();
+    assert.eq( 1 , explain.n , tojson( explain ) );
+    assert.eq( 1 , Object.keySet( explain.shards ).length , tojson( explain ) );
+}
+
+// a migration only copies the documents in the chunk's murmur range
+var before = st.shard0.getDB( "test" ).foo.count() + st.shard1.getDB( "test" ).foo.count();
+assert.eq( 1000 , before );
+var chunk = config.chunks.findOne( { ns : "test.foo" } );
+var to = chunk.shard == "shard0000" ? "shard0001" : "shard0000";
+assert.commandWorked( admin.runCommand( { moveChunk : "test.foo" , bounds : [ chunk.min , chunk.max ] ,
+                                          to : to , _waitForDelete : true } ) );
+assert.eq( 1000 , st.shard0.getDB( "test" ).foo.count() + st.shard1.getDB( "test" ).foo.count() );
+assert.eq( 1000 , db.foo.find().itcount() );
+for ( var i = 0; i < 1000; i += 97 ) {
+    assert.eq( 1 , db.foo.find( { a : i } ).itcount() , "lost " + i );
+}
+
+st.stop();
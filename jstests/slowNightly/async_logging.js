@@ -0,0 +1,56 @@
+// With --setParameter asyncLogging=true, log lines are written by a background thread and still
+// show up in order, and dropped lines are counted in serverStatus.
+
+port = allocatePorts( 1 )[ 0 ];
+var baseName = "jstests_slowNightly_async_logging";
+var m = startMongod( "--port", port, "--dbpath", "/data/db/" + baseName,
+                     "--setParameter", "asyncLogging=true",
+                     "--setParameter", "asyncLogQueueSize=64",
+                     "--setParameter", "asyncLogOverflow=dropDebug" );
+var db = m.getDB( baseName );
+
+function globalLog() {
+    return db.adminCommand( { getLog : "global" } ).log.join( "\n" );
+}
+
+// slow ops are logged
+db.c.insert( { x : 1 } );
+assert.eq( null, db.getLastError() );
+for ( var i = 0; i < 3; i++ ) {
+    db.c.find( { $where : "sleep( 150 ); return this.x == 1 || '" + baseName + "_" + i + "';" } ).itcount();
+}
+assert.soon( function() {
+    var log = globalLog();
+    var at = [ 0, 1, 2 ].map( function( i ) { return log.indexOf( baseName + "_" + i ); } );
+    return at[ 0 ] >= 0 && at[ 0 ] < at[ 1 ] && at[ 1 ] < at[ 2 ];
+}, "slow queries not logged in order" );
+
+// A burst of verbose lines overflows the small queue while the writer thread is held up, and
+// only those are dropped: a slow query logged in the middle of the burst still makes it out.
+assert.eq( 0, db.adminCommand( { serverStatus : 1 } ).metrics.log.dropped );
+assert.commandWorked( db.adminCommand( { _testHooks : 1, pauseAsyncLogWriter : true } ) );
+assert.commandWorked( db.adminCommand( { setParameter : 1, logLevel : 5 } ) );
+for ( var i = 0; i < 200; i++ ) {
+    db.c.findOne( { x : i } );
+    if ( i == 100 ) {
+        db.c.find( { $where : "sleep( 150 ); return this.x == 1 || '" + baseName + "_burst';" } ).itcount();
+    }
+}
+assert.commandWorked( db.adminCommand( { setParameter : 1, logLevel : 0 } ) );
+assert.commandWorked( db.adminCommand( { _testHooks : 1, pauseAsyncLogWriter : false } ) );
+var dropped = db.adminCommand( { serverStatus : 1 } ).metrics.log.dropped;
+assert.lt( 0, dropped );
+print( "async logging dropped " + dropped + " lines" );
+assert.soon( function() { return globalLog().indexOf( baseName + "_burst" ) >= 0; },
+             "non-verbose line dropped" );
+
+db.c.find( { $where : "sleep( 150 ); return this.x == 1 || '" + baseName + "_done';" } ).itcount();
+assert.soon( function() { return globalLog().indexOf( baseName + "_done" ) >= 0; } );
+
+stopMongod( port );
+
+// bad parameters stop the server from starting
+port = allocatePorts( 1 )[ 0 ];
+assert.eq( 2, runMongoProgram( "mongod", "--port", port, "--dbpath", "/data/db/" + baseName,
+                               "--setParameter", "asyncLogging=true",
+                               "--setParameter", "asyncLogOverflow=sometimes" ) );
@@ -0,0 +1,75 @@
+// Serving connections from a small pool of worker threads
+// (--setParameter connectionWorkerThreads=N) keeps each connection's
+// state: getLastError, cursors and multi-statement transactions, and
+// doesn't hang when every worker is blocked on another connection.
+
+port = allocatePorts( 1 )[ 0 ];
+var baseName = "jstests_slowNightly_connection_worker_threads";
+var m = startMongod( "--port", port, "--dbpath", "/data/db/" + baseName,
+                     "--setParameter", "connectionWorkerThreads=2",
+                     "--setParameter", "lockTimeout=60000" );
+
+var conns = [];
+for ( var i = 0; i < 20; i++ ) {
+    conns.push( new Mongo( "127.0.0.1:" + port ) );
+}
+
+// interleave requests from many more connections than workers
+for ( var round = 0; round < 10; round++ ) {
+    for ( var i = 0; i < conns.length; i++ ) {
+        var t = conns[i].getDB( baseName ).getCollection( "c" + i );
+        t.insert( { _id: round } );
+        assert.eq( null, conns[i].getDB( baseName ).getLastError() );
+        t.insert( { _id: round } );
+        assert.eq( 11000, conns[i].getDB( baseName ).getLastErrorObj().code );
+    }
+}
+
+// cursors and transactions belong to their connection
+var cursors = [];
+for ( var i = 0; i < conns.length; i++ ) {
+    var db = conns[i].getDB( baseName );
+    assert.commandWorked( db.runCommand( { beginTransaction: 1 } ) );
+    db.getCollection( "c" + i ).insert( { _id: "txn" } );
+    cursors.push( db.getCollection( "c" + i ).find().batchSize( 2 ) );
+}
+for ( var i = 0; i < conns.length; i++ ) {
+    assert.eq( 11, cursors[i].itcount() );
+    var db = conns[i].getDB( baseName );
+    assert.commandWorked( db.runCommand( { rollbackTransaction: 1 } ) );
+    assert.eq( 10, db.getCollection( "c" + i ).count() );
+}
+
+// Requests that block on another connection don't starve the one that frees
+// them: with 2 workers, 3 connections wait on a row locked by a transaction
+// that another connection then commits.  The lock timeout is long, so the
+// commit only comes back quickly if the pool starts more workers.
+var holder = conns[0].getDB( baseName );
+assert.commandWorked( holder.runCommand( { beginTransaction: 1 } ) );
+holder.c0.insert( { _id: "blocker" } );
+assert.eq( null, holder.getLastError() );
+var waiters = [];
+for ( var i = 0; i < 3; i++ ) {
+    waiters.push( startParallelShell(
+        "db = db.getSiblingDB( '" + baseName + "' ); db.c0.insert( { _id: 'blocker' } ); " +
+        "db.getLastError();", port ) );
+}
+sleep( 2000 );
+var start = new Date();
+assert.commandWorked( holder.runCommand( { commitTransaction: 1 } ) );
+assert.lt( new Date() - start, 20000 );
+waiters.forEach( function( join ) { join(); } );
+assert.eq( 1, holder.c0.find( { _id: "blocker" } ).itcount() );
+
+// closing connections releases them
+var before = m.getDB( "admin" ).serverStatus().connections.current;
+for ( var i = 0; i < 10; i++ ) {
+    var c = new Mongo( "127.0.0.1:" + port );
+    c.getDB( baseName ).runCommand( { ping: 1 } );
+}
+gc();
+assert.soon( function() {
+    return m.getDB( "admin" ).serverStatus().connections.current <= before + 10;
+} );
+
+stopMongod( port );
@@ -0,0 +1,69 @@
+/**
+ * A partitioned collection with a partitionRetention policy gets partitions created ahead of the
+ * current time, and whole partitions dropped once they expire, by the TTL monitor (which runs
+ * every 60 seconds).
+ */
+
+var t = db.partition_retention;
+t.drop();
+
+// Malformed policies are rejected at creation.
+assert.commandFailed(db.runCommand({create: t.getName(), partitioned: true,
+                                    primaryKey: {ts: 1, _id: 1},
+                                    partitionRetention: {expireAfterSeconds: 3600}}));
+assert.commandFailed(db.runCommand({create: t.getName(), partitioned: true,
+                                    primaryKey: {ts: -1, _id: 1},
+                                    partitionRetention: {intervalSeconds: 3600,
+                                                         expireAfterSeconds: 3600}}));
+t.drop();
+
+// Keep the TTL monitor from adding partitions while the test adds its own.
+assert.commandWorked(db.adminCommand({setParameter: 1, ttlMonitorEnabled: false}));
+
+var hour = 3600 * 1000;
+var now = (new Date()).getTime();
+var thisHour = Math.floor(now / hour) * hour;
+
+// Hourly partitions, kept for five hours, with two hours created ahead.
+assert.commandWorked(db.runCommand({create: t.getName(), partitioned: true,
+                                    primaryKey: {ts: 1, _id: 1},
+                                    partitionRetention: {intervalSeconds: 3600,
+                                                         expireAfterSeconds: 5 * 3600,
+                                                         precreate: 2}}));
+
+// Ten hours of data, one partition per hour.
+for (var h = 10; h > 0; h--) {
+    for (var i = 0; i < 10; i++) {
+        t.insert({ts: new Date(thisHour - h * hour + i * 1000)});
+    }
+    assert.commandWorked(db.runCommand({addPartition: t.getName(),
+                                        newMax: {ts: new Date(thisHour - (h - 1) * hour)}}));
+}
+for (var i = 0; i < 10; i++) {
+    t.insert({ts: new Date(now)});
+}
+assert.eq(null, db.getLastError());
+assert.eq(110, t.count());
+assert.eq(11, db.runCommand({getPartitionInfo: t.getName()}).numPartitions);
+
+assert.commandWorked(db.adminCommand({setParameter: 1, ttlMonitorEnabled: true}));
+
+// The five partitions ending five or more hours ago go.  The current hour and the two after it
+// get partitions of their own.
+assert.soon(function() {
+    return db.runCommand({getPartitionInfo: t.getName()}).numPartitions == 9;
+}, "partition retention did not run", 70 * 1000);
+
+var info = db.runCommand({getPartitionInfo: t.getName()});
+assert.eq(new Date(thisHour - 4 * hour), info.partitions[0].max.ts, tojson(info));
+assert.eq(new Date(thisHour + 3 * hour), info.partitions[info.numPartitions - 2].max.ts, tojson(info));
+
+// Expired rows went with their partitions; nothing else was touched.
+assert.eq(60, t.count());
+assert.eq(0, t.find({ts: {$lt: new Date(thisHour - 5 * hour)}}).itcount());
+
+var status = db.serverStatus().metrics.ttl;
+assert.lte(5, status.droppedPartitions, tojson(status));
+assert.lte(3, status.addedPartitions, tojson(status));
+
+t.drop();
@@ -140,6 +140,7 @@ files.forEach(function(x) {
             'partition_sorted_cursor|' +
             'partition_stats|' +
             'partition_stats2|' +
+            'parallel_collection_scan|' +
             'part_coll_simple|' +
             'part_convert|' +
             'pk_unique_check_param|' +
@@ -0,0 +1,75 @@
+// Sorts without an index that outgrow memory are merged from disk and returned through getMore.
+
+t = db.jstests_sort_spill;
+t.drop();
+
+var big = new Array( 100 * 1024 ).toString();
+var n = 500;
+for ( var i = 0; i < n; ++i ) {
+    // x is a permutation of 0..n-1, so documents are inserted out of order.
+    t.save( { _id : i , x : ( i * 7 ) % n , arr : [ i % 3 , 3 ] , big : big } );
+}
+assert.eq( null , db.getLastError() );
+
+function checkOrder( cursor , expectedCount , first , step ) {
+    var count = 0;
+    var last = first - step;
+    while ( cursor.hasNext() ) {
+        var o = cursor.next();
+        assert.eq( last + step , o.x , "out of order after " + count );
+        last = o.x;
+        ++count;
+    }
+    assert.eq( expectedCount , count );
+}
+
+// Everything comes back, in order, over many getMores.
+checkOrder( t.find().sort( { x : 1 } ) , n , 0 , 1 );
+checkOrder( t.find().sort( { x : -1 } ) , n , n - 1 , -1 );
+checkOrder( t.find( { x : { $gte : 100 } } ).sort( { x : 1 } ) , n - 100 , 100 , 1 );
+
+// Skip and limit apply to the merged results.
+checkOrder( t.find().sort( { x : 1 } ).skip( 50 ) , n - 50 , 50 , 1 );
+checkOrder( t.find().sort( { x : 1 } ).skip( 10 ).limit( 300 ) , 300 , 10 , 1 );
+assert.eq( 100 , t.find().sort( { x : 1 } ).skip( 20 ).limit( -100 ).itcount() );
+
+// Projections, including positional ones, apply to results returned by getMore too.
+var projected = t.find( {} , { x : 1 , _id : 0 } ).sort( { x : 1 } ).toArray();
+assert.eq( n , projected.length );
+assert.eq( { x : n - 1 } , projected[ n - 1 ] );
+var positional = t.find( { arr : 3 } , { x : 1 , 'arr.$' : 1 } ).sort( { x : 1 } ).toArray();
+assert.eq( n , positional.length );
+assert.eq( [ 3 ] , positional[ n - 1 ].arr );
+
+// Explain reports the spills and the memory used.
+var explain = t.find().sort( { x : 1 } ).explain( true );
+assert( explain.scanAndOrder , tojson( explain ) );
+assert.eq( n , explain.n );
+assert.lt( 0 , explain.scanAndOrderSpills , tojson( explain ) );
+assert.lt( 0 , explain.scanAndOrderBytes , tojson( explain ) );
+assert.gt( 32 * 1024 * 1024 , explain.scanAndOrderBytes , tojson( explain ) );
+
+// A small result stays in memory.
+explain = t.find( { x : { $lt : 10 } } ).sort( { x : 1 } ).explain( true );
+assert.eq( 10 , explain.n );
+assert.eq( 0 , explain.scanAndOrderSpills , tojson( explain ) );
+
+// So does a top-k sort.
+explain = t.find().sort( { x : 1 } ).limit( 5 ).explain( true );
+assert.eq( 5 , explain.n );
+assert.eq( 0 , explain.scanAndOrderSpills , tojson( explain ) );
+
+// The profiler records them as well.
+db.setProfilingLevel( 2 );
+t.find().sort( { x : -1 } ).limit( 2 ).itcount();
+t.find().sort( { x : 1 } ).itcount();
+db.setProfilingLevel( 0 );
+var profiled = db.system.profile.find( { ns : t.getFullName() , op : "query" } ).sort( { $natural : 1 } ).toArray();
+assert.eq( 2 , profiled.length , tojson( profiled ) );
+assert( profiled[ 0 ].scanAndOrder , tojson( profiled[ 0 ] ) );
+assert.eq( 0 , profiled[ 0 ].scanAndOrderSpills , tojson( profiled[ 0 ] ) );
+assert.lt( 0 , profiled[ 1 ].scanAndOrderSpills , tojson( profiled[ 1 ] ) );
+assert.lt( 0 , profiled[ 1 ].scanAndOrderBytes , tojson( profiled[ 1 ] ) );
+db.system.profile.drop();
+
+t.drop();
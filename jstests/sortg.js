@@ -1,4 +1,5 @@
-// Test that a memory exception is triggered for in memory sorts, but not for indexed sorts.
+// Test that in memory sorts too large for memory spill to disk, or trigger a memory exception if
+// spilling is turned off, and that indexed sorts need neither.
 
 t = db.jstests_sortg;
 t.drop();
@@ -25,6 +26,16 @@ function memoryException( sortSpec, querySpec ) {
     assert( db.getLastError().match( /too much data for sort\(\) with no index/ ) );
 }
 
+function spills( sortSpec, querySpec ) {
+    querySpec = querySpec || {};
+    var count = t.find( querySpec ).itcount();
+    assert.eq( count, t.find( querySpec ).sort( sortSpec ).batchSize( 1000 ).itcount() );
+    var explain = t.find( querySpec ).sort( sortSpec ).batchSize( 1000 ).explain( true );
+    assert( explain.scanAndOrder, tojson( explain ) );
+    assert.lt( 0, explain.scanAndOrderSpills, tojson( explain ) );
+    assert.eq( count, explain.n );
+}
+
 function noMemoryException( sortSpec, querySpec ) {
     querySpec = querySpec || {};
     t.find( querySpec ).sort( sortSpec ).batchSize( 1000 ).itcount();
@@ -38,8 +49,14 @@ function noMemoryException( sortSpec, querySpec ) {
 }
 
 // Unindexed sorts.
+spills( {a:1} );
+spills( {b:1} );
+
+// Without spilling they run out of memory.
+assert.commandWorked( db.adminCommand( {setParameter:1, scanAndOrderAllowDiskUse:false} ) );
 memoryException( {a:1} );
 memoryException( {b:1} );
+assert.commandWorked( db.adminCommand( {setParameter:1, scanAndOrderAllowDiskUse:true} ) );
 
 // Indexed sorts.
 noMemoryException( {_id:1} );
@@ -55,8 +72,8 @@ t.ensureIndex( {c:1} );
 //noMemoryException( {a:1} );
 noMemoryException( {b:1} );
 
-// A memory exception is triggered for an unindexed sort involving multiple plans.
-memoryException( {d:1}, {b:null,c:null} );
+// An unindexed sort involving multiple plans spills too.
+spills( {d:1}, {b:null,c:null} );
 
 // With an indexed plan on _id:1 and an unindexed plan on b:1, the indexed plan
 // should succeed even if the unindexed one would exhaust its memory limit.
@@ -0,0 +1,27 @@
+// Spill files left in <dbpath>/_tmp by a sort or $group that didn't finish, e.g. because the
+// server crashed, are removed when the server starts again.
+
+var testName = 'spill_dir_cleanup';
+
+var path = MongoRunner.toRealDir(testName);
+var port = allocatePorts(1, parseInt(myPort(), 10) + 1)[0];
+var mongod = startMongod('--port', port,
+                         '--dbpath', path,
+                         '--nohttpinterface',
+                         '--bind_ip', '127.0.0.1');
+mongod.getDB(testName).foo.insert({});
+assert(!mongod.getDB(testName).getLastError());
+stopMongod(port);
+
+// Stand-ins for what a killed sort would have left behind.
+var leftover = path + '/_tmp/sort.leftover';
+assert(mkdir(leftover + '/a'));
+assert.eq(1, listFiles(path + '/_tmp').length);
+
+mongod = startMongodNoReset('--port', port,
+                            '--dbpath', path,
+                            '--nohttpinterface',
+                            '--bind_ip', '127.0.0.1');
+assert.eq(1, mongod.getDB(testName).foo.count());
+assert.eq(0, listFiles(path + '/_tmp').length);
+stopMongod(port);
@@ -54,6 +54,8 @@ var assertFieldNamesMatch = function( splitPoint , keyPattern ){
 f = db.jstests_splitvector;
 
 // run everything once with clustering indexes, and then again without clustering indexes
+// (secondary indexes only estimate split points by scaling, so their pass asks for exact ones;
+// splitvector_estimate.js checks the estimates)
 for (var cl = 1; cl >= 0; --cl) {
 
 f.drop();
@@ -98,7 +100,7 @@ var case4 = function() {
         f.save( { x: i, y: filler } );
     }
     db.getLastError();
-    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 } );
+    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , exact: !cl } );
 
     // splitVector aims at getting half-full chunks after split
     factor = 0.5;
@@ -130,7 +132,7 @@ var case5 = function() {
         f.save( { x: i, y: filler } );
     }
     db.getLastError();
-    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , maxSplitPoints: 1} );
+    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , exact: !cl , maxSplitPoints: 1} );
 
     assert.eq( true , res.ok , "5a" );
     assert.eq( 1 , res.splitKeys.length , "5b" );
@@ -155,7 +157,7 @@ var case6 = function() {
         f.save( { x: i, y: filler } );
     }
     db.getLastError();
-    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , maxChunkObjects: 500} );
+    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , exact: !cl , maxChunkObjects: 500} );
 
     assert.eq( true , res.ok , "6a" );
     assert.eq( 19 , res.splitKeys.length , "6b" );
@@ -184,7 +186,7 @@ var case7 = function() {
         f.save( { x: 2, y: filler } );
     }
     db.getLastError();
-    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 } );
+    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , exact: !cl } );
 
     assert.eq( true , res.ok , "7a" );
     assert.eq( 2 , res.splitKeys[0].x, "7b");
@@ -216,7 +218,7 @@ var case8 = function() {
     }
 
     db.getLastError();
-    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 } );
+    res = db.runCommand( { splitVector: db.getName() + ".jstests_splitvector" , keyPattern: {x:1} , maxChunkSize: 1 , exact: !cl } );
 
     assert.eq( true , res.ok , "8a" );
     assert.eq( 2 , res.splitKeys.length , "8b" );
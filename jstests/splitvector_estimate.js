@@ -0,0 +1,64 @@
+// splitVector and datasize estimate from index statistics instead of reading every document.
+// Estimates report an error bound derived from the sample they were made with.
+
+var t = db.jstests_splitvector_estimate;
+t.drop();
+t.ensureIndex({x: 1});
+
+var filler = new Array(500).join("a");
+var numDocs = 20000;
+for (var i = 0; i < numDocs; i++) {
+    t.insert({x: i, y: filler});
+}
+assert.eq(null, db.getLastError());
+t.reIndex(); // force stats to be updated
+
+var datasize = function(min, max, estimate, maxObjects) {
+    var res = db.runCommand({datasize: t.getFullName(), keyPattern: {x: 1}, min: min, max: max, estimate: estimate,
+                             maxObjects: maxObjects});
+    assert.commandWorked(res);
+    return res;
+};
+
+// A range smaller than the sample is read whole, so the estimate is exact.
+var small = datasize({x: 100}, {x: 150}, true);
+assert(small.exact, tojson(small));
+assert.eq(0, small.errorBound);
+assert.eq(50, small.numObjects);
+assert.eq(datasize({x: 100}, {x: 150}, false).size, small.size);
+
+// A large range is estimated, within a few times the reported error bound.
+var whole = datasize({x: 0}, {x: numDocs}, false);
+var est = datasize({x: 0}, {x: numDocs}, true);
+printjson(est);
+assert.gte(est.errorBound, 0);
+assert.lt(Math.abs(whole.size - est.size), 4 * est.errorBound + whole.size / 10, tojson(est));
+
+// maxObjects is honored by estimates as it is by exact counts.
+assert(!est.maxReached, tojson(est));
+assert(datasize({x: 0}, {x: numDocs}, false, 1000).maxReached);
+assert(datasize({x: 0}, {x: numDocs}, true, 1000).maxReached);
+assert(datasize({x: 100}, {x: 150}, true, 10).maxReached);
+assert(!datasize({x: 0}, {x: numDocs}, true, 2 * numDocs).maxReached);
+
+// Split points on a secondary index are estimated unless exact ones are asked for.
+var maxChunkSize = 1;
+var splitVector = function(exact) {
+    var res = db.runCommand({splitVector: t.getFullName(), keyPattern: {x: 1}, maxChunkSize: maxChunkSize, exact: exact});
+    assert.commandWorked(res);
+    return res;
+};
+var exactRes = splitVector(true);
+assert(!exactRes.estimated);
+var estRes = splitVector(false);
+assert(estRes.estimated, tojson(estRes));
+assert.eq(100, estRes.sampleSize, tojson(estRes));
+// The documents are all about the same size, so the bound is well under a chunk.
+assert.gte(estRes.errorBound, 0, tojson(estRes));
+assert.lt(estRes.errorBound, maxChunkSize * 1024 * 1024 / 4, tojson(estRes));
+assert.lt(0, estRes.splitKeys.length);
+assert.lt(Math.abs(exactRes.splitKeys.length - estRes.splitKeys.length), exactRes.splitKeys.length / 2 + 2,
+          tojson(exactRes.splitKeys) + " vs " + tojson(estRes.splitKeys));
+for (var i = 1; i < estRes.splitKeys.length; i++) {
+    assert.lt(estRes.splitKeys[i - 1].x, estRes.splitKeys[i].x);
+}
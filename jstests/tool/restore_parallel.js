@@ -0,0 +1,51 @@
+// mongorestore --numParallelCollections and mongoimport --numParsingThreads put back exactly what
+// the serial versions would.
+
+t = new ToolTest( "restore_parallel" );
+
+c = t.startDB( "foo" );
+db = t.db;
+
+var pad = new Array(1000).join("x");
+for (var i = 0; i < 5; i++) {
+    var coll = db["c" + i];
+    for (var j = 0; j < 1000 * (i + 1); j++) {
+        coll.insert({_id: j, a: j % 7, pad: pad});
+    }
+    coll.ensureIndex({a: 1});
+}
+db.createCollection("capped", {capped: true, size: 100000});
+db.capped.insert({x: 1});
+assert.eq(null, db.getLastError());
+
+t.runTool( "dump" , "--out" , t.ext );
+db.dropDatabase();
+
+t.runTool( "restore" , "--dir" , t.ext , "--numParallelCollections" , "3" );
+for (var i = 0; i < 5; i++) {
+    var coll = db["c" + i];
+    assert.eq(1000 * (i + 1), coll.count(), "restored c" + i);
+    assert.eq(2, coll.getIndexes().length, "indexes of c" + i);
+    assert.eq(Math.ceil(1000 * (i + 1) / 7), coll.find({a: 0}).hint({a: 1}).itcount(), "index on c" + i);
+}
+assert(db.capped.isCapped());
+assert.eq(1, db.capped.count());
+
+// Restoring over existing data without --drop still works document by document.
+t.runTool( "restore" , "--dir" , t.ext , "--numParallelCollections" , "3" );
+assert.eq(5000, db.c4.count());
+
+// Import with several parsers.
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "c4" );
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--numParsingThreads" , "4" );
+assert.eq(5000, c.count());
+assert.eq(db.c4.find().sort({_id: 1}).toArray(), c.find().sort({_id: 1}).toArray());
+
+// The header line is still read first, and quoted newlines still join lines into one row.
+c.drop();
+t.runTool( "import" , "--file" , "jstests/tool/data/csvimport1.csv" , "-d" , t.baseName , "-c" , "foo" , "--type" , "csv" , "--headerline" , "--numParsingThreads" , "2" );
+assert.eq(5, c.count());
+assert.eq(0, c.find({a: "a"}).count(), "header line imported as a document");
+
+t.stop();
@@ -31,6 +31,7 @@
 #include "mongo/s/stale_exception.h"  // for RecvStaleConfigException
 #include "mongo/util/assert_util.h"
 #include "mongo/util/md5.hpp"
+#include "mongo/util/net/message_compressor.h"
 
 #ifdef MONGO_SSL
 // TODO: Remove references to cmdline from the client.
@@ -947,6 +948,31 @@ namespace mongo {
                     ex.what() << std::endl;
             }
         }
+        if ( _compressionRequested ) {
+            negotiateCompression();
+        }
+    }
+
+    bool DBClientConnection::negotiateCompression() {
+        _compressionRequested = true;
+
+        BSONObjBuilder cmd;
+        cmd.append( "isMaster", 1 );
+        BSONArrayBuilder compressors( cmd.subarrayStart( messageCompressionFieldName ) );
+        appendSupportedMessageCompressors( compressors );
+        compressors.done();
+
+        BSONObj info;
+        if ( !runCommand( "admin", cmd.obj(), info ) ) {
+            return false;
+        }
+        const MessageCompressor compressor = chooseMessageCompressor( info[messageCompressionFieldName] );
+        if ( compressor == MessageCompressor_None ) {
+            return false;
+        }
+        port().setCompressor( compressor );
+        LOG(_logLevel) << "compressing messages to " << _serverString << endl;
+        return true;
     }
 
     void DBClientConnection::setSoTimeout(double timeout) {
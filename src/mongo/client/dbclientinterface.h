@@ -1154,7 +1154,8 @@ namespace mongo {
            Connect timeout is fixed, but short, at 5 seconds.
          */
         DBClientConnection(bool _autoReconnect=false, DBClientReplicaSet* cp=0, double so_timeout=0) :
-            clientSet(cp), _failed(false), autoReconnect(_autoReconnect), lastReconnectTry(0), _so_timeout(so_timeout) {
+            clientSet(cp), _failed(false), autoReconnect(_autoReconnect), lastReconnectTry(0), _so_timeout(so_timeout),
+            _compressionRequested(false) {
             _numConnections++;
         }
 
@@ -1229,6 +1230,14 @@ namespace mongo {
 
         MessagingPort& port() { verify(p); return *p; }
 
+        /**
+           Offers the server our message compressors in an isMaster, and if it picks one,
+           compresses large messages we send from then on.  Also done again after an
+           automatic reconnect.
+           @return true if the server agreed to compress
+         */
+        bool negotiateCompression();
+
         string toStringLong() const {
             stringstream ss;
             ss << _serverString;
@@ -1294,6 +1303,7 @@ namespace mongo {
 
         map<string, BSONObj> authCache;
         double _so_timeout;
+        bool _compressionRequested;
         bool _connect( string& errmsg );
 
         static AtomicUInt _numConnections;
@@ -0,0 +1,388 @@
+// admission_control.cpp
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/admission_control.h"
+
+#include "mongo/base/init.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    using namespace mongoutils;
+
+    const int AdmissionControl::kDefaultReserved[NUM_OP_CLASSES] = { 8, 16, 16, 4 };
+    const int AdmissionControl::kDefaultSharedLimit[NUM_OP_CLASSES] = { 64, 64, 64, 16 };
+
+    bool AdmissionControl::enabled = false;
+    AdmissionControl AdmissionControl::global;
+
+    const char *AdmissionControl::className(OpClass c) {
+        switch (c) {
+            case INTERNAL: return "internal";
+            case POINT_READ: return "pointRead";
+            case WRITE: return "write";
+            case SCAN: return "scan";
+            default: return "notAdmitted";
+        }
+    }
+
+    namespace {
+
+        /** @return the query in q, without the $query/query wrapper that read preferences and sorts add. */
+        BSONObj unwrapQuery(const BSONObj &q) {
+            BSONElement first = q.firstElement();
+            if (first.type() == Object &&
+                (str::equals(first.fieldName(), "$query") || str::equals(first.fieldName(), "query"))) {
+                return first.embeddedObject();
+            }
+            return q;
+        }
+
+        /** Only looks at the query itself: an equality match on _id is a point read. */
+        bool isPointQuery(const BSONObj &query) {
+            BSONElement id = query["_id"];
+            if (id.eoo() || id.type() == RegEx) {
+                return false;
+            }
+            if (id.type() == Object) {
+                BSONObj o = id.embeddedObject();
+                return o.isEmpty() || o.firstElementFieldName()[0] != '$';
+            }
+            return id.type() != Array;
+        }
+
+        AdmissionControl::OpClass classifyCommand(const BSONObj &cmd) {
+            const StringData name = cmd.firstElementFieldName();
+            if (name == "aggregate" || name == "count" || name == "distinct" || name == "group" ||
+                name == "mapReduce" || name == "mapreduce" || name == "geoNear" ||
+                name == "geoSearch" || name == "text") {
+                return AdmissionControl::SCAN;
+            }
+            if (name == "findAndModify" || name == "findandmodify") {
+                return AdmissionControl::WRITE;
+            }
+            if (name == "_migrateClone" || name == "_transferMods") {
+                return AdmissionControl::INTERNAL;
+            }
+            // Everything else is either cheap, or waits for something other than the storage
+            // engine (getLastError, sleep), or is an administrative task nobody wants to queue.
+            return AdmissionControl::NOT_ADMITTED;
+        }
+
+    } // namespace
+
+    AdmissionControl::OpClass AdmissionControl::classify(Message &m) {
+        const int op = m.operation();
+        if (op == dbInsert || op == dbUpdate || op == dbDelete) {
+            return WRITE;
+        }
+        if (op != dbQuery && op != dbGetMore) {
+            return NOT_ADMITTED;
+        }
+
+        DbMessage d(m);
+        const StringData ns(d.getns());
+        if (nsToDatabaseSubstring(ns) == "local") {
+            // secondaries reading the oplog
+            return INTERNAL;
+        }
+        if (op == dbGetMore) {
+            return SCAN;
+        }
+
+        QueryMessage q(d);
+        BSONObj query = unwrapQuery(q.query);
+        if (NamespaceString::isCommand(ns)) {
+            return classifyCommand(query);
+        }
+        return isPointQuery(query) ? POINT_READ : SCAN;
+    }
+
+    AdmissionControl::AdmissionControl() : _shared(kDefaultSharedTickets), _mutex("AdmissionControl") {
+        for (int c = 0; c < NUM_OP_CLASSES; c++) {
+            _classes[c].reserved.resize(kDefaultReserved[c]);
+            _classes[c].sharedLimit.store(kDefaultSharedLimit[c]);
+        }
+    }
+
+    void AdmissionControl::Ticket::acquire(AdmissionControl &ac, OpClass c) {
+        verify(_ac == NULL);
+        if (c == NOT_ADMITTED) {
+            return;
+        }
+        ac.acquire(c, _shared);
+        _ac = &ac;
+        _c = c;
+    }
+
+    AdmissionControl::Ticket::~Ticket() {
+        if (_ac != NULL) {
+            _ac->release(_c, _shared);
+        }
+    }
+
+    bool AdmissionControl::canTakeShared(OpClass c) const {
+        return _classes[c].sharedHeld.load() < _classes[c].sharedLimit.load();
+    }
+
+    bool AdmissionControl::higherPriorityWaiting(OpClass c) const {
+        for (int p = 0; p < c; p++) {
+            if (_classes[p].waiting.load() > 0 && canTakeShared(OpClass(p))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool AdmissionControl::tryShared(OpClass c) {
+        if (higherPriorityWaiting(c)) {
+            return false;
+        }
+        // Count ourselves against the class's limit before taking from the pool, so the class
+        // never holds more shared tickets than its limit.
+        ClassState &cs = _classes[c];
+        int held = cs.sharedHeld.load();
+        while (true) {
+            if (held >= cs.sharedLimit.load()) {
+                return false;
+            }
+            const int prev = cs.sharedHeld.compareAndSwap(held, held + 1);
+            if (prev == held) {
+                break;
+            }
+            held = prev;
+        }
+        if (_shared.tryAcquire()) {
+            return true;
+        }
+        cs.sharedHeld.fetchAndSubtract(1);
+        return false;
+    }
+
+    bool AdmissionControl::tryAcquire(OpClass c, bool &shared) {
+        if (_classes[c].reserved.tryAcquire()) {
+            shared = false;
+            return true;
+        }
+        if (tryShared(c)) {
+            shared = true;
+            return true;
+        }
+        return false;
+    }
+
+    void AdmissionControl::acquire(OpClass c, bool &shared) {
+        ClassState &cs = _classes[c];
+        if (tryAcquire(c, shared)) {
+            cs.waitMicros.record(0);
+            return;
+        }
+
+        Timer t;
+        {
+            scoped_lock lk(_mutex);
+            // Registered before the last tryAcquire, like TicketHolder::waitForTicket.
+            cs.waiting.fetchAndAdd(1);
+            while (!tryAcquire(c, shared)) {
+                // The timeout only bounds how long a wakeup lost to a racing tryShared() that
+                // backed out can delay us.
+                cs.cond.timed_wait(lk.boost(), boost::posix_time::milliseconds(100));
+            }
+            cs.waiting.fetchAndSubtract(1);
+
+            // Two returned tickets may have woken the same waiter, pass the other one on.
+            if (cs.waiting.load() > 0 && cs.reserved.available() > 0) {
+                cs.cond.notify_one();
+            }
+            if (_shared.available() > 0) {
+                notifySharedWaiter();
+            }
+        }
+        cs.waited.fetchAndAdd(1);
+        cs.waitMicros.record(t.micros());
+    }
+
+    void AdmissionControl::release(OpClass c, bool shared) {
+        ClassState &cs = _classes[c];
+        if (!shared) {
+            cs.reserved.release();
+            if (cs.waiting.load() > 0) {
+                scoped_lock lk(_mutex);
+                cs.cond.notify_one();
+            }
+            return;
+        }
+
+        _shared.release();
+        cs.sharedHeld.fetchAndSubtract(1);
+        for (int p = 0; p < NUM_OP_CLASSES; p++) {
+            if (_classes[p].waiting.load() > 0) {
+                scoped_lock lk(_mutex);
+                notifySharedWaiter();
+                return;
+            }
+        }
+    }
+
+    void AdmissionControl::notifySharedWaiter() {
+        for (int p = 0; p < NUM_OP_CLASSES; p++) {
+            if (_classes[p].waiting.load() > 0 && canTakeShared(OpClass(p))) {
+                _classes[p].cond.notify_one();
+                return;
+            }
+        }
+    }
+
+    void AdmissionControl::notifyAll() {
+        scoped_lock lk(_mutex);
+        for (int c = 0; c < NUM_OP_CLASSES; c++) {
+            _classes[c].cond.notify_all();
+        }
+    }
+
+    void AdmissionControl::setReserved(OpClass c, int n) {
+        _classes[c].reserved.resize(n);
+        notifyAll();
+    }
+
+    void AdmissionControl::setSharedLimit(OpClass c, int n) {
+        _classes[c].sharedLimit.store(n);
+        notifyAll();
+    }
+
+    void AdmissionControl::setSharedTickets(int n) {
+        _shared.resize(n);
+        notifyAll();
+    }
+
+    void AdmissionControl::append(BSONObjBuilder &b, const std::vector<double> &percentiles) const {
+        b.appendBool("enabled", enabled);
+        {
+            BSONObjBuilder sb(b.subobjStart("shared"));
+            sb.append("out", _shared.outof());
+            sb.append("available", _shared.available());
+            sb.done();
+        }
+        for (int c = 0; c < NUM_OP_CLASSES; c++) {
+            const ClassState &cs = _classes[c];
+            BSONObjBuilder cb(b.subobjStart(className(OpClass(c))));
+            cb.append("reserved", cs.reserved.outof());
+            cb.append("reservedAvailable", cs.reserved.available());
+            cb.append("sharedLimit", cs.sharedLimit.load());
+            cb.append("sharedHeld", cs.sharedHeld.load());
+            cb.append("queueDepth", cs.waiting.load());
+            cb.appendNumber("waited", static_cast<long long>(cs.waited.load()));
+            LatencyHistogram h;
+            cs.waitMicros.snapshot(h);
+            BSONObjBuilder hb(cb.subobjStart("waitMicros"));
+            h.append(hb, percentiles);
+            hb.done();
+            cb.done();
+        }
+    }
+
+    namespace {
+
+        ExportedServerParameter<bool> admissionControlParameter(ServerParameterSet::getGlobal(),
+                                                                "admissionControl",
+                                                                &AdmissionControl::enabled, true, true);
+
+        /**
+         * admission<Class>Reserved and admission<Class>Shared set a class's reserved tickets and
+         * its limit of shared ones, admissionSharedTickets sets the size of the shared pool.
+         */
+        class AdmissionTicketsParameter : public ExportedServerParameter<int> {
+          public:
+            AdmissionTicketsParameter(const string &name, int *value,
+                                      AdmissionControl::OpClass c, bool reserved)
+                : ExportedServerParameter<int>(ServerParameterSet::getGlobal(), name, value, true, true),
+                  _c(c), _reserved(reserved) {}
+
+          protected:
+            virtual Status validate(const int &n) {
+                if (n < 0 || n > 1000000) {
+                    return Status(ErrorCodes::BadValue,
+                                  str::stream() << name() << " must be between 0 and 1000000");
+                }
+                if (_c == AdmissionControl::NUM_OP_CLASSES) {
+                    AdmissionControl::global.setSharedTickets(n);
+                }
+                else if (_reserved) {
+                    AdmissionControl::global.setReserved(_c, n);
+                }
+                else {
+                    AdmissionControl::global.setSharedLimit(_c, n);
+                }
+                return Status::OK();
+            }
+
+          private:
+            const AdmissionControl::OpClass _c;
+            const bool _reserved;
+        };
+
+        int reservedTickets[AdmissionControl::NUM_OP_CLASSES];
+        int sharedLimits[AdmissionControl::NUM_OP_CLASSES];
+        int sharedTickets = AdmissionControl::kDefaultSharedTickets;
+
+        MONGO_INITIALIZER(RegisterAdmissionControlParameters)(InitializerContext* context) {
+            // Leaked intentionally: a ServerParameter registers itself when constructed.
+            new AdmissionTicketsParameter("admissionSharedTickets", &sharedTickets,
+                                          AdmissionControl::NUM_OP_CLASSES, false);
+            static const char *names[] = { "Internal", "PointRead", "Write", "Scan" };
+            for (int c = 0; c < AdmissionControl::NUM_OP_CLASSES; c++) {
+                reservedTickets[c] = AdmissionControl::kDefaultReserved[c];
+                sharedLimits[c] = AdmissionControl::kDefaultSharedLimit[c];
+                new AdmissionTicketsParameter(str::stream() << "admission" << names[c] << "Reserved",
+                                              &reservedTickets[c], AdmissionControl::OpClass(c), true);
+                new AdmissionTicketsParameter(str::stream() << "admission" << names[c] << "Shared",
+                                              &sharedLimits[c], AdmissionControl::OpClass(c), false);
+            }
+            return Status::OK();
+        }
+
+        /**
+         * serverStatus().admissionControl, percentiles of the wait times can be asked for like
+         * in serverStatus().latency.
+         */
+        class AdmissionControlSSS : public ServerStatusSection {
+          public:
+            AdmissionControlSSS() : ServerStatusSection("admissionControl") {}
+            virtual bool includeByDefault() const { return true; }
+
+            BSONObj generateSection(const BSONElement &configElement) const {
+                vector<double> percentiles = LatencyHistogram::defaultPercentiles();
+                if (configElement.isABSONObj()) {
+                    percentiles = LatencyHistogram::parsePercentiles(configElement.Obj()["percentiles"]);
+                }
+                BSONObjBuilder b;
+                AdmissionControl::global.append(b, percentiles);
+                return b.obj();
+            }
+        } admissionControlSSS;
+
+    } // namespace
+
+} // namespace mongo
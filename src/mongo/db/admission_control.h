@@ -0,0 +1,145 @@
+// admission_control.h
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <vector>
+#include <boost/thread/condition_variable.hpp>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/latency_histogram.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+    class Message;
+
+    /**
+     * Limits how many client operations of each class run at once, so that long scans can't take
+     * every slot away from short point reads.
+     *
+     * Each class has reserved tickets that only it uses, and may also hold up to a limit of
+     * tickets from a pool shared by all classes.  An operation that can't get either waits.  A
+     * returned shared ticket goes to the highest priority class that has an operation waiting
+     * and is under its limit: internal, then point reads, then writes, then scans.  Operations
+     * don't take shared tickets from under a higher priority class that is waiting for one.
+     *
+     * Taking and returning a ticket are a few atomic operations; the mutex is only used by
+     * operations that wait, and to wake them.
+     */
+    class AdmissionControl : boost::noncopyable {
+      public:
+        enum OpClass {
+            /** replication and migration traffic between members of the cluster */
+            INTERNAL = 0,
+            /** queries by _id */
+            POINT_READ,
+            WRITE,
+            /** other queries, getMores and aggregations */
+            SCAN,
+            NUM_OP_CLASSES,
+            /** operations that don't need a ticket, like most commands */
+            NOT_ADMITTED = NUM_OP_CLASSES
+        };
+
+        static const char *className(OpClass c);
+
+        /** @return the class of the client request in m. */
+        static OpClass classify(Message &m);
+
+        /**
+         * Holds a ticket, if acquired, until destroyed.
+         */
+        class Ticket : boost::noncopyable {
+          public:
+            Ticket() : _ac(NULL), _c(NOT_ADMITTED), _shared(false) {}
+            ~Ticket();
+
+            /** Waits for a ticket for an operation of class c, or does nothing if NOT_ADMITTED. */
+            void acquire(AdmissionControl &ac, OpClass c);
+
+            /** @return true if this holds one of the shared tickets */
+            bool shared() const { return _shared; }
+
+          private:
+            AdmissionControl *_ac;
+            OpClass _c;
+            bool _shared;
+        };
+
+        AdmissionControl();
+
+        /**
+         * Change the limits.  If more tickets are in use than a new limit allows, operations
+         * keep them but new ones wait until enough are returned.
+         */
+        void setReserved(OpClass c, int n);
+        void setSharedLimit(OpClass c, int n);
+        void setSharedTickets(int n);
+
+        /** @return how many operations of class c are waiting for a ticket */
+        int queueDepth(OpClass c) const { return _classes[c].waiting.load(); }
+        /** @return how many shared tickets class c holds */
+        int sharedHeld(OpClass c) const { return _classes[c].sharedHeld.load(); }
+
+        /**
+         * Appends each class's limits, tickets in use, queue depth, and a histogram of how long
+         * operations waited for their tickets.
+         */
+        void append(BSONObjBuilder &b, const std::vector<double> &percentiles) const;
+
+        /** The admission control of client operations, when the admissionControl parameter is set. */
+        static AdmissionControl global;
+        static bool enabled;
+
+        static const int kDefaultReserved[NUM_OP_CLASSES];
+        static const int kDefaultSharedLimit[NUM_OP_CLASSES];
+        static const int kDefaultSharedTickets = 64;
+
+      private:
+        struct ClassState {
+            TicketHolder reserved;
+            AtomicInt32 sharedHeld;
+            AtomicInt32 sharedLimit;
+            AtomicInt32 waiting;
+            // operations that had to wait
+            AtomicUInt64 waited;
+            PartitionedLatencyHistogram waitMicros;
+            boost::condition_variable_any cond;
+            ClassState() : reserved(0) {}
+        };
+
+        bool tryAcquire(OpClass c, bool &shared);
+        bool tryShared(OpClass c);
+        bool higherPriorityWaiting(OpClass c) const;
+        bool canTakeShared(OpClass c) const;
+        void acquire(OpClass c, bool &shared);
+        void release(OpClass c, bool shared);
+        /** Wakes a waiter of the highest priority class that can take a shared ticket.  Needs _mutex. */
+        void notifySharedWaiter();
+        void notifyAll();
+
+        ClassState _classes[NUM_OP_CLASSES];
+        TicketHolder _shared;
+        mongo::mutex _mutex;
+    };
+
+} // namespace mongo
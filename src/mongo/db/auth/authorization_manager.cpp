@@ -102,6 +102,7 @@ namespace {
         readRoleActions.addAction(ActionType::find);
         readRoleActions.addAction(ActionType::indexRead);
         readRoleActions.addAction(ActionType::killCursors);
+        readRoleActions.addAction(ActionType::planCacheRead);
         readRoleActions.addAction(ActionType::transactionCommands);
 
         // Read-write role
@@ -145,6 +146,8 @@ namespace {
         dbAdminRoleActions.addAction(ActionType::ensureIndex);
         dbAdminRoleActions.addAction(ActionType::indexRead);
         dbAdminRoleActions.addAction(ActionType::indexStats);
+        dbAdminRoleActions.addAction(ActionType::planCacheRead);
+        dbAdminRoleActions.addAction(ActionType::planCacheWrite);
         dbAdminRoleActions.addAction(ActionType::profileEnable);
         dbAdminRoleActions.addAction(ActionType::profileRead);
         dbAdminRoleActions.addAction(ActionType::reIndex);
@@ -256,6 +259,7 @@ namespace {
         internalActions.addAction(ActionType::replSetFresh);
         internalActions.addAction(ActionType::replSetGetRBID);
         internalActions.addAction(ActionType::replSetHeartbeat);
+        internalActions.addAction(ActionType::replSetInitialSyncSnapshot);
         internalActions.addAction(ActionType::updateSlave);
         internalActions.addAction(ActionType::writebacklisten);
         internalActions.addAction(ActionType::_migrateClone);
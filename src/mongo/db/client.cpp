@@ -108,6 +108,18 @@ namespace mongo {
         return *c;
     }
 
+    Client* Client::releaseThread() {
+        Client *c = currentClient.release();
+        verify( c );
+        return c;
+    }
+
+    void Client::attachThread(Client *c) {
+        verify( c );
+        verify( currentClient.get() == 0 );
+        currentClient.reset(c);
+    }
+
     Client::Client(const char *desc, AbstractMessagingPort *p) :
         ClientBasic(p),
         _context(0),
@@ -476,6 +488,8 @@ namespace mongo {
         nscanned = -1;
         idhack = false;
         scanAndOrder = false;
+        scanAndOrderBytes = -1;
+        scanAndOrderSpills = -1;
         nupdated = -1;
         ninserted = -1;
         ndeleted = -1;
@@ -536,6 +550,8 @@ namespace mongo {
         OPDEBUG_TOSTRING_HELP( nscanned );
         OPDEBUG_TOSTRING_HELP_BOOL( idhack );
         OPDEBUG_TOSTRING_HELP_BOOL( scanAndOrder );
+        OPDEBUG_TOSTRING_HELP( scanAndOrderBytes );
+        OPDEBUG_TOSTRING_HELP( scanAndOrderSpills );
         OPDEBUG_TOSTRING_HELP( nupdated );
         OPDEBUG_TOSTRING_HELP( ninserted );
         OPDEBUG_TOSTRING_HELP( ndeleted );
@@ -604,6 +620,8 @@ namespace mongo {
         OPDEBUG_APPEND_NUMBER( nscanned );
         OPDEBUG_APPEND_BOOL( idhack );
         OPDEBUG_APPEND_BOOL( scanAndOrder );
+        OPDEBUG_APPEND_NUMBER( scanAndOrderBytes );
+        OPDEBUG_APPEND_NUMBER( scanAndOrderSpills );
         OPDEBUG_APPEND_NUMBER( nupdated );
         OPDEBUG_APPEND_NUMBER( ninserted );
         OPDEBUG_APPEND_NUMBER( ndeleted );
@@ -82,6 +82,16 @@ namespace mongo {
                 return;
             initThread(desc);
         }
+
+        /** detaches the current thread's Client without destroying it, so that a
+         *  connection served by a pool of threads can move to another thread.
+         *  @return the Client, which the caller now owns
+         */
+        static Client* releaseThread();
+
+        /** makes c, from releaseThread(), the current thread's Client */
+        static void attachThread(Client *c);
+
         static void abortLiveTransactions();
 
 
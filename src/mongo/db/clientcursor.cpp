@@ -58,8 +58,10 @@
 
 namespace mongo {
 
-    CCById ClientCursor::clientCursorsById;
-    boost::recursive_mutex& ClientCursor::ccmutex( *(new boost::recursive_mutex()) );
+    // Leaked, like the single mutex it replaced, so that it outlives any static destructor.
+    ClientCursor::Stripe *ClientCursor::stripes( new ClientCursor::Stripe[ClientCursor::kNumStripes] );
+    AtomicUInt32 ClientCursor::numberOpen;
+    AtomicUInt32 ClientCursor::nextStripe;
     long long ClientCursor::numberTimedOut = 0;
 
     void ClientCursor::invalidateAllCursors() {
@@ -136,25 +138,46 @@ namespace mongo {
         return Status::OK();
     }
 
-    /* note called outside of locks (other than ccmutex) so care must be exercised */
+    /* note called outside of locks (other than its stripe's) so care must be exercised */
     bool ClientCursor::shouldTimeout( unsigned millis ) {
         _idleAgeMillis += millis;
         dassert(idleAgeTimeoutMillis > 0);
-        return _idleAgeMillis > static_cast<unsigned>(idleAgeTimeoutMillis) && _pinValue == 0;
+        return _idleAgeMillis > static_cast<unsigned>(idleAgeTimeoutMillis) && _pinValue.load() == 0;
+    }
+
+    void ClientCursor::pin() {
+        unsigned v = _pinValue.load();
+        while (true) {
+            uassert( 12051, "clientcursor already in use? driver problem?", v < 100 );
+            const unsigned prev = _pinValue.compareAndSwap(v, v + 100);
+            if (prev == v) {
+                return;
+            }
+            v = prev;
+        }
+    }
+
+    void ClientCursor::unpin() {
+        const unsigned prev = _pinValue.fetchAndSubtract(100);
+        verify( prev >= 100 );
     }
 
     void ClientCursor::resetIdleAge() {
         _idleAgeMillis = 0;
     }
 
-    /* called every 4 seconds.  millis is amount of idle time passed since the last call -- could be zero */
+    /*
+     * called every 4 seconds.  millis is amount of idle time passed since the last call -- could be zero
+     *
+     * Only one stripe of the registry is locked at a time, and timed out cursors are destroyed
+     * after its lock is released, so getMores on other cursors don't wait for the sweep.
+     */
     void ClientCursor::idleTimeReport(unsigned millis) {
-        LockedIterator i;
-        unsigned sz = clientCursorsById.size();
+        unsigned sz = numCursors();
         if (sz >= 100000) { 
             RATELIMITED(300000) log() << "warning number of open cursors is very large: " << sz << endl;
         }
-        while (i.ok()) {
+        for (LockedIterator i; i.ok(); ) {
             ClientCursor *cc = i.current();
             if (cc->shouldTimeout(millis)) {
                 LOG(1) << "killing old cursor " << cc->_cursorid << ' ' << cc->_ns
@@ -166,18 +189,70 @@ namespace mongo {
         }
     }
 
+    ClientCursor::LockedIterator::LockedIterator() : _stripe(0) {
+        lockStripe();
+        settle();
+    }
+
+    ClientCursor::LockedIterator::~LockedIterator() {
+        unlockStripe();
+    }
+
+    void ClientCursor::LockedIterator::lockStripe() {
+        _lock.reset(new recursive_scoped_lock(stripes[_stripe].mutex));
+        _i = stripes[_stripe].cursors.begin();
+    }
+
+    void ClientCursor::LockedIterator::unlockStripe() {
+        _lock.reset();
+        // Deleting a cursor can delete others, which locks their stripes.
+        for (vector<ClientCursor *>::iterator it = _doomed.begin(); it != _doomed.end(); ++it) {
+            delete *it;
+        }
+        _doomed.clear();
+    }
+
+    void ClientCursor::LockedIterator::settle() {
+        while (_i == stripes[_stripe].cursors.end()) {
+            unlockStripe();
+            if (++_stripe == kNumStripes) {
+                return;
+            }
+            lockStripe();
+        }
+    }
+
+    void ClientCursor::LockedIterator::advance() {
+        ++_i;
+        settle();
+    }
+
     void ClientCursor::LockedIterator::deleteAndAdvance() {
         ClientCursor *cc = current();
-        CursorId id = cc->cursorid();
-        delete cc;
-        _i = clientCursorsById.upper_bound( id );
+        stripes[_stripe].cursors.erase(_i++);
+        numberOpen.fetchAndSubtract(1);
+        _doomed.push_back(cc);
+        settle();
+    }
+
+    void ClientCursor::unregister_inlock(Stripe &stripe) {
+        CCById::iterator it = stripe.cursors.find(_cursorid);
+        // A LockedIterator may have already taken us out, and our id may even have been reused
+        // since then.
+        if (it != stripe.cursors.end() && it->second == this) {
+            stripe.cursors.erase(it);
+            numberOpen.fetchAndSubtract(1);
+        }
     }
 
     void ClientCursor::initCursorID() {
         {
-            recursive_scoped_lock lock(ccmutex);
-            _cursorid = allocCursorId_inlock();
-            clientCursorsById.insert( make_pair(_cursorid, this) );
+            const unsigned stripeNum = nextStripe.fetchAndAdd(1) % kNumStripes;
+            Stripe &stripe = stripes[stripeNum];
+            recursive_scoped_lock lock(stripe.mutex);
+            _cursorid = allocCursorId_inlock(stripe, stripeNum);
+            stripe.cursors.insert( make_pair(_cursorid, this) );
+            numberOpen.fetchAndAdd(1);
         }
         
         if (_partOfMultiStatementTxn) {
@@ -233,14 +308,15 @@ namespace mongo {
         }
 
         if (_cursorid != INVALID_CURSOR_ID) {
-            recursive_scoped_lock lock(ccmutex);
+            Stripe &stripe = stripeFor(_cursorid);
+            recursive_scoped_lock lock(stripe.mutex);
 
-            clientCursorsById.erase(_cursorid);
+            unregister_inlock(stripe);
 
             // defensive:
             _cursorid = INVALID_CURSOR_ID;
             _pos = -2;
-            _pinValue = 0;
+            _pinValue.store(0);
         }
     }
 
@@ -333,18 +409,12 @@ namespace mongo {
         }
     }
 
-    namespace {
-        // so we don't have to do find() which is a little slow very often.
-        long long cursorGenTSLast = 0;
-        PseudoRandom* cursorGenRandom = NULL;
-    }
-
-    long long ClientCursor::allocCursorId_inlock() {
+    long long ClientCursor::allocCursorId_inlock(Stripe &stripe, unsigned stripeNum) {
         // It is important that cursor IDs not be reused within a short period of time.
 
-        if ( ! cursorGenRandom ) {
+        if ( ! stripe.genRandom ) {
             scoped_ptr<SecureRandom> sr( SecureRandom::create() );
-            cursorGenRandom = new PseudoRandom( sr->nextInt64() );
+            stripe.genRandom = new PseudoRandom( sr->nextInt64() );
         }
 
         const long long ts = Listener::getElapsedTimeMillis();
@@ -353,19 +423,23 @@ namespace mongo {
 
         while ( 1 ) {
             x = ts << 32;
-            x |= cursorGenRandom->nextInt32();
-
-            if ( x == 0 )
-                continue;
+            x |= stripe.genRandom->nextInt32();
 
             if ( x < 0 )
                 x *= -1;
 
-            if ( ts != cursorGenTSLast || ClientCursor::find_inlock(x, false) == 0 )
+            // the low bits say which stripe the cursor is in
+            x = x - stripeOf(x) + stripeNum;
+
+            if ( x == 0 )
+                continue;
+
+            // so we don't have to do find() which is a little slow very often.
+            if ( ts != stripe.genTSLast || ClientCursor::find_inlock(stripe, x, false) == 0 )
                 break;
         }
 
-        cursorGenTSLast = ts;
+        stripe.genTSLast = ts;
 
         return x;
     }
@@ -387,19 +461,23 @@ namespace mongo {
     }
 
     void ClientCursor::appendStats( BSONObjBuilder& result ) {
-        recursive_scoped_lock lock(ccmutex);
-        result.appendNumber("totalOpen", clientCursorsById.size() );
-        result.appendNumber("clientCursors_size", (int) numCursors());
-        result.appendNumber("timedOut" , numberTimedOut);
+        size_t total = 0;
         unsigned pinned = 0;
         unsigned notimeout = 0;
-        for ( CCById::iterator i = clientCursorsById.begin(); i != clientCursorsById.end(); i++ ) {
-            unsigned p = i->second->_pinValue;
-            if( p >= 100 )
-                pinned++;
-            else if( p > 0 )
-                notimeout++;
+        for ( unsigned s = 0; s < kNumStripes; s++ ) {
+            recursive_scoped_lock lock(stripes[s].mutex);
+            total += stripes[s].cursors.size();
+            for ( CCById::iterator i = stripes[s].cursors.begin(); i != stripes[s].cursors.end(); i++ ) {
+                unsigned p = i->second->_pinValue.load();
+                if( p >= 100 )
+                    pinned++;
+                else if( p > 0 )
+                    notimeout++;
+            }
         }
+        result.appendNumber("totalOpen", total );
+        result.appendNumber("clientCursors_size", (int) total);
+        result.appendNumber("timedOut" , numberTimedOut);
         if( pinned ) 
             result.append("pinned", pinned);
         if( notimeout )
@@ -455,39 +533,60 @@ namespace mongo {
     }
 
     void ClientCursor::find( const string& ns , set<CursorId>& all ) {
-        recursive_scoped_lock lock(ccmutex);
+        for ( unsigned s = 0; s < kNumStripes; s++ ) {
+            recursive_scoped_lock lock(stripes[s].mutex);
 
-        for ( CCById::iterator i=clientCursorsById.begin(); i!=clientCursorsById.end(); ++i ) {
-            if ( i->second->_ns == ns )
-                all.insert( i->first );
+            for ( CCById::iterator i=stripes[s].cursors.begin(); i!=stripes[s].cursors.end(); ++i ) {
+                if ( i->second->_ns == ns )
+                    all.insert( i->first );
+            }
         }
     }
 
-    bool ClientCursor::_erase_inlock(ClientCursor* cursor) {
+    void ClientCursor::_unregisterForErase_inlock(Stripe &stripe, ClientCursor* cursor) {
         // Must not have an active ClientCursor::Pin.
         massert( 16089,
                 str::stream() << "Cannot kill active cursor " << cursor->cursorid(),
-                cursor->_pinValue < 100 );
+                cursor->_pinValue.load() < 100 );
+
+        cursor->unregister_inlock(stripe);
+    }
+
+    bool ClientCursor::erase(CursorId id) {
+        Stripe &stripe = stripeFor(id);
+        ClientCursor* cursor;
+        {
+            recursive_scoped_lock lock(stripe.mutex);
+            cursor = find_inlock(stripe, id);
+            if (!cursor) {
+                return false;
+            }
+            _unregisterForErase_inlock(stripe, cursor);
+        }
 
+        // Deleting a cursor can delete others, which locks their stripes.
         delete cursor;
         return true;
     }
 
-    bool ClientCursor::erase(CursorId id) {
-        recursive_scoped_lock lock(ccmutex);
-        ClientCursor* cursor = find_inlock(id);
+    bool ClientCursor::touch(CursorId id) {
+        Stripe &stripe = stripeFor(id);
+        recursive_scoped_lock lock(stripe.mutex);
+        ClientCursor* cursor = find_inlock(stripe, id, false);
         if (!cursor) {
             return false;
         }
 
-        return _erase_inlock(cursor);
+        cursor->resetIdleAge();
+        return true;
     }
 
     bool ClientCursor::eraseIfAuthorized(CursorId id) {
+        Stripe &stripe = stripeFor(id);
         std::string ns;
         {
-            recursive_scoped_lock lock(ccmutex);
-            ClientCursor* cursor = find_inlock(id);
+            recursive_scoped_lock lock(stripe.mutex);
+            ClientCursor* cursor = find_inlock(stripe, id);
             if (!cursor) {
                 return false;
             }
@@ -502,19 +601,24 @@ namespace mongo {
         // It is safe to lookup the cursor again after temporarily releasing the mutex because
         // of 2 invariants: that the cursor ID won't be re-used in a short period of time, and that
         // the namespace associated with a cursor cannot change.
-        recursive_scoped_lock lock(ccmutex);
-        ClientCursor* cursor = find_inlock(id);
-        if (!cursor) {
-            // Cursor was deleted in another thread since we found it earlier in this function.
-            return false;
-        }
-        if (cursor->ns() != ns) {
-            warning() << "Cursor namespace changed. Previous ns: " << ns << ", current ns: "
-                    << cursor->ns() << endl;
-            return false;
+        ClientCursor* cursor;
+        {
+            recursive_scoped_lock lock(stripe.mutex);
+            cursor = find_inlock(stripe, id);
+            if (!cursor) {
+                // Cursor was deleted in another thread since we found it earlier in this function.
+                return false;
+            }
+            if (cursor->ns() != ns) {
+                warning() << "Cursor namespace changed. Previous ns: " << ns << ", current ns: "
+                        << cursor->ns() << endl;
+                return false;
+            }
+            _unregisterForErase_inlock(stripe, cursor);
         }
 
-        return _erase_inlock(cursor);
+        delete cursor;
+        return true;
     }
 
     int ClientCursor::erase(int n, long long *ids) {
@@ -34,6 +34,7 @@
 #include "mongo/db/matcher.h"
 #include "mongo/db/projection.h"
 #include "mongo/db/keypattern.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/s/d_chunk_manager.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/listen.h"
@@ -54,6 +55,8 @@ namespace mongo {
     */
     typedef map<CursorId, ClientCursor*> CCById;
 
+    class PseudoRandom;
+
     extern BSONObj id_obj;
     
     class ClientCursor : private boost::noncopyable {
@@ -69,12 +72,11 @@ namespace mongo {
         public:
             Pin( long long cursorid ) :
                 _cursorid( INVALID_CURSOR_ID ) {
-                recursive_scoped_lock lock( ccmutex );
-                ClientCursor *cursor = ClientCursor::find_inlock( cursorid, true );
+                Stripe &stripe = stripeFor( cursorid );
+                recursive_scoped_lock lock( stripe.mutex );
+                ClientCursor *cursor = ClientCursor::find_inlock( stripe, cursorid, true );
                 if ( cursor ) {
-                    uassert( 12051, "clientcursor already in use? driver problem?",
-                            cursor->_pinValue < 100 );
-                    cursor->_pinValue += 100;
+                    cursor->pin();
                     _cursorid = cursorid;
                 }
             }
@@ -85,8 +87,7 @@ namespace mongo {
                 ClientCursor *cursor = c();
                 _cursorid = INVALID_CURSOR_ID;
                 if ( cursor ) {
-                    verify( cursor->_pinValue >= 100 );
-                    cursor->_pinValue -= 100;
+                    cursor->unpin();
                 }
             }
             ~Pin() { DESTRUCTOR_GUARD( release(); ) }
@@ -142,23 +143,33 @@ namespace mongo {
         };
 
         /**
-         * Iterates through all ClientCursors, under its own ccmutex lock.
+         * Iterates through all ClientCursors, one stripe of the registry at a time, holding only
+         * that stripe's lock.  Cursors created in a stripe that was already visited are missed.
          * Also supports deletion on the fly.
          */
         class LockedIterator : boost::noncopyable {
         public:
-            LockedIterator() : _lock( ccmutex ), _i( clientCursorsById.begin() ) {}
-            bool ok() const { return _i != clientCursorsById.end(); }
+            LockedIterator();
+            ~LockedIterator();
+            bool ok() const { return _stripe < kNumStripes; }
             ClientCursor *current() const { return _i->second; }
-            void advance() { ++_i; }
+            void advance();
             /**
-             * Delete 'current' and advance. Properly handles cascading deletions that may occur
-             * when one ClientCursor is directly deleted.
+             * Delete 'current' and advance.  current is removed from the registry right away, and
+             * destroyed once the stripe's lock is released, so cascading deletions that may occur
+             * when one ClientCursor is deleted don't run under it.
              */
             void deleteAndAdvance();
         private:
-            recursive_scoped_lock _lock;
-            CCById::const_iterator _i;
+            void lockStripe();
+            void unlockStripe();
+            /** skips to the next cursor, in this stripe or the next nonempty one */
+            void settle();
+
+            unsigned _stripe;
+            scoped_ptr<recursive_scoped_lock> _lock;
+            CCById::iterator _i;
+            vector<ClientCursor *> _doomed;
         };
         
         ClientCursor(int queryOptions, const shared_ptr<Cursor>& c, const string& ns,
@@ -249,9 +260,27 @@ namespace mongo {
         ShardChunkManagerPtr getChunkManager(){ return _chunkManager; }
 
     private:
-        static ClientCursor* find_inlock(CursorId id, bool warn = true) {
-            CCById::iterator it = clientCursorsById.find(id);
-            if ( it == clientCursorsById.end() ) {
+        /**
+         * The registry of cursors is split into kNumStripes stripes, each with its own lock, so
+         * that getMores on different cursors rarely contend.  The low bits of a cursor's id are
+         * its stripe.
+         */
+        static const unsigned kNumStripes = 32;
+        struct Stripe {
+            boost::recursive_mutex mutex;
+            CCById cursors;
+            // for allocating ids
+            long long genTSLast;
+            PseudoRandom *genRandom;
+            Stripe() : genTSLast(0), genRandom(NULL) {}
+        };
+        static Stripe &stripeFor(CursorId id) {
+            return stripes[static_cast<unsigned long long>(id) % kNumStripes];
+        }
+
+        static ClientCursor* find_inlock(Stripe &stripe, CursorId id, bool warn = true) {
+            CCById::iterator it = stripe.cursors.find(id);
+            if ( it == stripe.cursors.end() ) {
                 if ( warn )
                     OCCASIONALLY out() << "ClientCursor::find(): cursor not found in map " << id << " (ok after a drop)\n";
                 return 0;
@@ -261,14 +290,27 @@ namespace mongo {
 
     public:
         static ClientCursor* find(CursorId id, bool warn = true) {
-            recursive_scoped_lock lock(ccmutex);
-            ClientCursor *c = find_inlock(id, warn);
+            Stripe &stripe = stripeFor(id);
+            recursive_scoped_lock lock(stripe.mutex);
+            ClientCursor *c = find_inlock(stripe, id, warn);
             // if this asserts, your code was not thread safe - you either need to set no timeout
             // for the cursor or keep a ClientCursor::Pointer in scope for it.
-            massert( 12521, "internal error: use of an unlocked ClientCursor", c == 0 || c->_pinValue );
+            massert( 12521, "internal error: use of an unlocked ClientCursor", c == 0 || c->_pinValue.load() );
             return c;
         }
 
+        /** @return which stripe of the registry the cursor with this id is in. */
+        static unsigned stripeOf(CursorId id) {
+            return static_cast<unsigned long long>(id) % kNumStripes;
+        }
+
+        /**
+         * Resets the idle age of the cursor with the provided @param 'id', pinned or not, so it
+         * doesn't time out while a client is busy elsewhere.  No auth checking, like erase().
+         * @return true if the cursor exists
+         */
+        static bool touch(CursorId id);
+
         /**
          * Deletes the cursor with the provided @param 'id' if one exists.
          * @throw if the cursor with the provided id is pinned.
@@ -278,7 +320,7 @@ namespace mongo {
         static bool erase(CursorId id);
         // Same as erase but checks to make sure this thread has read permission on the cursor's
         // namespace.  This should be called when receiving killCursors from a client.  This should
-        // not be called when ccmutex is held.
+        // not be called when a stripe's lock is held.
         static bool eraseIfAuthorized(CursorId id);
 
         /**
@@ -303,7 +345,7 @@ namespace mongo {
         static void idleTimeReport(unsigned millis);
 
         static void appendStats( BSONObjBuilder& result );
-        static unsigned numCursors() { return clientCursorsById.size(); }
+        static unsigned numCursors() { return numberOpen.load(); }
         static void find( const string& ns , set<CursorId>& all );
 
     public:
@@ -328,9 +370,20 @@ namespace mongo {
 
         // cursors normally timeout after an inactivity period to prevent excess memory use
         // setting this prevents timeout of the cursor in question.
-        void noTimeout() { _pinValue++; }
+        void noTimeout() { _pinValue.fetchAndAdd(1); }
+
+        /** Pins are a compare-and-swap on _pinValue, so two can't both succeed. */
+        void pin();
+        void unpin();
 
-        static bool _erase_inlock(ClientCursor* cursor);
+        /** Removes this from stripe's map, if it is still there.  Needs stripe's lock. */
+        void unregister_inlock(Stripe &stripe);
+
+        /**
+         * Takes an unpinned cursor out of stripe for erase() to delete once the lock is released,
+         * since deleting it can delete nested cursors in other stripes.
+         */
+        static void _unregisterForErase_inlock(Stripe &stripe, ClientCursor* cursor);
 
         CursorId _cursorid;
 
@@ -355,7 +408,7 @@ namespace mongo {
            1 = no timeout allowed
            100 = in use (pinned) -- see Pointer class
         */
-        unsigned _pinValue;
+        AtomicUInt32 _pinValue;
 
         ShardChunkManagerPtr _chunkManager;
         bool _partOfMultiStatementTxn;
@@ -367,10 +420,11 @@ namespace mongo {
 
     private: // static members
 
-        static CCById clientCursorsById;
+        static Stripe *stripes;
+        static AtomicUInt32 numberOpen;
+        static AtomicUInt32 nextStripe;
         static long long numberTimedOut;
-        static boost::recursive_mutex& ccmutex;   // must use this for all statics above!
-        static CursorId allocCursorId_inlock();
+        static CursorId allocCursorId_inlock(Stripe &stripe, unsigned stripeNum);
 
     };
 
@@ -162,7 +162,7 @@ namespace mongo {
        we need to fix up the value in the "ns" parameter so that the name prefix is correct on a
        copy to a new name.
     */
-    static BSONObj fixindex(BSONObj o, const string &dbname) {
+    BSONObj fixindex(BSONObj o, const string &dbname) {
         BSONObjBuilder b;
         BSONObjIterator i(o);
         while ( i.moreWithEOO() ) {
@@ -193,6 +193,31 @@ namespace mongo {
         return res;
     }
 
+    void insertClonedCappedObject(const StringData &ns, const BSONObj &js) {
+        Collection *cl = getCollection(ns);
+        verify(cl->isCapped());
+        BSONObj pk = js["$_"].Obj();
+        BSONObjBuilder rowBuilder;
+        BSONObjIterator it(js);
+        while (it.moreWithEOO()) {
+            BSONElement e = it.next();
+            if (e.eoo()) {
+                break;
+            }
+            if (!mongoutils::str::equals(e.fieldName(), "$_")) {
+                rowBuilder.append(e);
+            }
+        }
+        BSONObj row = rowBuilder.obj();
+        CappedCollection *cappedCl = cl->as<CappedCollection>();
+        bool indexBitChanged = false;
+        cappedCl->insertObjectWithPK(pk, row, Collection::NO_LOCKTREE, &indexBitChanged);
+        // Hack copied from Collection::insertObject. TODO: find a better way to do this
+        if (indexBitChanged) {
+            cl->noteMultiKeyChanged();
+        }
+    }
+
     struct Cloner::Fun {
         void operator()(DBClientCursorBatchIterator &i) {
             const string to_dbname = nsToDatabase(to_collection);
@@ -213,28 +238,7 @@ namespace mongo {
                         LOCK_REASON(lockReason, "cloner: copying documents into local collection");
                         Client::ReadContext ctx(to_collection, lockReason);
                         if (_isCapped) {
-                            Collection *cl = getCollection(to_collection);
-                            verify(cl->isCapped());
-                            BSONObj pk = js["$_"].Obj();
-                            BSONObjBuilder rowBuilder;                        
-                            BSONObjIterator it(js);
-                            while (it.moreWithEOO()) {
-                                BSONElement e = it.next();
-                                if (e.eoo()) {
-                                    break;
-                                }
-                                if (!mongoutils::str::equals(e.fieldName(), "$_")) {
-                                    rowBuilder.append(e);
-                                }
-                            }
-                            BSONObj row = rowBuilder.obj();
-                            CappedCollection *cappedCl = cl->as<CappedCollection>();
-                            bool indexBitChanged = false;
-                            cappedCl->insertObjectWithPK(pk, row, Collection::NO_LOCKTREE, &indexBitChanged);
-                            // Hack copied from Collection::insertObject. TODO: find a better way to do this                        
-                            if (indexBitChanged) {
-                                cl->noteMultiKeyChanged();
-                            }
+                            insertClonedCappedObject(to_collection, js);
                         }
                         else {
                             insertObject(to_collection, js, 0, logForRepl);
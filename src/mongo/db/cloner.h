@@ -49,6 +49,19 @@ namespace mongo {
     };
 
     class DBClientBase;
+    class DBClientConnection;
+
+    /** Connects to masterHost and authenticates as a replication peer. Empty on failure. */
+    shared_ptr<DBClientConnection> makeConnection(const char *masterHost, string& errmsg);
+
+    /** Rewrites the ns of a system.indexes entry into dbname, and drops its "v" field. */
+    BSONObj fixindex(BSONObj o, const string &dbname);
+
+    /**
+     * Inserts a document read with QueryOption_AddHiddenPK into the capped collection ns,
+     * keeping the primary key it had on the source.  Caller holds a lock on ns.
+     */
+    void insertClonedCappedObject(const StringData &ns, const BSONObj &js);
 
     bool cloneFrom(
         const string& masterHost , 
@@ -90,6 +90,8 @@ namespace mongo {
 
 namespace mongo {
 
+    MONGO_EXPORT_SERVER_PARAMETER(networkMessageCompression, bool, true);
+
     static bool _isPasswordArgument(char const* argumentName);
     static bool _isPasswordSwitch(char const* switchName);
 
@@ -200,6 +200,12 @@ namespace mongo {
 
     extern CmdLine cmdLine;
 
+    /**
+     * Whether internal connections (replication, sharding) offer to compress their messages,
+     * and whether isMaster accepts such offers from clients.
+     */
+    extern bool networkMessageCompression;
+
     void printCommandLineOpts();
 }
 
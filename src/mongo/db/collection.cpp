@@ -648,7 +648,7 @@ namespace mongo {
     bool CollectionBase::findByPK(const BSONObj &key, BSONObj &result) const {
         TOKULOG(3) << "CollectionBase::findByPK looking for " << key << endl;
 
-        storage::Key sKey(key, NULL);
+        storage::Key sKey(key, NULL, getPKIndexBase().descriptor());
         DBT key_dbt = sKey.dbt();
         DB *db = getPKIndexBase().db();
 
@@ -673,6 +673,83 @@ namespace mongo {
         return false;
     }
 
+    // A run of pks is prelocked as one range only if the range holds at most
+    // this many rows per pk, so a batch of widely spread pks doesn't lock and
+    // prefetch much of the table.
+    static const uint64_t maxPrelockedRowsPerPK = 4;
+    // Sparse runs shorter than twice this aren't split further to look for
+    // dense ones, their pks are looked up one at a time.
+    static const size_t minPrelockedRun = 16;
+
+    void CollectionBase::findByPKs(const vector<BSONObj> &pks, vector<BSONObj> &results) const {
+        results.clear();
+        results.resize(pks.size());
+        findByPKRun(pks, 0, pks.size(), results);
+    }
+
+    void CollectionBase::findByPKRun(const vector<BSONObj> &pks, size_t begin, size_t end,
+                                     vector<BSONObj> &results) const {
+        const size_t n = end - begin;
+        if (n <= 1) {
+            if (n == 1) {
+                findByPK(pks[begin], results[begin]);
+            }
+            return;
+        }
+
+        const IndexDetailsBase &pkIdx = getPKIndexBase();
+        const Descriptor &pkDescriptor = pkIdx.descriptor();
+        storage::Key leftSKey(pks[begin], NULL, pkDescriptor);
+        storage::Key rightSKey(pks[end - 1], NULL, pkDescriptor);
+        bool exact;
+        // [first, last) from the tree's subtree counts, plus the last pk
+        const uint64_t rows = pkIdx.estimateKeysInRange(leftSKey, rightSKey, exact) + 1;
+        if (rows > maxPrelockedRowsPerPK * n) {
+            if (n < 2 * minPrelockedRun) {
+                for (size_t i = begin; i < end; i++) {
+                    findByPK(pks[i], results[i]);
+                }
+            } else {
+                const size_t mid = begin + n / 2;
+                findByPKRun(pks, begin, mid, results);
+                findByPKRun(pks, mid, end, results);
+            }
+            return;
+        }
+
+        // The pks are sorted and close together, so bounding the cursor by the
+        // first and last pk takes all the row locks at once and lets the fractal
+        // tree prefetch the leaves in between, instead of a cold root-to-leaf
+        // search per row.
+        const int cursorFlags = cc().opSettings().getQueryCursorMode() != DEFAULT_LOCK_CURSOR ?
+                                DB_SERIALIZABLE | DB_RMW : 0;
+        shared_ptr<storage::Cursor> c = pkIdx.getCursor(cursorFlags);
+        DBC *cursor = c->dbc();
+
+        DBT start = leftSKey.dbt();
+        DBT endDBT = rightSKey.dbt();
+        int r = cursor->c_set_bounds(cursor, &start, &endDBT, true, 0);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+
+        for (size_t i = begin; i < end; i++) {
+            dassert(i == begin || pks[i - 1].woCompare(pks[i], pkIdx.keyPattern()) <= 0);
+            storage::Key sKey(pks[i], NULL, pkDescriptor);
+            DBT key_dbt = sKey.dbt();
+            struct findByPKCallbackExtra extra(results[i]);
+            r = cursor->c_getf_set(cursor, DB_PRELOCKED | DB_PRELOCKED_WRITE, &key_dbt,
+                                   findByPKCallback, &extra);
+            if (r == -1) {
+                extra.throwException();
+                msgasserted(17381, "got -1 from findByPKCallback but no exception saved");
+            }
+            if (r != 0 && r != DB_NOTFOUND) {
+                storage::handle_ydb_error(r);
+            }
+        }
+    }
+
     int CollectionBase::getLastKeyCallback(const DBT *key, const DBT *value, void *extra) {
         struct findByPKCallbackExtra *info = reinterpret_cast<findByPKCallbackExtra *>(extra);
         try {
@@ -723,7 +800,7 @@ namespace mongo {
         storage::DBTArrays valArrays(n);
         uint32_t put_flags[n];
 
-        storage::Key sPK(pk, NULL);
+        storage::Key sPK(pk, NULL, getPKIndexBase().descriptor());
         DBT src_key = storage::dbt_make(sPK.buf(), sPK.size());
         DBT src_val = storage::dbt_make(obj.objdata(), obj.objsize());
 
@@ -763,7 +840,7 @@ namespace mongo {
                 DBT_ARRAY *array = &keyArrays[i];
                 storage::dbt_array_clear_and_resize(array, idxKeys.size());
                 for (BSONObjSet::const_iterator it = idxKeys.begin(); it != idxKeys.end(); it++) {
-                    const storage::Key sKey(*it, &pk);
+                    const storage::Key sKey(*it, &pk, idx.descriptor());
                     storage::dbt_array_push(array, sKey.buf(), sKey.size());
                 }
             }
@@ -803,7 +880,7 @@ namespace mongo {
         storage::DBTArrays keyArrays(n);
         uint32_t del_flags[n];
 
-        storage::Key sPK(pk, NULL);
+        storage::Key sPK(pk, NULL, getPKIndexBase().descriptor());
         DBT src_key = storage::dbt_make(sPK.buf(), sPK.size());
         DBT src_val = storage::dbt_make(obj.objdata(), obj.objsize());
 
@@ -833,7 +910,7 @@ namespace mongo {
                 DBT_ARRAY *array = &keyArrays[i];
                 storage::dbt_array_clear_and_resize(array, idxKeys.size());
                 for (BSONObjSet::const_iterator it = idxKeys.begin(); it != idxKeys.end(); it++) {
-                    const storage::Key sKey(*it, &pk);
+                    const storage::Key sKey(*it, &pk, idx.descriptor());
                     storage::dbt_array_push(array, sKey.buf(), sKey.size());
                 }
             }
@@ -895,7 +972,7 @@ namespace mongo {
         storage::DBTArrays valArrays(n);
         uint32_t update_flags[n];
 
-        storage::Key sPK(pk, NULL);
+        storage::Key sPK(pk, NULL, getPKIndexBase().descriptor());
         DBT src_key = storage::dbt_make(sPK.buf(), sPK.size());
         DBT new_src_val = storage::dbt_make(newObj.objdata(), newObj.objsize());
         DBT old_src_val = storage::dbt_make(oldObj.objdata(), oldObj.objsize());
@@ -947,13 +1024,13 @@ namespace mongo {
                 DBT_ARRAY *array = &keyArrays[i];
                 storage::dbt_array_clear_and_resize(array, newIdxKeys.size());
                 for (BSONObjSet::const_iterator it = newIdxKeys.begin(); it != newIdxKeys.end(); it++) {
-                    const storage::Key sKey(*it, &pk);
+                    const storage::Key sKey(*it, &pk, idx.descriptor());
                     storage::dbt_array_push(array, sKey.buf(), sKey.size());
                 }
                 array = &keyArrays[i + n];
                 storage::dbt_array_clear_and_resize(array, oldIdxKeys.size());
                 for (BSONObjSet::const_iterator it = oldIdxKeys.begin(); it != oldIdxKeys.end(); it++) {
-                    const storage::Key sKey(*it, &pk);
+                    const storage::Key sKey(*it, &pk, idx.descriptor());
                     storage::dbt_array_push(array, sKey.buf(), sKey.size());
                 }
             }
@@ -1230,9 +1307,9 @@ namespace mongo {
             const bool isPK = isPKIndex(idx);
 
             storage::Key leftSKey(ascending ? minKey : maxKey,
-                                  isPK ? NULL : &minKey);
+                                  isPK ? NULL : &minKey, idx.descriptor());
             storage::Key rightSKey(ascending ? maxKey : minKey,
-                                   isPK ? NULL : &maxKey);
+                                   isPK ? NULL : &maxKey, idx.descriptor());
             uint64_t loops_run;
             idx.optimize(leftSKey, rightSKey, true, 0, &loops_run);
             return false;
@@ -2645,7 +2722,7 @@ namespace mongo {
     void BulkLoadedCollection::insertObject(BSONObj &obj, uint64_t flags, bool* indexBitChanged) {
         const BSONObj pk = getValidatedPKFromObject(obj);
 
-        storage::Key sPK(pk, NULL);
+        storage::Key sPK(pk, NULL, getPKIndexBase().descriptor());
         DBT key = storage::dbt_make(sPK.buf(), sPK.size());
         DBT val = storage::dbt_make(obj.objdata(), obj.objsize());
         const int r = _loader->put(&key, &val);
@@ -2763,11 +2840,44 @@ namespace mongo {
         sanityCheck();    
     }
 
+    const char PartitionRetention::fieldName[] = "partitionRetention";
+
+    bool PartitionRetention::parse(const BSONObj &options, PartitionRetention *policy) {
+        BSONElement e = options[fieldName];
+        if (e.eoo()) {
+            return false;
+        }
+        uassert(17391, "partitionRetention must be an object", e.type() == Object);
+        BSONObj o = e.Obj();
+        BSONElement interval = o["intervalSeconds"];
+        uassert(17392, "partitionRetention requires a positive intervalSeconds",
+                interval.isNumber() && interval.numberLong() > 0);
+        BSONElement expire = o["expireAfterSeconds"];
+        uassert(17393, "partitionRetention requires a positive expireAfterSeconds",
+                expire.isNumber() && expire.numberLong() > 0);
+        BSONElement precreate = o["precreate"];
+        uassert(17394, "partitionRetention precreate must be a number between 0 and 1000",
+                precreate.eoo() || (precreate.isNumber() && precreate.numberLong() >= 0 &&
+                                    precreate.numberLong() <= 1000));
+        policy->intervalMillis = interval.numberLong() * 1000;
+        policy->expireMillis = expire.numberLong() * 1000;
+        policy->precreate = precreate.eoo() ? 2 : precreate.numberInt();
+        return true;
+    }
+
     shared_ptr<PartitionedCollection> PartitionedCollection::make(
         const StringData &ns,
         const BSONObj &options
         )
     {
+        PartitionRetention policy;
+        if (PartitionRetention::parse(options, &policy)) {
+            // Partitions are cut at dates of the first primary key field, and expire oldest
+            // first, so that field must sort ascending.
+            uassert(17395, "partitionRetention requires a primary key that starts with an ascending field",
+                    getPrimaryKeyFromOptions(options).firstElement().number() > 0);
+        }
+
         shared_ptr<PartitionedCollection> ret;
         BSONObj stripped = cloneBSONWithFieldStripped(options, "partitioned");
         ret.reset(new PartitionedCollection(ns, stripped));
@@ -2916,6 +3026,27 @@ namespace mongo {
         return retval;
     }
 
+    void PartitionedCollection::findByPKs(const vector<BSONObj> &pks,
+                                          vector<BSONObj> &results) const {
+        results.clear();
+        results.resize(pks.size());
+        // Partitions are ranges of the pk, so each run of sorted pks that
+        // lands in the same partition is a batch for that partition.
+        vector<BSONObj> runPKs, runResults;
+        size_t runStart = 0;
+        while (runStart < pks.size()) {
+            const uint64_t whichPartition = partitionWithPK(pks[runStart]);
+            size_t runEnd = runStart + 1;
+            while (runEnd < pks.size() && partitionWithPK(pks[runEnd]) == whichPartition) {
+                runEnd++;
+            }
+            runPKs.assign(pks.begin() + runStart, pks.begin() + runEnd);
+            _partitions[whichPartition]->findByPKs(runPKs, runResults);
+            std::copy(runResults.begin(), runResults.end(), results.begin() + runStart);
+            runStart = runEnd;
+        }
+    }
+
     bool PartitionedCollection::isMultiKey(int idx) const {
         for (uint64_t i = 0; i < numPartitions(); i++) {
             if (_partitions[i]->isMultiKey(idx)) {
@@ -2997,6 +3128,30 @@ namespace mongo {
         return ret;
     }
     
+    shared_ptr<Cursor> PartitionedCollection::makePartitionRangeCursor(
+        const uint64_t firstPartition,
+        const uint64_t lastPartition
+        )
+    {
+        massert(17396, str::stream() << "invalid partition range [" << firstPartition << ", "
+                                     << lastPartition << "] (max: " << numPartitions() << ")",
+                firstPartition <= lastPartition && lastPartition < numPartitions());
+        shared_ptr<SinglePartitionCursorGenerator> subCursorGenerator (
+            new ExhaustivePartitionCursorGenerator(
+                this,
+                0,
+                1,
+                false,
+                true
+                )
+            );
+        shared_ptr<PartitionedCursorIDGenerator> subPartitionIDGenerator (
+            new PartitionedCursorIDGeneratorImpl(firstPartition, lastPartition, 1)
+            );
+        shared_ptr<Cursor> ret (new PartitionedCursor(false, subCursorGenerator, subPartitionIDGenerator, false));
+        return ret;
+    }
+
     shared_ptr<Cursor> PartitionedCollection::makeCursor(const IndexDetails &idx,
                                     const int direction, 
                                     const bool countCursor) {
@@ -175,6 +175,10 @@ namespace mongo {
         // Find by primary key (single element bson object, no field name).
         virtual bool findByPK(const BSONObj &pk, BSONObj &result) const = 0;
 
+        // Find a batch of primary keys, given in ascending pk order. results[i]
+        // is set to the object for pks[i], or left empty if it wasn't found.
+        virtual void findByPKs(const vector<BSONObj> &pks, vector<BSONObj> &results) const = 0;
+
         virtual bool isPKHidden() const = 0;
 
         // Extracts and returns validates an owned BSONObj represetning
@@ -370,10 +374,6 @@ namespace mongo {
             return _queryCache;
         }
 
-        void notifyOfWriteOp() {
-            _queryCache.notifyOfWriteOp();
-        }
-
         //
         // Simple collection metadata - common to all collections.
         //
@@ -517,6 +517,11 @@ namespace mongo {
             return _cd->findByPK(pk, result);
         }
 
+        // Find a batch of primary keys, given in ascending pk order.
+        void findByPKs(const vector<BSONObj> &pks, vector<BSONObj> &results) const {
+            _cd->findByPKs(pks, results);
+        }
+
         bool isPKHidden() const {
             return _cd->isPKHidden();
         }
@@ -784,6 +789,11 @@ namespace mongo {
         // Find by primary key (single element bson object, no field name).
         bool findByPK(const BSONObj &pk, BSONObj &result) const;
 
+        // Find a batch of primary keys, given in ascending pk order. Runs of
+        // nearby pks are read with one prelocked pass over the primary key
+        // index each, pks far from any other are looked up one at a time.
+        void findByPKs(const vector<BSONObj> &pks, vector<BSONObj> &results) const;
+
         // Extracts and returns validates an owned BSONObj represetning
         // the primary key portion of the given object. Validates each
         // field, ensuring there are no undefined, regex, or array types.
@@ -1016,6 +1026,9 @@ namespace mongo {
             findByPKCallbackExtra(BSONObj &o) : obj(o) { }
         };
         static int findByPKCallback(const DBT *key, const DBT *value, void *extra);
+        // findByPKs for pks[begin, end)
+        void findByPKRun(const vector<BSONObj> &pks, size_t begin, size_t end,
+                         vector<BSONObj> &results) const;
         static int getLastKeyCallback(const DBT *key, const DBT *value, void *extra);
 
         // @return the smallest (in terms of dataSize, which is key length + value length)
@@ -1311,6 +1324,27 @@ namespace mongo {
     string getMetaCollectionName(const StringData &ns);
     string getPartitionName(const StringData &ns, uint64_t partitionID);
 
+    // A retention policy for a partitioned collection whose primary key starts with a date,
+    // given at creation time:
+    //
+    //   { partitioned: true, primaryKey: { ts: 1, _id: 1 },
+    //     partitionRetention: { intervalSeconds: 3600, expireAfterSeconds: 604800, precreate: 2 } }
+    //
+    // The TTL monitor cuts partitions at multiples of 'intervalSeconds', keeping 'precreate'
+    // partitions ready after the one for the current interval, and drops whole partitions once
+    // everything in them is older than 'expireAfterSeconds'.
+    struct PartitionRetention {
+        static const char fieldName[];
+
+        long long intervalMillis;
+        long long expireMillis;
+        int precreate;
+
+        // Fills in 'policy' from collection options.  Returns false if the options have no
+        // retention policy, uasserts if the policy is malformed.
+        static bool parse(const BSONObj &options, PartitionRetention *policy);
+    };
+
     class PartitionedCollection : public CollectionData {
     public:
         //
@@ -1390,6 +1424,8 @@ namespace mongo {
             return _partitions[whichPartition]->findByPK(pk, result);
         }
 
+        virtual void findByPKs(const vector<BSONObj> &pks, vector<BSONObj> &results) const;
+
         virtual bool isPKHidden() const {
             return _partitions[0]->isPKHidden();
         }
@@ -1507,6 +1543,11 @@ namespace mongo {
                                        const int direction, const int numWanted,
                                        const bool countCursor);
 
+        // table scan over the partitions at offsets firstPartition through lastPartition,
+        // used to hand out disjoint pieces of the collection (see parallelCollectionScan)
+        shared_ptr<Cursor> makePartitionRangeCursor(const uint64_t firstPartition,
+                                                    const uint64_t lastPartition);
+
 
         class Renamer : public CollectionRenamer {
             shared_ptr<CollectionRenamer> _metaRenamer;
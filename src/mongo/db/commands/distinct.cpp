@@ -31,6 +31,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/query_optimizer.h"
+#include "mongo/db/queryutil.h"
 #include "mongo/util/timer.h"
 
 namespace mongo {
@@ -46,7 +47,9 @@ namespace mongo {
             out->push_back(Privilege(parseNs(dbname, cmdObj), actions));
         }
         virtual void help( stringstream &help ) const {
-            help << "{ distinct : 'collection name' , key : 'a.b' , query : {} }";
+            help << "{ distinct : 'collection name' , key : 'a.b' , query : {} }\n"
+                 << "when the query only constrains key, the values are read off an index led by key,\n"
+                 << "one entry per value; skipScan : false reads every entry instead";
         }
 
         bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
@@ -78,6 +81,12 @@ namespace mongo {
                 return true;
             }
 
+            const BSONElement skipScan = cmdObj["skipScan"];
+            if ( ( skipScan.eoo() || skipScan.trueValue() ) &&
+                 distinctFromIndex( cl, ns, key, query, result, t ) ) {
+                return true;
+            }
+
             shared_ptr<Cursor> cursor;
             if ( ! query.isEmpty() ) {
                 cursor = getOptimizedCursor(ns.c_str() , query , BSONObj() );
@@ -163,6 +172,128 @@ namespace mongo {
             return true;
         }
 
+    private:
+        /**
+         * Reads the distinct values of key straight off an index led by it, with a skip scan
+         * that visits one index entry per value rather than one per document.  This only works
+         * if the index keys alone can answer the query, so the query may constrain nothing but
+         * key itself, and exactly.
+         *
+         * The documents aren't visited, so there is no count of matching documents to report
+         * as n.  nDistinct is the number of values read.
+         *
+         * @return false if no index fits, and the documents have to be scanned
+         */
+        bool distinctFromIndex( Collection *cl, const string &ns, const string &key,
+                                const BSONObj &query, BSONObjBuilder &result, const Timer &t ) {
+            if ( cl->isPartitioned() ) {
+                return false;
+            }
+            BSONForEach( e, query ) {
+                if ( key != e.fieldName() ) {
+                    return false;
+                }
+            }
+            FieldRangeSet frs( ns.c_str(), query, true, true );
+            if ( !frs.matchPossible() || !frs.mustBeExactMatchRepresentation() ) {
+                return false;
+            }
+
+            int idxNo = -1;
+            for ( int i = 0; i < cl->nIndexes(); i++ ) {
+                IndexDetails &idx = cl->idx( i );
+                if ( cl->isMultikey( i ) || idx.special() ||
+                     key != idx.keyPattern().firstElementFieldName() ) {
+                    continue;
+                }
+                // Prefer the narrowest index, its entries pack more densely.
+                if ( idxNo < 0 || idx.keyPattern().nFields() < cl->idx( idxNo ).keyPattern().nFields() ) {
+                    idxNo = i;
+                }
+            }
+            if ( idxNo < 0 ) {
+                return false;
+            }
+
+            IndexDetails &idx = cl->idx( idxNo );
+            shared_ptr<FieldRangeVector> bounds( new FieldRangeVector( frs, idx.keyPattern(), 1 ) );
+            shared_ptr<Cursor> cursor = Cursor::makeSkipScan( cl, idx, bounds );
+            const string cursorName = cursor->toString();
+            auto_ptr<ClientCursor> cc( new ClientCursor( QueryOption_NoCursorTimeout, cursor, ns ) );
+
+            int bufSize = BSONObjMaxUserSize - 4096;
+            BufBuilder bb( bufSize );
+            char * start = bb.buf();
+            BSONArrayBuilder arr( bb );
+            BSONElementSet values;
+            long long nDistinct = 0;
+            long long nscannedObjects = 0;
+
+            for ( ; cursor->ok(); cursor->advance() ) {
+                if ( !cursor->currentMatches() ) {
+                    continue;
+                }
+                nDistinct++;
+
+                BSONObj currKey = cursor->currKey();
+                BSONElement e = currKey.firstElement();
+                if ( values.count( e ) )
+                    continue;
+                // A document without the field indexes as null too, but gives no value.
+                if ( e.isNull() && !hasNullValue( cl, ns, key, idx, nscannedObjects ) )
+                    continue;
+
+                int now = bb.len();
+
+                uassert(17420,  "distinct too big, 16mb cap", ( now + e.size() + 1024 ) < bufSize );
+
+                arr.append( e );
+                BSONElement x( start + now );
+
+                values.insert( x );
+
+                RARELY killCurrentOp.checkForInterrupt();
+            }
+
+            verify( start == bb.buf() );
+
+            result.appendArray( "values" , arr.done() );
+
+            {
+                BSONObjBuilder b;
+                b.appendNumber( "nDistinct" , nDistinct );
+                b.appendNumber( "nscanned" , cursor->nscanned() );
+                b.appendNumber( "nscannedObjects" , nscannedObjects );
+                b.appendNumber( "timems" , t.millis() );
+                b.append( "cursor" , cursorName );
+                result.append( "stats" , b.obj() );
+            }
+
+            return true;
+        }
+
+        /**
+         * @return true if some document with a null key in idx, which leads with key, has an
+         * actual null for key rather than no value at all.  Counts the documents read in
+         * nscannedObjects.
+         */
+        bool hasNullValue( Collection *cl, const string &ns, const string &key,
+                           const IndexDetails &idx, long long &nscannedObjects ) {
+            FieldRangeSet frs( ns.c_str(), BSON( key << BSONNULL ), true, true );
+            shared_ptr<FieldRangeVector> bounds( new FieldRangeVector( frs, idx.keyPattern(), 1 ) );
+            shared_ptr<Cursor> cursor = Cursor::make( cl, idx, bounds, 0, 1 );
+            for ( ; cursor->ok(); cursor->advance() ) {
+                nscannedObjects++;
+                BSONElementSet temp;
+                cursor->current().getFieldsDotted( key, temp );
+                if ( !temp.empty() ) {
+                    return true;
+                }
+                RARELY killCurrentOp.checkForInterrupt();
+            }
+            return false;
+        }
+
     } distinctCmd;
 
 }
@@ -0,0 +1,227 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/clientcursor.h"
+#include "mongo/db/collection.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/index.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/keypattern.h"
+#include "mongo/db/storage/key.h"
+
+namespace mongo {
+
+    /**
+     * Splits a collection into up to numCursors disjoint pieces of roughly equal size and
+     * returns a ClientCursor for each, so a client can read the whole collection with one
+     * thread per cursor using ordinary getMores.
+     *
+     * A normal collection is cut at primary keys found with the fractal tree's
+     * get_key_after_bytes estimate, stepping dataSize / numCursors bytes at a time.  A
+     * partitioned collection is cut at partition boundaries, so it gets at most one cursor
+     * per partition.  Fewer cursors than asked for come back when the collection is too
+     * small (or too skewed) to cut that many times.
+     *
+     * Each cursor gets its own snapshot transaction, the same way a saved query cursor does.
+     */
+    class ParallelCollectionScanCmd : public QueryCommand {
+        static const int MaxCursors = 10000;
+
+        // Collects the cut points for a non-partitioned collection, in primary key format
+        // (no field names).
+        class SplitPointFinder {
+            const IndexDetailsBase &_pk;
+            const Ordering _ordering;
+            vector<BSONObj> &_splitPoints;
+            BSONObj _last;
+            bool _done;
+
+          public:
+            SplitPointFinder(const IndexDetailsBase &pk, const BSONObj &start, vector<BSONObj> &splitPoints) :
+                _pk(pk), _ordering(Ordering::make(pk.keyPattern())), _splitPoints(splitPoints),
+                _last(start), _done(false) {
+            }
+
+            void operator()(const storage::Key *endKey, BSONObj *endPK, uint64_t skipped) {
+                if (endKey == NULL || skipped == 0) {
+                    // Hit the end of the dictionary, or one document bigger than a whole step.
+                    _done = true;
+                    return;
+                }
+                BSONObj key = endKey->key();
+                if (key.woCompare(_last, _ordering) <= 0) {
+                    // Deleted entries that haven't been garbage collected yet can make the
+                    // estimate lag behind, don't hand out an empty or overlapping range.
+                    _done = true;
+                    return;
+                }
+                _last = key.getOwned();
+                _splitPoints.push_back(_last);
+            }
+
+            void find(const long long step, const int maxPoints) {
+                while (!_done && _splitPoints.size() < (size_t) maxPoints) {
+                    const storage::Key start(_last, NULL, _pk.descriptor());
+                    _pk.getKeyAfterBytes(start, step, *this);
+                }
+            }
+        };
+
+        // Fills bounds with the numCursors + 1 (or fewer) primary keys that cut the collection,
+        // starting with the lowest possible key and ending with the highest.
+        static void findPKBounds(Collection *cl, const int numCursors, vector<BSONObj> &bounds) {
+            IndexDetails &pk = cl->getPKIndex();
+            const IndexDetailsBase *pkBase = dynamic_cast<const IndexDetailsBase *>(&pk);
+            massert(17397, "bug: failed to dynamically cast IndexDetails to IndexDetailsBase", pkBase != NULL);
+
+            const KeyPattern kp(pk.keyPattern());
+            bounds.push_back(KeyPattern::toKeyFormat(kp.extendRangeBound(BSONObj(), false)));
+
+            DB_BTREE_STAT64 st;
+            pk.getStat64(&st);
+            const long long step = st.bt_dsize / numCursors;
+            if (numCursors > 1 && step > 0) {
+                vector<BSONObj> splitPoints;
+                SplitPointFinder finder(*pkBase, bounds.back(), splitPoints);
+                finder.find(step, numCursors - 1);
+                bounds.insert(bounds.end(), splitPoints.begin(), splitPoints.end());
+            }
+            bounds.push_back(KeyPattern::toKeyFormat(kp.extendRangeBound(BSONObj(), true)));
+        }
+
+        // Fills groups with the first and last partition offsets of up to numCursors runs of
+        // partitions, holding roughly equal amounts of data.
+        static void findPartitionGroups(PartitionedCollection *pc, const int numCursors,
+                                        vector< pair<uint64_t, uint64_t> > &groups) {
+            const uint64_t n = pc->numPartitions();
+            vector<long long> sizes;
+            long long total = 0;
+            for (uint64_t i = 0; i < n; i++) {
+                DB_BTREE_STAT64 st;
+                pc->getPartition(i)->getPKIndex().getStat64(&st);
+                sizes.push_back(st.bt_dsize);
+                total += st.bt_dsize;
+            }
+
+            // Walk the partitions, closing a group whenever it reaches its share of the data,
+            // but always leave at least one partition for each group still to come.
+            const uint64_t wanted = std::min((uint64_t) numCursors, n);
+            uint64_t first = 0;
+            long long seen = 0;
+            for (uint64_t i = 0; i < n; i++) {
+                seen += sizes[i];
+                const uint64_t made = groups.size();
+                const bool lastGroup = made + 1 == wanted;
+                const bool mustClose = n - (i + 1) == wanted - (made + 1);
+                const bool full = (double) seen >= (double) total * (made + 1) / wanted;
+                if (i + 1 == n || (!lastGroup && (mustClose || full))) {
+                    groups.push_back(make_pair(first, i));
+                    first = i + 1;
+                }
+            }
+        }
+
+    public:
+        ParallelCollectionScanCmd() : QueryCommand("parallelCollectionScan") {}
+        virtual bool canRunInMultiStmtTxn() const { return false; }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::find);
+            out->push_back(Privilege(parseNs(dbname, cmdObj), actions));
+        }
+        virtual void help( stringstream &help ) const {
+            help << "{ parallelCollectionScan : 'collection name' , numCursors : N }" << endl
+                 << "Returns up to N cursors over disjoint ranges of the collection, in cursors[i].cursor.";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            const string ns = parseNs(dbname, cmdObj);
+
+            const BSONElement numCursorsElt = cmdObj["numCursors"];
+            uassert(17398, "numCursors must be a number", numCursorsElt.isNumber());
+            const long long numCursors = numCursorsElt.numberLong();
+            uassert(17399, str::stream() << "numCursors must be between 1 and " << MaxCursors,
+                    numCursors >= 1 && numCursors <= MaxCursors);
+
+            Collection *cl = getCollection(ns);
+            if (cl == NULL) {
+                errmsg = "ns does not exist";
+                return false;
+            }
+
+            // Find the cut points under the command's transaction.
+            vector<BSONObj> bounds;
+            vector< pair<uint64_t, uint64_t> > groups;
+            if (cl->isPartitioned()) {
+                findPartitionGroups(cl->as<PartitionedCollection>(), numCursors, groups);
+            }
+            else {
+                findPKBounds(cl, numCursors, bounds);
+            }
+            const size_t n = cl->isPartitioned() ? groups.size() : bounds.size() - 1;
+
+            vector<CursorId> ids;
+            try {
+                for (size_t i = 0; i < n; i++) {
+                    // A cursor has to be made under the transaction that will keep it alive
+                    // across getMores, so each one gets its own stack, just like a saved query.
+                    Client::AlternateTransactionStack ats;
+                    Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+                    shared_ptr<Cursor> c = cl->isPartitioned()
+                            ? cl->as<PartitionedCollection>()->makePartitionRangeCursor(groups[i].first, groups[i].second)
+                            : Cursor::make(cl, cl->getPKIndex(), bounds[i], bounds[i + 1], i + 1 == n, 1);
+                    ClientCursor::Holder ccPointer(new ClientCursor(0, c, ns, cmdObj.getOwned()));
+                    ids.push_back(ccPointer->cursorid());
+                    cc().swapTransactionStack(ccPointer->transactions);
+                    ccPointer.release();
+                }
+            }
+            catch (...) {
+                for (vector<CursorId>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+                    ClientCursor::erase(*it);
+                }
+                throw;
+            }
+
+            BSONArrayBuilder b(result.subarrayStart("cursors"));
+            for (vector<CursorId>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+                BSONObjBuilder entry(b.subobjStart());
+                BSONObjBuilder cursorObj(entry.subobjStart("cursor"));
+                cursorObj.append("id", *it);
+                cursorObj.append("ns", ns);
+                cursorObj.append("firstBatch", BSONArray());
+                cursorObj.done();
+                entry.appendBool("ok", true);
+                entry.done();
+            }
+            b.done();
+            return true;
+        }
+    } parallelCollectionScanCmd;
+
+} // namespace mongo
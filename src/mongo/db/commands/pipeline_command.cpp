@@ -35,6 +35,7 @@
 #include "mongo/db/pipeline/pipeline_d.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/ops/query.h"
+#include "mongo/db/storage/spill_file.h"
 
 namespace mongo {
 
@@ -207,6 +208,7 @@ namespace mongo {
         /* on the shard servers, create the local pipeline */
         intrusive_ptr<ExpressionContext> pShardCtx(
             ExpressionContext::create(&InterruptStatusMongod::status));
+        pShardCtx->setTempDir(storage::spillDir());
         intrusive_ptr<Pipeline> pShardPipeline(
             Pipeline::parseCommand(errmsg, shardBson, pShardCtx));
         if (!pShardPipeline.get()) {
@@ -254,6 +256,7 @@ namespace mongo {
 
         intrusive_ptr<ExpressionContext> pCtx(
             ExpressionContext::create(&InterruptStatusMongod::status));
+        pCtx->setTempDir(storage::spillDir());
 
         /* try to parse the command; if this fails, then we didn't run */
         intrusive_ptr<Pipeline> pPipeline(
@@ -51,6 +51,9 @@ namespace mongo {
                     theReplSet->setKeepOplogAlivePeriod(val);
                 }
             }
+            if (cmdObj.hasField("pauseAsyncLogWriter")) {
+                pauseAsyncLogWriter(cmdObj["pauseAsyncLogWriter"].trueValue());
+            }
 
             return true;
         }
@@ -524,6 +524,8 @@ namespace mongo {
     } // namespace crashdump
 
     void dumpCrashInfo(const StringData &reason) try {
+        // what was logged before the crash goes ahead of the report, which isn't queued
+        flushAsyncLog();
         crashdump::basicInfo();
         char buf[1<<12];
         strncpy(buf, reason.rawData(), reason.size());
@@ -560,6 +562,7 @@ namespace mongo {
     }
 
     void dumpCrashInfo(const DBException &e) try {
+        flushAsyncLog();
         crashdump::basicInfo();
         char buf[1<<12];
         snprintf(buf, 1<<12, "DBException code: %d what: %s", e.getCode(), e.what());
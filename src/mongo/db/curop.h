@@ -66,6 +66,8 @@ namespace mongo {
         long long nscanned;
         bool idhack;         // indicates short circuited code path on an update to make the update faster
         bool scanAndOrder;   // scanandorder query plan aspect was used
+        long long scanAndOrderBytes; // peak memory used to reorder results
+        int scanAndOrderSpills; // sorted runs written to disk while reordering
         long long nupdated; // number of records updated
         long long ninserted;
         long long ndeleted;
@@ -92,6 +92,22 @@ namespace mongo {
         return Cursor::make(cd, idx, bounds, singleIntervalLimit, direction, numWanted, countCursor);
     }
 
+    shared_ptr<Cursor> Cursor::makeSkipScan(Collection *cl, const IndexDetails &idx,
+                                            const shared_ptr<FieldRangeVector> &bounds,
+                                            const int direction) {
+        verify(!cl->isPartitioned());
+        CollectionData* cd = cl->as<CollectionData>();
+        return shared_ptr<Cursor>(new SkipScanCursor(cd, idx, bounds, direction));
+    }
+
+    shared_ptr<Cursor> Cursor::makeIntersection(Collection *cl,
+                                                const vector<const IndexDetails *> &idxs,
+                                                const vector<shared_ptr<FieldRangeVector> > &bounds) {
+        verify(!cl->isPartitioned());
+        CollectionData* cd = cl->as<CollectionData>();
+        return shared_ptr<Cursor>(new IndexIntersectionCursor(cd, idxs, bounds));
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
 
     bool ScanCursor::reverseMinMaxBoundsOrder(const Ordering &ordering, const int direction) {
@@ -138,7 +154,7 @@ namespace mongo {
         IndexCursor(cl, idx, startKey, endKey, endKeyInclusive, 1, 0),
         _bufferedRowCount(0),
         _exhausted(false),
-        _endSKeyPrefix(_endKey, NULL) {
+        _endSKeyPrefix(_endKey, NULL, idx.descriptor()) {
         TOKULOG(3) << toString() << ": constructor: bounds " << prettyIndexBounds() << endl;
         checkAssumptionsAndInit();
     }
@@ -150,7 +166,7 @@ namespace mongo {
         IndexCursor(cl, idx, bounds, false, 1, 0),
         _bufferedRowCount(0),
         _exhausted(false),
-        _endSKeyPrefix(_endKey, NULL) {
+        _endSKeyPrefix(_endKey, NULL, idx.descriptor()) {
         TOKULOG(3) << toString() << ": constructor: bounds " << prettyIndexBounds() << endl;
         dassert(_startKey == bounds->startKey());
         dassert(_endKey == bounds->endKey());
@@ -233,6 +249,132 @@ namespace mongo {
         verify(forward());
     }
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+
+    IndexIntersectionCursor::IndexIntersectionCursor(CollectionData *cl,
+                                                     const vector<const IndexDetails *> &idxs,
+                                                     const vector<shared_ptr<FieldRangeVector> > &bounds) :
+        _cl(cl),
+        _pkOrdering(Ordering::make(cl->getPKIndex().keyPattern())),
+        _clustering(NULL),
+        _ok(false) {
+        verify(idxs.size() >= 2 && idxs.size() == bounds.size());
+        for (size_t i = 0; i < idxs.size(); i++) {
+            verify(!_cl->isPKIndex(*idxs[i]));
+            _cursors.push_back(shared_ptr<IndexCursor>(new IndexCursor(cl, *idxs[i], bounds[i], 0, 1)));
+            if (_clustering == NULL && idxs[i]->clustering()) {
+                _clustering = _cursors.back().get();
+            }
+        }
+        findIntersection();
+    }
+
+    void IndexIntersectionCursor::skipTo(IndexCursor &c, const BSONObj &pk) {
+        // Seeking throws away the cursor's bulk fetched rows, so a pk a few rows away is
+        // cheaper to step to.
+        for (int i = 0; i < 8; i++) {
+            if (!c.ok() || c.currPK().woCompare(pk, _pkOrdering) >= 0) {
+                return;
+            }
+            c.advance();
+        }
+        if (c.ok() && c.currPK().woCompare(pk, _pkOrdering) < 0) {
+            c.skipToPK(pk);
+        }
+    }
+
+    void IndexIntersectionCursor::findIntersection() {
+        _currObj = BSONObj();
+        while (true) {
+            BSONObj target;
+            for (size_t i = 0; i < _cursors.size(); i++) {
+                IndexCursor &c = *_cursors[i];
+                if (!c.ok()) {
+                    _ok = false;
+                    return;
+                }
+                if (target.isEmpty() || c.currPK().woCompare(target, _pkOrdering) > 0) {
+                    target = c.currPK().getOwned();
+                }
+            }
+
+            bool agree = true;
+            for (size_t i = 0; i < _cursors.size(); i++) {
+                IndexCursor &c = *_cursors[i];
+                skipTo(c, target);
+                if (!c.ok()) {
+                    _ok = false;
+                    return;
+                }
+                if (c.currPK().woCompare(target, _pkOrdering) != 0) {
+                    agree = false;
+                }
+            }
+            if (agree) {
+                _ok = true;
+                return;
+            }
+        }
+    }
+
+    bool IndexIntersectionCursor::advance() {
+        killCurrentOp.checkForInterrupt();
+        if (!ok()) {
+            return false;
+        }
+        _cursors[0]->advance();
+        findIntersection();
+        return ok();
+    }
+
+    BSONObj IndexIntersectionCursor::current() {
+        if (_currObj.isEmpty()) {
+            if (_clustering != NULL) {
+                _currObj = _clustering->current();
+            } else {
+                const bool found = _cl->findByPK(currPK(), _currObj);
+                uassert(17408, str::stream() << toString()
+                               << ": could not find associated document with pk " << currPK(),
+                        found);
+            }
+        }
+        return _currObj;
+    }
+
+    bool IndexIntersectionCursor::modifiedKeys() const {
+        for (size_t i = 0; i < _cursors.size(); i++) {
+            if (_cursors[i]->modifiedKeys()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    string IndexIntersectionCursor::toString() const {
+        StringBuilder s;
+        s << "IndexIntersectionCursor";
+        for (size_t i = 0; i < _cursors.size(); i++) {
+            s << (i == 0 ? " " : ",") << _cursors[i]->_idx.indexName();
+        }
+        return s.str();
+    }
+
+    BSONObj IndexIntersectionCursor::prettyIndexBounds() const {
+        BSONObjBuilder b;
+        for (size_t i = 0; i < _cursors.size(); i++) {
+            b.append(_cursors[i]->_idx.indexName(), _cursors[i]->prettyIndexBounds());
+        }
+        return b.obj();
+    }
+
+    long long IndexIntersectionCursor::nscanned() const {
+        long long n = 0;
+        for (size_t i = 0; i < _cursors.size(); i++) {
+            n += _cursors[i]->nscanned();
+        }
+        return n;
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Partitioned Cursors (over the _id index)
     PartitionedCursor::PartitionedCursor(
@@ -445,6 +587,19 @@ namespace mongo {
         sanityCheckPartitionEndpoints();
     }
 
+    PartitionedCursorIDGeneratorImpl::PartitionedCursorIDGeneratorImpl(
+        const uint64_t startPartition,
+        const uint64_t endPartition,
+        const int direction
+        ) :
+        _startPartition(startPartition),
+        _endPartition(endPartition),
+        _direction(direction)
+    {
+        _currPartition = _startPartition;
+        sanityCheckPartitionEndpoints();
+    }
+
     void PartitionedCursorIDGeneratorImpl::sanityCheckPartitionEndpoints() {
         // sanity check
         if (_direction > 0) {
@@ -36,8 +36,8 @@ namespace mongo {
      * Query cursors, base class.  This is for our internal cursors.  "ClientCursor" is a separate
      * concept and is for the user's cursor.
      *
-     * WARNING concurrency: the vfunctions below are called back from within a
-     * ClientCursor::ccmutex.  Don't cause a deadlock, you've been warned.
+     * WARNING concurrency: the vfunctions below are called back from within the lock of a
+     * stripe of the ClientCursor registry.  Don't cause a deadlock, you've been warned.
      */
     class Cursor : boost::noncopyable {
     public:
@@ -93,6 +93,18 @@ namespace mongo {
                                        const int singleIntervalLimit,
                                        const int direction, const int numWanted = 0,
                                        const bool countCursor = false);
+
+        // distinct values of an index's leading field within bounds, see SkipScanCursor.
+        // cl must not be partitioned.
+        static shared_ptr<Cursor> makeSkipScan(Collection *cl, const IndexDetails &idx,
+                                               const shared_ptr<FieldRangeVector> &bounds,
+                                               const int direction = 1);
+
+        // documents found in every one of idxs, each scanned over a single key of bounds, see
+        // IndexIntersectionCursor.  cl must not be partitioned.
+        static shared_ptr<Cursor> makeIntersection(Collection *cl,
+                                                   const vector<const IndexDetails *> &idxs,
+                                                   const vector<shared_ptr<FieldRangeVector> > &bounds);
         virtual ~Cursor() { }
 
         virtual bool ok() = 0;
@@ -235,6 +247,10 @@ namespace mongo {
         // only reset it fields if there is something in the buffer.
         void empty();
 
+        // Append owned copies of the pks of the current row and up to n - 1
+        // rows after it, without moving the buffer's position.
+        void peekPKs(size_t n, vector<BSONObj> &pks) const;
+
     private:
         class HeaderBits {
         public:
@@ -302,6 +318,12 @@ namespace mongo {
         
         long long nscanned() const { return _nscanned; }
 
+        /**
+         * Skip forward to the first row at or after (currKey(), pk).  Only meaningful for a
+         * forward cursor whose bounds are a single key, so its rows come in pk order.
+         */
+        void skipToPK(const BSONObj &pk);
+
     protected:
         bool forward() const;
 
@@ -332,6 +354,12 @@ namespace mongo {
                      const shared_ptr< FieldRangeVector > &bounds,
                      int singleIntervalLimit, int direction, int numWanted = 0);
 
+        /** Advance the internal DBC, not updating nscanned or checking the key against our bounds. */
+        void _advance();
+        /** check if the current key is out of bounds, invalidate the current key if so */
+        bool checkCurrentAgainstBounds();
+        void skipPrefix(const BSONObj &key, const int k);
+
     private:
 
         /** Initialize the internal DBC */
@@ -343,8 +371,10 @@ namespace mongo {
 
         /** Get the current key/pk/obj from the row buffer and set _currKey/PK/Obj */
         void getCurrentFromBuffer();
-        /** Advance the internal DBC, not updating nscanned or checking the key against our bounds. */
-        void _advance();
+        /** Find the document for _currPK and set _currObj, batching if enabled. */
+        bool findCurrentObj();
+        /** Fetch the documents for the current and following buffered rows. */
+        void fetchObjBatch();
 
         /** ydb cursor callback + flags */
         struct cursor_getf_extra : public ExceptionSaver {
@@ -364,9 +394,6 @@ namespace mongo {
         void findKey(const BSONObj &key);
         /** find by key and a given PK */
         void setPosition(const BSONObj &key, const BSONObj &pk);
-        /** check if the current key is out of bounds, invalidate the current key if so */
-        bool checkCurrentAgainstBounds();
-        void skipPrefix(const BSONObj &key, const int k);
         int skipToNextKey(const BSONObj &currentKey);
         /** for tailable cursors to get a fresh value for minUnsafeKey from a TailableCollection */
         void refreshMinUnsafeEndKey();
@@ -415,6 +442,13 @@ namespace mongo {
         // - cc().opSettings().justOne() is true.
         const bool _prelock;
 
+        // If nonzero, documents for a non-clustering secondary index are
+        // fetched this many rows at a time: the pks buffered ahead of the
+        // current row are sorted and looked up in one pass over the pk index.
+        // The documents wait in _fetchedObjs, in index order, as (pk, obj).
+        const size_t _pkFetchBatchSize;
+        std::deque<std::pair<BSONObj, BSONObj> > _fetchedObjs;
+
         shared_ptr<storage::Cursor> _cursor;
         // An exhausted cursor has no more rows and is done iterating,
         // unless it's tailable. If so, it may try to read more rows.
@@ -439,6 +473,7 @@ namespace mongo {
 
         // For the Cursor::make() family of factories
         friend class CollectionBase;
+        friend class IndexIntersectionCursor;
     };
 
     /**
@@ -466,6 +501,75 @@ namespace mongo {
         friend class CollectionBase;
     };
 
+    /**
+     * Cursor over the distinct values of an index's leading field.
+     *
+     * After each key it seeks past every other key with the same first field instead of
+     * stepping to the next row, so it lands on one key per value.  Values that compare equal
+     * in the index (1 and 1.0, say) are one value to this cursor.
+     */
+    class SkipScanCursor : public IndexCursor {
+    public:
+        bool advance();
+        string toString() const;
+
+    protected:
+        SkipScanCursor(CollectionData *cl, const IndexDetails &idx,
+                       const shared_ptr<FieldRangeVector> &bounds, const int direction);
+
+        friend class Cursor;
+    };
+
+    /**
+     * Cursor over the documents found by every one of several index cursors.
+     *
+     * Each index cursor scans a single key, so its rows come in pk order, and the cursors are
+     * merged on pk: any that are behind skip ahead to the pk of the one furthest along, until
+     * they all agree.  Only then is the document fetched.  Each pk is found at most once per
+     * index, so there are no dups to track.
+     */
+    class IndexIntersectionCursor : public Cursor {
+    public:
+        bool ok() { return _ok; }
+        BSONObj current();
+        bool advance();
+
+        /* The keys of several indexes don't make one key, documents are matched whole. */
+        BSONObj currPK() const { return _ok ? _cursors[0]->currPK() : BSONObj(); }
+
+        bool getsetdup(const BSONObj &pk) { return false; }
+        bool isMultiKey() const { return false; }
+        bool modifiedKeys() const;
+
+        string toString() const;
+        BSONObj prettyIndexBounds() const;
+        long long nscanned() const;
+
+        CoveredIndexMatcher *matcher() const { return _matcher.get(); }
+        void setMatcher( shared_ptr< CoveredIndexMatcher > matcher ) { _matcher = matcher; }
+
+    protected:
+        IndexIntersectionCursor(CollectionData *cl, const vector<const IndexDetails *> &idxs,
+                                const vector<shared_ptr<FieldRangeVector> > &bounds);
+
+        friend class Cursor;
+
+    private:
+        /** Move the cursors forward until they agree on a pk or one of them runs out. */
+        void findIntersection();
+        /** Move c forward to pk, stepping when it is close and seeking when it isn't. */
+        void skipTo(IndexCursor &c, const BSONObj &pk);
+
+        CollectionData *_cl;
+        const Ordering _pkOrdering;
+        vector<shared_ptr<IndexCursor> > _cursors;
+        // A clustering index among _cursors, whose current() needn't look the document up.
+        IndexCursor *_clustering;
+        bool _ok;
+        BSONObj _currObj;
+        shared_ptr< CoveredIndexMatcher > _matcher;
+    };
+
     /**
      * Cursor optimized for count operations.
      * Does not track the current key or pk.
@@ -1032,6 +1136,12 @@ namespace mongo {
             const shared_ptr<FieldRangeVector> &bounds,
             const int direction
             );
+        // visits the partitions at offsets startPartition through endPartition
+        PartitionedCursorIDGeneratorImpl(
+            const uint64_t startPartition,
+            const uint64_t endPartition,
+            const int direction
+            );
         virtual uint64_t getCurrentPartitionIndex();
         virtual void advanceIndex();
         virtual bool lastIndex();
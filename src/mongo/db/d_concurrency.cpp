@@ -32,6 +32,7 @@
 #include "server.h"
 #include "lockstat.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/stats/latency_stats.h"
 
 // oplog locking
 // no top level read locks
@@ -288,6 +289,7 @@ namespace mongo {
         _timer.reset();
         _stat = stat;
         cc().curop()->lockStat().recordAcquireTimeMicros( _type , acquisitionTime );
+        LatencyStats::lockWait.record( acquisitionTime );
         return acquisitionTime;
     }
 
@@ -53,9 +53,12 @@
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/snapshots.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/db/storage/spill_file.h"
 #include "mongo/db/ttl.h"
 #include "mongo/db/txn_complete_hooks.h"
 #include "mongo/plugins/loader.h"
+#include "mongo/s/d_logic.h"
+#include "mongo/s/shard.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/background.h"
@@ -171,11 +174,58 @@ namespace mongo {
     }
 
     class MyMessageHandler : public MessageHandler {
+        /**
+         * a connection's Client, sharding info and cached shard connections, while it isn't
+         * on a thread
+         */
+        class ClientConnectionState : public ConnectionState {
+        public:
+            ClientConnectionState() :
+                _client( Client::releaseThread() ),
+                _shardInfo( ShardedConnectionInfo::release() ),
+                _shardConns( ShardConnection::releaseThreadConnections() ) {
+            }
+
+            virtual ~ClientConnectionState() {
+                delete _shardInfo;
+                ShardConnection::destroyThreadConnections( _shardConns );
+                if ( _client ) {
+                    // destroy the client on a thread, as if its thread had exited
+                    Client::attachThread( _client );
+                    currentClient.reset( NULL );
+                }
+            }
+
+            void attach() {
+                Client::attachThread( _client );
+                ShardedConnectionInfo::attach( _shardInfo );
+                ShardConnection::attachThreadConnections( _shardConns );
+                _client = NULL;
+                _shardInfo = NULL;
+                _shardConns = NULL;
+            }
+
+        private:
+            Client* _client;
+            ShardedConnectionInfo* _shardInfo;
+            ClientConnections* _shardConns;
+        };
+
     public:
         virtual void connected( AbstractMessagingPort* p ) {
             Client::initThread("conn", p);
         }
 
+        virtual bool canShareThreads() const { return true; }
+
+        virtual ConnectionState* detachConnection() {
+            return new ClientConnectionState();
+        }
+
+        virtual void attachConnection( ConnectionState* state ) {
+            static_cast<ClientConnectionState*>( state )->attach();
+        }
+
         virtual void process( Message& m , AbstractMessagingPort* port , LastError * le) {
             while ( true ) {
                 if ( inShutdown() ) {
@@ -681,6 +731,8 @@ namespace mongo {
         }
 
         acquirePathLock();
+        // nothing can be using spill files left by a previous run
+        storage::clearSpillDir();
 
         extern storage::UpdateCallback _storageUpdateCallback;
         storage::startup(&_txnCompleteHooks, &_storageUpdateCallback);
@@ -734,6 +786,7 @@ namespace mongo {
 
         snapshotThread.go();
         d.clientCursorMonitor.go();
+        startProfileWriter();
         PeriodicTask::theRunner->go();
         if (missingRepl) {
             // a warning was logged earlier
@@ -1392,6 +1445,9 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
     // (initializeServerGlobalState()) and before creation of any other threads.
     startSignalProcessingThread();
 
+    if (!initializeAsyncLogging())
+        ::_exit(EXIT_BADOPTIONS);
+
 #if defined(_WIN32)
     if (ntservice::shouldStartService()) {
         ntservice::startService();
@@ -1422,6 +1478,7 @@ namespace mongo {
 namespace mongo {
 
     static void abruptQuitNoCrashInfo(int x) {
+        flushAsyncLog();
         ostringstream ossSig;
         ossSig << "Got signal: " << x << " (" << strsignal( x ) << ")." << endl;
         rawOut(ossSig.str());
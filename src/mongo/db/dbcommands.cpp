@@ -55,6 +55,8 @@
 #include "mongo/db/collection.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/query_optimizer.h"
+#include "mongo/db/query_optimizer_internal.h"
+#include "mongo/db/querypattern.h"
 #include "mongo/db/ops/count.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/stats/counters.h"
@@ -1361,6 +1363,8 @@ namespace mongo {
                  "\nkeyPattern is an optional parameter indicating an index pattern that would be useful"
                  "for iterating over the min/max bounds. If keyPattern is omitted, it is inferred from "
                  "the structure of min. "
+                 "\nestimate:true estimates the size of a min/max range from index statistics and a sample "
+                 "of sampleSize documents (default 100), reporting exact and errorBound with it."
                  "\nnote: This command may take a while to run";
         }
         virtual void addRequiredPrivileges(const std::string& dbname,
@@ -1418,6 +1422,18 @@ namespace mongo {
                 min = KeyPattern::toKeyFormat( kp.extendRangeBound( min, false ) );
                 max = KeyPattern::toKeyFormat( kp.extendRangeBound( max, false ) );
 
+                const IndexDetailsBase *idxBase = dynamic_cast<const IndexDetailsBase *>( idx );
+                if ( estimate && idxBase != NULL ) {
+                    int sampleSize = jsobj["sampleSize"].numberInt();
+                    if ( sampleSize <= 0 ) {
+                        sampleSize = 100;
+                    }
+                    estimateDataSize( cl, *idxBase, min, max, jsobj["maxSize"].numberLong(),
+                                      jsobj["maxObjects"].numberLong(), sampleSize, result );
+                    result.append( "millis" , timer.millis() );
+                    return true;
+                }
+
                 c = Cursor::make( cl, *idx, min, max, false, 1 );
             }
 
@@ -1454,6 +1470,66 @@ namespace mongo {
             result.append( "millis" , timer.millis() );
             return true;
         }
+
+    private:
+        /**
+         * Estimates the size of [min, max) in idx without reading all of it.  The number of
+         * documents comes from the index's subtree statistics, and their size from a sample at
+         * the start of the range.  A range no bigger than the sample is just measured.
+         *
+         * maxReached is set, as for the exact count, if the estimate exceeds maxSize or
+         * maxObjects.
+         *
+         * errorBound is twice the standard error of the sampled average size times the number
+         * of documents, roughly a 95% interval if the sample is typical of the range.  The
+         * document count adds its own error unless "exact" is set.
+         */
+        void estimateDataSize( Collection *cl, const IndexDetailsBase &idx,
+                               const BSONObj &min, const BSONObj &max,
+                               long long maxSize, long long maxObjects, int sampleSize,
+                               BSONObjBuilder &result ) {
+            long long sampled = 0;
+            double sum = 0;
+            double sumSquares = 0;
+            shared_ptr<Cursor> c = Cursor::make( cl, idx, min, max, false, 1, sampleSize + 1 );
+            for ( ; c->ok() && sampled <= sampleSize; c->advance() ) {
+                const double objsize = c->current().objsize();
+                sum += objsize;
+                sumSquares += objsize * objsize;
+                sampled++;
+            }
+
+            if ( !c->ok() ) {
+                if ( ( maxSize && sum > maxSize ) || ( maxObjects && sampled > maxObjects ) ) {
+                    result.appendBool( "maxReached" , true );
+                }
+                result.appendNumber( "size" , (long long) sum );
+                result.appendNumber( "numObjects" , sampled );
+                result.appendBool( "exact" , true );
+                result.appendNumber( "errorBound" , 0 );
+                return;
+            }
+
+            const bool isPK = cl->isPKIndex( idx );
+            const storage::Key leftKey( min, isPK ? NULL : &minKey, idx.descriptor() );
+            const storage::Key rightKey( max, isPK ? NULL : &minKey, idx.descriptor() );
+            bool exact;
+            const long long numObjects = std::max( (long long) idx.estimateKeysInRange( leftKey, rightKey, exact ),
+                                                   sampled );
+
+            const double mean = sum / sampled;
+            const double variance = std::max( sumSquares / sampled - mean * mean, 0.0 );
+            const long long size = (long long) ( mean * numObjects );
+            if ( ( maxSize && size > maxSize ) || ( maxObjects && numObjects > maxObjects ) ) {
+                result.appendBool( "maxReached" , true );
+            }
+            result.appendNumber( "size" , size );
+            result.appendNumber( "numObjects" , numObjects );
+            result.appendBool( "exact" , exact );
+            result.appendNumber( "errorBound" ,
+                                 (long long) ( 2 * sqrt( variance / sampled ) * numObjects ) );
+        }
+
     } cmdDatasize;
 
     class CollectionStats : public QueryCommand {
@@ -1498,6 +1574,78 @@ namespace mongo {
         }
     } cmdCollectionStats;
 
+    class PlanCacheListShapes : public QueryCommand {
+    public:
+        PlanCacheListShapes() : QueryCommand( "planCacheListShapes" ) {}
+        virtual void help( stringstream &help ) const {
+            help << "{ planCacheListShapes: \"coll\" }\n"
+                    "list the query shapes in the collection's plan cache, with their cached plans "
+                    "and statistics";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::planCacheRead);
+            out->push_back(Privilege(parseNs(dbname, cmdObj), actions));
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            string ns = dbname + "." + jsobj.firstElement().valuestr();
+            Client::Context cx( ns );
+
+            Collection *cl = getCollection( ns );
+            if ( ! cl ) {
+                errmsg = "ns not found";
+                return false;
+            }
+
+            BSONArrayBuilder shapes( result.subarrayStart( "shapes" ) );
+            cl->getQueryCache().appendShapes( shapes );
+            shapes.done();
+            return true;
+        }
+    } cmdPlanCacheListShapes;
+
+    class PlanCacheClear : public QueryCommand {
+    public:
+        PlanCacheClear() : QueryCommand( "planCacheClear" ) {}
+        virtual void help( stringstream &help ) const {
+            help << "{ planCacheClear: \"coll\" [, query: {...}, sort: {...}] }\n"
+                    "drop the collection's cached plans, or only the one for the shape of query and sort";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::planCacheWrite);
+            out->push_back(Privilege(parseNs(dbname, cmdObj), actions));
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            string ns = dbname + "." + jsobj.firstElement().valuestr();
+            Client::Context cx( ns );
+
+            Collection *cl = getCollection( ns );
+            if ( ! cl ) {
+                errmsg = "ns not found";
+                return false;
+            }
+
+            BSONElement query = jsobj["query"];
+            BSONElement sort = jsobj["sort"];
+            if ( query.eoo() && sort.eoo() ) {
+                cl->getQueryCache().clearQueryCache();
+                return true;
+            }
+            if ( ( !query.eoo() && query.type() != Object ) || ( !sort.eoo() && sort.type() != Object ) ) {
+                errmsg = "query and sort must be objects";
+                return false;
+            }
+            FieldRangeSetPair frsp( ns.c_str(), query.eoo() ? BSONObj() : query.embeddedObject() );
+            QueryUtilIndexed::erasePatterns( frsp, sort.eoo() ? BSONObj() : sort.embeddedObject() );
+            return true;
+        }
+    } cmdPlanCacheClear;
+
     class DBStats : public QueryCommand {
     public:
         DBStats() : QueryCommand( "dbStats", false, "dbstats" ) {}
@@ -18,6 +18,7 @@
 
 #include "mongo/pch.h"
 #include "mongo/db/descriptor.h"
+#include "mongo/db/hasher.h"
 #include "mongo/db/keygenerator.h"
 
 namespace mongo {
@@ -25,14 +26,18 @@ namespace mongo {
     Descriptor::Descriptor(const BSONObj &keyPattern,
                            const bool hashed,
                            const int hashSeed,
+                           const int hashVersion,
                            const bool sparse,
-                           const bool clustering) :
+                           const bool clustering,
+                           const Version version) :
         _data(NULL), _size(serializedSize(keyPattern)), _dataOwned(new char[_size]) {
         _data = _dataOwned.get();
 
         // Create a header and write it first.
-        Header h(Ordering::make(keyPattern),
-                 hashed, sparse, clustering, hashSeed, keyPattern.nFields());
+        verify(version > VERSION_0 && version < NEXT_VERSION);
+        verify(!hashed || isValidHashVersion(hashVersion));
+        Header h(Ordering::make(keyPattern), version,
+                 hashed ? 1 + hashVersion : 0, sparse, clustering, hashSeed, keyPattern.nFields());
         memcpy(_dataOwned.get(), &h, sizeof(Header));
 
         // The offsets array is based after the header. It is an array of
@@ -120,9 +125,7 @@ namespace mongo {
         vector<const char *> fields;
         fieldNames(fields);
         if (h.hashed) {
-            // If we ever add new hash versions in the future, we'll need to add
-            // a hashVersion field to the descriptor and up the descriptor version.
-            const HashVersion hashVersion = 0;
+            const HashVersion hashVersion = h.hashed - 1;
             HashKeyGenerator generator(fields[0], h.hashSeed, hashVersion, h.sparse);
             generator.getKeys(obj, keys);
         } else {
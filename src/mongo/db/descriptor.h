@@ -34,12 +34,24 @@ namespace mongo {
 
     class Descriptor {
     public:
+        enum Version {
+            // Version 0 is kind of a fake version.
+            VERSION_0 = 0,
+            VERSION_1 = 1,
+            // Keys are written in the memcmp-comparable format, see storage::MemcmpKey.
+            // Dictionaries can't be upgraded to this version in place, they must be rebuilt.
+            VERSION_2 = 2,
+            NEXT_VERSION = 3
+        };
+
         // For creating a brand new descriptor.
         Descriptor(const BSONObj &keyPattern,
                    const bool hashed = false,
                    const int hashSeed = 0,
+                   const int hashVersion = 0,
                    const bool sparse = false,
-                   const bool clustering = false);
+                   const bool clustering = false,
+                   const Version version = VERSION_1);
         // For interpretting a memory buffer as a descriptor.
         Descriptor(const char *data, const size_t size);
 
@@ -49,6 +61,11 @@ namespace mongo {
 
         const Ordering &ordering() const;
 
+        // @return true if keys should be written in the memcmp-comparable format
+        bool memcmpKeys() const {
+            return version() >= VERSION_2;
+        }
+
         DBT dbt() const;
 
         int compareKeys(const storage::Key &key1, const storage::Key &key2) const {
@@ -74,7 +91,8 @@ namespace mongo {
         //   [
         //     4 bytes: ordering,
         //     1 byte: version,
-        //     1 byte: hashed boolean,
+        //     1 byte: 0 if not hashed, otherwise 1 + the hash version (so hashed indexes
+        //             from before there were hash versions are version 0),
         //     1 byte: sparse boolean,
         //     1 byte: clustering boolean,
         //     4 bytes: hash seed integer,
@@ -83,18 +101,8 @@ namespace mongo {
         //     byte array: array of null terminated field strings
         //   ]
         struct Header {
-        private:
-            enum Version {
-                // Version 0 is kind of a fake version.
-                VERSION_0 = 0,
-                VERSION_1 = 1,
-                NEXT_VERSION = 2
-            };
-            static const int CURRENT_VERSION = (int) NEXT_VERSION - 1;
-
-        public:
-            Header(const Ordering &o, char h, char s, char c, int hs, uint32_t n)
-                : ordering(o), version((char) CURRENT_VERSION), hashed(h), sparse(s), clustering(c),
+            Header(const Ordering &o, Version v, char h, char s, char c, int hs, uint32_t n)
+                : ordering(o), version((char) v), hashed(h), sparse(s), clustering(c),
                   hashSeed(hs), numFields(n) {
             }
 
@@ -85,6 +85,10 @@ namespace mongo {
         bob.appendNumber( "nscannedObjectsAllPlans", clauseInfo.nscannedObjectsAllPlans() );
         bob.appendNumber( "nscannedAllPlans", clauseInfo.nscannedAllPlans() );
         bob.append( "scanAndOrder", _scanAndOrder );
+        if ( clauseInfo.scanAndOrderSpills() >= 0 ) {
+            bob.appendNumber( "scanAndOrderBytes", clauseInfo.scanAndOrderBytes() );
+            bob.append( "scanAndOrderSpills", clauseInfo.scanAndOrderSpills() );
+        }
         bob.append( "indexOnly", _indexOnly );
         bob.appendNumber( "nChunkSkips", clauseInfo.nChunkSkips() );
         bob.appendNumber( "millis", clauseInfo.millis() );
@@ -101,7 +105,9 @@ namespace mongo {
     ExplainClauseInfo::ExplainClauseInfo() :
     _n(),
     _nscannedObjects(),
-    _nChunkSkips() {
+    _nChunkSkips(),
+    _scanAndOrderBytes( -1 ),
+    _scanAndOrderSpills( -1 ) {
     }
     
     BSONObj ExplainClauseInfo::bson() const {
@@ -136,6 +142,11 @@ namespace mongo {
         _n = n;
     }
 
+    void ExplainClauseInfo::noteScanAndOrder( long long memBytes, int nSpills ) {
+        _scanAndOrderBytes = memBytes;
+        _scanAndOrderSpills = nSpills;
+    }
+
     void ExplainClauseInfo::stopTimer() {
         _timer.stop();
     }
@@ -203,6 +214,11 @@ namespace mongo {
         _clauses.back()->reviseN( n );
     }
 
+    void ExplainQueryInfo::noteScanAndOrder( long long memBytes, int nSpills ) {
+        verify( !_clauses.empty() );
+        _clauses.back()->noteScanAndOrder( memBytes, nSpills );
+    }
+
     void ExplainQueryInfo::setAncillaryInfo( const AncillaryInfo &ancillaryInfo ) {
         _ancillaryInfo = ancillaryInfo;
     }
@@ -92,6 +92,8 @@ namespace mongo {
         void noteIterate( bool match, bool loadedRecord, bool chunkSkip );
         /** Revise the total number of documents returned to match an external count. */
         void reviseN( long long n );
+        /** Note the memory used and runs spilled to disk reordering the clause's results. */
+        void noteScanAndOrder( long long memBytes, int nSpills );
         /** Stop the clauses's timer. */
         void stopTimer();
 
@@ -106,6 +108,8 @@ namespace mongo {
         long long nscannedAllPlans() const;
         long long nChunkSkips() const { return _nChunkSkips; }
         int millis() const { return _timer.duration(); }
+        long long scanAndOrderBytes() const { return _scanAndOrderBytes; }
+        int scanAndOrderSpills() const { return _scanAndOrderSpills; }
 
     private:
         /**
@@ -118,6 +122,8 @@ namespace mongo {
         long long _n;
         long long _nscannedObjects;
         long long _nChunkSkips;
+        long long _scanAndOrderBytes;
+        int _scanAndOrderSpills;
         DurationTimer _timer;
     };
     
@@ -128,6 +134,8 @@ namespace mongo {
         void noteIterate( bool match, bool loadedRecord, bool chunkSkip );
         /** Revise the number of documents returned by the current clause. */
         void reviseN( long long n );
+        /** Note how the current clause's results were reordered. */
+        void noteScanAndOrder( long long memBytes, int nSpills );
 
         /* Additional information describing the query. */
         struct AncillaryInfo {
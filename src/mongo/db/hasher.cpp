@@ -23,34 +23,65 @@
 
 #include "mongo/db/hasher.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/util/mongoutils/str.h"
 #include "mongo/util/startup_test.h"
 
+#include "third_party/murmurhash3/MurmurHash3.h"
+
 namespace mongo {
 
-    Hasher::Hasher( HashSeed seed ) : _seed( seed ) {
+    using namespace mongoutils;
+
+    MD5Hasher::MD5Hasher( HashSeed seed ) : _seed( seed ) {
         md5_init( &_md5State );
         md5_append( &_md5State , reinterpret_cast< const md5_byte_t * >( & _seed ) , sizeof( _seed ) );
     }
 
-    void Hasher::addData( const void * keyData , size_t numBytes ) {
+    void MD5Hasher::addData( const void * keyData , size_t numBytes ) {
         md5_append( &_md5State , static_cast< const md5_byte_t * >( keyData ), numBytes );
     }
 
-    void Hasher::finish( HashDigest out ) {
+    void MD5Hasher::finish( HashDigest out ) {
         md5_finish( &_md5State , out );
     }
 
-    long long int BSONElementHasher::hash64( const BSONElement& e , HashSeed seed ){
-        scoped_ptr<Hasher> h( HasherFactory::createHasher( seed ) );
-        recursiveHash( h.get() , e , false );
+    void Murmur3Hasher::finish( HashDigest out ) {
+        MurmurHash3_x64_128( _buf.buf() , _buf.len() , static_cast< uint32_t >( _seed ) , out );
+    }
+
+    Hasher* HasherFactory::createHasher( HashSeed seed , HashVersion version ) {
+        if ( version == HASH_VERSION_MURMUR3 ) {
+            return new Murmur3Hasher( seed );
+        }
+        massert( 17415 , str::stream() << "unknown hashVersion " << version ,
+                 version == HASH_VERSION_MD5 );
+        return new MD5Hasher( seed );
+    }
+
+    long long int BSONElementHasher::hash64( const BSONElement& e , HashSeed seed ,
+                                             HashVersion version ){
+        // This runs for every write to a hashed index and every routed operation on a
+        // hashed shard key, so the hasher lives on the stack.
         HashDigest d;
-        h->finish(d);
+        if ( version == HASH_VERSION_MURMUR3 ) {
+            Murmur3Hasher h( seed );
+            recursiveHash( &h , e , false );
+            h.finish( d );
+        }
+        else {
+            massert( 17416 , str::stream() << "unknown hashVersion " << version ,
+                     version == HASH_VERSION_MD5 );
+            MD5Hasher h( seed );
+            recursiveHash( &h , e , false );
+            h.finish( d );
+        }
         //HashDigest is actually 16 bytes, but we just get 8 via truncation
         // NOTE: assumes little-endian
         return *reinterpret_cast< long long int * >( d );
     }
 
-    void BSONElementHasher::recursiveHash( Hasher* h ,
+    template< class H >
+    void BSONElementHasher::recursiveHash( H* h ,
                                            const BSONElement& e ,
                                            bool includeFieldName ) {
 
@@ -98,6 +129,8 @@ namespace mongo {
             // Hard-coded check to ensure the hash function is consistent across platforms
             BSONObj o = BSON( "check" << 42 );
             verify( BSONElementHasher::hash64( o.firstElement(), 0 ) == -944302157085130861LL );
+            verify( BSONElementHasher::hash64( o.firstElement(), 0 , HASH_VERSION_MURMUR3 ) ==
+                    8715208212397937794LL );
         }
     } hasherUnitTest;
 }
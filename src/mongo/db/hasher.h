@@ -25,6 +25,7 @@
 
 #include "mongo/pch.h"
 #include "mongo/bson/bsonelement.h"
+#include "mongo/bson/util/builder.h"
 #include "mongo/util/md5.hpp"
 
 namespace mongo {
@@ -33,17 +34,39 @@ namespace mongo {
     typedef int HashVersion;
     typedef unsigned char HashDigest[16];
 
+    /* The hash functions a hashed index or hashed shard key can use, chosen with the
+     * "hashVersion" index option (and shardCollection option).  Never change what an existing
+     * version computes, the hashes are stored in indexes and chunk ranges.
+     */
+    enum HashVersions {
+        // MD5 of the seed and the element, the first 8 bytes of the digest
+        HASH_VERSION_MD5 = 0,
+        // MurmurHash3_x64_128 of the element with the seed as its seed, the first 8 bytes
+        HASH_VERSION_MURMUR3 = 1,
+        NEXT_HASH_VERSION = 2
+    };
+
+    inline bool isValidHashVersion( HashVersion version ) {
+        return version >= HASH_VERSION_MD5 && version < NEXT_HASH_VERSION;
+    }
+
     class Hasher : private boost::noncopyable {
     public:
-
-        explicit Hasher( HashSeed seed );
-        ~Hasher() { };
+        virtual ~Hasher() { };
 
         //pointer to next part of input key, length in bytes to read
-        void addData( const void * keyData , size_t numBytes );
+        virtual void addData( const void * keyData , size_t numBytes ) = 0;
 
         //finish computing the hash, put the result in the digest
         //only call this once per Hasher
+        virtual void finish( HashDigest out ) = 0;
+    };
+
+    class MD5Hasher : public Hasher {
+    public:
+        explicit MD5Hasher( HashSeed seed );
+
+        void addData( const void * keyData , size_t numBytes );
         void finish( HashDigest out );
 
     private:
@@ -51,14 +74,27 @@ namespace mongo {
         HashSeed _seed;
     };
 
-    class HasherFactory : private boost::noncopyable  {
+    /* MurmurHash3 isn't incremental, so this buffers the input (on the stack, for the usual
+     * small keys) and hashes it all in finish().  Only the first 8 bytes of the digest are
+     * meaningful to hash64, the rest are filled in too.
+     */
+    class Murmur3Hasher : public Hasher {
     public:
-        /* Eventually this may be a more sophisticated factory
-         * for creating other hashers, but for now use MD5.
-         */
-        static Hasher* createHasher( HashSeed seed ) {
-            return new Hasher( seed );
+        explicit Murmur3Hasher( HashSeed seed ) : _seed( seed ) { }
+
+        void addData( const void * keyData , size_t numBytes ) {
+            _buf.appendBuf( keyData , numBytes );
         }
+        void finish( HashDigest out );
+
+    private:
+        StackBufBuilder _buf;
+        HashSeed _seed;
+    };
+
+    class HasherFactory : private boost::noncopyable  {
+    public:
+        static Hasher* createHasher( HashSeed seed , HashVersion version = HASH_VERSION_MD5 );
 
     private:
         HasherFactory();
@@ -80,12 +116,15 @@ namespace mongo {
          * ints via truncation, so floating point values round towards 0 to the
          * nearest int representable as a 64-bit long.
          *
+         * "version" picks the hash function, see HashVersions; massserts if it's unknown.
+         *
          * This function is used in the computation of hashed indexes
          * and hashed shard keys, and thus should not be changed unless
          * the associated "getKeys" and "makeSingleKey" method in the
          * hashindex type is changed accordingly.
          */
-        static long long int hash64( const BSONElement& e , HashSeed seed );
+        static long long int hash64( const BSONElement& e , HashSeed seed ,
+                                     HashVersion version = HASH_VERSION_MD5 );
 
     private:
         BSONElementHasher();
@@ -96,9 +135,11 @@ namespace mongo {
          * the element and the element value.  The hash function "h"
          * is applied recursively to any sub-elements (arrays/sub-documents),
          * squashing elements of the same canonical type.
-         * Used as a helper for hash64 above.
+         * Used as a helper for hash64 above, with the concrete hasher type so
+         * the calls to addData aren't virtual.
          */
-        static void recursiveHash( Hasher* h , const BSONElement& e , bool includeFieldName );
+        template< class H >
+        static void recursiveHash( H* h , const BSONElement& e , bool includeFieldName );
 
     };
 
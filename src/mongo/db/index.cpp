@@ -41,7 +41,8 @@ namespace mongo {
      *
      * Optional arguments:
      *  "seed" : int (default = 0, a seed for the hash function)
-     *  "hashVersion : int (default = 0, determines which hash function to use)
+     *  "hashVersion : int (default = 0, determines which hash function to use, see HashVersions:
+     *                 0 is MD5, 1 is the much faster MurmurHash3)
      *
      * Example use in the mongo shell:
      * > db.foo.ensureIndex({a : "hashed"}, {seed : 3, hashVersion : 0})
@@ -61,13 +62,22 @@ namespace mongo {
      * array values of the hashed field exist.
      */
     class HashedIndex : public IndexDetailsBase {
+        // Checked before anything is hashed with it, see _hashedNullObj.
+        static HashVersion validHashVersion(const BSONObj &info) {
+            const HashVersion version = info["hashVersion"].numberInt();
+            uassert( 17417, str::stream() << "hashVersion must be " << HASH_VERSION_MD5 << " (md5) or "
+                            << HASH_VERSION_MURMUR3 << " (murmur3)",
+                            isValidHashVersion( version ) );
+            return version;
+        }
+
     public:
         HashedIndex(const BSONObj &info) :
             IndexDetailsBase(info),
             _hashedField(_keyPattern.firstElement().fieldName()),
             // Default seed/version to 0 if not specified or not an integer.
             _seed(_info["seed"].numberInt()),
-            _hashVersion(_info["hashVersion"].numberInt()),
+            _hashVersion(validHashVersion(_info)),
             _hashedNullObj(BSON("" << HashKeyGenerator::makeSingleKey(nullElt, _seed, _hashVersion))) {
 
             // change these if single-field limitation lifted later
@@ -76,8 +86,8 @@ namespace mongo {
             uassert( 16242, "Currently hashed indexes cannot guarantee uniqueness. Use a regular index.",
                             !unique() );
 
-            // Create a descriptor with hashed = true and the appropriate hash seed.
-            _descriptor.reset(new Descriptor(_keyPattern, true, _seed, _sparse, _clustering));
+            // Create a descriptor with hashed = true and the appropriate hash seed and version.
+            _descriptor.reset(new Descriptor(_keyPattern, true, _seed, _hashVersion, _sparse, _clustering, keyFormat()));
 
         }
 
@@ -227,9 +237,24 @@ namespace mongo {
         }
     }
 
+    const char *IndexDetails::keyFormatFieldName = "keyFormat";
+
+    Descriptor::Version IndexDetails::keyFormat() const {
+        const BSONElement e = _info[keyFormatFieldName];
+        if (e.eoo()) {
+            return Descriptor::VERSION_1;
+        }
+        uassert(17390, str::stream() << "bad " << keyFormatFieldName << " for index "
+                                     << indexName() << ": " << e.toString(false)
+                                     << ", must be 1 or 2",
+                e.isNumber() && (e.numberInt() == Descriptor::VERSION_1 ||
+                                 e.numberInt() == Descriptor::VERSION_2));
+        return static_cast<Descriptor::Version>(e.numberInt());
+    }
+
     IndexDetailsBase::IndexDetailsBase(const BSONObj& info) :
         IndexDetails(info),
-        _descriptor(new Descriptor(_keyPattern, false, 0, _sparse, _clustering)) {
+        _descriptor(new Descriptor(_keyPattern, false, 0, 0, _sparse, _clustering, keyFormat())) {
     }
 
     // Open the dictionary. Creates it if necessary.
@@ -393,8 +418,8 @@ namespace mongo {
         // lock just the range of the index that may contain that secondary key,
         // if it exists. That range is { key, minKey } -> { key, maxKey }, where
         // the second part of the compound key is the appended primary key.
-        storage::Key leftSKey(key, &minKey);
-        storage::Key rightSKey(key, &maxKey);
+        storage::Key leftSKey(key, &minKey, *_descriptor);
+        storage::Key rightSKey(key, &maxKey, *_descriptor);
         DBT start = leftSKey.dbt();
         DBT end = rightSKey.dbt();
         int r = cursor->c_set_bounds(cursor, &start, &end, true, 0);
@@ -430,7 +455,7 @@ namespace mongo {
     }
 
     void IndexDetailsBase::updatePair(const BSONObj &key, const BSONObj *pk, const BSONObj &msg, uint64_t flags) {
-        storage::Key skey(key, pk);
+        storage::Key skey(key, pk, *_descriptor);
         DBT kdbt = skey.dbt();
         DBT vdbt = storage::dbt_make(msg.objdata(), msg.objsize());
 
@@ -486,6 +511,23 @@ namespace mongo {
         }
     }
 
+    uint64_t IndexDetailsBase::estimateKeysInRange(const storage::Key &leftKey,
+                                                   const storage::Key &rightKey,
+                                                   bool &exact) const {
+        DBT leftDBT = leftKey.dbt();
+        DBT rightDBT = rightKey.dbt();
+        uint64_t less, equalLeft, middle, equalRight, greater;
+        bool middleExact;
+        int r = db()->keys_range64(db(), cc().txn().db_txn(), &leftDBT, &rightDBT,
+                                   &less, &equalLeft, &middle, &equalRight, &greater,
+                                   &middleExact);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+        exact = middleExact;
+        return equalLeft + middle;
+    }
+
     int IndexDetailsBase::hot_optimize_callback(void *extra, float progress) {
         struct hot_optimize_callback_extra *info =
                 reinterpret_cast<hot_optimize_callback_extra *>(extra);
@@ -614,7 +656,7 @@ namespace mongo {
                                     << idx.keyPattern()) {}
 
     void IndexDetailsBase::Builder::insertPair(const BSONObj &key, const BSONObj *pk, const BSONObj &val) {
-        storage::Key skey(key, pk);
+        storage::Key skey(key, pk, *_idx._descriptor);
         DBT kdbt = skey.dbt();
         DBT vdbt = storage::dbt_make(NULL, 0);
         if (_idx.clustering()) {
@@ -681,6 +723,10 @@ namespace mongo {
     shared_ptr<storage::Cursor> PartitionedIndexDetails::getCursor(const int flags) const {
         uasserted(17243, "should not call getCursor on a PartitionedIndexDetails");
     }
+
+    const Descriptor &PartitionedIndexDetails::descriptor() const {
+        return getIndexDetailsOfPartition(0).descriptor();
+    }
     
     IndexDetails& PartitionedIndexDetails::getIndexDetailsOfPartition(uint64_t i) const {
         const int idxNum = _pc->findIndexByName(indexName());
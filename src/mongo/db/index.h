@@ -169,6 +169,20 @@ namespace mongo {
             return _info;
         }
 
+        // The "keyFormat" field of an index's info picks the descriptor version,
+        // and with it the key format, of its dictionary. Indexes without it use
+        // version 1. Version 2 (memcmp-comparable keys) must be asked for when
+        // the index is created: its keys don't keep the numeric type, so covered
+        // reads of such an index return numbers as the narrowest of int, long
+        // and double. There is no conversion between formats; the limits of
+        // version 2 are listed in docs/index_key_format.md.
+        static const char *keyFormatFieldName;
+
+        Descriptor::Version keyFormat() const;
+
+        // Describes the keys of this index to the storage layer.
+        virtual const Descriptor &descriptor() const = 0;
+
         // Index access statistics
         struct AccessStats {
             // ensures that the next member does not sit on the same cacheline as any real data.
@@ -311,6 +325,10 @@ namespace mongo {
             return ret;
         }
 
+        const Descriptor &descriptor() const {
+            return *_descriptor;
+        }
+
         class Builder {
         public:
             Builder(IndexDetailsBase &idx);
@@ -338,6 +356,12 @@ namespace mongo {
         template<class Callback>
         void getKeyAfterBytes(const storage::Key &startKey, uint64_t skipLen, Callback &cb) const;    
 
+        // Estimated number of keys in [leftKey, rightKey), from the subtree statistics in the
+        // dictionary's internal nodes rather than by reading the keys (see DB->keys_range64).
+        // exact is set if both ends fell in the same leaf, which is then counted exactly.
+        uint64_t estimateKeysInRange(const storage::Key &leftKey, const storage::Key &rightKey,
+                                     bool &exact) const;
+
     protected:
         // Open ydb dictionary representing the index on disk.
         shared_ptr<storage::Dictionary> _db;
@@ -389,9 +413,10 @@ namespace mongo {
                         t->_cb(NULL, NULL, skipped);
                     }
                     else {                
-                        storage::KeyV1 endKey(static_cast<char *>(endKeyDBT->data));
-                        if (endKey.dataSize() < (ssize_t) endKeyDBT->size) {
-                            BSONObj endPK(static_cast<char *>(endKeyDBT->data) + endKey.dataSize());
+                        const char *endKeyData = static_cast<char *>(endKeyDBT->data);
+                        const storage::Key endKey(endKeyData, false);
+                        if (endKey.size() < (int) endKeyDBT->size) {
+                            BSONObj endPK(storage::Key(endKeyData, true).pk());
                             t->_cb(&endKey, &endPK, skipped);
                         }
                         else {
@@ -457,6 +482,9 @@ namespace mongo {
         // access to IndexDetailsBase directly somehow
         // This is a workaround to get going for now
         virtual shared_ptr<storage::Cursor> getCursor(const int flags) const;
+
+        // Every partition is built from the same index info, so they all share a descriptor.
+        virtual const Descriptor &descriptor() const;
     private:
         IndexDetails& getIndexDetailsOfPartition(uint64_t i)  const;
         // This cannot be a shared_ptr, as this is a circular reference
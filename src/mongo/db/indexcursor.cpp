@@ -23,9 +23,32 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/collection.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
+    // Fetch documents for non-clustering secondary index scans in sorted
+    // batches, for every query. A query can also ask for it with $batchFetch.
+    // Cursors of updates and deletes, which lock what they read, never batch.
+    MONGO_EXPORT_SERVER_PARAMETER(queryBatchFetchPKs, bool, false);
+
+    static const size_t maxPKFetchBatchSize = 1000;
+
+    static size_t pkFetchBatchSize(CollectionData *cl, const IndexDetails &idx, bool prelock) {
+        // Batching reads ahead, which only pays off for cursors that want
+        // everything (see _prelock) and that don't already have the document.
+        if (!prelock || cl->isPKIndex(idx) || idx.clustering()) {
+            return 0;
+        }
+        if (!queryBatchFetchPKs && !cc().opSettings().shouldBatchFetchPKs()) {
+            return 0;
+        }
+        if (cc().opSettings().getQueryCursorMode() != DEFAULT_LOCK_CURSOR) {
+            return 0;
+        }
+        return maxPKFetchBatchSize;
+    }
+
     RowBuffer::RowBuffer() :
         _size(1024),
         _current_offset(0),
@@ -86,7 +109,7 @@ namespace mongo {
         }
 
         // Determine what to put in the header byte.
-        const bool hasPK = !sKey.pk().isEmpty();
+        const bool hasPK = sKey.hasPK();
         const bool hasObj = obj_size > 0;
         const unsigned char headerBits = (hasPK ? HeaderBits::hasPK : 0) | (hasObj ? HeaderBits::hasObj : 0);
         dassert(headerBits >= 1 && headerBits <= 3);
@@ -150,6 +173,24 @@ namespace mongo {
         }
     }
 
+    void RowBuffer::peekPKs(size_t n, vector<BSONObj> &pks) const {
+        size_t offset = _current_offset;
+        for (size_t i = 0; i < n && offset < _end_offset; i++) {
+            const char headerBits = *(_buf + offset);
+            dassert(headerBits >= 1 && headerBits <= 3);
+            offset += 1;
+
+            storage::Key sKey(_buf + offset, headerBits & HeaderBits::hasPK);
+            offset += sKey.size();
+            if (headerBits & HeaderBits::hasObj) {
+                offset += BSONObj(_buf + offset).objsize();
+            }
+
+            BSONObj pk = sKey.pk();
+            pks.push_back(pk.isEmpty() ? sKey.key() : pk.getOwned());
+        }
+    }
+
     /* ---------------------------------------------------------------------- */
 
     IndexCursor::IndexCursor( CollectionData *cl, const IndexDetails &idx,
@@ -168,6 +209,7 @@ namespace mongo {
         _nscanned(0),
         _nscannedObjects(0),
         _prelock(!cc().opSettings().getJustOne() && numWanted == 0),
+        _pkFetchBatchSize(pkFetchBatchSize(cl, idx, _prelock)),
         _tailable(false),
         _ok(false),
         _getf_iteration(0)
@@ -196,6 +238,7 @@ namespace mongo {
         _nscanned(0),
         _nscannedObjects(0),
         _prelock(!cc().opSettings().getJustOne() && numWanted == 0),
+        _pkFetchBatchSize(pkFetchBatchSize(cl, idx, _prelock)),
         _tailable(false),
         _ok(false),
         _getf_iteration(0)
@@ -314,8 +357,8 @@ namespace mongo {
         const BSONObj &rightKey = forward() ? endKey : startKey; 
         dassert(leftKey.woCompare(rightKey, _ordering) <= 0);
 
-        storage::Key sKey(leftKey, isSecondary ? &minKey : NULL);
-        storage::Key eKey(rightKey, isSecondary ? &maxKey : NULL);
+        storage::Key sKey(leftKey, isSecondary ? &minKey : NULL, _idx.descriptor());
+        storage::Key eKey(rightKey, isSecondary ? &maxKey : NULL, _idx.descriptor());
         DBT start = sKey.dbt();
         DBT end = eKey.dbt();
 
@@ -509,7 +552,7 @@ namespace mongo {
         _buffer.empty();
         _getf_iteration = 0;
 
-        storage::Key sKey( key, !pk.isEmpty() ? &pk : NULL );
+        storage::Key sKey( key, !pk.isEmpty() ? &pk : NULL, _idx.descriptor() );
         DBT key_dbt = sKey.dbt();;
 
         int r;
@@ -795,7 +838,7 @@ again:      while ( !allInclusive && ok() ) {
         // with the full document on the first call to current().
         if ( _currObj.isEmpty() ) {
             _nscannedObjects++;
-            bool found = _cl->findByPK( _currPK, _currObj );
+            bool found = findCurrentObj();
             if ( !found ) {
                 // If we didn't find the associated object, we must be either:
                 // - a snapshot transaction whose context deleted the current pk
@@ -804,7 +847,7 @@ again:      while ( !allInclusive && ok() ) {
                 TOKULOG(4) << "current() did not find associated object for pk " << _currPK << endl;
                 advance();
                 if ( ok() ) {
-                    found = _cl->findByPK( _currPK, _currObj );
+                    found = findCurrentObj();
                     uassert( 16741, str::stream()
                                 << toString() << ": could not find associated document with pk "
                                 << _currPK << ", index key " << _currKey, found );
@@ -821,6 +864,75 @@ again:      while ( !allInclusive && ok() ) {
         return _currObj;
     }
 
+    namespace {
+        // Orders positions in a vector of pks by the pk ordering.
+        class PKPositionLess {
+        public:
+            PKPositionLess(const vector<BSONObj> &pks, const Ordering &ordering) :
+                _pks(pks), _ordering(ordering) {
+            }
+            bool operator()(size_t a, size_t b) const {
+                return _pks[a].woCompare(_pks[b], _ordering) < 0;
+            }
+        private:
+            const vector<BSONObj> &_pks;
+            const Ordering &_ordering;
+        };
+    }
+
+    void IndexCursor::fetchObjBatch() {
+        vector<BSONObj> pks;
+        _buffer.peekPKs(_pkFetchBatchSize, pks);
+
+        vector<size_t> order(pks.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        const Ordering pkOrdering = Ordering::make(_cl->getPKIndex().keyPattern());
+        std::sort(order.begin(), order.end(), PKPositionLess(pks, pkOrdering));
+
+        vector<BSONObj> sortedPKs;
+        sortedPKs.reserve(pks.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            sortedPKs.push_back(pks[order[i]]);
+        }
+        vector<BSONObj> objs;
+        _cl->findByPKs(sortedPKs, objs);
+
+        // Hand the documents back in index order.
+        vector<BSONObj> objsInIndexOrder(pks.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            objsInIndexOrder[order[i]] = objs[i];
+        }
+        for (size_t i = 0; i < pks.size(); i++) {
+            _fetchedObjs.push_back(make_pair(pks[i], objsInIndexOrder[i]));
+        }
+    }
+
+    bool IndexCursor::findCurrentObj() {
+        if (_pkFetchBatchSize == 0) {
+            return _cl->findByPK( _currPK, _currObj );
+        }
+
+        // Rows the caller advanced past without looking at their document
+        // (the matcher rejected the key, a dup, a skip) are at the front.
+        while (!_fetchedObjs.empty() && !_fetchedObjs.front().first.binaryEqual(_currPK)) {
+            _fetchedObjs.pop_front();
+        }
+        if (_fetchedObjs.empty()) {
+            fetchObjBatch();
+        }
+        if (!_fetchedObjs.empty() && _fetchedObjs.front().first.binaryEqual(_currPK)) {
+            _currObj = _fetchedObjs.front().second;
+            _fetchedObjs.pop_front();
+            return !_currObj.isEmpty();
+        }
+
+        // Not positioned on a buffered row, look it up on its own.
+        _fetchedObjs.clear();
+        return _cl->findByPK( _currPK, _currObj );
+    }
+
     bool IndexCursor::currentMatches( MatchDetails *details ) {
          // If currKey() might not match the specified _bounds, check whether or not it does.
          if ( !_boundsMustMatch && _bounds && !_bounds->matchesKey( currKey() ) ) {
@@ -831,6 +943,18 @@ again:      while ( !allInclusive && ok() ) {
          return Cursor::currentMatches( details );
     }
 
+    void IndexCursor::skipToPK(const BSONObj &pk) {
+        verify(forward());
+        if ( !ok() ) {
+            return;
+        }
+        // Like _advance(), the seek lands on a key that hasn't been checked against _bounds.
+        _boundsMustMatch = true;
+        const BSONObj key = _currKey.getOwned();
+        setPosition( key, pk );
+        checkCurrentAgainstBounds();
+    }
+
     string IndexCursor::toString() const {
         string s = string("IndexCursor ") + _idx.indexName();
         if ( _direction < 0 ) {
@@ -850,4 +974,31 @@ again:      while ( !allInclusive && ok() ) {
         }
     }    
 
+    /* ---------------------------------------------------------------------- */
+
+    SkipScanCursor::SkipScanCursor(CollectionData *cl, const IndexDetails &idx,
+                                   const shared_ptr<FieldRangeVector> &bounds,
+                                   const int direction) :
+        IndexCursor(cl, idx, bounds, 0, direction) {
+    }
+
+    bool SkipScanCursor::advance() {
+        killCurrentOp.checkForInterrupt();
+        if ( !ok() ) {
+            return false;
+        }
+        // Like _advance(), the skip lands on a key that hasn't been checked against _bounds.
+        _boundsMustMatch = true;
+        skipPrefix( _currKey, 1 );
+        return checkCurrentAgainstBounds();
+    }
+
+    string SkipScanCursor::toString() const {
+        string s = string("SkipScanCursor ") + _idx.indexName();
+        if ( _direction < 0 ) {
+            s += " reverse";
+        }
+        return s;
+    }
+
 } // namespace mongo
@@ -86,10 +86,12 @@ namespace mongo {
         // The indexer intends to create.
         const bool may_create = true;
 
-        // We use the memcmp magic optimization on an index if it's the primary key
-        // and the key pattern is exactly { _id: 1 }, because they commonly contain
-        // OID keys (which are memcmp'able) and never have extra bytes appended the
-        // way that secondary keys do.
+        // Indexes created here get memcmp-comparable keys (see storage::MemcmpKey),
+        // which carry their own memcmp magic. For older indexes, which are opened
+        // with the same flag by CollectionBase, we use the memcmp magic optimization
+        // if it's the primary key and the key pattern is exactly { _id: 1 }, because
+        // they commonly contain OID keys (which are memcmp'able) and never have extra
+        // bytes appended the way that secondary keys do.
         const bool use_memcmp_magic = !_isSecondaryIndex && keyPattern == BSON("_id" << 1);
         _idx = IndexDetailsBase::make(_info, may_create, use_memcmp_magic);
 
@@ -28,6 +28,8 @@
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/security_key.h"
 #include "mongo/db/cmdline.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/processinfo.h"
@@ -172,6 +174,47 @@ namespace mongo {
         return true;
     }
 
+    // Write the log from a dedicated thread, see startAsyncLogging().
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asyncLogging, bool, false);
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asyncLogQueueSize, int, 16384);
+    // "block", "dropDebug" or "drop", see AsyncLogOverflowPolicy
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(asyncLogOverflow, string, "dropDebug");
+
+    class AsyncLogDroppedMetric : public ServerStatusMetric {
+    public:
+        AsyncLogDroppedMetric() : ServerStatusMetric("log.dropped") {}
+        virtual void appendAtLeaf(BSONObjBuilder& b) const {
+            b.appendNumber(_leafName, asyncLogDropped());
+        }
+    } asyncLogDroppedMetric;
+
+    bool initializeAsyncLogging() {
+        if (!asyncLogging) {
+            return true;
+        }
+        AsyncLogOverflowPolicy policy;
+        if (asyncLogOverflow == "block") {
+            policy = ASYNC_LOG_BLOCK;
+        }
+        else if (asyncLogOverflow == "dropDebug") {
+            policy = ASYNC_LOG_DROP_DEBUG;
+        }
+        else if (asyncLogOverflow == "drop") {
+            policy = ASYNC_LOG_DROP;
+        }
+        else {
+            cout << "asyncLogOverflow must be one of block, dropDebug or drop, not \""
+                 << asyncLogOverflow << "\"" << endl;
+            return false;
+        }
+        if (asyncLogQueueSize < 1 || asyncLogQueueSize > (1 << 24)) {
+            cout << "asyncLogQueueSize must be between 1 and " << (1 << 24) << endl;
+            return false;
+        }
+        startAsyncLogging(asyncLogQueueSize, policy);
+        return true;
+    }
+
     static void ignoreSignal( int sig ) {}
 
     void setupCoreSignals() {
@@ -32,4 +32,12 @@ namespace mongo {
 
     void setupCoreSignals();
 
+    /**
+     * Starts the async log writer if the asyncLogging parameter is set.  Like any other thread,
+     * it must be started after forking and setting the signal mask (SERVER-7434).
+     *
+     * @return false if the async logging parameters are bad.
+     */
+    bool initializeAsyncLogging();
+
 }  // namespace mongo
@@ -36,6 +36,7 @@
 
 #include "mongo/bson/util/atomic_int.h"
 
+#include "mongo/db/admission_control.h"
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/databaseholder.h"
@@ -226,6 +227,7 @@ namespace mongo {
                 Status status = cc().getAuthorizationManager()->checkAuthForQuery(d.getns());
                 uassert(16550, status.reason(), status.isOK());
             }
+            flushProfileEntriesBeforeRead(d.getns(), q.query);
             dbresponse.exhaustNS = runQuery(m, q, op, *resp);
             verify( !resp->empty() );
         }
@@ -306,17 +308,6 @@ namespace mongo {
         ::abort();
     }
 
-    // Profile the current op in an alternate transaction
-    void lockedDoProfile(const Client& c, int op, CurOp& currentOp) {
-        if ( dbHolder().__isLoaded( nsToDatabase( currentOp.getNS() ) , dbpath ) ) {
-            Client::Context ctx(currentOp.getNS(), dbpath);
-            Client::AlternateTransactionStack altStack;
-            Client::Transaction txn(DB_SERIALIZABLE);
-            profile(c, op, currentOp);
-            txn.commit();
-        }
-    }
-
     // Returns false when request includes 'end'
     void assembleResponse( Message &m, DbResponse &dbresponse, const HostAndPort& remote ) {
 
@@ -379,6 +370,13 @@ namespace mongo {
         OpDebug& debug = currentOp.debug();
         debug.op = op;
 
+        // Operations nested in another one (DBDirectClient) run on its ticket, and the server's
+        // own threads aren't admitted.
+        AdmissionControl::Ticket admissionTicket;
+        if ( AdmissionControl::enabled && c.port() != NULL && nestedOp.get() == NULL ) {
+            admissionTicket.acquire( AdmissionControl::global , AdmissionControl::classify( m ) );
+        }
+
         long long logThreshold = cmdLine.slowMS;
         bool shouldLog = logLevel >= 1;
 
@@ -468,19 +466,7 @@ namespace mongo {
 
         if ( currentOp.shouldDBProfile( debug.executionTime ) ) {
             // performance profiling is on
-            if ( Lock::isReadLocked() ) {
-                LOG(1) << "note: not profiling because recursive read lock" << endl;
-            }
-            else {
-                LOCK_REASON(lockReason, "writing to system.profile collection");
-                try {
-                    Lock::DBRead lk( currentOp.getNS(), lockReason );
-                    lockedDoProfile( c, op, currentOp );
-                } catch (RetryWithWriteLock &e) {
-                    Lock::DBWrite lk( currentOp.getNS(), lockReason );
-                    lockedDoProfile( c, op, currentOp );
-                }
-            }
+            profile( c, op, currentOp );
         }
 
         debug.recordStats();
@@ -1238,8 +1224,10 @@ namespace mongo {
         // Need to make sure coverage data is properly flushed before exit.
         // It appears that ::_exit() does not do this.
         log() << "calling regular ::exit() so coverage data may flush..." << endl;
+        flushAsyncLog();
         ::exit( rc );
 #else
+        flushAsyncLog();
         ::_exit( rc );
 #endif
     }
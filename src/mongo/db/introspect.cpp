@@ -19,30 +19,39 @@
 
 #include "mongo/pch.h"
 
+#include <boost/functional/hash.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "mongo/base/counter.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/principal_set.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/database.h"
 #include "mongo/db/databaseholder.h"
 #include "mongo/db/introspect.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/namespacestring.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/db/relock.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/background.h"
 #include "mongo/util/goodies.h"
 
 namespace mongo {
 
 namespace {
-    void _appendUserInfo(const Client& c, BSONObjBuilder& builder, AuthorizationManager* authManager) {
+    void _appendUserInfo(const StringData& opdb, BSONObjBuilder& builder, AuthorizationManager* authManager) {
         PrincipalSet::NameIterator nameIter = authManager->getAuthenticatedPrincipalNames();
 
         PrincipalName bestUser;
         if (nameIter.more())
             bestUser = *nameIter;
 
-        StringData opdb( nsToDatabaseSubstring( c.ns() ) );
-
         BSONArrayBuilder allUsers(builder.subarrayStart("allUsers"));
         for ( ; nameIter.more(); nameIter.next()) {
             BSONObjBuilder nextUser(allUsers.subobjStart());
@@ -61,10 +70,270 @@ namespace {
     }
 } // namespace
 
-    static void _profile(const Client& c, CurOp& currentOp, BufBuilder& profileBufBuilder) {
-        Database *db = c.database();
-        DEV verify( db );
+    // Profile entries are built on the op's thread, which needs no lock for it, and queued in
+    // that thread's ProfileRing.  The ProfileWriter drains every thread's ring in the background
+    // and inserts the entries into system.profile in batches, one transaction per database.
+    //
+    // If entries are queued faster than they're written, a full ring drops new entries rather
+    // than block the op; profiler.dropped counts them.
+
+    // entries each thread can queue before they are dropped, rounded up to a power of two
+    MONGO_EXPORT_SERVER_PARAMETER(profileBufferSize, int, 1024);
+    // profile only 1 in this many ops of each shape (see profileShape)
+    MONGO_EXPORT_SERVER_PARAMETER(profileSampleRate, int, 1);
+    // how often the writer drains the rings when they're not filling up
+    MONGO_EXPORT_SERVER_PARAMETER(profileWriterIntervalMillis, int, 100);
+
+    static Counter64 profileEntriesWritten;
+    static ServerStatusMetricField<Counter64> displayProfileEntriesWritten("profiler.written",
+                                                                            &profileEntriesWritten);
+    static Counter64 profileEntriesDropped;
+    static ServerStatusMetricField<Counter64> displayProfileEntriesDropped("profiler.dropped",
+                                                                            &profileEntriesDropped);
+
+namespace {
+
+    struct ProfileEntry {
+        string dbName;
+        BSONObj obj;
+        // orders entries from different threads, a client's consecutive ops may run on different
+        // threads
+        unsigned long long micros;
+
+        bool operator<(const ProfileEntry &other) const { return micros < other.micros; }
+    };
+
+    /**
+     * A single producer, single consumer queue of profile entries.  The producer is the thread
+     * the ring belongs to, the consumer is whoever holds ProfileWriter's drain mutex.
+     */
+    class ProfileRing : boost::noncopyable {
+      public:
+        explicit ProfileRing(unsigned capacity)
+                : _mask(capacity - 1), _slots(new ProfileEntry[capacity]) {
+            dassert((capacity & _mask) == 0);
+        }
+
+        /** @return false if the ring is full */
+        bool push(const ProfileEntry &e) {
+            const unsigned head = _head.loadRelaxed();
+            if (head - _tail.load() > _mask) {
+                return false;
+            }
+            _slots[head & _mask] = e;
+            _head.store(head + 1);
+            return true;
+        }
+
+        /** @return false if the ring is empty */
+        bool pop(ProfileEntry &e) {
+            const unsigned tail = _tail.loadRelaxed();
+            if (tail == _head.load()) {
+                return false;
+            }
+            ProfileEntry &slot = _slots[tail & _mask];
+            e = slot;
+            // don't hold on to the entry's buffer until the slot is reused
+            slot = ProfileEntry();
+            _tail.store(tail + 1);
+            return true;
+        }
+
+        bool halfFull() const {
+            return _head.loadRelaxed() - _tail.load() > _mask / 2;
+        }
+
+        // set once the owning thread has exited, then the consumer deletes the ring when it's
+        // empty
+        AtomicUInt32 exited;
 
+      private:
+        const unsigned _mask;
+        boost::scoped_array<ProfileEntry> _slots;
+        AtomicUInt32 _head;
+        AtomicUInt32 _tail;
+    };
+
+    class ProfileWriter : public BackgroundJob {
+      public:
+        ProfileWriter() : _ringsMutex("profileRings"), _ring(&ProfileWriter::threadExited) {}
+
+        virtual string name() const { return "ProfileWriter"; }
+
+        void enqueue(const ProfileEntry &e) {
+            ProfileRing &ring = threadRing();
+            if (!ring.push(e)) {
+                profileEntriesDropped.increment();
+            }
+            else if (ring.halfFull()) {
+                _drainNeeded.notify_one();
+            }
+        }
+
+        /** Writes everything queued so far, on the calling thread. */
+        void drain() {
+            boost::mutex::scoped_lock lk(_drainMutex);
+
+            vector<ProfileRing *> rings;
+            {
+                SimpleMutex::scoped_lock rlk(_ringsMutex);
+                rings.assign(_rings.begin(), _rings.end());
+            }
+
+            vector<ProfileEntry> entries;
+            ProfileEntry e;
+            for (vector<ProfileRing *>::const_iterator it = rings.begin(); it != rings.end(); ++it) {
+                ProfileRing *ring = *it;
+                const bool exited = ring->exited.load();
+                while (ring->pop(e)) {
+                    entries.push_back(e);
+                }
+                if (exited) {
+                    // it was empty after the thread stopped pushing
+                    {
+                        SimpleMutex::scoped_lock rlk(_ringsMutex);
+                        _rings.remove(ring);
+                    }
+                    delete ring;
+                }
+            }
+            if (entries.empty()) {
+                return;
+            }
+
+            std::stable_sort(entries.begin(), entries.end());
+            map<string, vector<BSONObj> > byDb;
+            for (vector<ProfileEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+                byDb[it->dbName].push_back(it->obj);
+            }
+            for (map<string, vector<BSONObj> >::const_iterator it = byDb.begin(); it != byDb.end(); ++it) {
+                try {
+                    LOCK_REASON(lockReason, "writing to system.profile collection");
+                    try {
+                        Lock::DBRead lk(it->first, lockReason);
+                        write(it->first, it->second);
+                    } catch (RetryWithWriteLock &) {
+                        Lock::DBWrite lk(it->first, lockReason);
+                        write(it->first, it->second);
+                    }
+                }
+                catch (const DBException &ex) {
+                    warning() << "Caught Assertion while writing " << it->second.size()
+                              << " profile entries to " << it->first << ": " << ex.toString() << endl;
+                    profileEntriesDropped.increment(it->second.size());
+                }
+            }
+        }
+
+      private:
+        void run() {
+            Client::initThread(name().c_str());
+            while (!inShutdown()) {
+                {
+                    boost::mutex::scoped_lock lk(_waitMutex);
+                    _drainNeeded.timed_wait(lk, boost::posix_time::milliseconds(
+                                                    std::max(profileWriterIntervalMillis, 1)));
+                }
+                try {
+                    drain();
+                }
+                catch (const std::exception &ex) {
+                    error() << "error writing profile entries: " << ex.what() << endl;
+                }
+            }
+            cc().shutdown();
+        }
+
+        static void write(const string &dbName, const vector<BSONObj> &objs) {
+            if (!dbHolder().__isLoaded(dbName, dbpath)) {
+                // dropped since the entries were queued
+                return;
+            }
+            Client::Context ctx(getSisterNS(dbName, "system.profile"), dbpath);
+            Client::AlternateTransactionStack altStack;
+            Client::Transaction txn(DB_SERIALIZABLE);
+            Collection *cl = getOrCreateProfileCollection(ctx.db());
+            if (cl == NULL) {
+                return;
+            }
+            for (vector<BSONObj>::const_iterator it = objs.begin(); it != objs.end(); ++it) {
+                BSONObj obj = *it;
+                insertOneObject(cl, obj);
+            }
+            txn.commit();
+            profileEntriesWritten.increment(objs.size());
+        }
+
+        ProfileRing &threadRing() {
+            ProfileRing *ring = _ring.get();
+            if (ring == NULL) {
+                unsigned capacity = 2;
+                while (capacity < static_cast<unsigned>(profileBufferSize) && capacity < (1U << 30)) {
+                    capacity <<= 1;
+                }
+                ring = new ProfileRing(capacity);
+                _ring.reset(ring);
+                SimpleMutex::scoped_lock lk(_ringsMutex);
+                _rings.push_back(ring);
+            }
+            return *ring;
+        }
+
+        static void threadExited(ProfileRing *ring) {
+            // the ring may still have entries, the next drain writes them and deletes it
+            ring->exited.store(1);
+        }
+
+        // protects _rings; the rings themselves are only deleted under _drainMutex
+        SimpleMutex _ringsMutex;
+        list<ProfileRing *> _rings;
+        boost::thread_specific_ptr<ProfileRing> _ring;
+
+        // one consumer at a time
+        boost::mutex _drainMutex;
+
+        boost::mutex _waitMutex;
+        boost::condition_variable _drainNeeded;
+    } profileWriter;
+
+    /**
+     * Hashes what an op's profile entries would have in common with those of other ops like it:
+     * its type, namespace, and the field names and operators of its query, but not the values.
+     */
+    size_t profileShape(int op, const StringData &ns, const BSONObj &query) {
+        size_t h = op;
+        boost::hash_combine(h, boost::hash_range(ns.rawData(), ns.rawData() + ns.size()));
+        vector<BSONObj> pending(1, query);
+        while (!pending.empty()) {
+            BSONObj o = pending.back();
+            pending.pop_back();
+            for (BSONObjIterator it(o); it.more(); ) {
+                BSONElement e = it.next();
+                const StringData name(e.fieldName());
+                boost::hash_combine(h, boost::hash_range(name.rawData(), name.rawData() + name.size()));
+                if (e.type() == Object) {
+                    pending.push_back(e.Obj());
+                }
+            }
+        }
+        return h;
+    }
+
+    /** @return true if this op should be skipped by sampling. */
+    bool sampledOut(int op, const StringData &ns, const OpDebug &debug) {
+        const int rate = profileSampleRate;
+        if (rate <= 1) {
+            return false;
+        }
+        static AtomicUInt32 shapeCounts[1024];
+        AtomicUInt32 &count = shapeCounts[profileShape(op, ns, debug.query) % 1024];
+        return count.fetchAndAdd(1) % rate != 0;
+    }
+
+} // namespace
+
+    static void _profile(const Client& c, CurOp& currentOp, BufBuilder& profileBufBuilder,
+                         const StringData& dbName) {
         // build object
         BSONObjBuilder b(profileBufBuilder);
         b.appendDate("ts", jsTime());
@@ -72,7 +341,12 @@ namespace {
         b.append("client", c.clientAddress());
 
         AuthorizationManager* authManager = c.getAuthorizationManager();
-        _appendUserInfo(c, b, authManager);
+        _appendUserInfo(dbName, b, authManager);
+
+        const int rate = profileSampleRate;
+        if (rate > 1) {
+            b.append("sampleRate", rate);
+        }
 
         BSONObj p = b.done();
 
@@ -85,7 +359,7 @@ namespace {
             BSONObjBuilder b(profileBufBuilder);
             b.appendDate("ts", jsTime());
             b.append("client", c.clientAddress() );
-            _appendUserInfo(c, b, authManager);
+            _appendUserInfo(dbName, b, authManager);
 
             b.append("err", "profile line too large (max is 100KB)");
             if (small.size() < 100*1024){ // should be much smaller but if not don't break anything
@@ -95,22 +369,24 @@ namespace {
             p = b.done();
         }
 
-        // get or create the profiling collection
-        Collection *cl = getOrCreateProfileCollection(db);
-        if (cl) {
-            insertOneObject(cl, p);
-        }
+        ProfileEntry e;
+        e.dbName = dbName.toString();
+        e.obj = p.getOwned();
+        e.micros = curTimeMicros64();
+        profileWriter.enqueue(e);
     }
 
     void profile(const Client& c, int op, CurOp& currentOp) {
-        Lock::assertAtLeastReadLocked(currentOp.getNS());
+        const StringData dbName = nsToDatabaseSubstring(currentOp.getNS());
+        if (dbName.empty() || sampledOut(op, currentOp.getNS(), currentOp.debug())) {
+            return;
+        }
 
         // initialize with 1kb to start, to avoid realloc later
-        // doing this outside the dblock to improve performance
         BufBuilder profileBufBuilder(1024);
 
         try {
-            _profile(c, currentOp, profileBufBuilder);
+            _profile(c, currentOp, profileBufBuilder, dbName);
         }
         catch (const AssertionException& assertionEx) {
             warning() << "Caught Assertion while trying to profile " << opToString(op)
@@ -119,6 +395,34 @@ namespace {
         }
     }
 
+    void flushProfileEntries() {
+        profileWriter.drain();
+    }
+
+    void flushProfileEntriesBeforeRead(const StringData& ns, const BSONObj& query) {
+        if (Lock::isLocked()) {
+            // the writer needs its own locks, and whoever reads with a lock held gets what's
+            // already written
+            return;
+        }
+        bool readsProfile = nsToCollectionSubstring(ns) == "system.profile";
+        if (!readsProfile && NamespaceString::isCommand(ns)) {
+            BSONObj cmd = query;
+            if (StringData(cmd.firstElement().fieldName()) == "$query" && cmd.firstElement().isABSONObj()) {
+                cmd = cmd.firstElement().Obj();
+            }
+            BSONElement target = cmd.firstElement();
+            readsProfile = target.type() == String && target.valuestringdatasafe() == "system.profile";
+        }
+        if (readsProfile) {
+            flushProfileEntries();
+        }
+    }
+
+    void startProfileWriter() {
+        profileWriter.go();
+    }
+
     Collection *getOrCreateProfileCollection(Database *db, bool force) {
         fassert(16372, db);
         const char *profileName = db->profileName().c_str();
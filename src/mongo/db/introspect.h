@@ -32,8 +32,25 @@ namespace mongo {
        do when database->profile is set
     */
 
+    /**
+     * Queues a profile entry for currentOp, which a background thread writes to its database's
+     * system.profile later.  Needs no lock.  Only 1 in profileSampleRate ops of each shape are
+     * profiled.
+     */
     void profile(const Client& c, int op, CurOp& currentOp);
 
+    /** Writes all queued profile entries now, on this thread. */
+    void flushProfileEntries();
+
+    /**
+     * Flushes queued profile entries if the query or command on ns reads a system.profile
+     * collection, so that it sees the ops that came before it.
+     */
+    void flushProfileEntriesBeforeRead(const StringData& ns, const BSONObj& query);
+
+    /** Starts the thread that writes queued profile entries. */
+    void startProfileWriter();
+
     /**
      * Get (or create) the profile collection
      *
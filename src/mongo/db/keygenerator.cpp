@@ -34,8 +34,8 @@ namespace mongo {
     long long int HashKeyGenerator::makeSingleKey(const BSONElement &e,
                                                   const HashSeed &seed,
                                                   const HashVersion &v) {
-        massert( 16245, "Only HashVersion 0 has been defined", v == 0 );
-        return BSONElementHasher::hash64( e , seed );
+        massert( 16245, mongoutils::str::stream() << "Unknown HashVersion " << v, isValidHashVersion( v ) );
+        return BSONElementHasher::hash64( e , seed , v );
     }
 
     void HashKeyGenerator::getKeys(const BSONObj &obj, BSONObjSet &keys) {
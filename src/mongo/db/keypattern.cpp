@@ -43,7 +43,8 @@ namespace mongo {
         return keyObj.obj();
     }
 
-    KeyPattern::KeyPattern( const BSONObj& pattern ): _pattern( pattern ) {
+    KeyPattern::KeyPattern( const BSONObj& pattern , int hashVersion ):
+        _pattern( pattern ), _hashVersion( hashVersion ) {
 
         // Extract all prefixes of each field in pattern.
         BSONForEach( field, _pattern ) {
@@ -65,7 +66,8 @@ namespace mongo {
             BSONElement fieldVal = doc.getFieldDotted( _pattern.firstElementFieldName() );
             return BSON( _pattern.firstElementFieldName() <<
                          BSONElementHasher::hash64( fieldVal ,
-                                                    BSONElementHasher::DEFAULT_HASH_SEED ) );
+                                                    BSONElementHasher::DEFAULT_HASH_SEED ,
+                                                    _hashVersion ) );
         }
 
         return doc.extractFields( _pattern );
@@ -245,7 +247,8 @@ namespace mongo {
                 if ( i->equality() ) {
                     // hash [a,a] --> [hash(a),hash(a)]
                     long long int h = BSONElementHasher::hash64( i->_lower._bound ,
-                                                             BSONElementHasher::DEFAULT_HASH_SEED );
+                                                             BSONElementHasher::DEFAULT_HASH_SEED ,
+                                                             _hashVersion );
                     ret.push_back( make_pair( BSON( field.fieldName() << h ) ,
                                               BSON( field.fieldName() << h ) ) );
                 } else {
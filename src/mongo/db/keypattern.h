@@ -68,14 +68,19 @@ namespace mongo {
 
         /*
          * We are allowing implicit conversion from BSON
+         *
+         * hashVersion is the hash function (see HashVersions in hasher.h) for a "hashed" field,
+         * the same as the hashed index's.
          */
-        KeyPattern( const BSONObj& pattern );
+        KeyPattern( const BSONObj& pattern , int hashVersion = 0 );
 
         /*
          *  Returns a BSON representation of this KeyPattern.
          */
         BSONObj toBSON() const { return _pattern; }
 
+        int hashVersion() const { return _hashVersion; }
+
         /*
          * Returns true if the given fieldname is the (dotted prefix of the) name of one
          * element of the (potentially) compound key described by this KeyPattern.
@@ -199,6 +204,7 @@ namespace mongo {
 
     private:
         BSONObj _pattern;
+        int _hashVersion;
 
         // Each field in the '_pattern' may be itself a dotted field. We store all the prefixes
         // of each field here. For instance, if a pattern is { 'a.b.c': 1, x: 1 }, we'll store
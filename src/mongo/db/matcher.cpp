@@ -578,6 +578,83 @@ namespace mongo {
         while ( i.more() ) {
             parseMatchExpressionElement( i.next(), nested );
         }
+        compile();
+    }
+
+    namespace {
+
+        /** Rough relative cost of evaluating 'bm' against a field, used to order a program. */
+        int basicCost( const ElementMatcher &bm ) {
+            switch( bm._compareOp ) {
+            case BSONObj::opEXISTS:
+                return 0;
+            case BSONObj::opTYPE:
+                return 1;
+            case BSONObj::Equality:
+            case BSONObj::LT:
+            case BSONObj::LTE:
+            case BSONObj::GT:
+            case BSONObj::GTE:
+                return bm._toMatch.isABSONObj() ? 3 : 2;
+            case BSONObj::opMOD:
+                return 3;
+            case BSONObj::NE:
+            case BSONObj::opSIZE:
+                return 4;
+            case BSONObj::opIN:
+            case BSONObj::NIN:
+                return bm._myregex.get() ? 7 : 5;
+            default:
+                // $elemMatch runs a nested matcher.
+                return 8;
+            }
+        }
+
+        const int regexCost = 9;
+
+    } // namespace
+
+    void Matcher::compile() {
+        if ( !_constrainIndexKey.isEmpty() || ( _basics.empty() && _regexs.empty() ) ) {
+            return;
+        }
+        vector<Instruction> program;
+        vector<StringData> fields;
+        for( int i = 0; i < (int)( _basics.size() + _regexs.size() ); ++i ) {
+            Instruction inst;
+            StringData fieldName;
+            if ( i < (int)_basics.size() ) {
+                const ElementMatcher &bm = _basics[ i ];
+                // $all matching looks the field up on its own.
+                if ( bm._compareOp == BSONObj::opALL ) {
+                    return;
+                }
+                fieldName = bm._toMatch.fieldName();
+                inst.basic = i;
+                inst.regex = -1;
+                inst.cost = basicCost( bm );
+            }
+            else {
+                inst.basic = -1;
+                inst.regex = i - _basics.size();
+                fieldName = _regexs[ inst.regex ]._fieldName;
+                inst.cost = regexCost;
+            }
+            if ( fieldName.find( '.' ) != string::npos ) {
+                return;
+            }
+            inst.slot = find( fields.begin(), fields.end(), fieldName ) - fields.begin();
+            if ( inst.slot == (int)fields.size() ) {
+                if ( inst.slot == MaxProgramFields ) {
+                    return;
+                }
+                fields.push_back( fieldName );
+            }
+            program.push_back( inst );
+        }
+        stable_sort( program.begin(), program.end() );
+        _program.swap( program );
+        _programFields.swap( fields );
     }
 
     Matcher::Matcher( const Matcher &docMatcher, const BSONObj &key ) :
@@ -884,6 +961,10 @@ namespace mongo {
             }
         }
 
+        return matchesElement( e, toMatch, compareOp, em, indexed, details );
+    }
+
+    int Matcher::matchesElement(const BSONElement& e, const BSONElement& toMatch, int compareOp, const ElementMatcher& em, bool indexed, MatchDetails * details ) const {
         if ( compareOp == BSONObj::opEXISTS ) {
             if( e.eoo() ) {
                 return 0;
@@ -938,6 +1019,91 @@ namespace mongo {
 
     extern int dump;
 
+    bool Matcher::basicAccepts( int cmp, const ElementMatcher &bm ) {
+        const BSONElement& m = bm._toMatch;
+        if ( cmp == 0 && bm._compareOp == BSONObj::opEXISTS ) {
+            // If missing, match cmp is opposite of $exists spec.
+            cmp = -retExistsFound(bm);
+        }
+        if ( bm._isNot )
+            cmp = -cmp;
+        if ( cmp < 0 )
+            return false;
+        if ( cmp == 0 ) {
+            /* missing is ok iff we were looking for null */
+            if ( m.type() == jstNULL || m.type() == Undefined ||
+                ( ( bm._compareOp == BSONObj::opIN || bm._compareOp == BSONObj::NIN ) && bm._myset->count( staticNull.firstElement() ) > 0 ) ) {
+                if ( bm.negativeCompareOp() ^ bm._isNot ) {
+                    return false;
+                }
+            }
+            else {
+                if ( !bm._isNot ) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool Matcher::matchesProgram( const BSONObj &obj ) const {
+        // Resolve every field the program refers to in one pass.  Like getField(), the first
+        // occurrence of a field name wins.
+        BSONElement fields[ MaxProgramFields ];
+        int nFields = _programFields.size();
+        int unresolved = nFields;
+        BSONObjIterator i( obj );
+        while ( unresolved > 0 && i.more() ) {
+            BSONElement e = i.next();
+            StringData name( e.fieldName(), e.fieldNameSize() - 1 );
+            for( int j = 0; j < nFields; ++j ) {
+                if ( fields[ j ].eoo() && _programFields[ j ] == name ) {
+                    fields[ j ] = e;
+                    --unresolved;
+                    break;
+                }
+            }
+        }
+
+        for( vector<Instruction>::const_iterator inst = _program.begin(); inst != _program.end(); ++inst ) {
+            const BSONElement &e = fields[ inst->slot ];
+            if ( inst->regex >= 0 ) {
+                const RegexMatcher &rm = _regexs[ inst->regex ];
+                bool match = false;
+                if ( e.type() == Array ) {
+                    BSONObjIterator ai( e.embeddedObject() );
+                    while ( !match && ai.more() ) {
+                        match = regexMatches( rm, ai.next() );
+                    }
+                }
+                else if ( !e.eoo() ) {
+                    match = regexMatches( rm, e );
+                }
+                if ( !match ^ rm._isNot )
+                    return false;
+                continue;
+            }
+            const ElementMatcher &bm = _basics[ inst->basic ];
+            int cmp;
+            if ( bm.negativeCompareOp() ) {
+                // As inverseMatch().
+                int inverseRet = matchesElement( e, bm._toMatch, bm.inverseOfNegativeCompareOp(), bm, false, 0 );
+                if ( bm.negativeCompareOpContainsNull() ) {
+                    cmp = ( inverseRet <= 0 ) ? 1 : 0;
+                }
+                else {
+                    cmp = -inverseRet;
+                }
+            }
+            else {
+                cmp = matchesElement( e, bm._toMatch, bm._compareOp, bm, false, 0 );
+            }
+            if ( !basicAccepts( cmp, bm ) )
+                return false;
+        }
+        return true;
+    }
+
     /* See if an object matches the query.
     */
     bool Matcher::matches(const BSONObj& jsobj , MatchDetails * details ) const {
@@ -949,37 +1115,21 @@ namespace mongo {
 
         LOG(5) << "Matcher::matches() " << jsobj.toString() << endl;
 
-        /* assuming there is usually only one thing to match.  if more this
-           could be slow sometimes. */
+        // The compiled program covers the basic and regex clauses.  It does not track the
+        // matched array element, so it is only used when no elemMatchKey is wanted.
+        const bool useProgram = !_program.empty() && ( !details || !details->needRecord() );
+        if ( useProgram && !matchesProgram( jsobj ) ) {
+            return false;
+        }
 
         // check normal non-regex cases:
-        for ( unsigned i = 0; i < _basics.size(); i++ ) {
+        for ( unsigned i = 0; !useProgram && i < _basics.size(); i++ ) {
             const ElementMatcher& bm = _basics[i];
             const BSONElement& m = bm._toMatch;
             // -1=mismatch. 0=missing element. 1=match
             int cmp = matchesDotted(m.fieldName(), m, jsobj, bm._compareOp, bm , false , details );
-            if ( cmp == 0 && bm._compareOp == BSONObj::opEXISTS ) {
-                // If missing, match cmp is opposite of $exists spec.
-                cmp = -retExistsFound(bm);
-            }
-            if ( bm._isNot )
-                cmp = -cmp;
-            if ( cmp < 0 )
+            if ( !basicAccepts( cmp, bm ) )
                 return false;
-            if ( cmp == 0 ) {
-                /* missing is ok iff we were looking for null */
-                if ( m.type() == jstNULL || m.type() == Undefined ||
-                    ( ( bm._compareOp == BSONObj::opIN || bm._compareOp == BSONObj::NIN ) && bm._myset->count( staticNull.firstElement() ) > 0 ) ) {
-                    if ( bm.negativeCompareOp() ^ bm._isNot ) {
-                        return false;
-                    }
-                }
-                else {
-                    if ( !bm._isNot ) {
-                        return false;
-                    }
-                }
-            }
         }
 
         for (vector<GeoMatcher>::const_iterator it = _geo.begin(); it != _geo.end(); ++it) {
@@ -997,7 +1147,7 @@ namespace mongo {
         }
 
         for (vector<RegexMatcher>::const_iterator it = _regexs.begin();
-             it != _regexs.end();
+             !useProgram && it != _regexs.end();
              ++it) {
             BSONElementSet s;
             if ( !_constrainIndexKey.isEmpty() ) {
@@ -1104,7 +1254,7 @@ namespace mongo {
         }
 
         for (vector<RegexMatcher>::const_iterator it = _regexs.begin();
-             it != _regexs.end();
+             !useProgram && it != _regexs.end();
              ++it) {
             BSONElementSet s;
             if ( !_constrainIndexKey.isEmpty() ) {
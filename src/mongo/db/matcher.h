@@ -250,6 +250,11 @@ namespace mongo {
             const BSONElement& toMatch, const BSONObj& obj,
             int compareOp, const ElementMatcher& bm, bool isArr , MatchDetails * details ) const;
 
+        /** The part of matchesDotted() that runs once the field 'e' has been located. */
+        int matchesElement(
+            const BSONElement& e, const BSONElement& toMatch,
+            int compareOp, const ElementMatcher& bm, bool indexed, MatchDetails * details ) const;
+
         /**
          * Perform a NE or NIN match by returning the inverse of the opposite matching operation.
          * Missing values are considered matches unless the match must not equal null.
@@ -343,6 +348,29 @@ namespace mongo {
         void parseWhere( const BSONElement &e );
         void parseMatchExpressionElement( const BSONElement &e, bool nested );
 
+        /** @return true if the result 'cmp' of matching a document against 'bm' is acceptable. */
+        static bool basicAccepts( int cmp, const ElementMatcher &bm );
+
+        /**
+         * Compile _basics and _regexs into _program, if all of them are on top level fields
+         * and use operators the program supports.  Otherwise _program stays empty and
+         * matches() uses the general path.
+         */
+        void compile();
+
+        /** Evaluate _program against 'obj', with a single pass over its fields. */
+        bool matchesProgram( const BSONObj &obj ) const;
+
+        /** One step of a compiled program: a basic or regex predicate on a resolved field. */
+        struct Instruction {
+            int slot;    // index into _programFields
+            int basic;   // index into _basics, or -1
+            int regex;   // index into _regexs, or -1
+            int cost;    // instructions run in increasing cost order
+            bool operator<( const Instruction &other ) const { return cost < other.cost; }
+        };
+        static const int MaxProgramFields = 32;
+
         Where *_where;                    // set if query uses $where
         BSONObj _jsobj;                  // the query pattern.  e.g., { name: "joe" }
         BSONObj _constrainIndexKey;
@@ -361,6 +389,9 @@ namespace mongo {
         list< shared_ptr< Matcher > > _orMatchers;
         list< shared_ptr< Matcher > > _norMatchers;
 
+        vector<Instruction> _program;
+        vector<StringData> _programFields;
+
         friend class CoveredIndexMatcher;
     };
 
@@ -411,7 +411,6 @@ namespace mongo {
             if (indexBitChanged) {
                 cl->noteMultiKeyChanged();
             }
-            cl->notifyOfWriteOp();
         }
 
         static void runCappedInsertFromOplog(const char *ns, const BSONObj &op, RollbackDocsMap* docsMap) {
@@ -465,7 +464,6 @@ namespace mongo {
             CappedCollection *cappedCl = cl->as<CappedCollection>();
             const uint64_t flags = Collection::NO_LOCKTREE;
             cappedCl->deleteObjectWithPK(pk, row, flags);
-            cl->notifyOfWriteOp();
         }
 
         static bool runUpdateFromOplogWithDocsMap(
@@ -5,6 +5,7 @@
 #include <boost/thread/thread.hpp>
 
 #include "mongo/base/counter.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/repl.h"
 #include "mongo/util/net/message.h"
@@ -161,6 +162,10 @@ namespace mongo {
                 log() << "repl: " << errmsg << endl;
                 return false;
             }
+            if (networkMessageCompression) {
+                // oplog batches and initial sync clones are large and usually compress well
+                _conn->negotiateCompression();
+            }
         }
         return true;
     }
@@ -33,7 +33,6 @@ namespace mongo {
 
     void deleteOneObject(Collection *cl, const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
         cl->deleteObject(pk, obj, flags);
-        cl->notifyOfWriteOp();
     }
     
     // Special-cased helper for deleting ranges out of an index.
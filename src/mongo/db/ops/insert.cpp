@@ -51,7 +51,6 @@ namespace mongo {
     void insertOneObject(Collection *cl, BSONObj &obj, uint64_t flags) {
         validateInsert(obj);
         cl->insertObject(obj, flags);
-        cl->notifyOfWriteOp();
     }
 
     // Does not check magic system collection inserts.
@@ -80,7 +79,6 @@ namespace mongo {
                         if (indexBitChanged) {
                             cl->noteMultiKeyChanged();
                         }
-                        cl->notifyOfWriteOp();
                     }
                 }
                 else {
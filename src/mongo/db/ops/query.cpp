@@ -424,6 +424,15 @@ namespace mongo {
     
     void ReorderBuildStrategy::init( const QueryPlanSummary &queryPlan ) {
         _scanAndOrder.reset( newScanAndOrder( queryPlan ) );
+        _scanAndOrder->setSpillingAllowed( true );
+    }
+
+    void ReorderBuildStrategy::setSpillingAllowed( bool allowed ) {
+        _scanAndOrder->setSpillingAllowed( allowed );
+    }
+
+    bool ReorderBuildStrategy::spillingAllowed() const {
+        return _scanAndOrder->spillingAllowed();
     }
 
     bool ReorderBuildStrategy::handleMatch( ResultDetails* resultDetails ) {
@@ -440,9 +449,12 @@ namespace mongo {
     }
 
     int ReorderBuildStrategy::rewriteMatches() {
-        cc().curop()->debug().scanAndOrder = true;
+        OpDebug &debug = cc().curop()->debug();
+        debug.scanAndOrder = true;
         int ret = 0;
         _scanAndOrder->fill( _buf, &_parsedQuery, ret );
+        debug.scanAndOrderBytes = _scanAndOrder->peakApproxSize();
+        debug.scanAndOrderSpills = _scanAndOrder->nSpills();
         _bufferedMatches = ret;
         return ret;
     }
@@ -485,6 +497,9 @@ namespace mongo {
     void HybridBuildStrategy::init() {
         _reorderBuild.reset( ReorderBuildStrategy::make( _parsedQuery, _cursor, _buf,
                                                          QueryPlanSummary() ) );
+        // Running out of memory is how out of order plans lose to in order ones, so they only
+        // spill once there is no in order plan left to fall back on.
+        _reorderBuild->setSpillingAllowed( false );
     }
 
     bool HybridBuildStrategy::handleMatch( ResultDetails* resultDetails ) {
@@ -512,6 +527,11 @@ namespace mongo {
                     _queryOptimizerCursor->abortOutOfOrderPlans();
                     return true;
                 }
+                _reorderBuild->setSpillingAllowed( true );
+                if ( _reorderBuild->spillingAllowed() ) {
+                    _reorderBuild->_handleMatchNoDedup( resultDetails );
+                    return true;
+                }
             }
             throw;
         }
@@ -536,6 +556,10 @@ namespace mongo {
     void HybridBuildStrategy::finishedFirstBatch() {
         _queryOptimizerCursor->abortOutOfOrderPlans();
     }
+
+    ScanAndOrder *HybridBuildStrategy::scanAndOrder() {
+        return _reorderedMatches ? _reorderBuild->scanAndOrder() : 0;
+    }
     
     QueryResponseBuilder *QueryResponseBuilder::make( const ParsedQuery &parsedQuery,
                                                      const shared_ptr<Cursor> &cursor,
@@ -601,6 +625,11 @@ namespace mongo {
             if ( rewriteCount != -1 ) {
                 explainInfo->reviseN( rewriteCount );
             }
+            const ScanAndOrder *scanAndOrder = _builder->scanAndOrder();
+            if ( scanAndOrder ) {
+                explainInfo->noteScanAndOrder( scanAndOrder->peakApproxSize(),
+                                               scanAndOrder->nSpills() );
+            }
             _builder->resetBuf();
             fillQueryResultFromObj( _buf, 0, explainInfo->bson() );
             result.appendData( _buf.buf(), _buf.len() );
@@ -614,6 +643,14 @@ namespace mongo {
         return _builder->bufferedMatches();
     }
 
+    shared_ptr<Cursor> QueryResponseBuilder::sortedRemainder() {
+        ScanAndOrder *scanAndOrder = _builder->scanAndOrder();
+        if ( !scanAndOrder ) {
+            return shared_ptr<Cursor>();
+        }
+        return scanAndOrder->sortedRemainder( &_parsedQuery );
+    }
+
     ShardChunkManagerPtr QueryResponseBuilder::newChunkManager() const {
         if ( !shardingState.needShardChunkManager( _parsedQuery.ns() ) ) {
             return ShardChunkManagerPtr();
@@ -804,11 +841,18 @@ namespace mongo {
         
         int nReturned = queryResponseBuilder->handoff( result );
 
+        // A sort that spilled to disk returns the rest of its merge through getMore.
+        shared_ptr<Cursor> sortedRemainder = queryResponseBuilder->sortedRemainder();
+        if ( sortedRemainder ) {
+            saveClientCursor = true;
+        }
+
         ccPointer.reset();
         long long cursorid = 0;
         if ( saveClientCursor ) {
             // Create a new ClientCursor, with a default timeout.
-            ccPointer.reset( new ClientCursor( queryOptions, cursor, ns,
+            ccPointer.reset( new ClientCursor( queryOptions,
+                                               sortedRemainder ? sortedRemainder : cursor, ns,
                                                jsobj.getOwned(), inMultiStatementTxn ) );
             cursorid = ccPointer->cursorid();
             DEV tlog(2) << "query has more, cursorid: " << cursorid << endl;
@@ -987,6 +1031,7 @@ namespace mongo {
         settings.setQueryCursorMode(DEFAULT_LOCK_CURSOR);
         settings.setBulkFetch(true);
         settings.setCappedAppendPK(pq.hasOption(QueryOption_AddHiddenPK));
+        settings.setBatchFetchPKs(pq.batchFetch());
         cc().setOpSettings(settings);
 
         // If our caller has a transaction, it's multi-statement.
@@ -144,6 +144,8 @@ namespace mongo {
         shared_ptr<QueryOptimizerCursor> _cursor;
     };
 
+    class ScanAndOrder;
+
     /** Interface for building a query response in a supplied BufBuilder. */
     class ResponseBuildStrategy {
     public:
@@ -173,6 +175,8 @@ namespace mongo {
          * to getMore.
          */
         virtual void finishedFirstBatch() {}
+        /** @return the ScanAndOrder that reordered the matches written by rewriteMatches(). */
+        virtual ScanAndOrder *scanAndOrder() { return 0; }
         /** Reset the buffer. */
         void resetBuf();
     protected:
@@ -200,8 +204,6 @@ namespace mongo {
         int _bufferedMatches;
     };
     
-    class ScanAndOrder;
-    
     /** Build strategy for a cursor returning out of order results. */
     class ReorderBuildStrategy : public ResponseBuildStrategy {
     public:
@@ -214,6 +216,10 @@ namespace mongo {
         void _handleMatchNoDedup( ResultDetails* resultDetails );
         virtual int rewriteMatches();
         virtual int bufferedMatches() const { return _bufferedMatches; }
+        virtual ScanAndOrder *scanAndOrder() { return _scanAndOrder.get(); }
+        /** Let matches be sorted on disk once they outgrow memory. */
+        void setSpillingAllowed( bool allowed );
+        bool spillingAllowed() const;
     private:
         ReorderBuildStrategy( const ParsedQuery& parsedQuery,
                               const shared_ptr<Cursor>& cursor,
@@ -243,6 +249,7 @@ namespace mongo {
         virtual int rewriteMatches();
         virtual int bufferedMatches() const;
         virtual void finishedFirstBatch();
+        virtual ScanAndOrder *scanAndOrder();
         bool handleReorderMatch( ResultDetails* resultDetails );
         PKDupSet _scanAndOrderDups;
         OrderedBuildStrategy _orderedBuild;
@@ -280,6 +287,11 @@ namespace mongo {
          * @return the number of results in the buffer.
          */
         int handoff( Message &result );
+        /**
+         * @return a cursor over sorted results that spilled to disk and didn't fit in the
+         * buffer handed off, for getMore; otherwise an empty pointer.
+         */
+        shared_ptr<Cursor> sortedRemainder();
         /** A chunk manager found at the beginning of the query. */
         ShardChunkManagerPtr chunkManager() const { return _chunkManager; }
 
@@ -89,7 +89,6 @@ namespace mongo {
             // - does not maintain sencondary indexes so we can only do it
             // when no indexes were affected
             cl->updateObjectMods(pk, updateobj, query, fastUpdateFlags, fromMigrate, flags);
-            cl->notifyOfWriteOp();
             return true;
         }
         return false;
@@ -100,7 +99,6 @@ namespace mongo {
                          const bool fromMigrate,
                          uint64_t flags) {
         cl->updateObject(pk, oldObj, newObj, fromMigrate, flags);
-        cl->notifyOfWriteOp();
     }
 
     static void checkNoMods(const BSONObj &obj) {
@@ -26,7 +26,8 @@ namespace mongo {
         _queryCursorMode(DEFAULT_LOCK_CURSOR),
         _shouldBulkFetch(false),
         _shouldAppendPKForCapped(false),
-        _justOne(false) {
+        _justOne(false),
+        _batchFetchPKs(false) {
     }
 
     OpSettings& OpSettings::setQueryCursorMode(QueryCursorMode mode) {
@@ -65,4 +66,13 @@ namespace mongo {
         return *this;
     }
 
+    bool OpSettings::shouldBatchFetchPKs() {
+        return _batchFetchPKs;
+    }
+
+    OpSettings &OpSettings::setBatchFetchPKs(bool val) {
+        _batchFetchPKs = val;
+        return *this;
+    }
+
 } // namespace mongo
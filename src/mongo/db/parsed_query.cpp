@@ -112,6 +112,7 @@ namespace mongo {
         _explain = false;
         _returnKey = false;
         _maxScan = 0;
+        _batchFetch = false;
     }
 
     /* This is for languages whose "objects" are not well ordered (JSON is well ordered).
@@ -171,6 +172,8 @@ namespace mongo {
                     _returnKey = e.trueValue();
                 else if ( strcmp( "maxScan" , name ) == 0 )
                     _maxScan = e.numberInt();
+                else if ( strcmp( "batchFetch" , name ) == 0 )
+                    _batchFetch = e.trueValue();
                 else if ( strcmp( "comment" , name ) == 0 ) {
                     ; // no-op
                 }
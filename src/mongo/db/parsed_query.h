@@ -63,6 +63,7 @@ namespace mongo {
         const BSONObj& getOrder() const { return _order; }
         const BSONObj& getHint() const { return _hint; }
         int getMaxScan() const { return _maxScan; }
+        bool batchFetch() const { return _batchFetch; }
         
         bool couldBeCommand() const;
         
@@ -105,6 +106,7 @@ namespace mongo {
         BSONObj _max;
         BSONObj _hint;
         int _maxScan;
+        bool _batchFetch;
     };
 
 } // namespace mongo
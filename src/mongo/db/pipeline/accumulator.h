@@ -44,6 +44,24 @@ namespace mongo {
          */
         virtual Value getValue() const = 0;
 
+        /*
+          Get the accumulated value in the form a merging accumulator
+          (one created with an ExpressionContext that is doing a merge)
+          expects as its input.  This is what gets written when a $group
+          spills partial results to disk.
+
+          @returns the partial value
+         */
+        virtual Value getPartialValue() const { return getValue(); }
+
+        /*
+          Get the approximate amount of memory used by the accumulated
+          value, not counting the accumulator object itself.
+
+          @returns the number of bytes
+         */
+        virtual size_t getMemUsage() const { return 0; }
+
     protected:
         Accumulator();
 
@@ -68,6 +86,7 @@ namespace mongo {
         virtual Value evaluate(const Document& pDocument) const;
         virtual Value getValue() const;
         virtual const char *getOpName() const;
+        virtual size_t getMemUsage() const { return memUsage; }
 
         /*
           Create an appending accumulator.
@@ -80,9 +99,11 @@ namespace mongo {
 
     private:
         AccumulatorAddToSet(const intrusive_ptr<ExpressionContext> &pTheCtx);
+        void insert(const Value& value) const;
         typedef boost::unordered_set<Value, Value::Hash > SetType;
         mutable SetType set;
         mutable SetType::iterator itr; 
+        mutable size_t memUsage;
         intrusive_ptr<ExpressionContext> pCtx;
     };
 
@@ -98,6 +119,7 @@ namespace mongo {
     public:
         // virtuals from Expression
         virtual Value getValue() const;
+        virtual size_t getMemUsage() const;
 
     protected:
         AccumulatorSingleValue();
@@ -206,6 +228,7 @@ namespace mongo {
         virtual Value evaluate(const Document& pDocument) const;
         virtual Value getValue() const;
         virtual const char *getOpName() const;
+        virtual size_t getMemUsage() const { return memUsage; }
 
         /*
           Create an appending accumulator.
@@ -220,6 +243,7 @@ namespace mongo {
         AccumulatorPush(const intrusive_ptr<ExpressionContext> &pTheCtx);
 
         mutable vector<Value> vpValue;
+        mutable size_t memUsage;
         intrusive_ptr<ExpressionContext> pCtx;
     };
 
@@ -231,6 +255,7 @@ namespace mongo {
         // virtuals from Accumulator
         virtual Value evaluate(const Document& pDocument) const;
         virtual Value getValue() const;
+        virtual Value getPartialValue() const;
         virtual const char *getOpName() const;
 
         /*
@@ -28,7 +28,7 @@ namespace mongo {
 
         if (!pCtx->getDoingMerge()) {
             if (!prhs.missing()) {
-                set.insert(prhs);
+                insert(prhs);
             }
         } else {
             /*
@@ -40,12 +40,20 @@ namespace mongo {
             verify(prhs.getType() == Array);
             
             const vector<Value>& array = prhs.getArray();
-            set.insert(array.begin(), array.end());
+            for (vector<Value>::const_iterator it = array.begin(); it != array.end(); ++it) {
+                insert(*it);
+            }
         }
 
         return Value();
     }
 
+    void AccumulatorAddToSet::insert(const Value& value) const {
+        if (set.insert(value).second) {
+            memUsage += value.getApproximateSize();
+        }
+    }
+
     Value AccumulatorAddToSet::getValue() const {
         vector<Value> valVec;
 
@@ -60,6 +68,7 @@ namespace mongo {
         const intrusive_ptr<ExpressionContext> &pTheCtx):
         Accumulator(),
         set(),
+        memUsage(0),
         pCtx(pTheCtx) {
     }
 
@@ -67,6 +67,10 @@ namespace mongo {
             return Value::createDouble(avg);
         }
 
+        return getPartialValue();
+    }
+
+    Value AccumulatorAvg::getPartialValue() const {
         MutableDocument out;
         out.addField(subTotalName, Value::createDouble(doubleTotal));
         out.addField(countName, Value::createLong(count));
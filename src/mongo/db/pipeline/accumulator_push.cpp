@@ -29,6 +29,7 @@ namespace mongo {
         if (!pCtx->getDoingMerge()) {
             if (!prhs.missing()) {
                 vpValue.push_back(prhs);
+                memUsage += prhs.getApproximateSize();
             }
         }
         else {
@@ -42,6 +43,7 @@ namespace mongo {
             
             const vector<Value>& vec = prhs.getArray();
             vpValue.insert(vpValue.end(), vec.begin(), vec.end());
+            memUsage += prhs.getApproximateSize();
         }
 
         return Value();
@@ -55,6 +57,7 @@ namespace mongo {
         const intrusive_ptr<ExpressionContext> &pTheCtx):
         Accumulator(),
         vpValue(),
+        memUsage(0),
         pCtx(pTheCtx) {
     }
 
@@ -26,6 +26,10 @@ namespace mongo {
         return pValue;
     }
 
+    size_t AccumulatorSingleValue::getMemUsage() const {
+        return pValue.getApproximateSize();
+    }
+
     AccumulatorSingleValue::AccumulatorSingleValue():
         pValue(Value()) {
     }
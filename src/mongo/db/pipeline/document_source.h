@@ -35,6 +35,7 @@
 namespace mongo {
     class Accumulator;
     class Cursor;
+    class DBClientCursor;
     class Document;
     class Expression;
     class ExpressionContext;
@@ -42,6 +43,7 @@ namespace mongo {
     class ExpressionObject;
     class DocumentSourceLimit;
     class Matcher;
+    class ScopedDbConnection;
 
     class DocumentSource :
         public IntrusiveCounterUnsigned,
@@ -318,45 +320,87 @@ namespace mongo {
         virtual bool advance();
         virtual Document getCurrent();
         virtual void setSource(DocumentSource *pSource);
+        virtual void dispose();
 
         /* convenient shorthand for a commonly used type */
         typedef map<Shard, BSONObj> ShardOutput;
+        /* the host that answered for each shard */
+        typedef map<Shard, string> ShardHosts;
+
+        /**
+          The output of one shard.  This is either the result array of the
+          shard's command response, or the first batch of the cursor the
+          shard returned followed by batches fetched from it with getMore
+          as they are needed.  The getMores go to host, the member of the
+          shard that ran the command and so holds the cursor, which for a
+          slaveOk command may be a secondary.  If the cursor isn't read to
+          the end, it is killed when this goes away.
+         */
+        class ShardResults : boost::noncopyable {
+        public:
+            ShardResults(const Shard& shard, const string& host,
+                         const BSONObj& commandResult);
+            ~ShardResults();
+
+            /** @returns true if next() has another Document */
+            bool more();
+            Document next();
+
+        private:
+            const Shard shard;
+            const string host;
+            BSONObj commandResult; // owns the first batch
+            BSONObjIterator batchIterator;
+            string ns;
+            long long cursorId; // until it is handed to pCursor
+            scoped_ptr<ScopedDbConnection> pConnection;
+            scoped_ptr<DBClientCursor> pCursor;
+        };
+        typedef boost::shared_ptr<ShardResults> ShardResultsPtr;
 
         /**
           Create a DocumentSource that wraps the output of many shards
 
           @param shardOutput output from the individual shards
+          @param shardHosts the hosts that produced it, shards missing from
+            it are reached through their connection string
           @param pExpCtx the expression context for the pipeline
           @returns the newly created DocumentSource
          */
         static intrusive_ptr<DocumentSourceCommandShards> create(
             const ShardOutput& shardOutput,
+            const ShardHosts& shardHosts,
             const intrusive_ptr<ExpressionContext>& pExpCtx);
 
+        /**
+          Hand over each shard's output separately, for a merge of results
+          each shard sorted.  This source returns nothing afterwards.
+         */
+        vector<ShardResultsPtr> releaseShardResults();
+
     protected:
         // virtuals from DocumentSource
         virtual void sourceToBson(BSONObjBuilder *pBuilder, bool explain) const;
 
     private:
         DocumentSourceCommandShards(const ShardOutput& shardOutput,
+            const ShardHosts& shardHosts,
             const intrusive_ptr<ExpressionContext>& pExpCtx);
 
         /**
           Advance to the next document, setting pCurrent appropriately.
 
-          Adjusts pCurrent, pBsonSource, and iterator, as needed.  On exit,
-          pCurrent is the Document to return, or NULL.  If NULL, this
-          indicates there is nothing more to return.
+          Adjusts pCurrent and shardIndex, as needed.  On exit, pCurrent is
+          the Document to return, or NULL.  If NULL, this indicates there is
+          nothing more to return.
          */
         void getNextDocument();
 
         bool unstarted;
         bool hasCurrent;
-        bool newSource; // set to true for the first item of a new source
-        intrusive_ptr<DocumentSourceBsonArray> pBsonSource;
         Document pCurrent;
-        ShardOutput::const_iterator iterator;
-        ShardOutput::const_iterator listEnd;
+        vector<ShardResultsPtr> shardResults;
+        size_t shardIndex;
     };
 
 
@@ -601,6 +645,15 @@ namespace mongo {
 
         static const char groupName[];
 
+        /* number of files each spill is hash partitioned into */
+        static const size_t nSpillPartitions = 16;
+
+        /*
+          The partition groups with the given _id are spilled to when a
+          partition depth levels down is split.
+         */
+        static size_t spillPartitionFor(const Value& id, unsigned depth);
+
     protected:
         // virtuals from DocumentSource
         virtual void sourceToBson(BSONObjBuilder *pBuilder, bool explain) const;
@@ -623,6 +676,51 @@ namespace mongo {
             vector<intrusive_ptr<Accumulator> >, Value::Hash> GroupsType;
         GroupsType groups;
 
+        /*
+          With allowDiskUse, once the groups use more memory than the
+          aggregationGroupMaxMemoryBytes server parameter allows, the partial
+          value of every accumulator is written out to a set of temporary
+          files, partitioned by a hash of the group _id, and the groups are
+          cleared.  When the input is exhausted, each partition is read back
+          and merged on its own, using accumulators created with a merging
+          context just like the ones getRouterSource() sets up.  A partition
+          that is itself too big is split again with a different hash.
+         */
+        class SpillFile;
+        typedef boost::shared_ptr<SpillFile> SpillFilePtr;
+
+        bool spillingEnabled;
+        long long memoryUsageBytes;
+        size_t nSpills;
+
+        /* the partitions the input is spilled to */
+        vector<SpillFilePtr> inputPartitions;
+        /* partitions that still need to be merged and returned */
+        deque<SpillFilePtr> pendingPartitions;
+
+        intrusive_ptr<ExpressionContext> pMergeExpCtx;
+        vector<intrusive_ptr<Expression> > vpMergeExpression;
+
+        /*
+          Create a group for the given _id if there isn't one, and feed the
+          document to its accumulators, tracking memory use if spilling is
+          enabled.
+         */
+        void accumulate(const Value& id, const Document& input, bool merging);
+
+        /*
+          Write all current groups to the partitions (creating them if
+          needed) and clear them.
+         */
+        void spill(vector<SpillFilePtr>* partitions, unsigned depth);
+
+        /*
+          Merge the next spilled partition that has any groups into groups.
+
+          @returns false if there are no more groups
+         */
+        bool loadNextPartition();
+
         /*
           The field names for the result documents and the accumulator
           factories for the result documents.  The Expressions are the
@@ -796,11 +894,10 @@ namespace mongo {
         virtual GetDepsReturn getDependencies(set<string>& deps) const;
 
         // Virtuals for SplittableDocumentSource
-        // All work for sort is done in router currently if there is no limit.
-        // If there is a limit, the $sort/$limit combination is performed on the
-        // shards, then the results are resorted and limited on mongos
-        virtual intrusive_ptr<DocumentSource> getShardSource() { return limitSrc ? this : NULL; }
-        virtual intrusive_ptr<DocumentSource> getRouterSource() { return this; }
+        // The $sort (and $limit, if any) is performed on the shards, then
+        // mongos merges the shards' sorted results as they stream in.
+        virtual intrusive_ptr<DocumentSource> getShardSource() { return this; }
+        virtual intrusive_ptr<DocumentSource> getRouterSource();
 
         /**
           Add sort key field.
@@ -872,6 +969,13 @@ namespace mongo {
         void populateOne();  // limit == 1
         void populateTopK(); // limit > 1
 
+        /*
+          On mongos, the shards' results are already sorted, so rather than
+          sort them all again, they are merged a document at a time.
+         */
+        bool mergingPresorted;
+        void mergeNext();
+
         /* these two parallel each other */
         typedef vector<intrusive_ptr<ExpressionFieldPath> > SortPaths;
         SortPaths vSortKey;
@@ -904,6 +1008,27 @@ namespace mongo {
         deque<KeyAndDoc> documents;
 
         intrusive_ptr<DocumentSourceLimit> limitSrc;
+
+        /* the next document from each shard being merged, on a heap */
+        struct MergeHead {
+            MergeHead(const Document& d, const SortPaths& sp, size_t shardIndex):
+                keyAndDoc(d, sp), shard(shardIndex) {}
+            KeyAndDoc keyAndDoc;
+            size_t shard;
+        };
+        class MergeComparator {
+        public:
+            explicit MergeComparator(const DocumentSourceSort& source): _source(source) {}
+            bool operator()(const MergeHead& lhs, const MergeHead& rhs) const {
+                // puts the first document at the top of the heap
+                return (_source.compare(lhs.keyAndDoc, rhs.keyAndDoc) > 0);
+            }
+        private:
+            const DocumentSourceSort& _source;
+        };
+        vector<MergeHead> mergeHeap;
+        vector<DocumentSourceCommandShards::ShardResultsPtr> mergeShards;
+        long long nMerged;
     };
     inline void swap(DocumentSourceSort::KeyAndDoc& l, DocumentSourceSort::KeyAndDoc& r) {
         l.key.swap(r.key);
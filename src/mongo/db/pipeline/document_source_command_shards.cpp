@@ -17,10 +17,85 @@
 #include "pch.h"
 
 #include "mongo/db/pipeline/document_source.h"
+#include "mongo/client/connpool.h"
+#include "mongo/client/dbclientcursor.h"
 #include "mongo/s/shard.h"
 
 namespace mongo {
 
+    DocumentSourceCommandShards::ShardResults::ShardResults(
+        const Shard& theShard, const string& theHost, const BSONObj& result):
+        shard(theShard),
+        host(theHost),
+        commandResult(result),
+        batchIterator(BSONObj()),
+        cursorId(0) {
+        uassert(16390, str::stream() << "sharded pipeline failed on shard " <<
+                                    shard.getName() << ": " <<
+                                    commandResult.toString(),
+                commandResult["ok"].trueValue());
+
+        /* grab the result array, or the cursor, out of the shard server's response */
+        BSONElement batch = commandResult["result"];
+        BSONElement cursor = commandResult["cursor"];
+        if (batch.eoo() && cursor.type() == Object) {
+            batch = cursor.embeddedObject()["firstBatch"];
+            cursorId = cursor.embeddedObject()["id"].numberLong();
+            ns = cursor.embeddedObject()["ns"].str();
+        }
+        massert(16391, str::stream() << "no result array? shard:" <<
+                                    shard.getName() << ": " <<
+                                    commandResult.toString(),
+                batch.type() == Array);
+        batchIterator = BSONObjIterator(batch.embeddedObject());
+    }
+
+    DocumentSourceCommandShards::ShardResults::~ShardResults() {
+        DESTRUCTOR_GUARD(
+            if (cursorId != 0) {
+                /* nothing was read past the first batch; kill the shard's cursor */
+                pConnection.reset(ScopedDbConnection::getScopedDbConnection(host));
+                pConnection->get()->killCursor(cursorId);
+            }
+            /* this kills the shard's cursor if it wasn't read to the end */
+            pCursor.reset();
+            if (pConnection)
+                pConnection->done();
+        )
+    }
+
+    bool DocumentSourceCommandShards::ShardResults::more() {
+        if (batchIterator.more())
+            return true;
+
+        if (cursorId != 0) {
+            // we use ScopedDbConnection because the cursor already exists on
+            // the host and there is no shard version to check
+            pConnection.reset(ScopedDbConnection::getScopedDbConnection(host));
+            pCursor.reset(new DBClientCursor(pConnection->get(), ns, cursorId, 0, 0));
+            cursorId = 0;
+        }
+        if (!pCursor)
+            return false;
+
+        if (pCursor->more())
+            return true;
+
+        /* done with this shard, give the connection back */
+        pCursor.reset();
+        pConnection->done();
+        pConnection.reset();
+        return false;
+    }
+
+    Document DocumentSourceCommandShards::ShardResults::next() {
+        if (batchIterator.more())
+            return Document(batchIterator.next().embeddedObject());
+
+        verify(pCursor);
+        return Document(pCursor->nextSafe());
+    }
+
     DocumentSourceCommandShards::~DocumentSourceCommandShards() {
     }
 
@@ -54,6 +129,12 @@ namespace mongo {
         verify(false);
     }
 
+    void DocumentSourceCommandShards::dispose() {
+        /* stop any shard cursors that are still open */
+        shardResults.clear();
+        shardIndex = 0;
+    }
+
     void DocumentSourceCommandShards::sourceToBson(
         BSONObjBuilder *pBuilder, bool explain) const {
         /* this has no BSON equivalent */
@@ -62,78 +143,63 @@ namespace mongo {
 
     DocumentSourceCommandShards::DocumentSourceCommandShards(
         const ShardOutput& shardOutput,
+        const ShardHosts& shardHosts,
         const intrusive_ptr<ExpressionContext> &pExpCtx):
         DocumentSource(pExpCtx),
         unstarted(true),
         hasCurrent(false),
-        newSource(false),
-        pBsonSource(),
         pCurrent(),
-        iterator(shardOutput.begin()),
-        listEnd(shardOutput.end())
-    {}
+        shardResults(),
+        shardIndex(0) {
+        for (ShardOutput::const_iterator it = shardOutput.begin();
+             it != shardOutput.end(); ++it) {
+            ShardHosts::const_iterator host = shardHosts.find(it->first);
+            const string hostName = host == shardHosts.end() || host->second.empty() ?
+                it->first.getConnString() : host->second;
+            shardResults.push_back(
+                ShardResultsPtr(new ShardResults(it->first, hostName, it->second)));
+        }
+    }
 
     intrusive_ptr<DocumentSourceCommandShards>
     DocumentSourceCommandShards::create(
         const ShardOutput& shardOutput,
+        const ShardHosts& shardHosts,
         const intrusive_ptr<ExpressionContext> &pExpCtx) {
         intrusive_ptr<DocumentSourceCommandShards> pSource(
-            new DocumentSourceCommandShards(shardOutput, pExpCtx));
+            new DocumentSourceCommandShards(shardOutput, shardHosts, pExpCtx));
         return pSource;
     }
 
+    vector<DocumentSourceCommandShards::ShardResultsPtr>
+    DocumentSourceCommandShards::releaseShardResults() {
+        verify(unstarted);
+        unstarted = false;
+        hasCurrent = false;
+
+        vector<ShardResultsPtr> released;
+        released.swap(shardResults);
+        return released;
+    }
+
     void DocumentSourceCommandShards::getNextDocument() {
         if (unstarted) {
             unstarted = false;
             hasCurrent = true;
         }
 
-        while(true) {
-            if (!pBsonSource.get()) {
-                /* if there aren't any more futures, we're done */
-                if (iterator == listEnd) {
-                    pCurrent = Document();
-                    hasCurrent = false;
-                    return;
-                }
-
-                /* grab the next command result */
-                BSONObj resultObj = iterator->second;
-
-                uassert(16390, str::stream() << "sharded pipeline failed on shard " <<
-                                            iterator->first.getName() << ": " <<
-                                            resultObj.toString(),
-                        resultObj["ok"].trueValue());
-
-                /* grab the result array out of the shard server's response */
-                BSONElement resultArray = resultObj["result"];
-                massert(16391, str::stream() << "no result array? shard:" <<
-                                            iterator->first.getName() << ": " <<
-                                            resultObj.toString(),
-                        resultArray.type() == Array);
-
-                // done with error checking, don't need the shard name anymore
-                ++iterator;
-
-                if (resultArray.embeddedObject().isEmpty()){
-                    // this shard had no results, on to the next one
-                    continue;
-                }
-
-                pBsonSource = DocumentSourceBsonArray::create(&resultArray, pExpCtx);
-                newSource = true;
+        while (shardIndex < shardResults.size()) {
+            if (shardResults[shardIndex]->more()) {
+                pCurrent = shardResults[shardIndex]->next();
+                return;
             }
 
-            /* if we're done with this shard's results, try the next */
-            if (pBsonSource->eof() ||
-                (!newSource && !pBsonSource->advance())) {
-                pBsonSource.reset();
-                continue;
-            }
-
-            pCurrent = pBsonSource->getCurrent();
-            newSource = false;
-            return;
+            /* done with this shard's results, try the next */
+            shardResults[shardIndex].reset();
+            ++shardIndex;
         }
+
+        pCurrent = Document();
+        hasCurrent = false;
     }
 }
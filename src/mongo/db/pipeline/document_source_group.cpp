@@ -19,15 +19,55 @@
 
 #include "db/pipeline/document_source.h"
 
+#include "mongo/base/units.h"
 #include "db/jsobj.h"
 #include "db/pipeline/accumulator.h"
 #include "db/pipeline/document.h"
 #include "db/pipeline/expression.h"
 #include "db/pipeline/expression_context.h"
 #include "db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/spill_file.h"
+#include "third_party/murmurhash3/MurmurHash3.h"
 
 namespace mongo {
     const char DocumentSourceGroup::groupName[] = "$group";
+    const size_t DocumentSourceGroup::nSpillPartitions;
+
+    MONGO_EXPORT_SERVER_PARAMETER(aggregationGroupMaxMemoryBytes, BytesQuantity<uint64_t>, StringData("100MB"));
+
+    /* how many times a partition that doesn't fit may be split again */
+    static const unsigned maxSpillDepth = 4;
+    /* rough cost of a group's hash table entry and accumulator objects */
+    static const size_t groupOverheadBytes = 64;
+    static const size_t accumulatorOverheadBytes = 64;
+
+    /* a spilled partition, and how many times its groups have been split */
+    class DocumentSourceGroup::SpillFile : public storage::SpillFile {
+    public:
+        SpillFile(const string& dir, unsigned depth) :
+            storage::SpillFile(dir, "group"),
+            _depth(depth) {
+        }
+
+        unsigned depth() const { return _depth; }
+
+    private:
+        const unsigned _depth;
+    };
+
+    size_t DocumentSourceGroup::spillPartitionFor(const Value& id, unsigned depth) {
+        /*
+          Every _id in a partition has the same partition at the depth
+          before, so each depth has to take different bits of the hash;
+          seeding the hash of the _id differently isn't enough.
+         */
+        size_t idHash = 0xf0afbeef;
+        id.hash_combine(idHash);
+        uint32_t out;
+        MurmurHash3_x86_32(&idHash, sizeof(idHash), depth, &out);
+        return out % nSpillPartitions;
+    }
 
     DocumentSourceGroup::~DocumentSourceGroup() {
     }
@@ -53,6 +93,9 @@ namespace mongo {
 
         ++groupsIterator;
         if (groupsIterator == groups.end()) {
+            if (loadNextPartition())
+                return true;
+
             dispose();
             return false;
         }
@@ -70,6 +113,8 @@ namespace mongo {
     void DocumentSourceGroup::dispose() {
         GroupsType().swap(groups);
         groupsIterator = groups.end();
+        inputPartitions.clear();
+        pendingPartitions.clear();
 
         pSource->dispose();
     }
@@ -120,6 +165,9 @@ namespace mongo {
         populated(false),
         pIdExpression(),
         groups(),
+        spillingEnabled(false),
+        memoryUsageBytes(0),
+        nSpills(0),
         vFieldName(),
         vpAccumulatorFactory(),
         vpExpression() {
@@ -133,6 +181,7 @@ namespace mongo {
         vFieldName.push_back(fieldName);
         vpAccumulatorFactory.push_back(pAccumulatorFactory);
         vpExpression.push_back(pExpression);
+        vpMergeExpression.push_back(ExpressionFieldPath::create(fieldName));
     }
 
 
@@ -287,9 +336,146 @@ namespace mongo {
         return pGroup;
     }
 
-    void DocumentSourceGroup::populate() {
+    void DocumentSourceGroup::accumulate(const Value& id, const Document& input,
+                                         bool merging) {
         const size_t numAccumulators = vpAccumulatorFactory.size();
-        dassert(numAccumulators == vpExpression.size());
+
+        /*
+          Look for the _id value in the map; if it's not there, add a
+          new entry with a blank accumulator.
+        */
+        const size_t nGroups = groups.size();
+        vector<intrusive_ptr<Accumulator> >& group = groups[id];
+        if (spillingEnabled && groups.size() > nGroups) {
+            memoryUsageBytes += groupOverheadBytes + id.getApproximateSize() +
+                                numAccumulators * accumulatorOverheadBytes;
+        }
+
+        if (numAccumulators == 0)
+            return; // we are basically building a set
+
+        if (group.empty()) {
+            /* add the accumulators */
+            group.reserve(numAccumulators);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                intrusive_ptr<Accumulator> accum =
+                    (*vpAccumulatorFactory[i])(merging ? pMergeExpCtx : pExpCtx);
+                accum->addOperand(merging ? vpMergeExpression[i] : vpExpression[i]);
+                group.push_back(accum);
+            }
+        }
+
+        /* tickle all the accumulators for the group we found */
+        dassert(numAccumulators == group.size());
+        if (!spillingEnabled) {
+            for (size_t i = 0; i < numAccumulators; i++)
+                group[i]->evaluate(input);
+            return;
+        }
+
+        for (size_t i = 0; i < numAccumulators; i++) {
+            const long long before = group[i]->getMemUsage();
+            group[i]->evaluate(input);
+            memoryUsageBytes += static_cast<long long>(group[i]->getMemUsage()) - before;
+        }
+    }
+
+    void DocumentSourceGroup::spill(vector<SpillFilePtr>* partitions, unsigned depth) {
+        if (partitions->empty()) {
+            for (size_t i = 0; i < nSpillPartitions; i++) {
+                partitions->push_back(
+                    SpillFilePtr(new SpillFile(pExpCtx->getTempDir(), depth)));
+            }
+        }
+
+        const size_t n = vFieldName.size();
+        for (GroupsType::iterator it = groups.begin(); it != groups.end(); ++it) {
+            MutableDocument out (1 + n);
+            out.addField("_id", it->first);
+            for (size_t i = 0; i < n; ++i) {
+                Value partial(it->second[i]->getPartialValue());
+                if (!partial.missing())
+                    out.addField(vFieldName[i], partial);
+            }
+
+            BSONObjBuilder builder;
+            out.freeze().toBson(&builder);
+            (*partitions)[spillPartitionFor(it->first, depth)]->write(builder.done());
+        }
+
+        GroupsType().swap(groups);
+        memoryUsageBytes = 0;
+        nSpills++;
+    }
+
+    bool DocumentSourceGroup::loadNextPartition() {
+        GroupsType().swap(groups);
+        groupsIterator = groups.end();
+        memoryUsageBytes = 0;
+
+        const long long maxMemoryUsageBytes = aggregationGroupMaxMemoryBytes.value();
+        while (!pendingPartitions.empty()) {
+            SpillFilePtr partition = pendingPartitions.front();
+            pendingPartitions.pop_front();
+
+            /*
+              If this partition doesn't fit in memory either, the groups read
+              so far and everything after them is split up again.  Order is
+              preserved for each _id, which $first, $last and $push rely on.
+             */
+            vector<SpillFilePtr> subPartitions;
+            const unsigned subDepth = partition->depth() + 1;
+
+            partition->startReading();
+            BSONObj record;
+            while (partition->read(&record)) {
+                pExpCtx->checkForInterrupt();
+
+                Document input(record);
+                Value id(input["_id"]);
+                if (!subPartitions.empty()) {
+                    subPartitions[spillPartitionFor(id, subDepth)]->write(record);
+                    continue;
+                }
+
+                accumulate(id, input, true);
+                if (memoryUsageBytes > maxMemoryUsageBytes && subDepth <= maxSpillDepth) {
+                    spill(&subPartitions, subDepth);
+                }
+            }
+
+            if (!subPartitions.empty()) {
+                for (vector<SpillFilePtr>::reverse_iterator it = subPartitions.rbegin();
+                     it != subPartitions.rend(); ++it) {
+                    if (!(*it)->empty())
+                        pendingPartitions.push_front(*it);
+                }
+                continue;
+            }
+
+            if (!groups.empty()) {
+                groupsIterator = groups.begin();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void DocumentSourceGroup::populate() {
+        dassert(vpAccumulatorFactory.size() == vpExpression.size());
+
+        /*
+          Spilling happens on mongod only, and only when the user asked for
+          it; otherwise all groups are kept in memory.
+        */
+        spillingEnabled = pExpCtx->getAllowDiskUse() && !pExpCtx->getInRouter() &&
+                          !pExpCtx->getTempDir().empty();
+        if (spillingEnabled) {
+            pMergeExpCtx = pExpCtx->clone();
+            pMergeExpCtx->setDoingMerge(true);
+        }
+        const long long maxMemoryUsageBytes = aggregationGroupMaxMemoryBytes.value();
 
         for (bool hasNext = !pSource->eof(); hasNext; hasNext = pSource->advance()) {
             Document input  = pSource->getCurrent();
@@ -301,34 +487,30 @@ namespace mongo {
             if (id.missing())
                 id = Value(BSONNULL);
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-
-            if (numAccumulators == 0)
-                continue; // we are basically building a set
-
-            if (group.empty()) {
-                /* add the accumulators */
-                group.reserve(numAccumulators);
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    intrusive_ptr<Accumulator> accum = (*vpAccumulatorFactory[i])(pExpCtx);
-                    accum->addOperand(vpExpression[i]);
-                    group.push_back(accum);
-                }
+            accumulate(id, input, false);
+
+            if (spillingEnabled && memoryUsageBytes > maxMemoryUsageBytes) {
+                spill(&inputPartitions, 0);
             }
+        }
 
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
-            for (size_t i = 0; i < numAccumulators; i++)
-                group[i]->evaluate(input);
+        populated = true;
+
+        if (!inputPartitions.empty()) {
+            /* the last of the input gets merged with what was spilled */
+            spill(&inputPartitions, 0);
+            for (size_t i = 0; i < inputPartitions.size(); i++) {
+                if (!inputPartitions[i]->empty())
+                    pendingPartitions.push_back(inputPartitions[i]);
+            }
+            inputPartitions.clear();
+
+            loadNextPartition();
+            return;
         }
 
         /* start the group iterator */
         groupsIterator = groups.begin();
-        populated = true;
     }
 
     Document DocumentSourceGroup::makeDocument(
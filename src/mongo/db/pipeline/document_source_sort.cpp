@@ -52,6 +52,9 @@ namespace mongo {
         if (!documents.empty())
             documents.pop_front(); // this way we release memory as we go
 
+        if (mergingPresorted && documents.empty())
+            mergeNext();
+
         return !documents.empty();
     }
 
@@ -71,6 +74,9 @@ namespace mongo {
             if (explain && limitSrc) {
                 insides.appendNumber("limit", limitSrc->getLimit());
             }
+            if (mergingPresorted) {
+                insides.append("mergePresorted", true);
+            }
             insides.doneFast();
             sortObj.doneFast();
         }
@@ -91,14 +97,26 @@ namespace mongo {
 
     void DocumentSourceSort::dispose() {
         documents.clear();
+        mergeHeap.clear();
+        mergeShards.clear();
         pSource->dispose();
     }
 
     DocumentSourceSort::DocumentSourceSort(const intrusive_ptr<ExpressionContext> &pExpCtx)
         : SplittableDocumentSource(pExpCtx)
         , populated(false)
+        , mergingPresorted(false)
+        , nMerged(0)
     {}
 
+    intrusive_ptr<DocumentSource> DocumentSourceSort::getRouterSource() {
+        BSONObjBuilder sortKey;
+        sortKeyToBson(&sortKey, false);
+        intrusive_ptr<DocumentSourceSort> pMerge(create(pExpCtx, sortKey.obj(), getLimit()));
+        pMerge->mergingPresorted = true;
+        return pMerge;
+    }
+
     long long DocumentSourceSort::getLimit() const {
         return limitSrc ? limitSrc->getLimit() : -1;
     }
@@ -197,14 +215,52 @@ namespace mongo {
         /* make sure we've got a sort key */
         verify(vSortKey.size());
 
+        populated = true;
+
+        DocumentSourceCommandShards* pShards =
+            dynamic_cast<DocumentSourceCommandShards*>(pSource);
+        if (mergingPresorted && pShards) {
+            mergeShards = pShards->releaseShardResults();
+            for (size_t i = 0; i < mergeShards.size(); ++i) {
+                if (mergeShards[i]->more())
+                    mergeHeap.push_back(MergeHead(mergeShards[i]->next(), vSortKey, i));
+            }
+            std::make_heap(mergeHeap.begin(), mergeHeap.end(), MergeComparator(*this));
+            mergeNext();
+            return;
+        }
+
+        /* anything else, even if it is presorted, is sorted here */
+        mergingPresorted = false;
+
         if (!limitSrc)
             populateAll();
         else if (limitSrc->getLimit() == 1)
             populateOne();
         else
             populateTopK();
+    }
 
-        populated = true;
+    void DocumentSourceSort::mergeNext() {
+        if (mergeHeap.empty() || (limitSrc && nMerged >= limitSrc->getLimit())) {
+            /* stop any shard cursors that are still open */
+            mergeHeap.clear();
+            mergeShards.clear();
+            return;
+        }
+
+        MergeComparator comp(*this);
+        std::pop_heap(mergeHeap.begin(), mergeHeap.end(), comp);
+        documents.push_back(mergeHeap.back().keyAndDoc);
+        ++nMerged;
+
+        /* replace it with the next document from the same shard */
+        const size_t shard = mergeHeap.back().shard;
+        mergeHeap.pop_back();
+        if (mergeShards[shard]->more()) {
+            mergeHeap.push_back(MergeHead(mergeShards[shard]->next(), vSortKey, shard));
+            std::push_heap(mergeHeap.begin(), mergeHeap.end(), comp);
+        }
     }
 
     void DocumentSourceSort::populateAll() {
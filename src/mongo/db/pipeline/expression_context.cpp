@@ -29,6 +29,8 @@ namespace mongo {
         doingMerge(false),
         inShard(false),
         inRouter(false),
+        allowDiskUse(false),
+        tempDir(),
         intCheckCounter(1),
         pStatus(pS) {
     }
@@ -42,6 +44,8 @@ namespace mongo {
         newContext->setDoingMerge(getDoingMerge());
         newContext->setInShard(getInShard());
         newContext->setInRouter(getInRouter());
+        newContext->setAllowDiskUse(getAllowDiskUse());
+        newContext->setTempDir(getTempDir());
         return newContext;
     }
 
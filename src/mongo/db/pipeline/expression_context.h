@@ -33,10 +33,19 @@ namespace mongo {
         void setDoingMerge(bool b);
         void setInShard(bool b);
         void setInRouter(bool b);
+        void setAllowDiskUse(bool b);
+        void setTempDir(const string& dir);
 
         bool getDoingMerge() const;
         bool getInShard() const;
         bool getInRouter() const;
+        bool getAllowDiskUse() const;
+
+        /**
+           Directory that stages may spill temporary files to.  Empty if this
+           process can't spill, which is always the case in mongos.
+         */
+        const string& getTempDir() const;
 
         /**
            Used by a pipeline to check for interrupts so that killOp() works.
@@ -55,6 +64,8 @@ namespace mongo {
         bool doingMerge;
         bool inShard;
         bool inRouter;
+        bool allowDiskUse;
+        string tempDir;
         unsigned intCheckCounter; // interrupt check counter
         InterruptStatus *const pStatus;
     };
@@ -77,6 +88,14 @@ namespace mongo {
         inRouter = b;
     }
 
+    inline void ExpressionContext::setAllowDiskUse(bool b) {
+        allowDiskUse = b;
+    }
+
+    inline void ExpressionContext::setTempDir(const string& dir) {
+        tempDir = dir;
+    }
+
     inline bool ExpressionContext::getDoingMerge() const {
         return doingMerge;
     }
@@ -89,4 +108,12 @@ namespace mongo {
         return inRouter;
     }
 
+    inline bool ExpressionContext::getAllowDiskUse() const {
+        return allowDiskUse;
+    }
+
+    inline const string& ExpressionContext::getTempDir() const {
+        return tempDir;
+    }
+
 };
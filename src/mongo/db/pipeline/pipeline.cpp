@@ -33,6 +33,7 @@ namespace mongo {
     const char Pipeline::explainName[] = "explain";
     const char Pipeline::fromRouterName[] = "fromRouter";
     const char Pipeline::splitMongodPipelineName[] = "splitMongodPipeline";
+    const char Pipeline::allowDiskUseName[] = "allowDiskUse";
     const char Pipeline::serverPipelineName[] = "serverPipeline";
     const char Pipeline::mongosPipelineName[] = "mongosPipeline";
 
@@ -124,6 +125,14 @@ namespace mongo {
                 continue;
             }
 
+            /* check for permission to spill to disk */
+            if (!strcmp(pFieldName, allowDiskUseName)) {
+                uassert(17376, str::stream() << allowDiskUseName << " must be a bool",
+                        cmdElement.type() == Bool);
+                pCtx->setAllowDiskUse(cmdElement.Bool());
+                continue;
+            }
+
             /* if the request came from the router, we're in a shard */
             if (!strcmp(pFieldName, fromRouterName)) {
                 pCtx->setInShard(cmdElement.Bool());
@@ -379,6 +388,10 @@ namespace mongo {
         if ((btemp = pCtx->getInRouter())) {
             pBuilder->append(fromRouterName, btemp);
         }
+
+        if ((btemp = pCtx->getAllowDiskUse())) {
+            pBuilder->append(allowDiskUseName, btemp);
+        }
     }
 
     void Pipeline::stitch() {
@@ -27,12 +27,17 @@
 #include "mongo/db/parsed_query.h"
 #include "mongo/db/query_plan_selection_policy.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/db/server_parameters.h"
 
 //#define DEBUGQO(x) cout << x << endl;
 #define DEBUGQO(x)
 
 namespace mongo {
 
+    // A plan chosen from the plan cache is abandoned, and the query replanned, once it has
+    // scanned this many times more than it did when it won.
+    MONGO_EXPORT_SERVER_PARAMETER(planCacheReplanFactor, int, 10);
+
     // returns an IndexDetails* for a hint, 0 if hint is $natural.
     // hint must not be eoo()
     IndexDetails* parseHint( const BSONElement& hint, Collection *cl ) {
@@ -359,6 +364,8 @@ namespace mongo {
         
         vector<shared_ptr<QueryPlan> > plans;
         shared_ptr<QueryPlan> optimalPlan;
+        vector<shared_ptr<QueryPlan> > skipScanPlans;
+        vector<shared_ptr<QueryPlan> > intersectablePlans;
         shared_ptr<QueryPlan> specialPlan;
         for( int i = 0; i < cl->nIndexes(); ++i ) {
             
@@ -380,11 +387,19 @@ namespace mongo {
                     if ( p->special().empty() ) {
                         // Not a 'special' plan.
                         plans.push_back( p );
+                        if ( p->intersectable() ) {
+                            intersectablePlans.push_back( p );
+                        }
                     }
                     else if ( _allowSpecial ) {
                         specialPlan = p;
                     }
                     break;
+                case QueryPlan::Unhelpful:
+                    if ( p->skipScan() ) {
+                        skipScanPlans.push_back( p );
+                    }
+                    break;
                 default:
                     break;
             }
@@ -410,9 +425,26 @@ namespace mongo {
             ++i ) {
             _qps.addCandidatePlan( *i );
         }        
+
+        // Intersecting indexes pays off when each index matches many documents but few match
+        // them all, which the race finds out.
+        shared_ptr<QueryPlan> intersectionPlan = newIntersectionPlan( cl, intersectablePlans );
+        if ( intersectionPlan ) {
+            _qps.addCandidatePlan( intersectionPlan );
+        }
+
+        // Skip scans only win when the leading field has few values, which can't be told
+        // without trying, so they are only tried when nothing else helps and always race a
+        // table scan.
+        if ( plans.empty() ) {
+            for( vector<shared_ptr<QueryPlan> >::const_iterator i = skipScanPlans.begin();
+                 i != skipScanPlans.end(); ++i ) {
+                _qps.addCandidatePlan( *i );
+            }
+        }
         
         // Only add a table-scan plan if no helpful indexes were found.
-        if (_qps.nPlans() == 0) {
+        if (plans.empty()) {
             _qps.addCandidatePlan( newPlan( cl, -1 ) );
         }
     }
@@ -511,6 +543,20 @@ namespace mongo {
         if ( str::equals( bestIndex.firstElementFieldName(), "$natural" ) ) {
             p = newPlan( cl, -1 );
         }
+        else if ( str::equals( bestIndex.firstElementFieldName(), "$intersect" ) ) {
+            vector<shared_ptr<QueryPlan> > plans;
+            BSONForEach( e, bestIndex.firstElement().embeddedObject() ) {
+                for (int i = 0; i < cl->nIndexes(); i++) {
+                    if ( cl->idx(i).keyPattern().woCompare( e.embeddedObject() ) == 0 ) {
+                        plans.push_back( newPlan( cl, i ) );
+                    }
+                }
+            }
+            p = newIntersectionPlan( cl, plans );
+            if ( !p || p->indexKey() != bestIndex ) {
+                return false;
+            }
+        }
         
         for (int i = 0; i < cl->nIndexes(); i++) {
             IndexDetails &ii = cl->idx(i);
@@ -521,7 +567,7 @@ namespace mongo {
         
         massert( 10368, "Unable to locate previously recorded index", p );
 
-        if ( p->utility() == QueryPlan::Unhelpful ||
+        if ( ( p->utility() == QueryPlan::Unhelpful && !p->skipScan() ) ||
              p->utility() == QueryPlan::Disallowed ) {
             return false;
         }
@@ -556,6 +602,52 @@ namespace mongo {
         return ret;
     }
 
+    static bool widerIndex( const shared_ptr<QueryPlan>& a, const shared_ptr<QueryPlan>& b ) {
+        return a->indexKey().nFields() > b->indexKey().nFields();
+    }
+
+    shared_ptr<QueryPlan> QueryPlanGenerator::newIntersectionPlan
+            ( Collection *cl, const vector<shared_ptr<QueryPlan> >& plans ) const {
+        // Like special plans, intersections aren't run for $or clauses (the only plan sets that
+        // disallow special plans), whose dedup takes one index's ranges as scanned.  See
+        // MultiPlanScanner::handleEndOfClause().
+        if ( !_allowSpecial ) {
+            return shared_ptr<QueryPlan>();
+        }
+
+        // Widest indexes first, so a narrower one that pins nothing new is left out.
+        vector<shared_ptr<QueryPlan> > candidates;
+        for( vector<shared_ptr<QueryPlan> >::const_iterator i = plans.begin(); i != plans.end();
+             ++i ) {
+            if ( (*i)->intersectable() ) {
+                candidates.push_back( *i );
+            }
+        }
+        std::stable_sort( candidates.begin(), candidates.end(), widerIndex );
+
+        vector<int> idxNos;
+        set<string> pinnedFields;
+        for( vector<shared_ptr<QueryPlan> >::const_iterator i = candidates.begin();
+             i != candidates.end(); ++i ) {
+            bool pinsNewField = false;
+            BSONForEach( e, (*i)->indexKey() ) {
+                pinsNewField = pinnedFields.insert( e.fieldName() ).second || pinsNewField;
+            }
+            if ( pinsNewField ) {
+                idxNos.push_back( (*i)->idxNo() );
+            }
+        }
+        if ( idxNos.size() < 2 ) {
+            return shared_ptr<QueryPlan>();
+        }
+        return shared_ptr<QueryPlan>( QueryPlan::makeIntersection( cl,
+                                                                   idxNos,
+                                                                   _qps.frsp(),
+                                                                   _qps.originalQuery(),
+                                                                   _qps.order(),
+                                                                   _parsedQuery ) );
+    }
+
     bool QueryPlanGenerator::setUnindexedPlanIf( bool set, Collection *cl ) {
         if ( set ) {
             setSingleUnindexedPlan( cl );
@@ -828,7 +920,8 @@ namespace mongo {
                                                 const QueryPlanRunner& prototypeRunner ) :
         _prototypeRunner( prototypeRunner ),
         _plans( plans ),
-        _done() {
+        _done(),
+        _micros() {
     }
 
     shared_ptr<QueryPlanRunner> QueryPlanRunnerQueue::init() {
@@ -877,6 +970,7 @@ namespace mongo {
     
     shared_ptr<QueryPlanRunner> QueryPlanRunnerQueue::next() {
         verify( !done() );
+        _timer.reset();
 
         if ( _runners.empty() ) {
             shared_ptr<QueryPlanRunner> initialRet = init();
@@ -890,6 +984,7 @@ namespace mongo {
         do {
             ret = _next();
         } while( ret->error() && !_queue.empty() );
+        _micros += _timer.micros();
 
         if ( _queue.empty() ) {
             _done = true;
@@ -908,6 +1003,10 @@ namespace mongo {
                 runner.queryPlan().registerSelf( runner.nscanned(),
                                                  _plans.characterizeCandidatePlans() );
             }
+            else if ( _plans.usingCachedPlan() && runner.mayRecordPlan() ) {
+                runner.queryPlan().noteCachedRun( runner.nscanned(),
+                                                  _micros + _timer.micros() );
+            }
             _done = true;
             return holder._runner;
         }
@@ -915,8 +1014,9 @@ namespace mongo {
             return holder._runner;
         }
         if ( _plans.hasPossiblyExcludedPlans() &&
-            runner.nscanned() > _plans.oldNScanned() * 10 ) {
+            runner.nscanned() > _plans.oldNScanned() * planCacheReplanFactor ) {
             verify( _plans.nPlans() == 1 && _plans.firstPlan()->special().empty() );
+            runner.queryPlan().noteReplan();
             holder._offset = -runner.nscanned();
             _plans.addFallbackPlans();
             QueryPlanSet::PlanVector::const_iterator i = _plans.plans().begin();
@@ -1420,18 +1520,25 @@ namespace mongo {
         Collection *cl = getCollection(frsp.ns());
         if (cl != NULL) {
             QueryCache &qc = cl->getQueryCache();
-            QueryCache::Lock::Exclusive lk(qc);
             CachedQueryPlan noCachedPlan;
             qc.registerCachedQueryPlanForPattern( frsp._singleKey.pattern( order ), noCachedPlan );
             qc.registerCachedQueryPlanForPattern( frsp._multiKey.pattern( order ), noCachedPlan );
         }
     }
     
+    void QueryUtilIndexed::erasePatterns( const FieldRangeSetPair &frsp, const BSONObj &order ) {
+        Collection *cl = getCollection(frsp.ns());
+        if (cl != NULL) {
+            QueryCache &qc = cl->getQueryCache();
+            qc.erase( frsp._singleKey.pattern( order ) );
+            qc.erase( frsp._multiKey.pattern( order ) );
+        }
+    }
+    
     CachedQueryPlan QueryUtilIndexed::bestIndexForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order ) {
         Collection *cl = getCollection(frsp.ns());
         if (cl != NULL) {
             QueryCache &qc = cl->getQueryCache();
-            QueryCache::Lock::Shared lk(qc);
             // TODO Maybe it would make sense to return the index with the lowest
             // nscanned if there are two possibilities.
             {
@@ -23,6 +23,7 @@
 #include "mongo/db/query_plan.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/util/elapsed_tracker.h"
+#include "mongo/util/timer.h"
 
 #pragma once
 
@@ -311,6 +312,13 @@ namespace mongo {
                                        const BSONObj& max = BSONObj(),
                                        const string& special = "" ) const;
 
+        /**
+         * @return a plan intersecting the intersectable() ones of 'plans' that each pin a field
+         * none of the others already do, or an empty pointer if fewer than two are left.
+         */
+        shared_ptr<QueryPlan> newIntersectionPlan( Collection *cl,
+                                                   const vector<shared_ptr<QueryPlan> >& plans ) const;
+
         bool setUnindexedPlanIf( bool set, Collection *cl );
 
         void setSingleUnindexedPlan( Collection *cl );
@@ -497,6 +505,9 @@ namespace mongo {
         PriorityQueue<RunnerHolder> _queue;
         shared_ptr<ExplainClauseInfo> _explainClauseInfo;
         bool _done;
+        // Time spent in next(), which does not include time between getMores.
+        long long _micros;
+        Timer _timer;
     };
 
     /** Handles $or type queries by generating a QueryPlanSet for each $or clause. */
@@ -744,6 +755,9 @@ namespace mongo {
         /** Clear any indexes recorded as the best for either the single or multi key pattern. */
         static void clearIndexesForPatterns( const FieldRangeSetPair& frsp, const BSONObj& order );
 
+        /** Remove the single and multi key patterns, and their statistics, from the plan cache. */
+        static void erasePatterns( const FieldRangeSetPair& frsp, const BSONObj& order );
+
         /** Return a recorded best index for the single or multi key pattern. */
         static CachedQueryPlan bestIndexForPatterns( const FieldRangeSetPair& frsp,
                                                      const BSONObj& order );
@@ -60,6 +60,34 @@ namespace mongo {
         ret->init( originalFrsp, startKey, endKey );
         return ret.release();
     }
+
+    QueryPlan* QueryPlan::makeIntersection( Collection *cl,
+                                            const vector<int>& idxNos,
+                                            const FieldRangeSetPair& frsp,
+                                            const BSONObj& originalQuery,
+                                            const BSONObj& order,
+                                            const shared_ptr<const ParsedQuery>& parsedQuery ) {
+        verify( idxNos.size() >= 2 );
+        auto_ptr<QueryPlan> ret( new QueryPlan( cl,
+                                                idxNos[ 0 ],
+                                                frsp,
+                                                originalQuery,
+                                                order,
+                                                parsedQuery,
+                                                "" ) );
+        ret->_index = &cl->idx( idxNos[ 0 ] );
+        ret->_scanAndOrderRequired = !order.isEmpty();
+        for( vector<int>::const_iterator i = idxNos.begin(); i != idxNos.end(); ++i ) {
+            const IndexDetails& idx = cl->idx( *i );
+            ret->_intersectIndexes.push_back( &idx );
+            ret->_intersectFrvs.push_back
+                    ( shared_ptr<FieldRangeVector>
+                     ( new FieldRangeVector( frsp.frsForIndex( cl, *i ), idx.keyPattern(), 1 ) ) );
+        }
+        ret->_frv = ret->_intersectFrvs[ 0 ];
+        ret->_originalFrv = ret->_frv;
+        return ret.release();
+    }
     
     QueryPlan::QueryPlan( Collection *cl,
                           int idxNo,
@@ -81,6 +109,8 @@ namespace mongo {
         _direction( 0 ),
         _endKeyInclusive(),
         _utility( Helpful ),
+        _skipScan( false ),
+        _intersectable( false ),
         _special( special ),
         _startOrEndSpec() {
     }
@@ -224,10 +254,37 @@ doneCheckOrder:
         if ( ( _scanAndOrderRequired || _order.isEmpty() ) && 
             _frs.range( idxKey.firstElementFieldName() ).universal() ) { // NOTE SERVER-2140
             _utility = Unhelpful;
+            if ( _order.isEmpty() ) {
+                BSONObjIterator j( idxKey );
+                j.next();
+                while( j.more() ) {
+                    const FieldRange& fr = _frs.range( j.next().fieldName() );
+                    if ( !fr.universal() ) {
+                        _skipScan = fr.equality();
+                        break;
+                    }
+                }
+            }
         }
             
         if ( _index->sparse() && hasPossibleExistsFalsePredicate() ) {
             _utility = Disallowed;
+            _skipScan = false;
+        }
+
+        if ( _utility == Helpful &&
+             _order.isEmpty() &&
+             !_cl->isPartitioned() &&
+             !_cl->isPKIndex( *_index ) ) {
+            _intersectable = true;
+            BSONObjIterator j( idxKey );
+            while( j.more() ) {
+                const FieldRange& fr = _frs.range( j.next().fieldName() );
+                if ( !fr.equality() || fr.min().type() == Array ) {
+                    _intersectable = false;
+                    break;
+                }
+            }
         }
 
         if ( _parsedQuery && _parsedQuery->getFields() && !_cl->isMultikey( _idxNo ) ) {
@@ -254,6 +311,10 @@ doneCheckOrder:
             return Cursor::make(NULL);
         }
 
+        if ( intersection() ) {
+            return Cursor::makeIntersection(_cl, _intersectIndexes, _intersectFrvs);
+        }
+
         if (willScanTable()) {
             checkTableScanAllowed();
             const int direction = _order.getField("$natural").number() >= 0 ? 1 : -1;
@@ -287,6 +348,17 @@ doneCheckOrder:
     BSONObj QueryPlan::indexKey() const {
         if ( !_index )
             return BSON( "$natural" << 1 );
+        if ( intersection() ) {
+            // Not any one index's key, but it stands for the plan in the query cache like one.
+            BSONObjBuilder b;
+            BSONArrayBuilder a( b.subarrayStart( "$intersect" ) );
+            for( vector<const IndexDetails *>::const_iterator i = _intersectIndexes.begin();
+                 i != _intersectIndexes.end(); ++i ) {
+                a.append( (*i)->keyPattern() );
+            }
+            a.done();
+            return b.obj();
+        }
         return _index->keyPattern();
     }
 
@@ -305,12 +377,25 @@ doneCheckOrder:
         Collection *cl = getCollection(ns());
         if (cl != NULL) {
             QueryCache &qc = cl->getQueryCache();
-            QueryCache::Lock::Exclusive lk(qc);
             QueryPattern queryPattern = _frs.pattern( _order );
             CachedQueryPlan queryPlanToCache( indexKey(), nScanned, candidatePlans );
             qc.registerCachedQueryPlanForPattern( queryPattern, queryPlanToCache );
         }
     }
+
+    void QueryPlan::noteCachedRun( long long nScanned, long long micros ) const {
+        Collection *cl = getCollection(ns());
+        if (cl != NULL) {
+            cl->getQueryCache().notePlanRun( _frs.pattern( _order ), indexKey(), nScanned, micros );
+        }
+    }
+
+    void QueryPlan::noteReplan() const {
+        Collection *cl = getCollection(ns());
+        if (cl != NULL) {
+            cl->getQueryCache().noteReplan( _frs.pattern( _order ) );
+        }
+    }
     
     void QueryPlan::checkTableScanAllowed() const {
         if ( likely( !cmdLine.noTableScan ) )
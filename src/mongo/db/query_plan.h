@@ -54,6 +54,19 @@ namespace mongo {
                                 const BSONObj& endKey = BSONObj(),
                                 const std::string& special = "" );
 
+        /**
+         * A plan that scans each of the indexes idxNos, all of whose fields the query pins to a
+         * single value, and keeps the documents found in every one; see
+         * IndexIntersectionCursor.  Each index's plan must be intersectable().
+         */
+        static QueryPlan* makeIntersection( Collection *cl,
+                                            const vector<int>& idxNos,
+                                            const FieldRangeSetPair& frsp,
+                                            const BSONObj& originalQuery,
+                                            const BSONObj& order,
+                                            const shared_ptr<const ParsedQuery>& parsedQuery =
+                                                    shared_ptr<const ParsedQuery>() );
+
         /** Categorical classification of a QueryPlan's utility. */
         enum Utility {
             Impossible, // Cannot produce any matches, so the query must have an empty result set.
@@ -67,6 +80,23 @@ namespace mongo {
         };
 
         Utility utility() const { return _utility; }
+
+        /**
+         * @return true if this Unhelpful plan constrains its index's leading field not at all but
+         * a later field by equality.  Its bounds iteration then seeks from one leading value to
+         * the next (a skip scan), which beats a table scan when there are few such values.
+         */
+        bool skipScan() const { return _skipScan; }
+
+        /**
+         * @return true if this Helpful plan's query pins every field of its secondary index to a
+         * single value, so the index's matching pks come in order and can be intersected with
+         * another such index's.
+         */
+        bool intersectable() const { return _intersectable; }
+
+        /** @return true if this plan intersects several indexes. */
+        bool intersection() const { return !_intersectFrvs.empty(); }
         
         /** @return true if ScanAndOrder processing will be required for result set. */
         bool scanAndOrderRequired() const { return _scanAndOrderRequired; }
@@ -95,6 +125,15 @@ namespace mongo {
         /** Register this plan as a winner for its QueryPattern, with specified 'nscanned'. */
         void registerSelf( long long nScanned, CandidatePlanCharacter candidatePlans ) const;
 
+        /**
+         * Record a completed run of this plan, chosen from the plan cache, in its statistics.
+         * 'micros' is the time spent running the plan, excluding time between getMores.
+         */
+        void noteCachedRun( long long nScanned, long long micros ) const;
+
+        /** Record that this plan, chosen from the plan cache, was abandoned for a replan. */
+        void noteReplan() const;
+
         int direction() const { return _direction; }
 
         BSONObj indexKey() const;
@@ -168,6 +207,10 @@ namespace mongo {
         BSONObj _endKey;
         bool _endKeyInclusive;
         Utility _utility;
+        bool _skipScan;
+        bool _intersectable;
+        vector<const IndexDetails *> _intersectIndexes;
+        vector<shared_ptr<FieldRangeVector> > _intersectFrvs;
         string _special;
         bool _startOrEndSpec;
         shared_ptr<Projection::KeyOnly> _keyFieldsOnly;
@@ -17,9 +17,13 @@
 
 #include "querypattern.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
+    // The most query patterns a collection's plan cache holds, spread across its stripes.
+    MONGO_EXPORT_SERVER_PARAMETER(planCacheMaxShapes, int, 5000);
+
     QueryPattern::QueryPattern( const FieldRangeSet &frs, const BSONObj &sort ) {
         for( map<string,FieldRange>::const_iterator i = frs.ranges().begin(); i != frs.ranges().end(); ++i ) {
             if ( i->second.equality() ) {
@@ -46,21 +50,21 @@ namespace mongo {
             }
         }
         setSort( sort );
+        computeHash();
     }
 
-    /** for testing only - speed unimportant */
-    bool QueryPattern::operator==( const QueryPattern &other ) const {
-        bool less = operator<( other );
-        bool more = other.operator<( *this );
-        verify( !( less && more ) );
-        return !( less || more );
-    }
-    
-    /** for testing only - speed unimportant */
-    bool QueryPattern::operator!=( const QueryPattern &other ) const {
-        return !operator==( other );
+    void QueryPattern::computeHash() {
+        // FNV-1a over the field names and types, then mixed with the sort spec.
+        size_t h = 2166136261U;
+        for( map<string,Type>::const_iterator i = _fieldTypes.begin(); i != _fieldTypes.end(); ++i ) {
+            for( string::const_iterator c = i->first.begin(); c != i->first.end(); ++c ) {
+                h = ( h ^ static_cast<unsigned char>( *c ) ) * 16777619U;
+            }
+            h = ( h ^ ( 0x100 + i->second ) ) * 16777619U;
+        }
+        _hash = ( h ^ static_cast<unsigned>( _sort.hash() ) ) * 16777619U;
     }
-    
+
     string typeToString( enum QueryPattern::Type t ) {
         switch (t) {
             case QueryPattern::Empty:
@@ -79,12 +83,16 @@ namespace mongo {
         return "";
     }
     
-    string QueryPattern::toString() const {
+    BSONObj QueryPattern::toBSON() const {
         BSONObjBuilder b;
         for( map<string,Type>::const_iterator i = _fieldTypes.begin(); i != _fieldTypes.end(); ++i ) {
             b << i->first << typeToString( i->second );
         }
-        return BSON( "query" << b.done() << "sort" << _sort ).toString();
+        return BSON( "query" << b.done() << "sort" << _sort );
+    }
+
+    string QueryPattern::toString() const {
+        return toBSON().toString();
     }
     
     void QueryPattern::setSort( const BSONObj sort ) {
@@ -113,33 +121,164 @@ namespace mongo {
     _planCharacter( planCharacter ) {
     }
 
-    QueryCache::QueryCache() :
-        _qcWriteCount(0) {
+    QueryCache::Entry::Entry( const CachedQueryPlan &cachedPlan ) :
+        plan( cachedPlan ),
+        replans( 0 ),
+        runs( 0 ),
+        totalMicros( 0 ),
+        nHistory( 0 ) {
+        if ( !cachedPlan.indexKey().isEmpty() ) {
+            addRun( cachedPlan.nScanned() );
+        }
+    }
+
+    void QueryCache::Entry::resetHistory() {
+        runs = 0;
+        totalMicros = 0;
+        nHistory = 0;
+    }
+
+    void QueryCache::Entry::addRun( long long nScanned ) {
+        nScannedHistory[ nHistory % NScannedHistorySize ] = nScanned;
+        ++nHistory;
+    }
+
+    BSONObj QueryCache::Entry::toBSON( const QueryPattern &pattern ) const {
+        BSONObjBuilder b;
+        b.appendElements( pattern.toBSON() );
+        if ( plan.indexKey().isEmpty() ) {
+            b.appendNull( "plan" );
+        }
+        else {
+            b.append( "plan", plan.indexKey() );
+        }
+        b.appendNumber( "nscanned", plan.nScanned() );
+        BSONArrayBuilder history( b.subarrayStart( "nscannedHistory" ) );
+        // Oldest first.
+        int n = std::min( nHistory, static_cast<int>( NScannedHistorySize ) );
+        for( int i = nHistory - n; i < nHistory; ++i ) {
+            history.append( nScannedHistory[ i % NScannedHistorySize ] );
+        }
+        history.done();
+        b.appendNumber( "hits", hits.load() );
+        b.appendNumber( "replans", replans );
+        b.appendNumber( "runs", runs );
+        b.appendNumber( "avgMicros", runs > 0 ? totalMicros / runs : 0LL );
+        return b.obj();
+    }
+
+    QueryCache::QueryCache() {
     }
 
     CachedQueryPlan QueryCache::cachedQueryPlanForPattern( const QueryPattern &pattern ) {
-        map<QueryPattern, CachedQueryPlan>::const_iterator i = _qcCache.find(pattern);
-        return i != _qcCache.end() ? i->second : CachedQueryPlan();
+        Stripe &stripe = stripeFor( pattern );
+        SimpleRWLock::Shared lk( stripe.rwlock );
+        EntryMap::const_iterator i = stripe.entries.find( pattern );
+        if ( i == stripe.entries.end() ) {
+            return CachedQueryPlan();
+        }
+        Entry &entry = *i->second;
+        if ( entry.plan.indexKey().isEmpty() ) {
+            return CachedQueryPlan();
+        }
+        entry.hits.fetchAndAdd( 1 );
+        touch( entry );
+        return entry.plan;
     }
 
     void QueryCache::registerCachedQueryPlanForPattern( const QueryPattern &pattern,
-                                            const CachedQueryPlan &cachedQueryPlan ) {
-        _qcCache[ pattern ] = cachedQueryPlan;
+                                                        const CachedQueryPlan &cachedQueryPlan ) {
+        Stripe &stripe = stripeFor( pattern );
+        SimpleRWLock::Exclusive lk( stripe.rwlock );
+        EntryMap::iterator i = stripe.entries.find( pattern );
+        if ( i == stripe.entries.end() ) {
+            evictForInsert( stripe );
+            boost::shared_ptr<Entry> entry( new Entry( cachedQueryPlan ) );
+            touch( *entry );
+            stripe.entries.insert( make_pair( pattern, entry ) );
+            return;
+        }
+        boost::shared_ptr<Entry> &entry = i->second;
+        touch( *entry );
+        // Statistics describe the shape and are kept, but the nscanned history only means
+        // something for the plan that produced it.
+        if ( entry->plan.indexKey() != cachedQueryPlan.indexKey() ) {
+            entry->resetHistory();
+        }
+        entry->plan = cachedQueryPlan;
+        if ( !cachedQueryPlan.indexKey().isEmpty() ) {
+            entry->addRun( cachedQueryPlan.nScanned() );
+        }
+    }
+
+    void QueryCache::noteReplan( const QueryPattern &pattern ) {
+        Stripe &stripe = stripeFor( pattern );
+        SimpleRWLock::Exclusive lk( stripe.rwlock );
+        EntryMap::iterator i = stripe.entries.find( pattern );
+        if ( i != stripe.entries.end() ) {
+            ++i->second->replans;
+        }
     }
 
-    void QueryCache::notifyOfWriteOp() {
-        if ( _qcCache.empty() ) {
+    void QueryCache::notePlanRun( const QueryPattern &pattern, const BSONObj &indexKey,
+                                  long long nScanned, long long micros ) {
+        Stripe &stripe = stripeFor( pattern );
+        SimpleRWLock::Exclusive lk( stripe.rwlock );
+        EntryMap::iterator i = stripe.entries.find( pattern );
+        if ( i == stripe.entries.end() || i->second->plan.indexKey() != indexKey ) {
             return;
         }
-        if ( ++_qcWriteCount >= 100 ) {
-            clearQueryCache();
+        Entry &entry = *i->second;
+        entry.addRun( nScanned );
+        ++entry.runs;
+        entry.totalMicros += micros;
+        touch( entry );
+    }
+
+    void QueryCache::evictForInsert( Stripe &stripe ) {
+        size_t cap = std::max( planCacheMaxShapes / NumStripes, 1 );
+        while( stripe.entries.size() >= cap ) {
+            // A linear scan, but only when a new pattern arrives at a full stripe.
+            EntryMap::iterator oldest = stripe.entries.begin();
+            for( EntryMap::iterator i = stripe.entries.begin(); i != stripe.entries.end(); ++i ) {
+                if ( i->second->lastUsed.load() < oldest->second->lastUsed.load() ) {
+                    oldest = i;
+                }
+            }
+            stripe.entries.erase( oldest );
         }
     }
 
+    void QueryCache::erase( const QueryPattern &pattern ) {
+        Stripe &stripe = stripeFor( pattern );
+        SimpleRWLock::Exclusive lk( stripe.rwlock );
+        stripe.entries.erase( pattern );
+    }
+
     void QueryCache::clearQueryCache() {
-        QueryCache::Lock::Exclusive lk(*this);
-        _qcCache.clear();
-        _qcWriteCount = 0;
+        for( int i = 0; i < NumStripes; ++i ) {
+            SimpleRWLock::Exclusive lk( _stripes[ i ].rwlock );
+            _stripes[ i ].entries.clear();
+        }
+    }
+
+    void QueryCache::appendShapes( BSONArrayBuilder &b ) {
+        for( int i = 0; i < NumStripes; ++i ) {
+            SimpleRWLock::Shared lk( _stripes[ i ].rwlock );
+            for( EntryMap::const_iterator j = _stripes[ i ].entries.begin();
+                 j != _stripes[ i ].entries.end(); ++j ) {
+                b.append( j->second->toBSON( j->first ) );
+            }
+        }
+    }
+
+    size_t QueryCache::size() {
+        size_t n = 0;
+        for( int i = 0; i < NumStripes; ++i ) {
+            SimpleRWLock::Shared lk( _stripes[ i ].rwlock );
+            n += _stripes[ i ].entries.size();
+        }
+        return n;
     }
     
 } // namespace mongo
@@ -18,6 +18,8 @@
 #pragma once
 
 #include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/unordered_map.h"
 #include "mongo/util/concurrency/rwlock.h"
 #include "mongo/util/concurrency/simplerwlock.h"
 
@@ -45,17 +47,25 @@ namespace mongo {
             ConstraintPresent
         };
         bool operator<( const QueryPattern &other ) const;
-        /** for testing only */
         bool operator==( const QueryPattern &other ) const;
-        /** for testing only */
         bool operator!=( const QueryPattern &other ) const;
         /** for development / debugging */
         string toString() const;
+        /** @return the pattern as a document, as reported by planCacheListShapes. */
+        BSONObj toBSON() const;
+
+        /** Precomputed on construction, so hashing a pattern is cheap. */
+        size_t hash() const { return _hash; }
+        struct Hasher {
+            size_t operator()( const QueryPattern &pattern ) const { return pattern.hash(); }
+        };
     private:
         void setSort( const BSONObj sort );
         static BSONObj normalizeSort( const BSONObj &spec );
+        void computeHash();
         map<string,Type> _fieldTypes;
         BSONObj _sort;
+        size_t _hash;
     };
 
     /** Summarizes the candidate plans that may run for a query. */
@@ -95,37 +105,105 @@ namespace mongo {
         CandidatePlanCharacter _planCharacter;
     };
 
-    /** A cache of query plans */
-    class QueryCache {
+    /**
+     * A cache of query plans, keyed by QueryPattern.
+     *
+     * The cache is split into stripes by pattern hash, each with its own lock, so that lookups
+     * for different query shapes do not contend.  Alongside each cached plan the cache keeps
+     * statistics about the shape (hits, replans, runs, recent nscanned values and latency), which
+     * survive changes of the chosen plan and are reported by the planCacheListShapes command.
+     *
+     * Each stripe holds at most planCacheMaxShapes / NumStripes patterns.  Registering a new
+     * pattern in a full stripe evicts the stripe's least recently used pattern.
+     *
+     * All methods do their own locking.
+     */
+    class QueryCache : boost::noncopyable {
     public:
         QueryCache();
 
-        struct Lock : boost::noncopyable {
-            struct Shared : boost::noncopyable {
-                Shared(QueryCache &qc) : _lk(qc._rwlock) { }
-                SimpleRWLock::Shared _lk;
-            };
-            struct Exclusive : boost::noncopyable {
-                Exclusive(QueryCache &qc) : _lk(qc._rwlock) { }
-                SimpleRWLock::Exclusive _lk;
-            };
-        };
-
+        /**
+         * @return the plan cached for 'pattern', or an empty plan if there is none.  The
+         * returned plan's nScanned() is the one it won with, so that a plan that degrades
+         * gradually is still measured against what it cost when chosen.
+         */
         CachedQueryPlan cachedQueryPlanForPattern(const QueryPattern &pattern);
 
+        /** Cache 'cachedQueryPlan' for 'pattern'.  An empty plan clears the pattern's plan. */
         void registerCachedQueryPlanForPattern(const QueryPattern &pattern,
-                                               const CachedQueryPlan &cachedQueryPlan) ;
+                                               const CachedQueryPlan &cachedQueryPlan);
+
+        /** Record that the cached plan for 'pattern' performed badly and was replanned. */
+        void noteReplan(const QueryPattern &pattern);
+
+        /**
+         * Record a run of the cached plan for 'pattern' that completed after scanning
+         * 'nScanned' and spending 'micros' in the query optimizer.  Ignored if 'indexKey' is no
+         * longer the cached plan.
+         */
+        void notePlanRun(const QueryPattern &pattern, const BSONObj &indexKey,
+                         long long nScanned, long long micros);
 
-        void notifyOfWriteOp();
+        /** Remove 'pattern' and its statistics from the cache. */
+        void erase(const QueryPattern &pattern);
 
         void clearQueryCache();
 
+        /** Append a document per cached pattern, describing its plan and statistics. */
+        void appendShapes(BSONArrayBuilder &b);
+
+        size_t size();
+
     private:
-        SimpleRWLock _rwlock;
-        int _qcWriteCount;
-        map<QueryPattern, CachedQueryPlan> _qcCache;
+        static const int NumStripes = 16;
+        static const int NScannedHistorySize = 8;
+
+        struct Entry : boost::noncopyable {
+            explicit Entry(const CachedQueryPlan &plan);
+            void resetHistory();
+            void addRun(long long nScanned);
+            BSONObj toBSON(const QueryPattern &pattern) const;
+
+            // Written under the stripe's exclusive lock.
+            CachedQueryPlan plan;
+            long long replans;
+            long long runs;
+            long long totalMicros;
+            long long nScannedHistory[NScannedHistorySize];
+            int nHistory;
+            // Bumped under the stripe's shared lock.
+            AtomicInt64 hits;
+            AtomicInt64 lastUsed;
+        };
+        typedef unordered_map<QueryPattern, boost::shared_ptr<Entry>, QueryPattern::Hasher> EntryMap;
+
+        struct Stripe {
+            SimpleRWLock rwlock;
+            EntryMap entries;
+        };
+
+        Stripe &stripeFor(const QueryPattern &pattern) {
+            return _stripes[pattern.hash() % NumStripes];
+        }
+
+        void touch(Entry &entry) { entry.lastUsed.store(_clock.addAndFetch(1)); }
+
+        /** Make room for one more pattern in 'stripe', which must be locked exclusively. */
+        static void evictForInsert(Stripe &stripe);
+
+        Stripe _stripes[NumStripes];
+        AtomicInt64 _clock;
     };
 
+    inline bool QueryPattern::operator==( const QueryPattern &other ) const {
+        return _hash == other._hash && _fieldTypes == other._fieldTypes &&
+                _sort.binaryEqual( other._sort );
+    }
+
+    inline bool QueryPattern::operator!=( const QueryPattern &other ) const {
+        return !operator==( other );
+    }
+
     inline bool QueryPattern::operator<( const QueryPattern &other ) const {
         map<string,Type>::const_iterator i = _fieldTypes.begin();
         map<string,Type>::const_iterator j = other._fieldTypes.begin();
@@ -41,6 +41,7 @@
 #include "../util/goodies.h"
 #include "repl.h"
 #include "../util/net/message.h"
+#include "../util/net/message_compressor.h"
 #include "../util/background.h"
 #include "../client/connpool.h"
 #include "commands.h"
@@ -168,6 +169,9 @@ namespace mongo {
             result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
             result.appendNumber("maxMessageSizeBytes", MaxMessageSizeBytes);
             result.appendDate("localTime", jsTime());
+            if (networkMessageCompression) {
+                negotiateMessageCompression(cmdObj, ClientBasic::getCurrent()->port(), result);
+            }
             return true;
         }
     } cmdismaster;
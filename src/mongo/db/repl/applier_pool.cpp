@@ -0,0 +1,270 @@
+/**
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/applier_pool.h"
+
+#include <boost/bind.hpp>
+
+#include "third_party/murmurhash3/MurmurHash3.h"
+
+#include "mongo/db/client.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    static uint64_t hashBytes(const void* data, int len, uint64_t seed) {
+        uint64_t out[2];
+        MurmurHash3_x64_128(data, len, static_cast<uint32_t>(seed ^ (seed >> 32)), out);
+        return out[0] ^ seed;
+    }
+
+    // Hashes an element's value so that values that compare equal as part of
+    // a primary key hash equally. Numbers of different types are hashed by
+    // their double value, which may give false conflicts for very large
+    // integers, but never misses a real one. Embedded objects and arrays are
+    // hashed field by field, like BSONElementHasher does, so that their
+    // numbers are canonicalized too.
+    static uint64_t hashIdValue(const BSONElement& e, uint64_t seed, bool includeFieldName) {
+        const int canonical = e.canonicalType();
+        seed = hashBytes(&canonical, sizeof(canonical), seed);
+        if (includeFieldName) {
+            seed = hashBytes(e.fieldName(), e.fieldNameSize(), seed);
+        }
+        if (e.isNumber()) {
+            double d = e.numberDouble();
+            if (d == 0) {
+                d = 0; // -0.0 and 0.0 are the same key
+            }
+            return hashBytes(&d, sizeof(d), seed);
+        }
+        if (!e.mayEncapsulate()) {
+            return hashBytes(e.value(), e.valuesize(), seed);
+        }
+        BSONObj sub;
+        if (e.type() == CodeWScope) {
+            seed = hashBytes(e.codeWScopeCode(), e.codeWScopeCodeLen(), seed);
+            sub = e.codeWScopeObject();
+        }
+        else {
+            sub = e.embeddedObject();
+        }
+        for (BSONObjIterator it(sub); it.more(); ) {
+            seed = hashIdValue(it.next(), seed, true);
+        }
+        return seed;
+    }
+
+    static uint64_t hashNs(const StringData& ns) {
+        return hashBytes(ns.rawData(), ns.size(), 0);
+    }
+
+    static bool appendOpConflictKey(const BSONObj& op, std::vector<uint64_t>* keys) {
+        const char* opType = op["op"].valuestrsafe();
+        if (mongoutils::str::equals(opType, "n")) {
+            // a no-op touches nothing, and is logged without an ns
+            return true;
+        }
+
+        const StringData ns = op["ns"].valuestrsafe();
+        if (ns.empty() || NamespaceString::special(ns)) {
+            return false;
+        }
+
+        if (mongoutils::str::equals(opType, "ci") || mongoutils::str::equals(opType, "cd")) {
+            keys->push_back(hashNs(ns));
+            return true;
+        }
+
+        BSONElement id;
+        if (mongoutils::str::equals(opType, "i") || mongoutils::str::equals(opType, "d")) {
+            BSONElement row = op["o"];
+            if (!row.isABSONObj()) {
+                return false;
+            }
+            id = row.Obj()["_id"];
+        }
+        else if (mongoutils::str::equals(opType, "u") || mongoutils::str::equals(opType, "ur")) {
+            BSONElement oldRow = op["o"];
+            if (oldRow.isABSONObj()) {
+                id = oldRow.Obj()["_id"];
+            }
+            else if (op["pk"].isABSONObj()) {
+                // Updates logged with only the pk and mods. A defined
+                // primary key must end in _id, so the last field is the _id.
+                BSONObjIterator it(op["pk"].Obj());
+                while (it.more()) {
+                    id = it.next();
+                }
+            }
+        }
+        else {
+            // commands and anything we don't know about
+            return false;
+        }
+
+        if (id.eoo()) {
+            return false;
+        }
+        keys->push_back(hashIdValue(id, hashNs(ns), false));
+        return true;
+    }
+
+    bool getTxnConflictKeys(const BSONObj& entry, std::vector<uint64_t>* keys) {
+        keys->clear();
+        BSONElement ops = entry["ops"];
+        if (ops.type() != Array) {
+            // big transactions keep their operations in oplog.refs
+            return false;
+        }
+        for (BSONObjIterator it(ops.Obj()); it.more(); ) {
+            BSONElement op = it.next();
+            if (!op.isABSONObj() || !appendOpConflictKey(op.Obj(), keys)) {
+                keys->clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ReplApplierPool::ReplApplierPool(uint32_t numWorkers) :
+        _numInFlight(0),
+        _shutdown(false) {
+        verify(numWorkers > 0);
+        for (uint32_t i = 0; i < numWorkers; i++) {
+            _workerStats.push_back(new WorkerStats());
+        }
+        for (uint32_t i = 0; i < numWorkers; i++) {
+            _threads.push_back(new boost::thread(boost::bind(&ReplApplierPool::workerThread, this, i)));
+        }
+    }
+
+    ReplApplierPool::~ReplApplierPool() {
+        shutdown();
+        for (size_t i = 0; i < _workerStats.size(); i++) {
+            delete _workerStats[i];
+        }
+    }
+
+    bool ReplApplierPool::conflictsWithInFlight(const std::vector<uint64_t>& keys) const {
+        for (std::vector<uint64_t>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+            if (_inFlightKeys.count(*it) > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ReplApplierPool::schedule(const std::vector<uint64_t>& keys, const Task& task) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        verify(!_shutdown);
+        // Keep a small backlog per worker, so that a conflicting task doesn't
+        // hold up the dispatcher while workers still have work to do.
+        const size_t maxQueued = 2 * _workerStats.size();
+        while (_queue.size() >= maxQueued || conflictsWithInFlight(keys)) {
+            _taskDone.wait(lk);
+        }
+        for (std::vector<uint64_t>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+            _inFlightKeys[*it]++;
+        }
+        _numInFlight++;
+        _queue.push_back(QueuedTask());
+        _queue.back().keys = keys;
+        _queue.back().task = task;
+        _workAvailable.notify_one();
+    }
+
+    void ReplApplierPool::drain() {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        while (_numInFlight > 0) {
+            _taskDone.wait(lk);
+        }
+    }
+
+    void ReplApplierPool::shutdown() {
+        drain();
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            if (_shutdown) {
+                return;
+            }
+            _shutdown = true;
+            _workAvailable.notify_all();
+        }
+        for (size_t i = 0; i < _threads.size(); i++) {
+            _threads[i]->join();
+            delete _threads[i];
+        }
+        _threads.clear();
+    }
+
+    void ReplApplierPool::appendStats(BSONArrayBuilder& b) const {
+        for (size_t i = 0; i < _workerStats.size(); i++) {
+            BSONObjBuilder wb(b.subobjStart());
+            wb.append("ops", _workerStats[i]->ops);
+            wb.append("batches", _workerStats[i]->apply.getReport());
+            wb.done();
+        }
+    }
+
+    void ReplApplierPool::workerThread(uint32_t id) {
+        const string threadName = str::stream() << "applier worker " << id;
+        Client::initThread(threadName.c_str());
+        replLocalAuth();
+        // like the applier thread, workers must finish any work they start
+        cc().setGloballyUninterruptible(true);
+        WorkerStats* stats = _workerStats[id];
+
+        while (true) {
+            QueuedTask work;
+            {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                while (_queue.empty() && !_shutdown) {
+                    _workAvailable.wait(lk);
+                }
+                if (_queue.empty()) {
+                    break;
+                }
+                work = _queue.front();
+                _queue.pop_front();
+            }
+
+            {
+                TimerHolder timer(&stats->apply);
+                work.task();
+            }
+            stats->ops.increment();
+
+            {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                for (std::vector<uint64_t>::const_iterator it = work.keys.begin(); it != work.keys.end(); ++it) {
+                    std::map<uint64_t, uint32_t>::iterator k = _inFlightKeys.find(*it);
+                    dassert(k != _inFlightKeys.end());
+                    if (--k->second == 0) {
+                        _inFlightKeys.erase(k);
+                    }
+                }
+                _numInFlight--;
+                _taskDone.notify_all();
+            }
+        }
+        cc().shutdown();
+    }
+
+} // namespace mongo
@@ -0,0 +1,116 @@
+/**
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/stats/timer_stats.h"
+
+namespace mongo {
+
+    /**
+     * Computes the conflict keys of a transaction entry from the oplog.
+     *
+     * Each row operation contributes one key, a hash of its namespace and the
+     * _id of the affected row. Primary keys in TokuMX always end in _id, so
+     * two operations on the same row always produce the same key. Operations
+     * on capped collections contribute a key for the whole namespace, since
+     * their order of application matters.
+     *
+     * Returns false if the entry cannot be described by row keys (commands,
+     * references to oplog.refs, system collections, rows without an _id). Such
+     * an entry must be applied while nothing else is being applied.
+     */
+    bool getTxnConflictKeys(const BSONObj& entry, std::vector<uint64_t>* keys);
+
+    /**
+     * A fixed pool of threads that applies replicated transactions.
+     *
+     * Transactions are scheduled by a single dispatcher thread, in GTID order,
+     * along with their conflict keys. A transaction is handed to a worker only
+     * once no transaction sharing one of its keys is still being applied, so
+     * transactions touching the same row are applied in the order they were
+     * scheduled. Unrelated transactions may complete in any order.
+     *
+     * Worker threads are initialized as uninterruptible, internally
+     * authorized replication clients.
+     */
+    class ReplApplierPool : boost::noncopyable {
+    public:
+        typedef boost::function<void(void)> Task;
+
+        explicit ReplApplierPool(uint32_t numWorkers);
+        ~ReplApplierPool();
+
+        /**
+         * Waits until the task no longer conflicts with an in-flight task and
+         * a worker has room for it, then queues it. Must only be called from
+         * one thread. The task must not throw.
+         */
+        void schedule(const std::vector<uint64_t>& keys, const Task& task);
+
+        /** Waits until every scheduled task has completed. */
+        void drain();
+
+        /** Drains the pool and stops and joins all worker threads. */
+        void shutdown();
+
+        uint32_t numWorkers() const { return _workerStats.size(); }
+
+        /** Appends per-worker throughput, one object per worker. */
+        void appendStats(BSONArrayBuilder& b) const;
+
+    private:
+        struct QueuedTask {
+            std::vector<uint64_t> keys;
+            Task task;
+        };
+
+        struct WorkerStats {
+            Counter64 ops;
+            TimerStats apply;
+        };
+
+        bool conflictsWithInFlight(const std::vector<uint64_t>& keys) const;
+        void workerThread(uint32_t id);
+
+        boost::mutex _mutex;
+        // signaled when the queue gets a task or the pool is shutting down
+        boost::condition_variable _workAvailable;
+        // signaled whenever a task completes
+        boost::condition_variable _taskDone;
+
+        std::deque<QueuedTask> _queue;
+        // number of queued or running tasks holding each key
+        std::map<uint64_t, uint32_t> _inFlightKeys;
+        uint32_t _numInFlight;
+        bool _shutdown;
+
+        std::vector<boost::thread*> _threads;
+        std::vector<WorkerStats*> _workerStats;
+    };
+
+} // namespace mongo
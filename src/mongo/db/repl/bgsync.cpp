@@ -23,7 +23,9 @@
 #include "mongo/db/crash.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/base/counter.h"
+#include "mongo/db/stats/latency_stats.h"
 #include "mongo/db/stats/timer_stats.h"
 
 namespace mongo {
@@ -64,10 +66,32 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> displayOpsApplied( "repl.apply.ops",
                                                                 &opsAppliedStats );
 
+    // Number of threads applying non-conflicting transactions in parallel on a
+    // secondary. With 1, transactions are applied one at a time by the applier.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replApplierThreads, uint32_t, 8);
+
+    // Per-worker throughput of the parallel applier
+    class ApplierWorkersMetric : public ServerStatusMetric {
+    public:
+        ApplierWorkersMetric() : ServerStatusMetric("repl.apply.workers") {}
+        virtual void appendAtLeaf(BSONObjBuilder& b) const {
+            BSONArrayBuilder ab(b.subarrayStart(_leafName));
+            // don't create the BackgroundSync if we aren't replicating
+            if (theReplSet) {
+                BackgroundSync* sync = BackgroundSync::get();
+                if (sync != NULL) {
+                    sync->appendApplierWorkerStats(ab);
+                }
+            }
+            ab.done();
+        }
+    } applierWorkersMetric;
+
     BackgroundSync::BackgroundSync() : _opSyncShouldRun(false),
                                             _opSyncRunning(false),
                                             _seqCounter(0),
                                             _currentSyncTarget(NULL),
+                                            _numApplying(0),
                                             _opSyncShouldExit(false),
                                             _opSyncInProgress(false),
                                             _applierShouldExit(false),
@@ -131,7 +155,16 @@ namespace mongo {
         // as it must finish work that it starts
         // done for github issues #770 and #771
         cc().setGloballyUninterruptible(true);
+        if (replApplierThreads > 1 && !_applierPool) {
+            // serverStatus reads _applierPool under _mutex, this thread is
+            // the only one that sets it
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _applierPool.reset(new ReplApplierPool(replApplierThreads));
+        }
         applyOpsFromOplog();
+        if (_applierPool) {
+            _applierPool->shutdown();
+        }
         cc().shutdown();
         {
             boost::unique_lock<boost::mutex> lock(_mutex);
@@ -139,9 +172,49 @@ namespace mongo {
         }
     }
 
+    void BackgroundSync::applyEntry(const BSONObj& entry) {
+        GTID currEntry = getGTIDFromOplogEntry(entry);
+        // we must do applyTransactionFromOplog in a loop
+        // because once we have called noteApplyingGTID, we must
+        // continue until we are successful in applying the transaction.
+        bool applied = false;
+        uint32_t numTries = 0;
+        while (!applied) {
+            try {
+                numTries++;
+                TimerHolder timer(&applyBatchStats);
+                Timer t;
+                applyTransactionFromOplog(entry, NULL, false);
+                LatencyStats::oplogApply.record(t.micros());
+                opsAppliedStats.increment();
+                applied = true;
+            }
+            catch (std::exception &e) {
+                log() << "exception during applying transaction from oplog: " << e.what() << endl;
+                log() << "oplog entry: " << entry.str() << endl;
+                if (numTries > 100) {
+                    // something is really wrong if we fail 100 times, let's abort
+                    dumpCrashInfo("100 errors applying oplog entry");
+                    ::abort();
+                }
+                sleepsecs(1);
+            }
+        }
+        LOG(3) << "applied " << entry.toString(false, true) << endl;
+        theReplSet->gtidManager->noteGTIDApplied(currEntry);
+
+        boost::unique_lock<boost::mutex> lck(_mutex);
+        dassert(_numApplying > 0);
+        _numApplying--;
+        bufferCountGauge.increment(-1);
+        bufferSizeGauge.increment(-entry.objsize());
+        if (!applierBusy()) {
+            _queueDone.notify_all();
+        }
+    }
+
     void BackgroundSync::applyOpsFromOplog() {
-        GTID lastLiveGTID;
-        GTID lastUnappliedGTID;
+        std::vector<uint64_t> conflictKeys;
         while (1) {
             try {
                 BSONObj curr;
@@ -149,50 +222,18 @@ namespace mongo {
                     boost::unique_lock<boost::mutex> lck(_mutex);
                     // wait until we know an item has been produced
                     while (_deque.size() == 0 && !_applierShouldExit) {
-                        _queueDone.notify_all();
+                        if (!applierBusy()) {
+                            _queueDone.notify_all();
+                        }
                         _queueCond.wait(lck);
                     }
                     if (_deque.size() == 0 && _applierShouldExit) {
                         return; 
                     }
                     curr = _deque.front();
-                }
-                GTID currEntry = getGTIDFromOplogEntry(curr);
-                theReplSet->gtidManager->noteApplyingGTID(currEntry);
-                // we must do applyTransactionFromOplog in a loop
-                // because once we have called noteApplyingGTID, we must
-                // continue until we are successful in applying the transaction.
-                bool applied = false;
-                uint32_t numTries = 0;
-                while (!applied) {
-                    try {
-                        numTries++;
-                        TimerHolder timer(&applyBatchStats);
-                        applyTransactionFromOplog(curr, NULL, false);
-                        opsAppliedStats.increment();
-                        applied = true;
-                    }
-                    catch (std::exception &e) {
-                        log() << "exception during applying transaction from oplog: " << e.what() << endl;
-                        log() << "oplog entry: " << curr.str() << endl;
-                        if (numTries > 100) {
-                            // something is really wrong if we fail 100 times, let's abort
-                            dumpCrashInfo("100 errors applying oplog entry");
-                            ::abort();
-                        }
-                        sleepsecs(1);
-                    }
-                }
-                LOG(3) << "applied " << curr.toString(false, true) << endl;
-                theReplSet->gtidManager->noteGTIDApplied(currEntry);
-
-                {
-                    boost::unique_lock<boost::mutex> lck(_mutex);
-                    dassert(_deque.size() > 0);
                     _deque.pop_front();
-                    bufferCountGauge.increment(-1);
-                    bufferSizeGauge.increment(-curr.objsize());
-                    
+                    _numApplying++;
+
                     // this is a flow control mechanism, with bad numbers
                     // hard coded for now just to get something going.
                     // If the opSync thread notices that we have over 20000
@@ -204,6 +245,24 @@ namespace mongo {
                         _queueCond.notify_all();
                     }
                 }
+
+                // Transactions that touch disjoint rows go to the worker
+                // pool. Anything else is applied here, once everything
+                // before it has been applied.
+                const bool parallel = _applierPool && getTxnConflictKeys(curr, &conflictKeys);
+                if (_applierPool && !parallel) {
+                    _applierPool->drain();
+                }
+                // GTIDs must be noted as applying in order, so this is
+                // always done here rather than in the workers.
+                theReplSet->gtidManager->noteApplyingGTID(getGTIDFromOplogEntry(curr));
+                if (parallel) {
+                    _applierPool->schedule(conflictKeys,
+                                           boost::bind(&BackgroundSync::applyEntry, this, curr));
+                }
+                else {
+                    applyEntry(curr);
+                }
             }
             catch (DBException& e) {
                 sethbmsg(str::stream() << "db exception in producer on applier thread: " << e.toString());
@@ -215,6 +274,13 @@ namespace mongo {
             }
         }
     }
+
+    void BackgroundSync::appendApplierWorkerStats(BSONArrayBuilder& b) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        if (_applierPool) {
+            _applierPool->appendStats(b);
+        }
+    }
     
     void BackgroundSync::producerThread() {
         {
@@ -507,7 +573,7 @@ namespace mongo {
                             // if we have a large transaction, we don't want
                             // to let it pile up. We want to process it immedietely
                             // before processing anything else.
-                            while (_deque.size() > 0) {
+                            while (applierBusy()) {
                                 _queueDone.wait(lock);
                             }
                         }
@@ -589,7 +655,7 @@ namespace mongo {
         if (!_applierInProgress) {
             return;
         }
-        verify(_deque.size() == 0);
+        verify(!applierBusy());
         // do a sanity check on the GTID Manager
         GTID lastLiveGTID;
         GTID lastUnappliedGTID;
@@ -625,7 +691,7 @@ namespace mongo {
         verify(!_opSyncShouldRun);
 
         // wait for all things to be applied
-        while (_deque.size() > 0) {
+        while (applierBusy()) {
             _queueDone.wait(lock);
         }
 
@@ -17,10 +17,12 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "mongo/util/queue.h"
 #include "mongo/db/oplogreader.h"
+#include "mongo/db/repl/applier_pool.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/jsobj.h"
 
@@ -75,6 +77,16 @@ namespace mongo {
         // to _queueCounter.numElems
         std::deque<BSONObj> _deque;
 
+        // number of transactions taken off of _deque by the applier
+        // thread that have not yet finished being applied
+        uint32_t _numApplying;
+
+        // workers that apply non-conflicting transactions in parallel,
+        // NULL if transactions are applied serially by the applier thread.
+        // Created once by the applier thread, under _mutex, and never
+        // destroyed, so serverStatus can read its counters under _mutex.
+        boost::scoped_ptr<ReplApplierPool> _applierPool;
+
         // these variables are relevant to shutdown
 
         // states if opSync should exit, because we are shutting down
@@ -112,6 +124,15 @@ namespace mongo {
         bool shouldChangeSyncTarget();
 
         bool hasCursor();
+        // true if there are transactions either waiting in _deque or
+        // still being applied. Called with _mutex held.
+        bool applierBusy() const {
+            return _deque.size() > 0 || _numApplying > 0;
+        }
+        // applies one transaction, retrying until it succeeds, and does
+        // the bookkeeping for it being done. Runs on the applier thread or
+        // on one of the _applierPool workers.
+        void applyEntry(const BSONObj& entry);
         // name has "ForRollback" appended to it to as a reminder
         // that rollback is the only place that should be calling
         // this function. As of now, there is no other place that should
@@ -133,6 +154,7 @@ namespace mongo {
 
         // For monitoring
         BSONObj getCounters();
+        void appendApplierWorkerStats(BSONArrayBuilder& b);
 
         // for when we are assuming a primary
         // or we are going  into maintenance mode or we are blocking sync
@@ -29,6 +29,7 @@
 #include "connections.h"
 #include "mongo/util/startup_test.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/initial_sync_cloner.h"
 
 namespace mongo {
     /* decls for connections.h */
@@ -488,6 +489,7 @@ namespace mongo {
             b.append("syncingTo", syncTarget->fullName());
         }
         b.append("members", v);
+        appendInitialSyncCloneStatus(b);
         if( replSetBlind )
             b.append("blind",true); // to avoid confusion if set...normally never set except for testing.
     }
@@ -0,0 +1,605 @@
+/**
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/initial_sync_cloner.h"
+
+#include <algorithm>
+#include <set>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_manager.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/client.h"
+#include "mongo/db/clientcursor.h"
+#include "mongo/db/cloner.h"
+#include "mongo/db/collection.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/ops/insert.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    // Number of collections an initial sync copies at once, each over its own connection.
+    // With 0, databases are cloned one at a time over a single connection.
+    MONGO_EXPORT_SERVER_PARAMETER(replInitialSyncCloneThreads, int, 4);
+
+    /**
+     * Internal, for initial sync.  Hands out one cursor for each collection an initial sync
+     * copies, all reading the same snapshot, with what is needed to create the collection:
+     *
+     *   { replSetInitialSyncSnapshot: 1, namespaces: [ "local.oplog.rs", ... ] }
+     *   -> { collections: [ { ns, options, indexes, partitions, size, cursor }, ... ] }
+     *
+     * Covers every collection the cloner would copy outside the local database, plus the
+     * local namespaces asked for.  The cursors time out like any other, the syncing member
+     * keeps the ones it hasn't read yet alive with
+     *
+     *   { replSetInitialSyncSnapshot: 1, keepAlive: [ cursor ids ] }
+     */
+    class CmdReplSetInitialSyncSnapshot : public ReplSetCommand {
+        struct Snapshot {
+            vector<BSONObj> collections;
+            vector<CursorId> cursors;
+        };
+
+        // Same rules as Cloner::go: system.users and system.js are the only system
+        // collections copied, and nothing with a $ in its name.
+        static bool shouldCopy(const StringData &ns) {
+            if (NamespaceString::isSystem(ns) && legalClientSystemNS(ns, true) == 0) {
+                return false;
+            }
+            return NamespaceString::normal(ns);
+        }
+
+        static void addCollection(const string &ns, const BSONObj &options, Snapshot &snapshot) {
+            Collection *cl = getCollection(ns);
+            if (cl == NULL) {
+                return;
+            }
+
+            BSONObjBuilder b;
+            b.append("ns", ns);
+            b.append("options", options);
+            BSONArrayBuilder indexes(b.subarrayStart("indexes"));
+            for (int i = 0; i < cl->nIndexes(); i++) {
+                indexes.append(cl->idx(i).info());
+            }
+            indexes.done();
+            if (cl->isPartitioned()) {
+                uint64_t numPartitions = 0;
+                BSONArray partitions;
+                cl->as<PartitionedCollection>()->getPartitionInfo(&numPartitions, &partitions);
+                b.append("partitions", partitions);
+            }
+            DB_BTREE_STAT64 st;
+            cl->getPKIndex().getStat64(&st);
+            b.append("size", (long long) st.bt_dsize);
+
+            // Like a saved query, the cursor keeps its own snapshot transaction.  They are all
+            // begun while nothing can commit, so they all see the same data.
+            Client::AlternateTransactionStack ats;
+            Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+            ClientCursor::Holder ccPointer(new ClientCursor(QueryOption_AddHiddenPK, Cursor::make(cl), ns));
+            b.append("cursor", ccPointer->cursorid());
+            snapshot.cursors.push_back(ccPointer->cursorid());
+            cc().swapTransactionStack(ccPointer->transactions);
+            ccPointer.release();
+
+            snapshot.collections.push_back(b.obj());
+        }
+
+        static void takeSnapshot(const set<string> &localNamespaces, Snapshot &snapshot) {
+            Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+            vector<string> dbs;
+            getDatabaseNames(dbs);
+            for (vector<string>::const_iterator it = dbs.begin(); it != dbs.end(); ++it) {
+                const string &db = *it;
+                const bool local = db == "local";
+                if (local && localNamespaces.empty()) {
+                    continue;
+                }
+
+                Client::Context ctx(db);
+                Collection *catalog = getCollection(getSisterNS(db, "system.namespaces"));
+                if (catalog == NULL) {
+                    continue;
+                }
+                vector< pair<string, BSONObj> > toCopy;
+                for (shared_ptr<Cursor> c = Cursor::make(catalog); c->ok(); c->advance()) {
+                    const BSONObj entry = c->current();
+                    const string ns = entry["name"].String();
+                    if (local ? localNamespaces.count(ns) > 0 : shouldCopy(ns)) {
+                        toCopy.push_back(make_pair(ns, entry.getObjectField("options").getOwned()));
+                    }
+                }
+                for (vector< pair<string, BSONObj> >::const_iterator i = toCopy.begin(); i != toCopy.end(); ++i) {
+                    addCollection(i->first, i->second, snapshot);
+                }
+            }
+            txn.commit();
+        }
+
+        static void eraseCursors(const vector<CursorId> &cursors) {
+            for (vector<CursorId>::const_iterator it = cursors.begin(); it != cursors.end(); ++it) {
+                ClientCursor::erase(*it);
+            }
+        }
+
+    public:
+        CmdReplSetInitialSyncSnapshot() : ReplSetCommand("replSetInitialSyncSnapshot") { }
+        virtual bool canRunInMultiStmtTxn() const { return false; }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::replSetInitialSyncSnapshot);
+            out->push_back(Privilege(AuthorizationManager::SERVER_RESOURCE_NAME, actions));
+        }
+        virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            if( !check(errmsg, result) )
+                return false;
+
+            if (cmdObj["keepAlive"].type() == Array) {
+                long long found = 0;
+                BSONForEach(e, cmdObj["keepAlive"].Obj()) {
+                    if (ClientCursor::touch(e.numberLong())) {
+                        found++;
+                    }
+                }
+                result.append("found", found);
+                return true;
+            }
+
+            set<string> localNamespaces;
+            if (cmdObj["namespaces"].type() == Array) {
+                BSONForEach(e, cmdObj["namespaces"].Obj()) {
+                    uassert(17400, "namespaces must be strings naming collections in the local database",
+                            e.type() == String && nsToDatabaseSubstring(e.Stringdata()) == "local");
+                    localNamespaces.insert(e.String());
+                }
+            }
+
+            Snapshot snapshot;
+            try {
+                theReplSet->runWithCommitsBlocked(boost::bind(&takeSnapshot, boost::cref(localNamespaces), boost::ref(snapshot)));
+            }
+            catch (...) {
+                eraseCursors(snapshot.cursors);
+                throw;
+            }
+
+            int size = 0;
+            for (vector<BSONObj>::const_iterator it = snapshot.collections.begin(); it != snapshot.collections.end(); ++it) {
+                size += it->objsize();
+            }
+            if (size > BSONObjMaxUserSize / 2) {
+                eraseCursors(snapshot.cursors);
+                errmsg = "too many collections to describe in one reply";
+                return false;
+            }
+            result.append("collections", snapshot.collections);
+            return true;
+        }
+    } cmdReplSetInitialSyncSnapshot;
+
+    namespace {
+
+        /** What replSetGetStatus shows about a parallel initial sync. */
+        class InitialSyncProgress : boost::noncopyable {
+            struct Entry {
+                string ns;
+                bool bulkLoad;
+                long long totalBytes;
+                long long docs;
+                long long bytes;
+                long long startMillis;
+                long long endMillis; // 0 until the collection is copied
+            };
+
+            mutable boost::mutex _mutex;
+            bool _active;
+            string _source;
+            size_t _numCollections;
+            long long _totalBytes;
+            long long _startMillis;
+            vector<Entry> _started;
+
+          public:
+            InitialSyncProgress() : _active(false), _numCollections(0), _totalBytes(0), _startMillis(0) {}
+
+            void begin(const string &source, size_t numCollections, long long totalBytes) {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                _active = true;
+                _source = source;
+                _numCollections = numCollections;
+                _totalBytes = totalBytes;
+                _startMillis = curTimeMillis64();
+                _started.clear();
+            }
+
+            void end() {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                _active = false;
+                _started.clear();
+            }
+
+            /** @return a handle for the other calls about this collection */
+            size_t startCollection(const string &ns, bool bulkLoad, long long totalBytes) {
+                Entry e;
+                e.ns = ns;
+                e.bulkLoad = bulkLoad;
+                e.totalBytes = totalBytes;
+                e.docs = 0;
+                e.bytes = 0;
+                e.startMillis = curTimeMillis64();
+                e.endMillis = 0;
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                _started.push_back(e);
+                return _started.size() - 1;
+            }
+
+            void noteBatch(size_t i, long long docs, long long bytes) {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                _started[i].docs += docs;
+                _started[i].bytes += bytes;
+            }
+
+            void finishCollection(size_t i) {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                _started[i].endMillis = curTimeMillis64();
+            }
+
+            void append(BSONObjBuilder &b) const {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                if (!_active) {
+                    return;
+                }
+                const long long now = curTimeMillis64();
+                long long bytesCopied = 0;
+                int collectionsCopied = 0;
+                BSONObjBuilder sb(b.subobjStart("initialSync"));
+                sb.append("source", _source);
+                BSONArrayBuilder ab(sb.subarrayStart("progress"));
+                for (vector<Entry>::const_iterator it = _started.begin(); it != _started.end(); ++it) {
+                    const long long millis = (it->endMillis ? it->endMillis : now) - it->startMillis;
+                    BSONObjBuilder eb(ab.subobjStart());
+                    eb.append("ns", it->ns);
+                    eb.append("bulkLoad", it->bulkLoad);
+                    eb.append("done", it->endMillis != 0);
+                    eb.append("docs", it->docs);
+                    eb.append("bytes", it->bytes);
+                    eb.append("totalBytes", it->totalBytes);
+                    eb.append("secs", millis / 1000);
+                    eb.append("bytesPerSec", millis > 0 ? it->bytes * 1000 / millis : 0);
+                    eb.done();
+                    bytesCopied += it->bytes;
+                    if (it->endMillis) {
+                        collectionsCopied++;
+                    }
+                }
+                ab.done();
+                sb.append("collections", (long long) _numCollections);
+                sb.append("collectionsCopied", collectionsCopied);
+                sb.append("bytesCopied", bytesCopied);
+                sb.append("totalBytes", _totalBytes);
+                sb.append("secs", (now - _startMillis) / 1000);
+                sb.done();
+            }
+        } initialSyncProgress;
+
+        bool canBulkLoad(const StringData &ns, const BSONObj &options) {
+            return nsToDatabaseSubstring(ns) != "local" &&
+                    !NamespaceString::isSystem(ns) &&
+                    !options["capped"].trueValue() &&
+                    !options["natural"].trueValue() &&
+                    !options["partitioned"].trueValue();
+        }
+
+        // Inserts what's left of the cursor into ns, one batch per lock.
+        void copyDocuments(DBClientCursor &cursor, const string &ns, bool isCapped, size_t progress) {
+            vector<BSONObj> batch;
+            while (cursor.more()) {
+                long long bytes = 0;
+                batch.clear();
+                while (cursor.moreInCurrentBatch()) {
+                    BSONObj obj = cursor.nextSafe();
+                    bytes += obj.objsize();
+                    batch.push_back(obj);
+                }
+                {
+                    LOCK_REASON(lockReason, "repl: initial sync copying documents");
+                    Client::ReadContext ctx(ns, lockReason);
+                    if (isCapped) {
+                        for (vector<BSONObj>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                            insertClonedCappedObject(ns, *it);
+                        }
+                    }
+                    else {
+                        insertObjects(ns.c_str(), batch, false, 0, false);
+                    }
+                }
+                initialSyncProgress.noteBatch(progress, batch.size(), bytes);
+            }
+        }
+
+        // Creates and fills the collection described by entry (see CmdReplSetInitialSyncSnapshot)
+        // under the current transaction.
+        void copyCollection(DBClientConnection &conn, const BSONObj &entry, bool copyIndexes) {
+            const string ns = entry["ns"].String();
+            const BSONObj options = entry["options"].Obj();
+            vector<BSONObj> indexes;
+            if (copyIndexes) {
+                BSONForEach(e, entry["indexes"].Obj()) {
+                    const BSONObj info = e.Obj();
+                    // the _id index comes with the collection
+                    if (info["name"].str() != "_id_") {
+                        indexes.push_back(fixindex(info, nsToDatabase(ns)));
+                    }
+                }
+            }
+
+            const bool bulkLoad = canBulkLoad(ns, options);
+            LOG(1) << "replSet initial sync copying " << ns << (bulkLoad ? " with the loader" : "") << rsLog;
+            const size_t progress = initialSyncProgress.startCollection(ns, bulkLoad, entry["size"].numberLong());
+            DBClientCursor cursor(&conn, ns, entry["cursor"].numberLong(), 0, 0);
+
+            if (bulkLoad) {
+                cc().beginClientLoad(ns, indexes, options);
+                try {
+                    copyDocuments(cursor, ns, false, progress);
+                    cc().commitClientLoad();
+                }
+                catch (...) {
+                    if (cc().loadInProgress()) {
+                        cc().abortClientLoad();
+                    }
+                    throw;
+                }
+            }
+            else {
+                {
+                    LOCK_REASON(lockReason, "repl: initial sync creating collection");
+                    Client::WriteContext ctx(ns, lockReason);
+                    string err;
+                    userCreateNS(ns, options, err, false);
+                    if (entry["partitions"].type() == Array) {
+                        Collection *cl = getCollection(ns);
+                        massert(17402, "Could not get collection we just created", cl);
+                        cl->as<PartitionedCollection>()->addClonedPartitionInfo(entry["partitions"].Array());
+                    }
+                }
+                copyDocuments(cursor, ns, options["capped"].trueValue(), progress);
+
+                const string indexesNs = getSisterNS(ns, "system.indexes");
+                for (vector<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+                    LOCK_REASON(lockReason, "repl: initial sync creating indexes");
+                    Client::WriteContext ctx(ns, lockReason);
+                    insertObject(indexesNs.c_str(), *it, 0, false);
+                }
+            }
+
+            initialSyncProgress.finishCollection(progress);
+        }
+
+        bool biggerFirst(const BSONObj &a, const BSONObj &b) {
+            return a["size"].numberLong() > b["size"].numberLong();
+        }
+
+        /**
+         * Worker threads that copy collections, each in its own transaction over its own
+         * connection, while the thread that started them keeps the source's cursors alive.
+         */
+        class ParallelCloner : boost::noncopyable {
+            // well under the source's cursor timeout
+            static const int keepAliveSecs = 60;
+
+            const string _source;
+            const vector<BSONObj> &_collections;
+            const bool _buildIndexes;
+
+            boost::mutex _mutex;
+            boost::condition_variable _workerDone;
+            size_t _next;
+            int _running;
+            string _error;
+            // cursors on the source that haven't been read to the end
+            set<CursorId> _unread;
+
+            bool nextCollection(BSONObj &entry) {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                if (!_error.empty() || _next == _collections.size()) {
+                    return false;
+                }
+                entry = _collections[_next++];
+                return true;
+            }
+
+            void workerThread(int id) {
+                const string threadName = str::stream() << "rsInitialSyncClone " << id;
+                Client::initThread(threadName.c_str());
+                replLocalAuth();
+                try {
+                    string errmsg;
+                    shared_ptr<DBClientConnection> conn = makeConnection(_source.c_str(), errmsg);
+                    uassert(17401, str::stream() << "initial sync couldn't connect to " << _source << ": " << errmsg,
+                            conn);
+                    BSONObj entry;
+                    while (nextCollection(entry)) {
+                        Client::Transaction txn(DB_SERIALIZABLE);
+                        copyCollection(*conn, entry, _buildIndexes);
+                        txn.commit();
+
+                        boost::unique_lock<boost::mutex> lk(_mutex);
+                        _unread.erase(entry["cursor"].numberLong());
+                    }
+                }
+                catch (std::exception &e) {
+                    log() << "replSet initial sync worker " << id << " failed: " << e.what() << rsLog;
+                    boost::unique_lock<boost::mutex> lk(_mutex);
+                    if (_error.empty()) {
+                        _error = e.what();
+                    }
+                }
+                {
+                    boost::unique_lock<boost::mutex> lk(_mutex);
+                    _running--;
+                    _workerDone.notify_all();
+                }
+                cc().shutdown();
+            }
+
+            void keepAlive(DBClientConnection &conn, const vector<CursorId> &cursors) {
+                BSONObj res;
+                try {
+                    if (!conn.runCommand("admin", BSON("replSetInitialSyncSnapshot" << 1 << "keepAlive" << cursors), res)) {
+                        warning() << "replSet initial sync couldn't keep cursors alive: " << res << rsLog;
+                    }
+                }
+                catch (DBException &e) {
+                    warning() << "replSet initial sync couldn't keep cursors alive: " << e.what() << rsLog;
+                }
+            }
+
+          public:
+            ParallelCloner(const string &source, const vector<BSONObj> &collections, bool buildIndexes) :
+                _source(source), _collections(collections), _buildIndexes(buildIndexes),
+                _next(0), _running(0) {
+            }
+
+            /**
+             * Copies all the collections with up to nThreads threads.  Also keeps the cursors
+             * in others alive until then.  Throws if a collection fails to copy.
+             */
+            void run(DBClientConnection &conn, int nThreads, const vector<BSONObj> &others) {
+                for (vector<BSONObj>::const_iterator it = _collections.begin(); it != _collections.end(); ++it) {
+                    _unread.insert((*it)["cursor"].numberLong());
+                }
+                for (vector<BSONObj>::const_iterator it = others.begin(); it != others.end(); ++it) {
+                    _unread.insert((*it)["cursor"].numberLong());
+                }
+
+                boost::thread_group threads;
+                nThreads = std::min(nThreads, (int) _collections.size());
+                {
+                    boost::unique_lock<boost::mutex> lk(_mutex);
+                    _running = nThreads;
+                }
+                for (int i = 0; i < nThreads; i++) {
+                    threads.create_thread(boost::bind(&ParallelCloner::workerThread, this, i));
+                }
+
+                {
+                    boost::unique_lock<boost::mutex> lk(_mutex);
+                    while (_running > 0) {
+                        if (!_workerDone.timed_wait(lk, boost::posix_time::seconds(keepAliveSecs))) {
+                            const vector<CursorId> cursors(_unread.begin(), _unread.end());
+                            lk.unlock();
+                            keepAlive(conn, cursors);
+                            lk.lock();
+                        }
+                    }
+                }
+                threads.join_all();
+
+                if (!_error.empty()) {
+                    // don't leave the source holding snapshots until the cursors time out
+                    for (set<CursorId>::const_iterator it = _unread.begin(); it != _unread.end(); ++it) {
+                        try {
+                            conn.killCursor(*it);
+                        }
+                        catch (DBException &e) {
+                            break;
+                        }
+                    }
+                    uasserted(17403, str::stream() << "initial sync failed to copy a collection: " << _error);
+                }
+            }
+        };
+
+    } // namespace
+
+    bool parallelInitialSyncClone(const string &source, DBClientConnection &conn,
+                                  const vector<string> &localNamespaces,
+                                  bool buildIndexes) {
+        const int nThreads = replInitialSyncCloneThreads;
+        if (nThreads <= 0) {
+            return false;
+        }
+
+        BSONObj res;
+        if (!conn.runCommand("admin", BSON("replSetInitialSyncSnapshot" << 1 << "namespaces" << localNamespaces), res)) {
+            log() << "replSet initial sync source can't hand out a snapshot, cloning one database at a time: "
+                  << res << rsLog;
+            return false;
+        }
+
+        vector<BSONObj> collections;
+        vector<BSONObj> local;
+        long long totalBytes = 0;
+        BSONForEach(e, res["collections"].Obj()) {
+            const BSONObj entry = e.Obj();
+            if (nsToDatabaseSubstring(entry["ns"].Stringdata()) == "local") {
+                local.push_back(entry);
+            }
+            else {
+                collections.push_back(entry);
+            }
+            totalBytes += entry["size"].numberLong();
+        }
+        std::sort(collections.begin(), collections.end(), biggerFirst);
+
+        log() << "replSet initial sync copying " << collections.size() << " collections with up to "
+              << nThreads << " threads" << rsLog;
+        initialSyncProgress.begin(source, collections.size() + local.size(), totalBytes);
+        try {
+            ParallelCloner cloner(source, collections, buildIndexes);
+            cloner.run(conn, nThreads, local);
+
+            // Like the serial path, the replication state goes in all at once, and only after
+            // everything else is in.
+            LOCK_REASON(lockReason, "repl: initial sync copying replication state");
+            Lock::GlobalWrite lk(lockReason);
+            Client::Transaction txn(DB_SERIALIZABLE);
+            for (vector<BSONObj>::const_iterator it = local.begin(); it != local.end(); ++it) {
+                copyCollection(conn, *it, true);
+            }
+            txn.commit(0);
+        }
+        catch (...) {
+            initialSyncProgress.end();
+            throw;
+        }
+        initialSyncProgress.end();
+        return true;
+    }
+
+    void appendInitialSyncCloneStatus(BSONObjBuilder &b) {
+        initialSyncProgress.append(b);
+    }
+
+} // namespace mongo
@@ -0,0 +1,54 @@
+/**
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class DBClientConnection;
+
+    /**
+     * Copies everything an initial sync needs from source, several collections at a time.
+     *
+     * The source hands out, through replSetInitialSyncSnapshot, one cursor per collection
+     * along with the collection's options, indexes and partitions.  It begins all of them
+     * while no transaction can commit, so they read the same data the single "mvcc"
+     * transaction of the serial cloner would have.  replInitialSyncCloneThreads worker
+     * threads, each with its own connection, drain the cursors, biggest collection first.
+     *
+     * Collections that can be bulk loaded (anything but capped, natural order, partitioned
+     * and system collections) are built with the loader, which builds the primary key and
+     * every secondary index in one pass.  The others are inserted a batch at a time and get
+     * their indexes afterwards, as in the cloner.  The localNamespaces are copied last, in
+     * one transaction, once all the data is in.
+     *
+     * @return false, having copied nothing, if replInitialSyncCloneThreads is 0 or the
+     *         source can't hand out a snapshot, in which case the caller should clone
+     *         serially.  Throws if a collection fails to copy.
+     */
+    bool parallelInitialSyncClone(const std::string &source, DBClientConnection &conn,
+                                  const std::vector<std::string> &localNamespaces,
+                                  bool buildIndexes);
+
+    /** Appends the progress of the parallel initial sync in progress, if any, for replSetGetStatus. */
+    void appendInitialSyncCloneStatus(BSONObjBuilder &b);
+
+} // namespace mongo
@@ -207,6 +207,36 @@ namespace mongo {
         return _maintenanceMode > 0;
     }
 
+    void ReplSetImpl::runWithCommitsBlocked(const boost::function<void ()> &f) {
+        boost::unique_lock<boost::mutex> lock(stateChangeMutex);
+        bool wasSecondary;
+        {
+            RSBase::lock lk(this);
+            wasSecondary = box.getState().secondary();
+        }
+        // a secondary's producer and applier commit without holding any lock
+        if (wasSecondary) {
+            stopReplication();
+        }
+        try {
+            // no multi-statement transaction can commit
+            RWLockRecursive::Exclusive e(operationLock);
+            // and no write can be in progress
+            LOCK_REASON(lockReason, "repl: blocking commits");
+            Lock::GlobalWrite lk(lockReason);
+            f();
+        }
+        catch (...) {
+            if (wasSecondary) {
+                startReplication();
+            }
+            throw;
+        }
+        if (wasSecondary) {
+            startReplication();
+        }
+    }
+
     Member* ReplSetImpl::getMostElectable() {
         lock lk(this);
 
@@ -554,6 +554,12 @@ namespace mongo {
          */
         bool setMaintenanceMode(const bool inc, string& errmsg);
         bool inMaintenanceMode();
+        /**
+         * Runs f while no transaction can commit on this member, so every snapshot
+         * transaction f begins sees the same data.  A secondary stops applying the
+         * oplog for the duration.
+         */
+        void runWithCommitsBlocked(const boost::function<void ()> &f);
         // Records a new slave's id in the GhostSlave map, at handshake time.
         void registerSlave(const BSONObj& rid, const int memberId);
     private:
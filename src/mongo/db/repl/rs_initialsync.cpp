@@ -29,6 +29,7 @@
 #include "mongo/db/collection.h"
 #include "mongo/db/repl.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/initial_sync_cloner.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_optime.h"
 #include "mongo/db/repl/rs_sync.h"
@@ -452,73 +453,79 @@ namespace mongo {
                 sethbmsg("initial sync clone all databases", 0);
             
                 shared_ptr<DBClientConnection> conn(r.conn_shared());
-                RemoteTransaction rtxn(*conn, "mvcc");
-
-                list<string> dbs = conn->getDatabaseNamesForRepl();
-
-                //
-                // Not sure if it is necessary to have a separate fileOps 
-                // transaction and clone transaction. The cloneTransaction
-                // has a higher chance of failing, and I don't know at the moment
-                // if it is ok to do fileops successfully, and then an operation (cloning) that
-                // later causes an abort. So, to be cautious, they are separate
-
-                {
-                    LOCK_REASON(lockReason, "repl: initial sync");
-                    Lock::GlobalWrite lk(lockReason);
-                    Client::Transaction cloneTransaction(DB_SERIALIZABLE);
-                    bool ret = _syncDoInitialSync_clone(sourceHostname.c_str(), dbs, conn);
-
-                    if (!ret) {
-                        veto(source->fullName(), 600);
-                        cloneTransaction.abort();
-                        sleepsecs(300);
-                        return false;
-                    }
-
-                    // at this point, we have copied all of the data from the 
-                    // remote machine. Now we need to copy the replication information
-                    // on the remote machine's local database, we need to copy
-                    // the entire (small) replInfo dictionary, and the necessary portion
-                    // of the oplog
+                vector<string> replNamespaces;
+                replNamespaces.push_back(rsReplInfo);
+                replNamespaces.push_back(rsoplog);
+                replNamespaces.push_back(rsOplogRefs);
+                if (!parallelInitialSyncClone(sourceHostname, *conn, replNamespaces, _buildIndexes)) {
+                    RemoteTransaction rtxn(*conn, "mvcc");
+
+                    list<string> dbs = conn->getDatabaseNamesForRepl();
+
+                    //
+                    // Not sure if it is necessary to have a separate fileOps 
+                    // transaction and clone transaction. The cloneTransaction
+                    // has a higher chance of failing, and I don't know at the moment
+                    // if it is ok to do fileops successfully, and then an operation (cloning) that
+                    // later causes an abort. So, to be cautious, they are separate
 
-                    // first copy the replInfo, as we will use its information
-                    // to determine  how much of the opLog to copy
                     {
-                        Client::Context ctx( "local" );
-                        BSONObj q;
-                        cloneCollection(conn,
-                                            "local",
-                                            rsReplInfo,
-                                            q,
-                                            true, //copyIndexes
-                                            false //logForRepl
-                                            );
-
-                        // copy entire oplog (probably overkill)
-                        cloneCollection(conn,
-                                            "local",
-                                            rsoplog,
-                                            q,
-                                            true, //copyIndexes
-                                            false //logForRepl
-                                            );
-
-                        // copy entire oplog.refs (probably overkill)
-                        cloneCollection(conn,
-                                            "local",
-                                            rsOplogRefs,
-                                            q,
-                                            true, //copyIndexes
-                                            false //logForRepl
-                                            );
+                        LOCK_REASON(lockReason, "repl: initial sync");
+                        Lock::GlobalWrite lk(lockReason);
+                        Client::Transaction cloneTransaction(DB_SERIALIZABLE);
+                        bool ret = _syncDoInitialSync_clone(sourceHostname.c_str(), dbs, conn);
+
+                        if (!ret) {
+                            veto(source->fullName(), 600);
+                            cloneTransaction.abort();
+                            sleepsecs(300);
+                            return false;
+                        }
+
+                        // at this point, we have copied all of the data from the 
+                        // remote machine. Now we need to copy the replication information
+                        // on the remote machine's local database, we need to copy
+                        // the entire (small) replInfo dictionary, and the necessary portion
+                        // of the oplog
+
+                        // first copy the replInfo, as we will use its information
+                        // to determine  how much of the opLog to copy
+                        {
+                            Client::Context ctx( "local" );
+                            BSONObj q;
+                            cloneCollection(conn,
+                                                "local",
+                                                rsReplInfo,
+                                                q,
+                                                true, //copyIndexes
+                                                false //logForRepl
+                                                );
+
+                            // copy entire oplog (probably overkill)
+                            cloneCollection(conn,
+                                                "local",
+                                                rsoplog,
+                                                q,
+                                                true, //copyIndexes
+                                                false //logForRepl
+                                                );
+
+                            // copy entire oplog.refs (probably overkill)
+                            cloneCollection(conn,
+                                                "local",
+                                                rsOplogRefs,
+                                                q,
+                                                true, //copyIndexes
+                                                false //logForRepl
+                                                );
+                        }
+                        cloneTransaction.commit(0);
                     }
-                    cloneTransaction.commit(0);
-                }
 
-                bool ok = rtxn.commit();
-                verify(ok);  // absolutely no reason this should fail, it was read only
-                // data should now be consistent
+                    bool ok = rtxn.commit();
+                    verify(ok);  // absolutely no reason this should fail, it was read only
+                    // data should now be consistent
+                }
             }
             catch (DBException &e) {
                 sethbmsg("exception trying to copy data", 0);
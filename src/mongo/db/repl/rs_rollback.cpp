@@ -681,7 +681,7 @@ namespace mongo {
 
     void BackgroundSync::settleApplierForRollback() {
         boost::unique_lock<boost::mutex> lock(_mutex);
-        while (_deque.size() > 0) {
+        while (applierBusy()) {
             log() << "waiting for applier to finish work before doing rollback " << rsLog;
             _queueDone.wait(lock);
         }
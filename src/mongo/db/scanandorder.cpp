@@ -21,15 +21,191 @@
 
 #include "mongo/pch.h"
 #include "mongo/db/scanandorder.h"
+
+#include <queue>
+
+#include "mongo/db/cursor.h"
 #include "mongo/db/matcher.h"
 #include "mongo/db/storage/assert_ids.h"
+#include "mongo/db/storage/spill_file.h"
 #include "mongo/db/parsed_query.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
     const unsigned ScanAndOrder::MaxScanAndOrderBytes = 32 * 1024 * 1024;
 
+    // Sorts that don't fit in MaxScanAndOrderBytes write sorted runs to <tmpDir or dbpath>/_tmp
+    // and merge them, instead of failing.
+    MONGO_EXPORT_SERVER_PARAMETER(scanAndOrderAllowDiskUse, bool, true);
+
+    /**
+     * A spill file of (key, document) pairs in sort order, written once and then read back.
+     */
+    class ScanAndOrder::SortedRun : boost::noncopyable {
+    public:
+        SortedRun() : _file(storage::spillDir(), "sort") {}
+
+        void write(const BSONObj& key, const BSONObj& obj) {
+            _file.write(key);
+            _file.write(obj);
+        }
+
+        void startReading() {
+            _file.startReading();
+        }
+
+        /** @return false at the end of the run. */
+        bool read(BSONObj* key, BSONObj* obj) {
+            return _file.read(key) && _file.read(obj);
+        }
+
+    private:
+        storage::SpillFile _file;
+    };
+
+    /**
+     * k-way merge of spilled runs and the results still in memory, yielding documents in sort
+     * order.  Keys that compare equal come out in the order they were added, as they would from
+     * the in memory multimap.
+     */
+    class ScanAndOrder::RunMerger : boost::noncopyable {
+    public:
+        /**
+         * @param best the results still in memory, which are taken over.
+         * @param remaining the most results to yield.
+         */
+        RunMerger(const BSONObj& order, const vector<SortedRunPtr>& runs, BestMap& best,
+                  int remaining) :
+            _runs(runs),
+            _best(BSONObjCmp(order)),
+            _heap(HeadCmp(order)),
+            _remaining(remaining) {
+            _best.swap(best);
+            _bestIt = _best.begin();
+            for (size_t i = 0; i < _runs.size(); i++) {
+                _runs[i]->startReading();
+                _push(i);
+            }
+            _push(_runs.size());
+        }
+
+        bool more() const { return _remaining > 0 && !_heap.empty(); }
+
+        const BSONObj& current() const {
+            verify(more());
+            return _heap.top().obj;
+        }
+
+        void next() {
+            verify(more());
+            const size_t source = _heap.top().source;
+            _heap.pop();
+            _remaining--;
+            _push(source);
+        }
+
+    private:
+        struct Head {
+            BSONObj key;
+            BSONObj obj;
+            size_t source;
+        };
+
+        /** Orders the heap so that the first key, earliest source breaking ties, is on top. */
+        class HeadCmp {
+        public:
+            HeadCmp(const BSONObj& order) : _order(order) {}
+            bool operator()(const Head& l, const Head& r) const {
+                const int cmp = l.key.woCompare(r.key, _order);
+                return cmp != 0 ? cmp > 0 : l.source > r.source;
+            }
+        private:
+            BSONObj _order;
+        };
+
+        /** Push the next result from source, if it has one.  The last source is _best. */
+        void _push(size_t source) {
+            Head head;
+            head.source = source;
+            if (source < _runs.size()) {
+                if (!_runs[source]->read(&head.key, &head.obj)) {
+                    return;
+                }
+            }
+            else {
+                if (_bestIt == _best.end()) {
+                    return;
+                }
+                head.key = _bestIt->first;
+                head.obj = _bestIt->second;
+                ++_bestIt;
+            }
+            _heap.push(head);
+        }
+
+        vector<SortedRunPtr> _runs;
+        BestMap _best;
+        BestMap::const_iterator _bestIt;
+        std::priority_queue<Head, vector<Head>, HeadCmp> _heap;
+        int _remaining;
+    };
+
+    /**
+     * Returns the results of a spilled sort that didn't fit in the first batch to getMore.  The
+     * documents were matched when they were added, so only a positional projection needs a
+     * matcher, to find its array element again.
+     */
+    class ScanAndOrder::RemainderCursor : public Cursor {
+    public:
+        RemainderCursor(const shared_ptr<RunMerger>& merger, const ParsedQuery* parsedQuery) :
+            _merger(merger) {
+            Projection *projection = parsedQuery ? parsedQuery->getFields() : NULL;
+            if ( projection && projection->getArrayOpType() == Projection::ARRAY_OP_POSITIONAL ) {
+                _arrayMatcher.reset( new Matcher( parsedQuery->getFilter() ) );
+            }
+        }
+        virtual bool ok() { return _merger->more(); }
+        virtual BSONObj current() { return _merger->current(); }
+        virtual bool advance() {
+            _merger->next();
+            return ok();
+        }
+        virtual string toString() const { return "ScanAndOrder"; }
+        virtual bool getsetdup(const BSONObj &pk) { return false; }
+        virtual bool isMultiKey() const { return false; }
+        virtual bool modifiedKeys() const { return false; }
+        virtual long long nscanned() const { return 0; }
+        virtual bool currentMatches( MatchDetails *details = 0 ) {
+            massert( 17421, "positional operator specified, but no array match",
+                     !_arrayMatcher || _arrayMatcher->matches( current(), details ) );
+            return true;
+        }
+
+    private:
+        shared_ptr<RunMerger> _merger;
+        scoped_ptr<Matcher> _arrayMatcher;
+    };
+
+    ScanAndOrder::ScanAndOrder(int startFrom, int limit, const BSONObj &order,
+                               const FieldRangeSet &frs) :
+        _best( BSONObjCmp( order ) ),
+        _startFrom(startFrom), _order(order, frs),
+        _approxSize(0),
+        _peakApproxSize(0),
+        _maxApproxSize(MaxScanAndOrderBytes),
+        _spillingAllowed(false) {
+        _limit = limit > 0 ? limit + _startFrom : 0x7fffffff;
+    }
+
+    ScanAndOrder::~ScanAndOrder() {
+    }
+
+    bool ScanAndOrder::spillingAllowed() const {
+        return _spillingAllowed && scanAndOrderAllowDiskUse;
+    }
+
     void ScanAndOrder::add(const BSONObj& o) {
         verify( o.isValid() );
         BSONObj k;
@@ -59,7 +235,7 @@ namespace mongo {
         _addIfBetter(k, o, i);
     }
 
-    void ScanAndOrder::fill( BufBuilder& b, const ParsedQuery *parsedQuery, int& nout ) const {
+    void ScanAndOrder::fill( BufBuilder& b, const ParsedQuery *parsedQuery, int& nout ) {
         int n = 0;
         int nFilled = 0;
         Projection *projection = parsedQuery ? parsedQuery->getFields() : NULL;
@@ -72,24 +248,60 @@ namespace mongo {
             details.reset( new MatchDetails );
             details->requestElemMatchKey();
         }
-        for ( BestMap::const_iterator i = _best.begin(); i != _best.end(); i++ ) {
+        if ( _runs.empty() ) {
+            for ( BestMap::const_iterator i = _best.begin(); i != _best.end(); i++ ) {
+                n++;
+                if ( n <= _startFrom )
+                    continue;
+                const BSONObj& o = i->second;
+                massert( 16355, "positional operator specified, but no array match",
+                         ! arrayMatcher || arrayMatcher->matches( o, details.get() ) );
+                fillQueryResultFromObj( b, projection, o, details.get() );
+                nFilled++;
+                if ( nFilled >= _limit )
+                    break;
+            }
+            nout = nFilled;
+            return;
+        }
+
+        // Too many results to return at once, so fill the first batch and leave the rest of
+        // the merge to getMore.  Explain only counts them.
+        const bool explain = parsedQuery && parsedQuery->isExplain();
+        const bool firstBatchOnly = parsedQuery && parsedQuery->wantMore() && !explain;
+        _merger.reset( new RunMerger( _order._keyPattern, _runs, _best, _limit ) );
+        for ( ; _merger->more(); _merger->next() ) {
             n++;
             if ( n <= _startFrom )
                 continue;
-            const BSONObj& o = i->second;
-            massert( 16355, "positional operator specified, but no array match",
+            if ( firstBatchOnly && parsedQuery->enoughForFirstBatch( nFilled, b.len() ) )
+                break;
+            nFilled++;
+            if ( explain )
+                continue;
+            const BSONObj& o = _merger->current();
+            massert( 17422, "positional operator specified, but no array match",
                      ! arrayMatcher || arrayMatcher->matches( o, details.get() ) );
             fillQueryResultFromObj( b, projection, o, details.get() );
-            nFilled++;
-            if ( nFilled >= _limit )
-                break;
         }
         nout = nFilled;
     }
 
+    shared_ptr<Cursor> ScanAndOrder::sortedRemainder( const ParsedQuery *parsedQuery ) {
+        if ( !_merger || !_merger->more() ) {
+            return shared_ptr<Cursor>();
+        }
+        return shared_ptr<Cursor>( new RemainderCursor( _merger, parsedQuery ) );
+    }
+
     void ScanAndOrder::_add(const BSONObj& k, const BSONObj& o) {
         BSONObj docToReturn = o;
-        _validateAndUpdateApproxSize( k.objsize() + docToReturn.objsize() );
+        const int approxSizeDelta = k.objsize() + docToReturn.objsize();
+        if ( _approxSize + approxSizeDelta >= _maxApproxSize && !_best.empty() &&
+             spillingAllowed() ) {
+            _spill();
+        }
+        _validateAndUpdateApproxSize( approxSizeDelta );
         _best.insert(make_pair(k.getOwned(),docToReturn.getOwned()));
     }
     
@@ -110,8 +322,21 @@ namespace mongo {
         verify( newApproxSize >= 0 );
         uassert( ScanAndOrderMemoryLimitExceededAssertionCode,
                 "too much data for sort() with no index.  add an index or specify a smaller limit",
-                (unsigned)newApproxSize < MaxScanAndOrderBytes );
+                (unsigned)newApproxSize < _maxApproxSize || spillingAllowed() );
         _approxSize = newApproxSize;
+        _peakApproxSize = std::max( _peakApproxSize, _approxSize );
+    }
+
+    void ScanAndOrder::_spill() {
+        verify( !_best.empty() );
+        SortedRunPtr run( new SortedRun() );
+        for ( BestMap::const_iterator i = _best.begin(); i != _best.end(); i++ ) {
+            run->write( i->first, i->second );
+        }
+        _runs.push_back( run );
+        _best.clear();
+        _approxSize = 0;
+        LOG(1) << "scanAndOrder spilled sorted run " << _runs.size() << " to disk" << endl;
     }
 
 } // namespace mongo
@@ -67,35 +67,62 @@ namespace mongo {
         }
     }
 
+    class Cursor;
+
     typedef multimap<BSONObj,BSONObj,BSONObjCmp> BestMap;
     class ScanAndOrder {
     public:
         static const unsigned MaxScanAndOrderBytes;
 
-        ScanAndOrder(int startFrom, int limit, const BSONObj &order, const FieldRangeSet &frs) :
-            _best( BSONObjCmp( order ) ),
-            _startFrom(startFrom), _order(order, frs) {
-            _limit = limit > 0 ? limit + _startFrom : 0x7fffffff;
-            _approxSize = 0;
-        }
+        ScanAndOrder(int startFrom, int limit, const BSONObj &order, const FieldRangeSet &frs);
+        ~ScanAndOrder();
 
         int size() const { return _best.size(); }
 
+        /**
+         * Let add() write sorted runs to disk instead of failing once memory usage reaches
+         * MaxScanAndOrderBytes.  Has no effect if the scanAndOrderAllowDiskUse server parameter
+         * is off.
+         */
+        void setSpillingAllowed(bool allowed) { _spillingAllowed = allowed; }
+        bool spillingAllowed() const;
+
         /**
          * @throw ScanAndOrderMemoryLimitExceededAssertionCode if adding would grow memory usage
-         * to ScanAndOrder::MaxScanAndOrderBytes.
+         * to ScanAndOrder::MaxScanAndOrderBytes and spilling is not allowed.
          */
         void add(const BSONObj &o);
 
-        /* scanning complete. stick the query result in b for n objects. */
-        void fill(BufBuilder& b, const ParsedQuery *query, int& nout) const;
+        /**
+         * Scanning complete. stick the query result in b for n objects.  If runs were spilled,
+         * only the first batch is filled (all of it for explain, which is counted but not
+         * written) and the rest is left for sortedRemainder().
+         */
+        void fill(BufBuilder& b, const ParsedQuery *query, int& nout);
+
+        /**
+         * @return a cursor over the sorted results fill() left for getMore, or an empty pointer
+         * if fill() returned them all.
+         */
+        shared_ptr<Cursor> sortedRemainder(const ParsedQuery *query);
+
+        /** @return the most memory used to buffer results at once. */
+        unsigned peakApproxSize() const { return _peakApproxSize; }
+        /** @return the number of sorted runs written to disk. */
+        int nSpills() const { return _runs.size(); }
 
     /** Functions for testing. */
     protected:
 
         unsigned approxSize() const { return _approxSize; }
 
+        void setMaxApproxSize(unsigned maxApproxSize) { _maxApproxSize = maxApproxSize; }
+
     private:
+        class SortedRun;
+        class RunMerger;
+        class RemainderCursor;
+        typedef boost::shared_ptr<SortedRun> SortedRunPtr;
 
         void _add(const BSONObj& k, const BSONObj& o);
 
@@ -107,11 +134,20 @@ namespace mongo {
          */
         void _validateAndUpdateApproxSize( const int approxSizeDelta );
 
+        /** Write _best to disk as a sorted run and empty it. */
+        void _spill();
+
         BestMap _best; // key -> full object
         int _startFrom;
         int _limit;   // max to send back.
         KeyType _order;
         unsigned _approxSize;
+        unsigned _peakApproxSize;
+        unsigned _maxApproxSize;
+        bool _spillingAllowed;
+        vector<SortedRunPtr> _runs;
+        // Merge of the spilled runs and _best, set up by fill().
+        shared_ptr<RunMerger> _merger;
 
     };
 
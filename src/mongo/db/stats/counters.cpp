@@ -19,6 +19,7 @@
 #include "pch.h"
 #include "../jsobj.h"
 #include "counters.h"
+#include "../../util/net/message_compressor.h"
 
 namespace mongo {
     OpCounters::OpCounters() {}
@@ -65,6 +66,9 @@ namespace mongo {
         b.appendNumber("bytesIn", _bytesIn.loadRelaxed());
         b.appendNumber("bytesOut" , _bytesOut.loadRelaxed());
         b.appendNumber("numRequests", _requests.loadRelaxed());
+        BSONObjBuilder compression(b.subobjStart("compression"));
+        appendMessageCompressionStats(compression);
+        compression.done();
     }
 
     OpCounters globalOpCounters;
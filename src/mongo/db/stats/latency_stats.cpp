@@ -0,0 +1,79 @@
+// latency_stats.cpp
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/stats/latency_stats.h"
+
+#include "mongo/db/cmdline.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/stats/top.h"
+
+namespace mongo {
+
+    PartitionedLatencyHistogram LatencyStats::lockWait;
+    PartitionedLatencyHistogram LatencyStats::storageCommit;
+    PartitionedLatencyHistogram LatencyStats::oplogApply;
+
+    namespace {
+
+        void appendHistogram(BSONObjBuilder &b, const char *name,
+                             const PartitionedLatencyHistogram &plh, const vector<double> &percentiles) {
+            LatencyHistogram h;
+            plh.snapshot(h);
+            BSONObjBuilder hb(b.subobjStart(name));
+            h.append(hb, percentiles);
+            hb.done();
+        }
+
+        /**
+         * serverStatus().latency, or serverStatus({latency: {percentiles: [50, 99.99]}}).latency
+         * for other percentiles.
+         */
+        class LatencySSS : public ServerStatusSection {
+          public:
+            LatencySSS() : ServerStatusSection("latency") {}
+            virtual bool includeByDefault() const { return true; }
+
+            BSONObj generateSection(const BSONElement &configElement) const {
+                if (cmdLine.isMongos()) {
+                    return BSONObj();
+                }
+
+                vector<double> percentiles = LatencyHistogram::defaultPercentiles();
+                if (configElement.isABSONObj()) {
+                    percentiles = LatencyHistogram::parsePercentiles(configElement.Obj()["percentiles"]);
+                }
+
+                BSONObjBuilder b;
+                b.append("note", "all times in microseconds");
+                {
+                    BSONObjBuilder ob(b.subobjStart("ops"));
+                    Top::global.appendOpLatency(ob, percentiles);
+                    ob.done();
+                }
+                appendHistogram(b, "lockWait", LatencyStats::lockWait, percentiles);
+                appendHistogram(b, "storageCommit", LatencyStats::storageCommit, percentiles);
+                appendHistogram(b, "oplogApply", LatencyStats::oplogApply, percentiles);
+                return b.obj();
+            }
+        } latencySSS;
+
+    } // namespace
+
+} // namespace mongo
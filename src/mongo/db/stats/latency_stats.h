@@ -0,0 +1,38 @@
+// latency_stats.h
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mongo/util/latency_histogram.h"
+
+namespace mongo {
+
+    /**
+     * Latency histograms, in micros, of the parts of an operation that aren't tracked by Top.
+     * All of them, along with Top's histograms of each kind of operation, are reported in
+     * serverStatus().latency.
+     */
+    struct LatencyStats {
+        /** time spent waiting to acquire a lock */
+        static PartitionedLatencyHistogram lockWait;
+        /** time spent committing root transactions in the storage engine, including log flushes */
+        static PartitionedLatencyHistogram storageCommit;
+        /** time spent applying each transaction from the oplog on a secondary */
+        static PartitionedLatencyHistogram oplogApply;
+    };
+
+} // namespace mongo
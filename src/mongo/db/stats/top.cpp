@@ -26,9 +26,13 @@
 #include "mongo/db/auth/privilege.h"
 #include "mongo/util/net/message.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
+    // per collection latency histograms cost a few KB per collection
+    MONGO_EXPORT_SERVER_PARAMETER( topLatencyHistograms , bool , true );
+
     Top::UsageData::UsageData( const UsageData& older , const UsageData& newer ) {
         // this won't be 100% accurate on rollovers and drop(), but at least it won't be negative
         time  = (newer.time  >= older.time)  ? (newer.time  - older.time)  : newer.time;
@@ -48,10 +52,58 @@ namespace mongo {
 
     }
 
+    const char * Top::CollectionLatency::kindName( Kind k ) {
+        switch ( k ) {
+        case TOTAL: return "total";
+        case QUERIES: return "queries";
+        case GETMORE: return "getmore";
+        case INSERT: return "insert";
+        case UPDATE: return "update";
+        case REMOVE: return "remove";
+        case COMMANDS: return "commands";
+        default: ;
+        }
+        verify( false );
+        return "";
+    }
+
+    Top::CollectionLatency::Kind Top::CollectionLatency::kindOf( int op , bool command ) {
+        switch ( op ) {
+        case dbUpdate: return UPDATE;
+        case dbInsert: return INSERT;
+        case dbQuery: return command ? COMMANDS : QUERIES;
+        case dbGetMore: return GETMORE;
+        case dbDelete: return REMOVE;
+        default: return NUM_KINDS;
+        }
+    }
+
+    void Top::CollectionLatency::record( Kind k , long long micros ) {
+        boost::shared_ptr<LatencyHistogram>& h = hists[k];
+        if ( ! h )
+            h.reset( new LatencyHistogram() );
+        h->record( micros );
+    }
+
+    void Top::CollectionLatency::append( BSONObjBuilder& b , const vector<double>& percentiles ) const {
+        for ( int k = 0; k < NUM_KINDS; k++ ) {
+            if ( ! hists[k] )
+                continue;
+            BSONObjBuilder bb( b.subobjStart( kindName( Kind( k ) ) ) );
+            hists[k]->append( bb , percentiles );
+            bb.done();
+        }
+    }
+
     void Top::record( const StringData& ns , int op , int lockType , long long micros , bool command ) {
         if ( ns[0] == '?' )
             return;
 
+        const CollectionLatency::Kind kind = CollectionLatency::kindOf( op , command );
+        _opLatency[CollectionLatency::TOTAL].record( micros );
+        if ( kind != CollectionLatency::NUM_KINDS )
+            _opLatency[kind].record( micros );
+
         //cout << "record: " << ns << "\t" << op << "\t" << command << endl;
         SimpleMutex::scoped_lock lk(_lock);
 
@@ -63,6 +115,13 @@ namespace mongo {
         CollectionData& coll = _usage[ns];
         _record( coll , op , lockType , micros , command );
         _record( _global , op , lockType , micros , command );
+
+        if ( topLatencyHistograms ) {
+            CollectionLatency& latency = _latency[ns];
+            latency.record( CollectionLatency::TOTAL , micros );
+            if ( kind != CollectionLatency::NUM_KINDS )
+                latency.record( kind , micros );
+        }
     }
 
     void Top::_record( CollectionData& c , int op , int lockType , long long micros , bool command ) {
@@ -111,6 +170,7 @@ namespace mongo {
         //cout << "collectionDropped: " << ns << endl;
         SimpleMutex::scoped_lock lk(_lock);
         _usage.erase(ns);
+        _latency.erase(ns);
         _lastDropped = ns.toString();
     }
 
@@ -119,12 +179,23 @@ namespace mongo {
         out = _usage;
     }
 
-    void Top::append( BSONObjBuilder& b ) {
+    void Top::append( BSONObjBuilder& b , const vector<double>* latencyPercentiles ) {
         SimpleMutex::scoped_lock lk( _lock );
-        _appendToUsageMap( b , _usage );
+        _appendToUsageMap( b , _usage , latencyPercentiles );
+    }
+
+    void Top::appendOpLatency( BSONObjBuilder& b , const vector<double>& percentiles ) const {
+        for ( int k = 0; k < CollectionLatency::NUM_KINDS; k++ ) {
+            LatencyHistogram h;
+            _opLatency[k].snapshot( h );
+            BSONObjBuilder bb( b.subobjStart( CollectionLatency::kindName( CollectionLatency::Kind( k ) ) ) );
+            h.append( bb , percentiles );
+            bb.done();
+        }
     }
 
-    void Top::_appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const {
+    void Top::_appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ,
+                                 const vector<double>* latencyPercentiles ) const {
         // pull all the names into a vector so we can sort them for the user
         
         vector<string> names;
@@ -151,6 +222,15 @@ namespace mongo {
             _appendStatsEntry( b , "remove" , coll.remove );
             _appendStatsEntry( b , "commands" , coll.commands );
 
+            if ( latencyPercentiles ) {
+                LatencyMap::const_iterator it = _latency.find( names[i] );
+                if ( it != _latency.end() ) {
+                    BSONObjBuilder lb( b.subobjStart( "latency" ) );
+                    it->second.append( lb , *latencyPercentiles );
+                    lb.done();
+                }
+            }
+
             bb.done();
         }
     }
@@ -167,7 +247,11 @@ namespace mongo {
         TopCmd() : WebInformationCommand("top") {}
 
         virtual bool adminOnly() const { return true; }
-        virtual void help( stringstream& help ) const { help << "usage by collection, in micros "; }
+        virtual void help( stringstream& help ) const {
+            help << "usage by collection, in micros\n"
+                 << "{ top : 1 , latency : true } also gives latency percentiles, which can be chosen with\n"
+                 << "{ top : 1 , percentiles : [ 50 , 99 , 99.9 ] }";
+        }
         virtual void addRequiredPrivileges(const std::string& dbname,
                                            const BSONObj& cmdObj,
                                            std::vector<Privilege>* out) {
@@ -176,10 +260,12 @@ namespace mongo {
             out->push_back(Privilege(AuthorizationManager::SERVER_RESOURCE_NAME, actions));
         }
         virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            const bool latency = cmdObj["latency"].trueValue() || cmdObj.hasField( "percentiles" );
+            const vector<double> percentiles = LatencyHistogram::parsePercentiles( cmdObj["percentiles"] );
             {
                 BSONObjBuilder b( result.subobjStart( "totals" ) );
                 b.append( "note" , "all times in microseconds" );
-                Top::global.append( b );
+                Top::global.append( b , latency ? &percentiles : NULL );
                 b.done();
             }
             return true;
@@ -19,6 +19,7 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "mongo/util/latency_histogram.h"
 #include "mongo/util/string_map.h"
 
 namespace mongo {
@@ -65,9 +66,33 @@ namespace mongo {
 
         typedef StringMap<CollectionData> UsageMap;
 
+        /**
+         * latency histograms of one collection's operations.  each is about 2KB, so it is only
+         * created once that kind of operation is seen.
+         */
+        struct CollectionLatency {
+            enum Kind { TOTAL , QUERIES , GETMORE , INSERT , UPDATE , REMOVE , COMMANDS , NUM_KINDS };
+            static const char * kindName( Kind k );
+            /** @return NUM_KINDS for ops that aren't tracked separately */
+            static Kind kindOf( int op , bool command );
+
+            void record( Kind k , long long micros );
+            void append( BSONObjBuilder& b , const vector<double>& percentiles ) const;
+
+            boost::shared_ptr<LatencyHistogram> hists[NUM_KINDS];
+        };
+
+        typedef StringMap<CollectionLatency> LatencyMap;
+
     public:
         void record( const StringData& ns , int op , int lockType , long long micros , bool command );
-        void append( BSONObjBuilder& b );
+        /**
+         * @param latencyPercentiles if not NULL, each collection also gets these percentiles of
+         *                           its operations' latencies
+         */
+        void append( BSONObjBuilder& b , const vector<double>* latencyPercentiles = NULL );
+        /** appends the latency histograms of each kind of operation, over all collections */
+        void appendOpLatency( BSONObjBuilder& b , const vector<double>& percentiles ) const;
         void cloneMap(UsageMap& out) const;
         CollectionData getGlobalData() const { return _global; }
         void collectionDropped( const StringData& ns );
@@ -76,14 +101,19 @@ namespace mongo {
         static Top global;
 
     private:
-        void _appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const;
+        void _appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ,
+                                const vector<double>* latencyPercentiles ) const;
         void _appendStatsEntry( BSONObjBuilder& b , const char * statsName , const UsageData& map ) const;
         void _record( CollectionData& c , int op , int lockType , long long micros , bool command );
 
         mutable SimpleMutex _lock;
         CollectionData _global;
         UsageMap _usage;
+        LatencyMap _latency;
         string _lastDropped;
+
+        // recorded per thread, outside _lock
+        PartitionedLatencyHistogram _opLatency[CollectionLatency::NUM_KINDS];
     };
 
 } // namespace mongo
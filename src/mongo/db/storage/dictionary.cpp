@@ -51,11 +51,19 @@ namespace mongo {
                 const Ordering &ordering(*reinterpret_cast<const Ordering *>(desc->data));
                 const Ordering &expected(descriptor.ordering());
                 verify(memcmp(&ordering, &expected, 4) == 0);
+                massert(17388, "cannot upgrade an unversioned dictionary descriptor to memcmp keys, "
+                               "the index must be rebuilt",
+                        !descriptor.memcmpKeys());
                 set_db_descriptor(db, descriptor, hot_index);
             } else {
                 const Descriptor existing(reinterpret_cast<const char *>(desc->data), desc->size);
                 if (existing.version() < descriptor.version()) {
                     // existing descriptor is out-dated. upgrade to the current version.
+                    // the key format changes with memcmp keys, so that takes a rebuild.
+                    massert(17389, mongoutils::str::stream() << "cannot upgrade a version "
+                                   << existing.version() << " dictionary descriptor to memcmp keys, "
+                                   << "the index must be rebuilt",
+                            existing.memcmpKeys() || !descriptor.memcmpKeys());
                     set_db_descriptor(db, descriptor, hot_index);
                 } else if (existing.version() > descriptor.version()) {
                     problem() << "Detected a \"dictionary descriptor\" version that is too new: "
@@ -151,7 +159,13 @@ namespace mongo {
             scoped_ptr<Client::Transaction> altTxn(!needAltTxn ? NULL :
                                                    new Client::Transaction(0));
 
-            if (set_memcmp_magic) {
+            if (descriptor.memcmpKeys()) {
+                // Every key that starts with the magic byte compares with memcmp.
+                const int r = _db->set_memcmp_magic(_db, MemcmpKey::Magic);
+                if (r != 0) {
+                    handle_ydb_error_fatal(r);
+                }
+            } else if (set_memcmp_magic) {
                 const int r = _db->set_memcmp_magic(_db, memcmpMagic());
                 if (r != 0) {
                     handle_ydb_error_fatal(r);
@@ -172,7 +172,7 @@ namespace mongo {
                 descriptor.generateKeys(obj, keys);
                 dbt_array_clear_and_resize(dest_keys, keys.size());
                 for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); i++) {
-                    const Key sKey(*i, &pk);
+                    const Key sKey(*i, &pk, descriptor);
                     dbt_array_push(dest_keys, sKey.buf(), sKey.size());
                 }
                 // Set the multiKey bool if it's provided and we generated multiple keys.
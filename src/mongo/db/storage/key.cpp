@@ -19,10 +19,14 @@
 
 #include "mongo/pch.h"
 
+#include <cmath>
+
 #include "mongo/bson/util/builder.h"
+#include "mongo/db/descriptor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/storage/key.h"
 #include "mongo/server.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -551,6 +555,385 @@ namespace mongo {
             return true;
         }
 
+        // Type bytes of the memcmp key format, in canonical type order. Ascending
+        // fields use 0x10 - 0x7f and descending (inverted) ones 0x80 - 0xef, so
+        // neither is ever confused with the 0x00 terminator.
+        enum MemcmpTypes {
+            mMinKey = 0x10,
+            mNull = 0x14,
+            mNaN = 0x20,
+            mNegHuge = 0x21,    // below -2^63, including -inf
+            mNumber = 0x22,     // int64 floor, then 0x00 or 0x01 and the double
+            mPosHuge = 0x23,    // 2^63 and above, including +inf
+            mString = 0x30,
+            mBinData = 0x40,
+            mOID = 0x48,
+            mFalse = 0x50,
+            mTrue = 0x51,
+            mDate = 0x58,
+            mMaxKey = 0x7f,
+            mDescending = 0x80
+        };
+
+        static const unsigned long long signBit = 1ULL << 63;
+
+        static void appendBigEndian64(StackBufBuilder &b, unsigned long long v) {
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                b.appendUChar(static_cast<unsigned char>(v >> shift));
+            }
+        }
+
+        // Maps a double to an unsigned integer with the same order.
+        static unsigned long long orderedDoubleBits(const double d) {
+            unsigned long long bits;
+            memcpy(&bits, &d, sizeof(bits));
+            return (bits & signBit) ? ~bits : bits ^ signBit;
+        }
+
+        static double doubleFromOrderedBits(const unsigned long long bits) {
+            const unsigned long long raw = (bits & signBit) ? bits ^ signBit : ~bits;
+            double d;
+            memcpy(&d, &raw, sizeof(d));
+            return d;
+        }
+
+        static void appendMemcmpNumber(StackBufBuilder &b, const BSONElement &e) {
+            if (e.type() != NumberDouble) {
+                b.appendUChar(mNumber);
+                appendBigEndian64(b, static_cast<unsigned long long>(e.numberLong()) ^ signBit);
+                b.appendUChar(0);
+                return;
+            }
+            // 2^63, exactly representable as a double.
+            static const double twoTo63 = 9223372036854775808.0;
+            const double d = e._numberDouble();
+            if (isNaN(d)) {
+                b.appendUChar(mNaN);
+            } else if (d < -twoTo63) {
+                b.appendUChar(mNegHuge);
+                appendBigEndian64(b, orderedDoubleBits(d));
+            } else if (d >= twoTo63) {
+                b.appendUChar(mPosHuge);
+                appendBigEndian64(b, orderedDoubleBits(d));
+            } else {
+                const double f = std::floor(d);
+                b.appendUChar(mNumber);
+                appendBigEndian64(b, static_cast<unsigned long long>(static_cast<long long>(f)) ^ signBit);
+                if (f == d) {
+                    b.appendUChar(0);
+                } else {
+                    b.appendUChar(1);
+                    appendBigEndian64(b, orderedDoubleBits(d));
+                }
+            }
+        }
+
+        static void appendMemcmpField(StackBufBuilder &b, const BSONElement &e) {
+            switch (e.type()) {
+            case MinKey:
+                b.appendUChar(mMinKey);
+                break;
+            case jstNULL:
+                b.appendUChar(mNull);
+                break;
+            case NumberInt:
+            case NumberLong:
+            case NumberDouble:
+                appendMemcmpNumber(b, e);
+                break;
+            case String: {
+                b.appendUChar(mString);
+                const char *s = e.valuestr();
+                const int len = e.valuestrsize() - 1;
+                for (int i = 0; i < len; i++) {
+                    b.appendChar(s[i]);
+                    if (s[i] == '\0') {
+                        b.appendUChar(0xff);
+                    }
+                }
+                b.appendUChar(0);
+                b.appendUChar(0);
+                break;
+            }
+            case BinData: {
+                // Length, then subtype, then data: the order compareElementValues uses.
+                const unsigned len = e.valuestrsize();
+                b.appendUChar(mBinData);
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    b.appendUChar(static_cast<unsigned char>(len >> shift));
+                }
+                b.appendBuf(e.value() + 4, len + 1);
+                break;
+            }
+            case jstOID:
+                b.appendUChar(mOID);
+                b.appendBuf(e.value(), 12);
+                break;
+            case Bool:
+                b.appendUChar(e.boolean() ? mTrue : mFalse);
+                break;
+            case Date:
+                b.appendUChar(mDate);
+                appendBigEndian64(b, static_cast<unsigned long long>(e.date().millis) ^ signBit);
+                break;
+            case MaxKey:
+                b.appendUChar(mMaxKey);
+                break;
+            default:
+                verify(false);
+            }
+        }
+
+        // BSON compares a long with a double by converting the long to a double,
+        // which loses precision at 2^53 and above, so 2^53 + 1 compares equal to
+        // the double 2^53.  Encoding by exact value would order them differently.
+        static const long long maxExactLong = 1LL << 53;
+
+        bool MemcmpKey::canEncode(const BSONObj &obj) {
+            for (BSONObjIterator it(obj); it.more(); ) {
+                const BSONElement e = it.next();
+                switch (e.type()) {
+                case NumberLong: {
+                    const long long v = e._numberLong();
+                    if (v >= maxExactLong || v <= -maxExactLong) {
+                        return false;
+                    }
+                    break;
+                }
+                case MinKey:
+                case jstNULL:
+                case NumberInt:
+                case NumberDouble:
+                case String:
+                case BinData:
+                case jstOID:
+                case Bool:
+                case Date:
+                case MaxKey:
+                    break;
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void MemcmpKey::encode(const BSONObj &key, const BSONObj *pk, const Ordering &ordering,
+                               StackBufBuilder &b) {
+            b.appendUChar(Magic);
+            int i = 0;
+            for (BSONObjIterator it(key); it.more(); i++) {
+                const int start = b.len();
+                appendMemcmpField(b, it.next());
+                if (ordering.get(i) < 0) {
+                    // Inverting every byte of a prefix-free encoding reverses its order.
+                    for (char *p = b.buf() + start; p < b.buf() + b.len(); p++) {
+                        *p = ~*p;
+                    }
+                }
+            }
+            b.appendUChar(0);
+            if (pk != NULL) {
+                for (BSONObjIterator it(*pk); it.more(); ) {
+                    appendMemcmpField(b, it.next());
+                }
+                b.appendUChar(0);
+            }
+        }
+
+        // Reads the fields written by appendMemcmpField, undoing the inversion
+        // of descending fields as it goes.
+        class MemcmpReader {
+        public:
+            explicit MemcmpReader(const char *p) :
+                _start(reinterpret_cast<const unsigned char *>(p)), _p(_start), _mask(0) {
+            }
+
+            bool atEnd() const {
+                return *_p == 0;
+            }
+
+            int consumed() const {
+                return _p - _start;
+            }
+
+            // Reads and decodes (into b, unless NULL) the next field.
+            void readField(BSONObjBuilder *b) {
+                _mask = (*_p & mDescending) ? 0xff : 0;
+                const unsigned char type = next();
+                switch (type) {
+                case mMinKey:
+                    if (b) b->appendMinKey("");
+                    break;
+                case mNull:
+                    if (b) b->appendNull("");
+                    break;
+                case mNaN:
+                    if (b) b->append("", std::numeric_limits<double>::quiet_NaN());
+                    break;
+                case mNegHuge:
+                case mPosHuge: {
+                    const double d = doubleFromOrderedBits(next64());
+                    if (b) b->append("", d);
+                    break;
+                }
+                case mNumber: {
+                    const long long whole = static_cast<long long>(next64() ^ signBit);
+                    if (next() == 0) {
+                        if (b) {
+                            if (whole >= std::numeric_limits<int>::min() &&
+                                whole <= std::numeric_limits<int>::max()) {
+                                b->append("", static_cast<int>(whole));
+                            } else if (whole >= maxExactLong || whole <= -maxExactLong) {
+                                // Only a double can have been encoded here (see canEncode).
+                                b->append("", static_cast<double>(whole));
+                            } else {
+                                b->append("", whole);
+                            }
+                        }
+                    } else {
+                        const double d = doubleFromOrderedBits(next64());
+                        if (b) b->append("", d);
+                    }
+                    break;
+                }
+                case mString: {
+                    std::string s;
+                    while (true) {
+                        const unsigned char c = next();
+                        if (c == 0) {
+                            if (next() == 0) {
+                                break;
+                            }
+                            // 0x00 0xff is an escaped zero byte.
+                        }
+                        if (b) s.push_back(static_cast<char>(c));
+                    }
+                    if (b) b->append("", s);
+                    break;
+                }
+                case mBinData: {
+                    unsigned len = 0;
+                    for (int i = 0; i < 4; i++) {
+                        len = (len << 8) | next();
+                    }
+                    const BinDataType subtype = static_cast<BinDataType>(next());
+                    std::string data;
+                    for (unsigned i = 0; i < len; i++) {
+                        const unsigned char c = next();
+                        if (b) data.push_back(static_cast<char>(c));
+                    }
+                    if (b) b->appendBinData("", len, subtype, data.data());
+                    break;
+                }
+                case mOID: {
+                    OID oid;
+                    unsigned char *raw = reinterpret_cast<unsigned char *>(&oid);
+                    for (int i = 0; i < 12; i++) {
+                        raw[i] = next();
+                    }
+                    if (b) b->append("", oid);
+                    break;
+                }
+                case mFalse:
+                case mTrue:
+                    if (b) b->appendBool("", type == mTrue);
+                    break;
+                case mDate: {
+                    const long long millis = static_cast<long long>(next64() ^ signBit);
+                    if (b) b->appendDate("", Date_t(static_cast<unsigned long long>(millis)));
+                    break;
+                }
+                case mMaxKey:
+                    if (b) b->appendMaxKey("");
+                    break;
+                default:
+                    msgasserted(17387, mongoutils::str::stream() << "bad memcmp key type byte " << (int) type);
+                }
+            }
+
+        private:
+            unsigned char next() {
+                return *_p++ ^ _mask;
+            }
+
+            unsigned long long next64() {
+                unsigned long long v = 0;
+                for (int i = 0; i < 8; i++) {
+                    v = (v << 8) | next();
+                }
+                return v;
+            }
+
+            const unsigned char *const _start;
+            const unsigned char *_p;
+            unsigned char _mask;
+        };
+
+        int MemcmpKey::keySize(const char *buf) {
+            dassert(isMemcmpFormat(buf));
+            MemcmpReader reader(buf + 1);
+            while (!reader.atEnd()) {
+                reader.readField(NULL);
+            }
+            return 1 + reader.consumed() + 1;
+        }
+
+        int MemcmpKey::pkSize(const char *buf) {
+            MemcmpReader reader(buf);
+            while (!reader.atEnd()) {
+                reader.readField(NULL);
+            }
+            return reader.consumed() + 1;
+        }
+
+        BSONObj MemcmpKey::toBson(const char *buf, BufBuilder &bb) {
+            BSONObjBuilder b(bb);
+            MemcmpReader reader(buf);
+            while (!reader.atEnd()) {
+                reader.readField(&b);
+            }
+            return b.done();
+        }
+
+        void Key::reset(const BSONObj &other, const BSONObj *pk, const Descriptor &descriptor) {
+            if (!descriptor.memcmpKeys() || !MemcmpKey::canEncode(other) ||
+                (pk != NULL && !MemcmpKey::canEncode(*pk))) {
+                reset(other, pk);
+                return;
+            }
+            _b.reset();
+            MemcmpKey::encode(other, pk, descriptor.ordering(), _b);
+            _buf = _b.buf();
+            _size = _b.len();
+        }
+
+        int Key::compareDecoded(const Key &key1, const Key &key2, const Ordering &ordering) {
+            BufBuilder bb1, bb2;
+            {
+                const int c = key1.key(bb1).woCompare(key2.key(bb2), ordering, false);
+                if (c < 0) {
+                    return -1;
+                } else if (c > 0) {
+                    return 1;
+                }
+            }
+            // Primary keys compare ascending, as in woCompare.
+            const BSONObj pk1 = key1.pk();
+            const BSONObj pk2 = key2.pk();
+            if (!pk1.isEmpty() && !pk2.isEmpty()) {
+                static const unsigned ordering_bits = 0;
+                static const Ordering &pk_ordering = *reinterpret_cast<const Ordering *>(&ordering_bits);
+                const int c = pk1.woCompare(pk2, pk_ordering, false);
+                if (c < 0) {
+                    return -1;
+                } else if (c > 0) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+
     } // namespace storage
 
 } // namespace mongo
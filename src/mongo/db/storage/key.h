@@ -36,13 +36,63 @@
 //
 // The dictionary val format is either the entire BSON object, or nothing at all.
 // If there's nothing, there must be an associated primary key.
+//
+// Dictionaries with a version 2 descriptor store keys in a format that sorts
+// correctly with memcmp, see MemcmpKey below.
 
 namespace mongo {
 
+    class Descriptor;
+
     namespace storage {
 
         unsigned char memcmpMagic();
 
+        // Key format of dictionaries with a version 2 descriptor. The ydb is told
+        // (see Dictionary::open) that two keys starting with Magic compare with
+        // memcmp, so it never has to call back into Key::woCompare for them:
+        //
+        //    Magic { key fields } 0x00 [ { pk fields } 0x00 ]
+        //
+        // Each field is a type byte, in canonical type order, followed by an
+        // order-preserving encoding of the value. Every byte of a descending key
+        // field is inverted, which a decoder can tell from the type byte. Primary
+        // key fields are always ascending, like the BSON comparison in Key.
+        //
+        // Numbers are encoded by value, so 5, NumberLong(5) and 5.0 are the same
+        // key and all decode as the narrowest of int, long and double that holds
+        // the value (a double for any magnitude of 2^53 or more). Keys holding a
+        // value that has no such encoding (objects, timestamps, regexes, code,
+        // longs of magnitude 2^53 or more, which BSON compares with doubles only
+        // after rounding, ...) are written in the version 1 format instead, which
+        // never starts with Magic. Key::woCompare decodes both sides of such a
+        // comparison to BSON, and decoding preserves the BSON order of every
+        // value that has an encoding, so both formats sort together.
+        class MemcmpKey {
+        public:
+            static const unsigned char Magic = 0x80;
+
+            static bool isMemcmpFormat(const char *buf) {
+                return static_cast<unsigned char>(*buf) == Magic;
+            }
+
+            // @return true if every value in obj has a memcmp encoding
+            static bool canEncode(const BSONObj &obj);
+
+            // Appends the encoding of key and, if given, pk. Both must satisfy canEncode().
+            static void encode(const BSONObj &key, const BSONObj *pk, const Ordering &ordering,
+                               StackBufBuilder &b);
+
+            // @return size of the magic byte and the key fields, with their terminator
+            static int keySize(const char *buf);
+
+            // @return size of the pk fields starting at buf, with their terminator
+            static int pkSize(const char *buf);
+
+            // Decodes the fields starting at buf, up to their terminator.
+            static BSONObj toBson(const char *buf, BufBuilder &bb);
+        };
+
         /** Key class for precomputing a small format index key that is denser than a traditional BSONObj. */
         class KeyV1Owned;
 
@@ -119,15 +169,15 @@ namespace mongo {
         // { KeyV1 key [, BSONObj primary key] }
         class Key {
         public:
-            // For serializing
+            // For serializing in the version 1 format, used by dictionaries
+            // that are not indexes.
             Key(const BSONObj &key, const BSONObj *pk) {
-                KeyV1Owned keyOwned(key);
-                _b.appendBuf(keyOwned.data(), keyOwned.dataSize());
-                if (pk != NULL) {
-                    _b.appendBuf(pk->objdata(), pk->objsize());
-                }
-                _buf = _b.buf();
-                _size = _b.len();
+                reset(key, pk);
+            }
+
+            // For serializing in the format of the dictionary described by descriptor.
+            Key(const BSONObj &key, const BSONObj *pk, const Descriptor &descriptor) {
+                reset(key, pk, descriptor);
             }
 
             // For deserializing
@@ -138,13 +188,34 @@ namespace mongo {
                 _buf(static_cast<const char *>(dbt->data)), _size(dbt->size) {
             }
 
+            // With hasPK false, only the key part of buf is used, even if a
+            // primary key follows it.
             Key(const char *buf, const bool hasPK) : _buf(buf) {
+                if (MemcmpKey::isMemcmpFormat(_buf)) {
+                    const size_t keySize = MemcmpKey::keySize(_buf);
+                    _size = keySize + (hasPK ? MemcmpKey::pkSize(_buf + keySize) : 0);
+                    return;
+                }
                 storage::KeyV1 kv1(_buf);
                 const size_t keySize = kv1.dataSize();
                 _size = keySize + (hasPK ? BSONObj(_buf + keySize).objsize() : 0);
             }
 
             static int woCompare(const Key &key1, const Key &key2, const Ordering &ordering) {
+                const bool memcmp1 = MemcmpKey::isMemcmpFormat(key1.buf());
+                const bool memcmp2 = MemcmpKey::isMemcmpFormat(key2.buf());
+                if (memcmp1 && memcmp2) {
+                    // The same rule the ydb uses for memcmp magic keys.
+                    const int c = memcmp(key1.buf(), key2.buf(), std::min(key1.size(), key2.size()));
+                    if (c != 0) {
+                        return c < 0 ? -1 : 1;
+                    }
+                    return key1.size() < key2.size() ? -1 : (key1.size() > key2.size() ? 1 : 0);
+                }
+                if (memcmp1 || memcmp2) {
+                    return compareDecoded(key1, key2, ordering);
+                }
+
                 // Interpret the beginning of the Key's buf as KeyV1. The size of the Key
                 // must be at least as big as the size of the KeyV1 (otherwise format error).
                 dassert(key1.buf());
@@ -223,15 +294,7 @@ namespace mongo {
                 _size = _b.len();
             }
 
-            void reset(const KeyV1 &other, const BSONObj *pk) {
-                _b.reset();
-                _b.appendBuf(other.data(), other.dataSize());
-                if (pk != NULL) {
-                    _b.appendBuf(pk->objdata(), pk->objsize());
-                }
-                _buf = _b.buf();
-                _size = _b.len();
-            }
+            void reset(const BSONObj &other, const BSONObj *pk, const Descriptor &descriptor);
 
             BSONObj key() const {
                 BufBuilder bb;
@@ -239,16 +302,35 @@ namespace mongo {
             }
 
             BSONObj key(BufBuilder &bb) const {
+                if (MemcmpKey::isMemcmpFormat(_buf)) {
+                    return MemcmpKey::toBson(_buf + 1, bb);
+                }
                 storage::KeyV1 kv1(_buf);
                 return kv1.toBson(bb);
             }
 
             BSONObj pk() const {
+                if (MemcmpKey::isMemcmpFormat(_buf)) {
+                    const size_t keySize = MemcmpKey::keySize(_buf);
+                    if (keySize < _size) {
+                        BufBuilder bb;
+                        return MemcmpKey::toBson(_buf + keySize, bb).getOwned();
+                    }
+                    return BSONObj();
+                }
                 storage::KeyV1 kv1(_buf);
                 const size_t keySize = kv1.dataSize();
                 return keySize < _size ? BSONObj(_buf + keySize) : BSONObj();
             }
 
+            // @return true if a primary key follows the key part
+            bool hasPK() const {
+                const size_t keySize = (MemcmpKey::isMemcmpFormat(_buf)
+                                        ? MemcmpKey::keySize(_buf)
+                                        : storage::KeyV1(_buf).dataSize());
+                return keySize < _size;
+            }
+
             const char *buf() const {
                 return _buf;
             }
@@ -258,6 +340,9 @@ namespace mongo {
             }
 
         private:
+            // Compares keys of different formats by their BSON values.
+            static int compareDecoded(const Key &key1, const Key &key2, const Ordering &ordering);
+
             StackBufBuilder _b;
             const char *_buf;
             size_t _size;
@@ -0,0 +1,105 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/storage/spill_file.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include "mongo/bson/oid.h"
+#include "mongo/db/cmdline.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/paths.h"
+
+namespace mongo {
+
+    using namespace mongoutils;
+
+    namespace storage {
+
+        string spillDir() {
+            const string &base = cmdLine.tmpDir.empty() ? dbpath : cmdLine.tmpDir;
+            return (boost::filesystem::path(base) / "_tmp").string();
+        }
+
+        void clearSpillDir() {
+            const boost::filesystem::path dir(spillDir());
+            boost::system::error_code ec;
+            if (!boost::filesystem::exists(dir, ec)) {
+                return;
+            }
+            for (boost::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+                boost::system::error_code removeEc;
+                boost::filesystem::remove_all(it->path(), removeEc);
+                if (removeEc) {
+                    warning() << "couldn't remove old spill file " << it->path().string()
+                              << ": " << removeEc.message() << endl;
+                }
+            }
+            if (ec) {
+                warning() << "couldn't clear spill directory " << dir.string()
+                          << ": " << ec.message() << endl;
+            }
+        }
+
+        SpillFile::SpillFile(const string &dir, const string &prefix) :
+            _count(0) {
+            boost::filesystem::create_directories(dir);
+            _path = (boost::filesystem::path(dir) / (prefix + "." + OID::gen().str())).string();
+            _out.open(_path.c_str(), std::ios::binary | std::ios::trunc);
+            uassert(17377, str::stream() << "couldn't open spill file " << _path,
+                    _out.is_open());
+        }
+
+        SpillFile::~SpillFile() {
+            _out.close();
+            _in.close();
+            boost::system::error_code ec;
+            boost::filesystem::remove(_path, ec);
+        }
+
+        void SpillFile::write(const BSONObj &obj) {
+            _out.write(obj.objdata(), obj.objsize());
+            uassert(17378, str::stream() << "couldn't write to spill file " << _path,
+                    _out.good());
+            _count++;
+        }
+
+        void SpillFile::startReading() {
+            _out.close();
+            _in.open(_path.c_str(), std::ios::binary);
+            uassert(17379, str::stream() << "couldn't read spill file " << _path,
+                    _in.is_open());
+        }
+
+        bool SpillFile::read(BSONObj *obj) {
+            int size;
+            if (!_in.read(reinterpret_cast<char *>(&size), sizeof(size))) {
+                return false;
+            }
+            verify(size >= 5 && size <= BSONObjMaxInternalSize);
+            boost::shared_ptr<char> buf(new char[size], boost::checked_array_deleter<char>());
+            memcpy(buf.get(), &size, sizeof(size));
+            uassert(17380, str::stream() << "spill file " << _path << " is truncated",
+                    _in.read(buf.get() + sizeof(size), size - sizeof(size)));
+            *obj = BSONObj(buf.get()).getOwned();
+            return true;
+        }
+
+    } // namespace storage
+
+} // namespace mongo
@@ -0,0 +1,64 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <fstream>
+
+#include "mongo/bson/bsonobj.h"
+
+namespace mongo {
+
+    namespace storage {
+
+        // Directory that sorts and aggregation stages spill to when they run out of
+        // memory: <tmpDir or dbpath>/_tmp.
+        string spillDir();
+
+        // Removes whatever a previous run left in spillDir(), such as the files of
+        // a spill that was interrupted by a crash. Called once at startup.
+        void clearSpillDir();
+
+        // A temporary file of BSON objects in dir, written once and then read back
+        // in order. The file is removed when this goes away.
+        class SpillFile : boost::noncopyable {
+        public:
+            // The file name starts with prefix, which names what is spilling.
+            SpillFile(const string &dir, const string &prefix);
+            ~SpillFile();
+
+            void write(const BSONObj &obj);
+
+            // Ends writing, the next read() returns the first object written.
+            void startReading();
+
+            // @return false at the end of the file
+            bool read(BSONObj *obj);
+
+            bool empty() const { return _count == 0; }
+
+        private:
+            string _path;
+            long long _count;
+            std::ofstream _out;
+            std::ifstream _in;
+        };
+
+    } // namespace storage
+
+} // namespace mongo
@@ -22,7 +22,9 @@
 
 #include "mongo/db/client.h"
 #include "mongo/db/cmdline.h"
+#include "mongo/db/stats/latency_stats.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -77,7 +79,14 @@ namespace mongo {
         void Txn::commit(int flags) {
             dassert(isLive());
             DEV { LOG(3) << "commit txn " << _db_txn << " with flags " << flags << endl; }
+            // child commits just hand their work to the parent, only the root's commit does any
+            // real work (like flushing the log), so that's what we measure
+            const bool root = _db_txn->parent == NULL;
+            Timer t;
             storage::commit_txn(_db_txn, flags);
+            if (root) {
+                LatencyStats::storageCommit.record(t.micros());
+            }
             _db_txn = NULL;
         }
 
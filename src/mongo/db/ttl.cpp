@@ -24,6 +24,7 @@
 #include "mongo/base/counter.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/collection.h"
 #include "mongo/db/databaseholder.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/ops/delete.h"
@@ -35,9 +36,13 @@ namespace mongo {
 
     Counter64 ttlPasses;
     Counter64 ttlDeletedDocuments;
+    Counter64 ttlAddedPartitions;
+    Counter64 ttlDroppedPartitions;
 
     ServerStatusMetricField<Counter64> ttlPassesDisplay("ttl.passes", &ttlPasses);
     ServerStatusMetricField<Counter64> ttlDeletedDocumentsDisplay("ttl.deletedDocuments", &ttlDeletedDocuments);
+    ServerStatusMetricField<Counter64> ttlAddedPartitionsDisplay("ttl.addedPartitions", &ttlAddedPartitions);
+    ServerStatusMetricField<Counter64> ttlDroppedPartitionsDisplay("ttl.droppedPartitions", &ttlDroppedPartitions);
 
     MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorEnabled, bool, true );
     
@@ -124,6 +129,101 @@ namespace mongo {
             }
         }
 
+        /**
+         * Apply the partitionRetention policies of the partitioned collections in dbName.
+         * Partitions are only ever added and dropped whole, with the addPartition and
+         * dropPartition commands, so secondaries follow along through the oplog.
+         */
+        void doPartitionRetentionForDB( const string& dbName ) {
+            if ( !isMasterNs( dbName.c_str() ) ) {
+                return;
+            }
+
+            Client::GodScope god;
+
+            vector<BSONObj> collections;
+            {
+                string field = string( "options." ) + PartitionRetention::fieldName;
+                auto_ptr<DBClientCursor> cursor =
+                                db.query( getSisterNS(dbName, "system.namespaces") ,
+                                          BSON( field << BSON( "$exists" << true ) ) );
+                if ( cursor.get() ) {
+                    while ( cursor->more() ) {
+                        collections.push_back( cursor->next().getOwned() );
+                    }
+                }
+            }
+
+            for ( unsigned i=0; i<collections.size(); i++ ) {
+                string ns = collections[i]["name"].String();
+                string coll = nsToCollectionSubstring( ns ).toString();
+                PartitionRetention policy;
+                try {
+                    PartitionRetention::parse( collections[i]["options"].Obj(), &policy );
+                }
+                catch ( DBException& e ) {
+                    error() << "bad partitionRetention for " << ns << ": " << e << endl;
+                    continue;
+                }
+
+                BSONObj info;
+                if ( !db.runCommand( dbName, BSON( "getPartitionInfo" << coll ), info ) ) {
+                    // collection was dropped
+                    continue;
+                }
+                vector<BSONElement> partitions = info["partitions"].Array();
+                const long long now = curTimeMillis64();
+
+                // Drop expired partitions, oldest first.  Each partition holds keys up to its
+                // max, so it has expired once its max has.  The last partition is open ended
+                // and is never dropped.
+                size_t dropped = 0;
+                for ( ; dropped + 1 < partitions.size(); dropped++ ) {
+                    BSONObj partition = partitions[dropped].Obj();
+                    BSONElement max = partition["max"].Obj().firstElement();
+                    if ( max.type() != Date ||
+                         (long long) max.date().millis + policy.expireMillis > now ) {
+                        break;
+                    }
+                    BSONObj res;
+                    if ( !db.runCommand( dbName, BSON( "dropPartition" << coll <<
+                                                       "id" << partition["_id"].numberLong() ), res ) ) {
+                        warning() << "TTL: could not drop expired partition of " << ns << ": " << res << endl;
+                        break;
+                    }
+                    LOG(1) << "TTL: dropped partition " << partition << " of " << ns << endl;
+                    ttlDroppedPartitions.increment();
+                }
+
+                // Cap the last partition at interval boundaries until 'precreate' intervals
+                // past now are covered.
+                const string field = partitions.back().Obj()["max"].Obj().firstElementFieldName();
+                long long lastMax = -1;
+                if ( partitions.size() - dropped > 1 ) {
+                    BSONElement max = partitions[ partitions.size() - 2 ].Obj()["max"].Obj().firstElement();
+                    if ( max.type() == Date ) {
+                        lastMax = max.date().millis;
+                    }
+                }
+                const long long horizon = now + policy.precreate * policy.intervalMillis;
+                while ( lastMax < horizon ) {
+                    long long next = ( std::max( lastMax, now ) / policy.intervalMillis + 1 ) *
+                                     policy.intervalMillis;
+                    BSONObjBuilder newMax;
+                    newMax.appendDate( field, next );
+                    BSONObj res;
+                    if ( !db.runCommand( dbName, BSON( "addPartition" << coll <<
+                                                       "newMax" << newMax.obj() ), res ) ) {
+                        warning() << "TTL: could not add partition to " << ns << ": " << res << endl;
+                        break;
+                    }
+                    LOG(1) << "TTL: added partition ending at " << Date_t( next ) << " to " << ns << endl;
+                    ttlAddedPartitions.increment();
+                    lastMax = next;
+                }
+            }
+        }
+
         virtual void run() {
             Client::initThread( name().c_str() );
 
@@ -158,6 +258,12 @@ namespace mongo {
                     catch ( DBException& e ) {
                         error() << "error processing ttl for db: " << db << " " << e << endl;
                     }
+                    try {
+                        doPartitionRetentionForDB( db );
+                    }
+                    catch ( DBException& e ) {
+                        error() << "error processing partition retention for db: " << db << " " << e << endl;
+                    }
                 }
 
             }
@@ -20,6 +20,7 @@
 
 #include "../s/chunk.h"
 #include "mongo/db/json.h"
+#include "mongo/platform/random.h"
 
 #include "dbtests.h"
 
@@ -50,7 +51,14 @@ namespace mongo {
             }
             
             chunkRanges.reloadAll( chunkMap );
+            const_cast<ChunkRoutingTable&>( _routingTable ).reloadAll( chunkMap );
         }
+        /** Finds point's chunk the way findIntersectingChunk did before the routing table. */
+        ChunkPtr findInChunkMap( const BSONObj &point ) const {
+            ChunkMap::const_iterator it = _chunkMap.upper_bound( point );
+            return it == _chunkMap.end() ? ChunkPtr() : it->second;
+        }
+        const ChunkRoutingTable &routingTable() const { return _routingTable; }
     };
     
 } // namespace mongo
@@ -236,6 +244,94 @@ namespace ChunkTests {
             }
         };
 
+        /**
+         * Routes random points, and the edges of every chunk, through the routing table and
+         * checks they land where the chunk map would put them.
+         */
+        class RoutingBase {
+        public:
+            virtual ~RoutingBase() {}
+            void run() {
+                ChunkManager chunkManager;
+                chunkManager.setShardKey( BSON( "a" << 1 ) );
+                vector<BSONObj> splitPoints;
+                for ( int i = 0; i < nChunks - 1; ++i ) {
+                    splitPoints.push_back( splitPoint( i ) );
+                }
+                chunkManager.setSingleChunkForShards( splitPoints );
+                ASSERT_EQUALS( static_cast<size_t>( nChunks ), chunkManager.routingTable().size() );
+                ASSERT_EQUALS( numeric(), chunkManager.routingTable().isNumeric() );
+
+                vector<BSONObj> points;
+                points.push_back( BSON( "a" << MINKEY ) );
+                for ( size_t i = 0; i < splitPoints.size(); ++i ) {
+                    points.push_back( splitPoints[i] );
+                    points.push_back( between( i ) );
+                }
+                PseudoRandom rand( 17 );
+                for ( int i = 0; i < 10000; ++i ) {
+                    points.push_back( randomPoint( rand ) );
+                }
+
+                for ( size_t i = 0; i < points.size(); ++i ) {
+                    ChunkPtr expected = chunkManager.findInChunkMap( points[i] );
+                    ASSERT( expected );
+                    ASSERT( expected->containsPoint( points[i] ) );
+                    ASSERT_EQUALS( expected, chunkManager.routingTable().upperBound( points[i] ) );
+                    ASSERT_EQUALS( expected, chunkManager.findIntersectingChunk( points[i] ) );
+                }
+                // MaxKey is the max of the last chunk, which contains no points at all.
+                ASSERT( !chunkManager.findInChunkMap( BSON( "a" << MAXKEY ) ) );
+                ASSERT( !chunkManager.routingTable().upperBound( BSON( "a" << MAXKEY ) ) );
+            }
+        protected:
+            static const int nChunks = 2000;
+            virtual bool numeric() const = 0;
+            virtual BSONObj splitPoint( int i ) const = 0;
+            /** A point strictly inside the chunk whose min is splitPoint( i ). */
+            virtual BSONObj between( int i ) const = 0;
+            virtual BSONObj randomPoint( PseudoRandom &rand ) const = 0;
+        };
+
+        /** Hashed shard keys split on NumberLongs spread over the whole range. */
+        class RoutingNumeric : public RoutingBase {
+        protected:
+            static long long value( int i ) {
+                return ( numeric_limits<long long>::min() / nChunks ) * ( nChunks - 2 * i );
+            }
+            virtual bool numeric() const { return true; }
+            virtual BSONObj splitPoint( int i ) const { return BSON( "a" << value( i ) ); }
+            virtual BSONObj between( int i ) const { return BSON( "a" << value( i ) + 1 ); }
+            virtual BSONObj randomPoint( PseudoRandom &rand ) const {
+                return BSON( "a" << static_cast<long long>( rand.nextInt64() ) );
+            }
+        };
+
+        class RoutingString : public RoutingBase {
+            virtual bool numeric() const { return false; }
+            virtual BSONObj splitPoint( int i ) const {
+                return BSON( "a" << string( str::stream() << "k" << 100000 + i * 10 ) );
+            }
+            virtual BSONObj between( int i ) const {
+                return BSON( "a" << string( str::stream() << "k" << 100000 + i * 10 << "x" ) );
+            }
+            virtual BSONObj randomPoint( PseudoRandom &rand ) const {
+                int n = 100000 + rand.nextInt32( nChunks * 10 );
+                return BSON( "a" << string( str::stream() << "k" << n ) );
+            }
+        };
+
+        /** A NumberLong point among other types of split points takes the generic path. */
+        class RoutingMixed : public RoutingNumeric {
+            virtual bool numeric() const { return false; }
+            virtual BSONObj splitPoint( int i ) const {
+                return i == nChunks / 2 ? BSON( "a" << i ) : RoutingNumeric::splitPoint( i );
+            }
+            virtual BSONObj between( int i ) const {
+                return i == nChunks / 2 ? BSON( "a" << i + 0.5 ) : RoutingNumeric::between( i );
+            }
+        };
+
     } // namespace ChunkManagerTests
     
     class All : public Suite {
@@ -264,6 +360,9 @@ namespace ChunkTests {
             add<ChunkManagerTests::InequalityThenUnsatisfiable>();
             add<ChunkManagerTests::OrEqualityUnsatisfiableInequality>();
             add<ChunkManagerTests::InMultiShard>();
+            add<ChunkManagerTests::RoutingNumeric>();
+            add<ChunkManagerTests::RoutingString>();
+            add<ChunkManagerTests::RoutingMixed>();
         }
     } myall;
     
@@ -20,6 +20,9 @@
 
 #include "mongo/pch.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/cursor.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/instance.h"
@@ -643,6 +646,149 @@ namespace CursorTests {
             
         } // namespace Pin
 
+        /**
+         * Cursor ids spread over the stripes of the registry, and the registry wide operations see
+         * the cursors in all of them.
+         */
+        class Stripes {
+        public:
+            void run() {
+                Client::Transaction transaction(DB_SERIALIZABLE);
+                {
+                    Client::WriteContext ctx( ns(), mongo::unittest::EMPTY_STRING );
+                    const unsigned before = ClientCursor::numCursors();
+                    set<CursorId> ids;
+                    set<unsigned> stripes;
+                    for ( int i = 0; i < 100; i++ ) {
+                        ClientCursor *cc = new ClientCursor( 0, BasicCursor::make( getCollection( ns() ) ), ns() );
+                        ASSERT( ids.insert( cc->cursorid() ).second );
+                        ASSERT( cc->cursorid() > 0 );
+                        stripes.insert( ClientCursor::stripeOf( cc->cursorid() ) );
+                    }
+                    ASSERT( stripes.size() > 1 );
+                    ASSERT_EQUALS( before + 100, ClientCursor::numCursors() );
+
+                    set<CursorId> found;
+                    ClientCursor::find( ns(), found );
+                    ASSERT( ids == found );
+
+                    // pins and touches find cursors in every stripe
+                    for ( set<CursorId>::const_iterator it = ids.begin(); it != ids.end(); ++it ) {
+                        ASSERT( ClientCursor::touch( *it ) );
+                        ClientCursor::Pin pin( *it );
+                        ASSERT( pin.c() );
+                        ASSERT_EQUALS( *it, pin.c()->cursorid() );
+                    }
+
+                    // delete half of them through the iterator, and the rest by id
+                    int seen = 0;
+                    for ( ClientCursor::LockedIterator i; i.ok(); ) {
+                        const CursorId id = i.current()->cursorid();
+                        if ( ids.count( id ) && ( seen++ % 2 == 0 ) ) {
+                            i.deleteAndAdvance();
+                            ids.erase( id );
+                        }
+                        else {
+                            i.advance();
+                        }
+                    }
+                    ASSERT_EQUALS( 100, seen );
+                    ASSERT_EQUALS( 50U, ids.size() );
+                    ASSERT_EQUALS( before + 50, ClientCursor::numCursors() );
+                    found.clear();
+                    ClientCursor::find( ns(), found );
+                    ASSERT( ids == found );
+
+                    for ( set<CursorId>::const_iterator it = ids.begin(); it != ids.end(); ++it ) {
+                        ASSERT( ClientCursor::erase( *it ) );
+                        ASSERT( !ClientCursor::erase( *it ) );
+                    }
+                    ASSERT_EQUALS( before, ClientCursor::numCursors() );
+                }
+                transaction.commit();
+            }
+        };
+
+        /**
+         * Stands in for an aggregation cursor: deleting it deletes the inner ClientCursor it
+         * holds, the way a pipeline's DocumentSourceCursor does.
+         */
+        class NestingCursor : public Cursor {
+        public:
+            bool ok() { return false; }
+            BSONObj current() { return BSONObj(); }
+            bool advance() { return false; }
+            virtual bool getsetdup(const BSONObj &pk) { return false; }
+            virtual bool isMultiKey() const { return false; }
+            virtual bool modifiedKeys() const { return false; }
+            virtual long long nscanned() const { return 0; }
+            void setInner( ClientCursor *inner ) { _inner.reset( inner ); }
+        private:
+            ClientCursor::Holder _inner;
+        };
+
+        /**
+         * Cursors that delete nested cursors in other stripes can be erased from several threads
+         * at once.  Half the pairs nest from a lower stripe into a higher one and half the other
+         * way, so erasing while holding the outer cursor's stripe would deadlock.
+         */
+        class NestedEraseConcurrent {
+        public:
+            void run() {
+                const unsigned before = ClientCursor::numCursors();
+                vector<CursorId> outer;
+                set<CursorId> inner;
+                Client::Transaction transaction(DB_SERIALIZABLE);
+                {
+                    Client::WriteContext ctx( ns(), mongo::unittest::EMPTY_STRING );
+                    for ( int i = 0; i < 256; i++ ) {
+                        shared_ptr<NestingCursor> a( new NestingCursor() );
+                        shared_ptr<NestingCursor> b( new NestingCursor() );
+                        ClientCursor *ca = new ClientCursor( 0, a, ns() );
+                        ClientCursor *cb = new ClientCursor( 0, b, ns() );
+                        const bool aIsLower = ClientCursor::stripeOf( ca->cursorid() ) <
+                                              ClientCursor::stripeOf( cb->cursorid() );
+                        if ( aIsLower == ( i % 2 == 0 ) ) {
+                            a->setInner( cb );
+                            outer.push_back( ca->cursorid() );
+                            inner.insert( cb->cursorid() );
+                        }
+                        else {
+                            b->setInner( ca );
+                            outer.push_back( cb->cursorid() );
+                            inner.insert( ca->cursorid() );
+                        }
+                    }
+                }
+                transaction.commit();
+                ASSERT_EQUALS( before + 512, ClientCursor::numCursors() );
+
+                boost::thread_group threads;
+                for ( int t = 0; t < kThreads; t++ ) {
+                    threads.create_thread( boost::bind( &NestedEraseConcurrent::eraseEvery,
+                                                        this, &outer, t ) );
+                }
+                threads.join_all();
+
+                ASSERT_EQUALS( outer.size(), _erased.load() );
+                ASSERT_EQUALS( before, ClientCursor::numCursors() );
+                for ( set<CursorId>::const_iterator it = inner.begin(); it != inner.end(); ++it ) {
+                    ASSERT( !ClientCursor::erase( *it ) );
+                }
+            }
+        private:
+            static const int kThreads = 8;
+            /** Erases outer[start], outer[start + kThreads], ... */
+            void eraseEvery( const vector<CursorId> *outer, int start ) {
+                for ( size_t i = start; i < outer->size(); i += kThreads ) {
+                    if ( ClientCursor::erase( (*outer)[i] ) ) {
+                        _erased.fetchAndAdd( 1 );
+                    }
+                }
+            }
+            AtomicUInt32 _erased;
+        };
+
     } // namespace ClientCursor
     
     class All : public Suite {
@@ -667,6 +813,8 @@ namespace CursorTests {
             add<ClientCursor::Pin::PinCursor>();
             add<ClientCursor::Pin::PinTwice>();
             add<ClientCursor::Pin::CursorDeleted>();
+            add<ClientCursor::Stripes>();
+            add<ClientCursor::NestedEraseConcurrent>();
         }
     } myall;
 } // namespace CursorTests
@@ -882,6 +882,45 @@ namespace DocumentSourceTests {
             string expectedResultSetString() { return "[{_id:[1,2,3],a:[[4,5,6]]}]"; }
         };
 
+        /**
+         * The _ids of a spill partition that is too big are spread over the partitions it is
+         * split into, at every depth, rather than all landing in one of them.
+         */
+        class SpillPartitionsSplit {
+        public:
+            void run() {
+                const size_t n = mongo::DocumentSourceGroup::nSpillPartitions;
+                vector<Value> ids;
+                for( int i = 0; i < 500000; ++i ) {
+                    ids.push_back( i % 2 ? Value( i ) : Value( string( str::stream() << "id" << i ) ) );
+                }
+                for( unsigned depth = 0; depth < 3; ++depth ) {
+                    // Keep the _ids of one partition at this depth.
+                    vector<Value> partition;
+                    for( size_t i = 0; i < ids.size(); ++i ) {
+                        if ( mongo::DocumentSourceGroup::spillPartitionFor( ids[ i ], depth ) == 0 ) {
+                            partition.push_back( ids[ i ] );
+                        }
+                    }
+                    ASSERT( partition.size() < ids.size() / 2 );
+                    ASSERT( !partition.empty() );
+
+                    // Splitting it one level down shrinks every sub-partition.
+                    vector<size_t> counts( n );
+                    for( size_t i = 0; i < partition.size(); ++i ) {
+                        const size_t sub = mongo::DocumentSourceGroup::spillPartitionFor(
+                                partition[ i ], depth + 1 );
+                        ASSERT( sub < n );
+                        ++counts[ sub ];
+                    }
+                    for( size_t i = 0; i < n; ++i ) {
+                        ASSERT( counts[ i ] < partition.size() / 2 );
+                    }
+                    ids.swap( partition );
+                }
+            }
+        };
+
     } // namespace DocumentSourceGroup
 
     namespace DocumentSourceProject {
@@ -1788,6 +1827,7 @@ namespace DocumentSourceTests {
             add<DocumentSourceGroup::FourValuesTwoKeysTwoAccumulators>();
             add<DocumentSourceGroup::GroupNullUndefinedIds>();
             add<DocumentSourceGroup::ComplexId>();
+            add<DocumentSourceGroup::SpillPartitionsSplit>();
             add<DocumentSourceGroup::UndefinedAccumulatorValue>();
             add<DocumentSourceGroup::RouterMerger>();
             add<DocumentSourceGroup::Dependencies>();
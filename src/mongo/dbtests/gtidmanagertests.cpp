@@ -18,6 +18,7 @@
 #include "pch.h"
 #include "dbtests.h"
 #include "mongo/db/gtid.h"
+#include "mongo/db/repl/applier_pool.h"
 
 namespace mongo {
     class GTIDManagerTest {
@@ -271,6 +272,107 @@ namespace mongo {
 }
 
 namespace GTIDManagerTests {
+
+    static BSONObj txnEntry(const BSONArray& ops) {
+        return BSON("_id" << 1 << "a" << false << "ops" << ops);
+    }
+
+    class ConflictKeys {
+    public:
+        void run() {
+            vector<uint64_t> a, b;
+
+            // the same row in different ops conflicts, regardless of how its _id is typed
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "i" << "ns" << "test.foo" << "o" << BSON("_id" << 1 << "x" << 1)))), &a));
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "d" << "ns" << "test.foo" << "o" << BSON("_id" << 1.0 << "x" << 2)))), &b));
+            ASSERT_EQUALS(1U, a.size());
+            ASSERT_EQUALS(1U, b.size());
+            ASSERT_EQUALS(a[0], b[0]);
+
+            // updates logged with only a pk use its trailing _id
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "ur" << "ns" << "test.foo" << "pk" << BSON("" << 5 << "" << 1LL) << "m" << BSON("$inc" << BSON("x" << 1))))), &b));
+            ASSERT_EQUALS(1U, b.size());
+            ASSERT_EQUALS(a[0], b[0]);
+
+            // different rows or collections don't conflict
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "i" << "ns" << "test.foo" << "o" << BSON("_id" << 2)))), &b));
+            ASSERT_NOT_EQUALS(a[0], b[0]);
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "i" << "ns" << "test.bar" << "o" << BSON("_id" << 1)))), &b));
+            ASSERT_NOT_EQUALS(a[0], b[0]);
+
+            // embedded _ids are canonicalized field by field, like numeric _ids
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "i" << "ns" << "test.foo" << "o" << BSON("_id" << BSON("a" << 1 << "b" << BSON_ARRAY(2 << "x")))))), &a));
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "d" << "ns" << "test.foo" << "o" << BSON("_id" << BSON("a" << 1.0 << "b" << BSON_ARRAY(2LL << "x")))))), &b));
+            ASSERT_EQUALS(a[0], b[0]);
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "d" << "ns" << "test.foo" << "o" << BSON("_id" << BSON("a" << 1 << "c" << BSON_ARRAY(2 << "x")))))), &b));
+            ASSERT_NOT_EQUALS(a[0], b[0]);
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "d" << "ns" << "test.foo" << "o" << BSON("_id" << BSON("a" << 1 << "b" << BSON_ARRAY(3 << "x")))))), &b));
+            ASSERT_NOT_EQUALS(a[0], b[0]);
+
+            // every op in a transaction contributes a key
+            ASSERT(getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "i" << "ns" << "test.foo" << "o" << BSON("_id" << 1)) <<
+                                                          BSON("op" << "i" << "ns" << "test.foo" << "o" << BSON("_id" << 2)) <<
+                                                          BSON("op" << "n" << "o" << BSON("msg" << "comment")))), &b));
+            ASSERT_EQUALS(2U, b.size());
+
+            // commands, system collections and refs to oplog.refs must be applied alone
+            ASSERT(!getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "c" << "ns" << "test.$cmd" << "o" << BSON("drop" << "foo")))), &b));
+            ASSERT(!getTxnConflictKeys(txnEntry(BSON_ARRAY(BSON("op" << "i" << "ns" << "test.system.indexes" << "o" << BSON("_id" << 1)))), &b));
+            ASSERT(!getTxnConflictKeys(BSON("_id" << 1 << "a" << false << "ref" << OID::gen()), &b));
+            ASSERT(b.empty());
+        }
+    };
+
+    class ApplierPoolOrdering {
+        boost::mutex _m;
+        map<uint64_t, int> _running;
+        vector<int> _order;
+        bool _overlapped;
+
+        void task(uint64_t key, int seq) {
+            {
+                boost::mutex::scoped_lock lk(_m);
+                if (_running[key]++ > 0) {
+                    _overlapped = true;
+                }
+            }
+            sleepmillis(1);
+            boost::mutex::scoped_lock lk(_m);
+            _running[key]--;
+            if (key == 0) {
+                _order.push_back(seq);
+            }
+        }
+    public:
+        ApplierPoolOrdering() : _overlapped(false) {}
+        void run() {
+            ReplApplierPool pool(4);
+            ASSERT_EQUALS(4U, pool.numWorkers());
+            for (int i = 0; i < 200; i++) {
+                vector<uint64_t> keys;
+                keys.push_back(i % 5);
+                pool.schedule(keys, boost::bind(&ApplierPoolOrdering::task, this, (uint64_t) i % 5, i));
+            }
+            pool.drain();
+            // tasks sharing a key never ran at the same time, and ran in order
+            ASSERT(!_overlapped);
+            ASSERT_EQUALS(40U, _order.size());
+            for (size_t i = 1; i < _order.size(); i++) {
+                ASSERT(_order[i - 1] < _order[i]);
+            }
+
+            BSONArrayBuilder ab;
+            pool.appendStats(ab);
+            BSONArray stats = ab.arr();
+            long long total = 0;
+            for (BSONObjIterator it(stats); it.more(); ) {
+                total += it.next().Obj()["ops"].numberLong();
+            }
+            ASSERT_EQUALS(200, total);
+            pool.shutdown();
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "GTIDManager" ) {
@@ -278,6 +380,8 @@ namespace GTIDManagerTests {
 
         void setupTests() {
             add<GTIDManagerTest>();
+            add<ConflictKeys>();
+            add<ApplierPoolOrdering>();
         }
 
     } all;
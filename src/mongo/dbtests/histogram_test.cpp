@@ -20,6 +20,9 @@
 
 #include "dbtests.h"
 #include "../util/histogram.h"
+#include "../util/latency_histogram.h"
+
+#include <boost/thread/thread.hpp>
 
 namespace mongo {
 
@@ -79,6 +82,114 @@ namespace mongo {
         }
     };
 
+    class LatencyBuckets {
+    public:
+        void run() {
+            // small values get a bucket each
+            for ( uint64_t v = 0; v < LatencyHistogram::kSubBuckets; v++ ) {
+                ASSERT_EQUALS( LatencyHistogram::bucketFor( v ), v );
+                ASSERT_EQUALS( LatencyHistogram::bucketUpperBound( v ), v );
+            }
+            // every value falls in the bucket whose bounds contain it, and the buckets are
+            // never wider than 1/kSubBuckets of their values
+            uint64_t lower = 0;
+            for ( uint32_t b = 0; b < LatencyHistogram::kNumBuckets - 1; b++ ) {
+                const uint64_t upper = LatencyHistogram::bucketUpperBound( b );
+                ASSERT( upper >= lower );
+                ASSERT_EQUALS( LatencyHistogram::bucketFor( lower ), b );
+                ASSERT_EQUALS( LatencyHistogram::bucketFor( upper ), b );
+                ASSERT( ( upper - lower ) * LatencyHistogram::kSubBuckets <= lower );
+                lower = upper + 1;
+            }
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 1ULL << LatencyHistogram::kMaxBits ),
+                           LatencyHistogram::kNumBuckets - 1 );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( numeric_limits<uint64_t>::max() ),
+                           LatencyHistogram::kNumBuckets - 1 );
+        }
+    };
+
+    class LatencyPercentiles {
+    public:
+        void run() {
+            LatencyHistogram h;
+            ASSERT_EQUALS( h.percentile( 50 ), 0u );
+
+            for ( uint64_t v = 1; v <= 1000; v++ ) {
+                h.record( v );
+            }
+            ASSERT_EQUALS( h.count(), 1000u );
+            ASSERT_EQUALS( h.sum(), 500500u );
+            ASSERT_EQUALS( h.max(), 1000u );
+            ASSERT_EQUALS( h.percentile( 100 ), 1000u );
+            ASSERT_EQUALS( h.percentile( 0.05 ), 1u );
+            assertClose( h.percentile( 50 ), 500 );
+            assertClose( h.percentile( 99 ), 990 );
+            assertClose( h.percentile( 99.9 ), 999 );
+
+            // one slow outlier shows up in the tail only
+            LatencyHistogram outlier;
+            for ( int i = 0; i < 999; i++ ) {
+                outlier.record( 100 );
+            }
+            outlier.record( 5000000 );
+            assertClose( outlier.percentile( 99.9 ), 100 );
+            ASSERT_EQUALS( outlier.percentile( 100 ), 5000000u );
+
+            h.merge( outlier );
+            ASSERT_EQUALS( h.count(), 2000u );
+            ASSERT_EQUALS( h.max(), 5000000u );
+        }
+    private:
+        static void assertClose( uint64_t actual, uint64_t expected ) {
+            ASSERT( actual >= expected );
+            ASSERT( actual <= expected + expected / LatencyHistogram::kSubBuckets );
+        }
+    };
+
+    class LatencyAppend {
+    public:
+        void run() {
+            LatencyHistogram h;
+            h.record( 3 );
+            h.record( 7 );
+            BSONObjBuilder b;
+            h.append( b, LatencyHistogram::parsePercentiles( BSON( "p" << BSON_ARRAY( 50 << 99.9 ) ).firstElement() ) );
+            ASSERT_EQUALS( b.obj(), BSON( "count" << 2 << "totalMicros" << 10 << "maxMicros" << 7 <<
+                                          "percentiles" << BSON( "p50" << 3 << "p99.9" << 7 ) ) );
+
+            ASSERT_EQUALS( LatencyHistogram::parsePercentiles( BSONElement() ).size(), 4u );
+            ASSERT_THROWS( LatencyHistogram::parsePercentiles( BSON( "p" << 50 ).firstElement() ), UserException );
+            ASSERT_THROWS( LatencyHistogram::parsePercentiles( BSON( "p" << BSON_ARRAY( 0 ) ).firstElement() ), UserException );
+            ASSERT_THROWS( LatencyHistogram::parsePercentiles( BSON( "p" << BSON_ARRAY( 101 ) ).firstElement() ), UserException );
+        }
+    };
+
+    class LatencyPartitioned {
+    public:
+        void run() {
+            PartitionedLatencyHistogram plh;
+            plh.record( 10 );
+            // values recorded by threads that have exited are kept
+            boost::thread_group threads;
+            for ( int i = 0; i < 4; i++ ) {
+                threads.create_thread( boost::bind( &LatencyPartitioned::recordMany, &plh, 1000 * ( i + 1 ) ) );
+            }
+            threads.join_all();
+
+            LatencyHistogram h;
+            plh.snapshot( h );
+            ASSERT_EQUALS( h.count(), 4001u );
+            ASSERT_EQUALS( h.max(), 4000u );
+            ASSERT_EQUALS( h.percentile( 0.01 ), 10u );
+        }
+    private:
+        static void recordMany( PartitionedLatencyHistogram* plh, uint64_t micros ) {
+            for ( int i = 0; i < 1000; i++ ) {
+                plh->record( micros );
+            }
+        }
+    };
+
     class HistogramSuite : public Suite {
     public:
         HistogramSuite() : Suite( "histogram" ) {}
@@ -87,6 +198,10 @@ namespace mongo {
             add< BoundariesInit >();
             add< BoundariesExponential >();
             add< BoundariesFind >();
+            add< LatencyBuckets >();
+            add< LatencyPercentiles >();
+            add< LatencyAppend >();
+            add< LatencyPartitioned >();
             // TODO: complete the test suite
         }
     } histogramSuite;
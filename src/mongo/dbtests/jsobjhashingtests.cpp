@@ -18,23 +18,32 @@
  */
 
 
+#include "mongo/db/descriptor.h"
 #include "mongo/db/hasher.h"
 #include "mongo/db/json.h"
+#include "mongo/db/keypattern.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/timer.h"
 
 namespace JsobjHashingTests {
 
+    // The properties every hash version must have.
+    template< HashVersion V >
     class BSONElementHashingTest {
     public:
+        static long long int hash( const BSONElement& e , HashSeed seed ) {
+            return BSONElementHasher::hash64( e , seed , V );
+        }
+
         void run() {
             int seed = 0;
 
             //test different oids hash to different things
-            long long int oidHash = BSONElementHasher::hash64(
+            long long int oidHash = hash(
                     BSONObjBuilder().genOID().obj().firstElement() , seed );
-            long long int oidHash2 = BSONElementHasher::hash64(
+            long long int oidHash2 = hash(
                     BSONObjBuilder().genOID().obj().firstElement() , seed );
-            long long int oidHash3 = BSONElementHasher::hash64(
+            long long int oidHash3 = hash(
                     BSONObjBuilder().genOID().obj().firstElement() , seed );
 
             ASSERT_NOT_EQUALS( oidHash , oidHash2 );
@@ -44,53 +53,53 @@ namespace JsobjHashingTests {
             //test 32-bit ints, 64-bit ints, doubles hash to same thing
             int i = 3;
             BSONObj p1 = BSON("a" << i);
-            long long int intHash = BSONElementHasher::hash64( p1.firstElement() , seed );
+            long long int intHash = hash( p1.firstElement() , seed );
 
             long long int ilong = 3;
             BSONObj p2 = BSON("a" << ilong);
-            long long int longHash = BSONElementHasher::hash64( p2.firstElement() , seed );
+            long long int longHash = hash( p2.firstElement() , seed );
 
             double d = 3.1;
             BSONObj p3 = BSON("a" << d);
-            long long int doubleHash = BSONElementHasher::hash64( p3.firstElement() , seed );
+            long long int doubleHash = hash( p3.firstElement() , seed );
 
             ASSERT_EQUALS( intHash, longHash );
             ASSERT_EQUALS( doubleHash, longHash );
 
             //test different ints don't hash to same thing
             BSONObj p4 = BSON("a" << 4);
-            long long int intHash4 = BSONElementHasher::hash64( p4.firstElement() , seed );
+            long long int intHash4 = hash( p4.firstElement() , seed );
             ASSERT_NOT_EQUALS( intHash , intHash4 );
 
             //test seed makes a difference
-            long long int intHash4Seed = BSONElementHasher::hash64( p4.firstElement() , 1 );
+            long long int intHash4Seed = hash( p4.firstElement() , 1 );
             ASSERT_NOT_EQUALS( intHash4 , intHash4Seed );
 
             //test strings hash to different things
             BSONObj p5 = BSON("a" << "3");
-            long long int stringHash = BSONElementHasher::hash64( p5.firstElement() , seed );
+            long long int stringHash = hash( p5.firstElement() , seed );
             ASSERT_NOT_EQUALS( intHash , stringHash );
 
             //test regexps and strings hash to different things
             BSONObjBuilder b;
             b.appendRegex("a","3");
-            long long int regexHash = BSONElementHasher::hash64( b.obj().firstElement() , seed );
+            long long int regexHash = hash( b.obj().firstElement() , seed );
             ASSERT_NOT_EQUALS( stringHash , regexHash );
 
             //test arrays and subobject hash to different things
             BSONObj p6 = fromjson("{a : {'0' : 0 , '1' : 1}}");
             BSONObj p7 = fromjson("{a : [0,1]}");
             ASSERT_NOT_EQUALS(
-                    BSONElementHasher::hash64( p6.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p7.firstElement() , seed )
+                    hash( p6.firstElement() , seed ) ,
+                    hash( p7.firstElement() , seed )
             );
 
             //testing sub-document grouping
             BSONObj p8 = fromjson("{x : {a : {}, b : 1}}");
             BSONObj p9 = fromjson("{x : {a : {b : 1}}}");
             ASSERT_NOT_EQUALS(
-                    BSONElementHasher::hash64( p8.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p9.firstElement() , seed )
+                    hash( p8.firstElement() , seed ) ,
+                    hash( p9.firstElement() , seed )
             );
 
             //testing codeWscope scope squashing
@@ -104,28 +113,28 @@ namespace JsobjHashingTests {
             BSONObjBuilder b3;
             b3.appendCodeWScope("a","print('this is \nsome stupider code')", BSON("a" << 3));
             ASSERT_EQUALS(
-                    BSONElementHasher::hash64( p10.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( b2.obj().firstElement() , seed )
+                    hash( p10.firstElement() , seed ) ,
+                    hash( b2.obj().firstElement() , seed )
             );
             ASSERT_NOT_EQUALS(
-                    BSONElementHasher::hash64( p10.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( b3.obj().firstElement() , seed )
+                    hash( p10.firstElement() , seed ) ,
+                    hash( b3.obj().firstElement() , seed )
             );
 
             //test some recursive squashing
             BSONObj p11 = fromjson("{x : {a : 3 , b : [ 3.1, {c : 3}]}}");
             BSONObj p12 = fromjson("{x : {a : 3.1 , b : [3, {c : 3.0}]}}");
             ASSERT_EQUALS(
-                    BSONElementHasher::hash64( p11.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p12.firstElement() , seed )
+                    hash( p11.firstElement() , seed ) ,
+                    hash( p12.firstElement() , seed )
             );
 
             //test minkey and maxkey don't hash to same thing
             BSONObj p13 = BSON("a" << MAXKEY);
             BSONObj p14 = BSON("a" << MINKEY);
             ASSERT_NOT_EQUALS(
-                    BSONElementHasher::hash64( p13.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p14.firstElement() , seed )
+                    hash( p13.firstElement() , seed ) ,
+                    hash( p14.firstElement() , seed )
             );
 
             //test squashing very large doubles and very small doubles
@@ -136,12 +145,12 @@ namespace JsobjHashingTests {
             BSONObj p16 = BSON("a" << smallerDouble );
             BSONObj p17 = BSON("a" << biggerDouble );
             ASSERT_NOT_EQUALS(
-                    BSONElementHasher::hash64( p15.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p16.firstElement() , seed )
+                    hash( p15.firstElement() , seed ) ,
+                    hash( p16.firstElement() , seed )
             );
             ASSERT_EQUALS(
-                    BSONElementHasher::hash64( p15.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p17.firstElement() , seed )
+                    hash( p15.firstElement() , seed ) ,
+                    hash( p17.firstElement() , seed )
             );
 
             long long minInt = std::numeric_limits<long long>::min();
@@ -149,20 +158,136 @@ namespace JsobjHashingTests {
             BSONObj p18 = BSON("a" << minInt );
             BSONObj p19 = BSON("a" << negativeDouble );
             ASSERT_EQUALS(
-                    BSONElementHasher::hash64( p18.firstElement() , seed ) ,
-                    BSONElementHasher::hash64( p19.firstElement() , seed )
+                    hash( p18.firstElement() , seed ) ,
+                    hash( p19.firstElement() , seed )
             );
 
         }
     };
 
+    // Hashed indexes and hashed shard keys store these, they must never change.
+    class HashVersionValues {
+    public:
+        void run() {
+            BSONObj o = BSON( "check" << 42 );
+            ASSERT_EQUALS( -944302157085130861LL ,
+                           BSONElementHasher::hash64( o.firstElement() , 0 ) );
+            ASSERT_EQUALS( -944302157085130861LL ,
+                           BSONElementHasher::hash64( o.firstElement() , 0 , HASH_VERSION_MD5 ) );
+            ASSERT_EQUALS( 8715208212397937794LL ,
+                           BSONElementHasher::hash64( o.firstElement() , 0 ,
+                                                      HASH_VERSION_MURMUR3 ) );
+
+            ASSERT( isValidHashVersion( HASH_VERSION_MD5 ) );
+            ASSERT( isValidHashVersion( HASH_VERSION_MURMUR3 ) );
+            ASSERT( !isValidHashVersion( -1 ) );
+            ASSERT( !isValidHashVersion( NEXT_HASH_VERSION ) );
+            ASSERT_THROWS( BSONElementHasher::hash64( o.firstElement() , 0 , NEXT_HASH_VERSION ) ,
+                           MsgAssertionException );
+        }
+    };
+
+    // A long element goes past the murmur hasher's stack buffer.
+    class LongElements {
+    public:
+        void run() {
+            string big( 4096 , 'x' );
+            BSONObj a = BSON( "a" << big );
+            big[ 4000 ] = 'y';
+            BSONObj b = BSON( "a" << big );
+            ASSERT_EQUALS( BSONElementHasher::hash64( a.firstElement() , 0 , HASH_VERSION_MURMUR3 ) ,
+                           BSONElementHasher::hash64( a.firstElement() , 0 , HASH_VERSION_MURMUR3 ) );
+            ASSERT_NOT_EQUALS( BSONElementHasher::hash64( a.firstElement() , 0 , HASH_VERSION_MURMUR3 ) ,
+                               BSONElementHasher::hash64( b.firstElement() , 0 , HASH_VERSION_MURMUR3 ) );
+        }
+    };
+
+    // The descriptor of a hashed index remembers its hash version, old ones are MD5.
+    class DescriptorHashVersion {
+    public:
+        void run() {
+            const BSONObj keyPattern = BSON( "a" << "hashed" );
+            const BSONObj doc = BSON( "a" << 3 );
+            for ( HashVersion v = HASH_VERSION_MD5; v < NEXT_HASH_VERSION; v++ ) {
+                const Descriptor d( keyPattern , true , 5 , v );
+                BSONObjSet keys;
+                d.generateKeys( doc , keys );
+                ASSERT_EQUALS( 1U , keys.size() );
+                ASSERT_EQUALS( BSON( "" << BSONElementHasher::hash64( doc.firstElement() , 5 , v ) ) ,
+                               *keys.begin() );
+            }
+
+            const Descriptor old( keyPattern , true , 0 );
+            BSONObjSet keys;
+            old.generateKeys( doc , keys );
+            ASSERT_EQUALS( BSON( "" << BSONElementHasher::hash64( doc.firstElement() , 0 ) ) ,
+                           *keys.begin() );
+        }
+    };
+
+    // Shard key extraction and routing bounds use the shard key's hash version.
+    class KeyPatternHashVersion {
+    public:
+        void run() {
+            const BSONObj doc = BSON( "a" << 3 );
+            const long long md5 = BSONElementHasher::hash64( doc.firstElement() , 0 );
+            const long long murmur = BSONElementHasher::hash64( doc.firstElement() , 0 ,
+                                                                HASH_VERSION_MURMUR3 );
+            ASSERT_EQUALS( BSON( "a" << md5 ) ,
+                           KeyPattern( BSON( "a" << "hashed" ) ).extractSingleKey( doc ) );
+            ASSERT_EQUALS( BSON( "a" << murmur ) ,
+                           KeyPattern( BSON( "a" << "hashed" ) ,
+                                       HASH_VERSION_MURMUR3 ).extractSingleKey( doc ) );
+        }
+    };
+
+    // Not a correctness test: logs what hashing typical shard key values costs with each version.
+    class HashBenchmark {
+    public:
+        void run() {
+            const int n = 1000;
+            const int iterations = 200;
+            vector<BSONObj> values;
+            for ( int i = 0; i < n; i++ ) {
+                switch ( i % 3 ) {
+                case 0: values.push_back( BSONObjBuilder().genOID().obj() ); break;
+                case 1: values.push_back( BSON( "_id" << i * 7919LL ) ); break;
+                default: values.push_back( BSON( "_id" << "user" + BSONObjBuilder::numStr( i ) ) ); break;
+                }
+            }
+            long long micros[ NEXT_HASH_VERSION ];
+            for ( HashVersion v = HASH_VERSION_MD5; v < NEXT_HASH_VERSION; v++ ) {
+                Timer t;
+                long long sum = 0;
+                for ( int it = 0; it < iterations; it++ ) {
+                    for ( int i = 0; i < n; i++ ) {
+                        sum += BSONElementHasher::hash64( values[ i ].firstElement() , 0 , v );
+                    }
+                }
+                micros[ v ] = t.micros();
+                // keep the loop from being optimized away
+                ASSERT_NOT_EQUALS( 0 , sum );
+            }
+            const long long hashes = (long long) iterations * n;
+            log() << "hash64: " << hashes << " hashes, "
+                  << "md5 " << micros[ HASH_VERSION_MD5 ] << "us, "
+                  << "murmur3 " << micros[ HASH_VERSION_MURMUR3 ] << "us" << endl;
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "jsobjhashing" ) {
         }
 
         void setupTests() {
-            add< BSONElementHashingTest >();
+            add< BSONElementHashingTest< HASH_VERSION_MD5 > >();
+            add< BSONElementHashingTest< HASH_VERSION_MURMUR3 > >();
+            add< HashVersionValues >();
+            add< LongElements >();
+            add< DescriptorHashVersion >();
+            add< KeyPatternHashVersion >();
+            add< HashBenchmark >();
         }
     } myall;
 
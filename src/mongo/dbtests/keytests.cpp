@@ -0,0 +1,377 @@
+// keytests.cpp : storage::Key formats
+
+/*
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pch.h"
+#include "dbtests.h"
+
+#include <limits>
+
+#include "mongo/db/descriptor.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/storage/key.h"
+#include "mongo/util/timer.h"
+
+namespace KeyTests {
+
+    using storage::Key;
+    using storage::MemcmpKey;
+
+    static int sign(int c) {
+        return c < 0 ? -1 : (c > 0 ? 1 : 0);
+    }
+
+    // A single-field value of each type with a memcmp encoding, in ascending order,
+    // with equal values in the same group.
+    static vector<vector<BSONObj> > orderedValues() {
+        const double inf = std::numeric_limits<double>::infinity();
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const char binA[] = "ab";
+        const char binB[] = "ac";
+        const char binC[] = "abc";
+        BSONObj groups[][3] = {
+            { BSON("" << MINKEY) },
+            { BSON("" << BSONNULL) },
+            { BSON("" << nan) },
+            { BSON("" << -inf) },
+            { BSON("" << -1e300) },
+            { BSON("" << -9007199254740991LL), BSON("" << -9007199254740991.0) },
+            { BSON("" << -2.5) },
+            { BSON("" << -2), BSON("" << -2LL), BSON("" << -2.0) },
+            { BSON("" << -0.5) },
+            { BSON("" << 0), BSON("" << 0LL), BSON("" << -0.0) },
+            { BSON("" << 0.25) },
+            { BSON("" << 0.5) },
+            { BSON("" << 1), BSON("" << 1.0) },
+            { BSON("" << 1.5) },
+            { BSON("" << 2147483648LL), BSON("" << 2147483648.0) },
+            { BSON("" << 9007199254740991LL), BSON("" << 9007199254740991.0) },
+            { BSON("" << 9007199254740992.0) },
+            { BSON("" << 1152921504606846976.0) },
+            { BSON("" << 1e300) },
+            { BSON("" << inf) },
+            { BSON("" << "") },
+            { BSON("" << string("\0", 1)) },
+            { BSON("" << "a") },
+            { BSON("" << string("a\0", 2)) },
+            { BSON("" << "ab") },
+            { BSON("" << "b") },
+            { BSONObjBuilder().appendBinData("", 2, BinDataGeneral, binA).obj() },
+            { BSONObjBuilder().appendBinData("", 2, BinDataGeneral, binB).obj() },
+            { BSONObjBuilder().appendBinData("", 2, Function, binA).obj() },
+            { BSONObjBuilder().appendBinData("", 3, BinDataGeneral, binC).obj() },
+            { BSON("" << OID("000000000000000000000000")) },
+            { BSON("" << OID("0123456789abcdef01234567")) },
+            { BSON("" << false) },
+            { BSON("" << true) },
+            { BSON("" << Date_t(static_cast<unsigned long long>(-1000LL))) },
+            { BSON("" << Date_t(0)) },
+            { BSON("" << Date_t(1000)) },
+            { BSON("" << MAXKEY) },
+        };
+        vector<vector<BSONObj> > values;
+        for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+            vector<BSONObj> group;
+            for (int j = 0; j < 3 && !groups[i][j].isEmpty(); j++) {
+                group.push_back(groups[i][j].getOwned());
+            }
+            values.push_back(group);
+        }
+        return values;
+    }
+
+    class Base {
+    public:
+        virtual ~Base() {}
+    protected:
+        // Descriptor for an index with memcmp keys.
+        static Descriptor *descriptor(const BSONObj &keyPattern) {
+            return new Descriptor(keyPattern, false, 0, 0, false, false, Descriptor::VERSION_2);
+        }
+    };
+
+    class DescriptorVersion : public Base {
+    public:
+        void run() {
+            const Descriptor v1(BSON("a" << 1));
+            scoped_ptr<Descriptor> v2(descriptor(BSON("a" << 1)));
+            ASSERT_EQUALS((int) Descriptor::VERSION_1, v1.version());
+            ASSERT(!v1.memcmpKeys());
+            ASSERT_EQUALS((int) Descriptor::VERSION_2, v2->version());
+            ASSERT(v2->memcmpKeys());
+
+            const BSONObj key = BSON("" << 5);
+            ASSERT(!MemcmpKey::isMemcmpFormat(Key(key, NULL, v1).buf()));
+            ASSERT(MemcmpKey::isMemcmpFormat(Key(key, NULL, *v2).buf()));
+        }
+    };
+
+    class RoundTrip : public Base {
+    public:
+        void run() {
+            const vector<vector<BSONObj> > values = orderedValues();
+            const BSONObj pk = BSON("" << OID::gen() << "" << 7);
+            for (int direction = 1; direction >= -1; direction -= 2) {
+                scoped_ptr<Descriptor> dp(descriptor(BSON("a" << direction << "b" << 1)));
+                const Descriptor &d = *dp;
+                for (size_t i = 0; i < values.size(); i++) {
+                    for (size_t j = 0; j < values[i].size(); j++) {
+                        const BSONObj key = BSONObjBuilder().appendElements(values[i][j])
+                                                            .append("", "x").obj();
+                        const Key sKey(key, &pk, d);
+                        ASSERT(MemcmpKey::isMemcmpFormat(sKey.buf()));
+                        ASSERT_EQUALS(0, key.woCompare(sKey.key(), BSONObj(), false));
+                        ASSERT_EQUALS(pk, sKey.pk());
+
+                        // A key built from the buffer without the pk is exactly the
+                        // encoding of the key alone.
+                        const Key prefix(sKey.buf(), false);
+                        const Key keyOnly(key, NULL, d);
+                        ASSERT_EQUALS(keyOnly.size(), prefix.size());
+                        ASSERT_EQUALS(0, memcmp(keyOnly.buf(), prefix.buf(), prefix.size()));
+                        ASSERT_EQUALS(sKey.size(), Key(sKey.buf(), true).size());
+                        ASSERT(keyOnly.pk().isEmpty());
+                    }
+                }
+            }
+        }
+    };
+
+    class CanonicalNumbers : public Base {
+    public:
+        void run() {
+            scoped_ptr<Descriptor> dp(descriptor(BSON("a" << 1)));
+            const Descriptor &d = *dp;
+            ASSERT_EQUALS(NumberInt, Key(BSON("" << 5LL), NULL, d).key().firstElement().type());
+            ASSERT_EQUALS(NumberInt, Key(BSON("" << 5.0), NULL, d).key().firstElement().type());
+            ASSERT_EQUALS(NumberLong, Key(BSON("" << 1e15), NULL, d).key().firstElement().type());
+            ASSERT_EQUALS(NumberDouble, Key(BSON("" << 5.5), NULL, d).key().firstElement().type());
+            ASSERT_EQUALS(NumberDouble, Key(BSON("" << 1e300), NULL, d).key().firstElement().type());
+        }
+    };
+
+    // Every pair of keys compares the same with memcmp as with BSON.
+    class OrderMatchesBson : public Base {
+    public:
+        void run() {
+            const vector<vector<BSONObj> > values = orderedValues();
+            for (int direction = 1; direction >= -1; direction -= 2) {
+                const BSONObj keyPattern = BSON("a" << direction);
+                scoped_ptr<Descriptor> dp(descriptor(keyPattern));
+                const Descriptor &d = *dp;
+                const Ordering ordering = Ordering::make(keyPattern);
+                for (size_t i = 0; i < values.size(); i++) {
+                    for (size_t j = 0; j < values.size(); j++) {
+                        const int expected = direction * sign((int) i - (int) j);
+                        for (size_t x = 0; x < values[i].size(); x++) {
+                            for (size_t y = 0; y < values[j].size(); y++) {
+                                const BSONObj &l = values[i][x];
+                                const BSONObj &r = values[j][y];
+                                ASSERT_EQUALS(expected, sign(l.woCompare(r, ordering, false)));
+                                const Key lKey(l, NULL, d);
+                                const Key rKey(r, NULL, d);
+                                ASSERT_EQUALS(expected, Key::woCompare(lKey, rKey, ordering));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    class CompoundAndPK : public Base {
+    public:
+        void run() {
+            const BSONObj keyPattern = BSON("a" << 1 << "b" << -1);
+            scoped_ptr<Descriptor> dp(descriptor(keyPattern));
+            const Descriptor &d = *dp;
+            const Ordering &ordering = d.ordering();
+            const BSONObj pk1 = BSON("" << 1);
+            const BSONObj pk2 = BSON("" << 2);
+            // In index order: a ascending, then b descending, then pk ascending.
+            const BSONObj keys[][2] = {
+                { BSON("" << 1 << "" << "z"), pk1 },
+                { BSON("" << 1 << "" << "z"), pk2 },
+                { BSON("" << 1 << "" << "b"), pk1 },
+                { BSON("" << 1 << "" << ""), pk2 },
+                { BSON("" << 1 << "" << MINKEY), pk1 },
+                { BSON("" << 2 << "" << MAXKEY), pk1 },
+                { BSON("" << 2 << "" << 10), pk2 },
+                { BSON("" << 2 << "" << 9.5), pk1 },
+                { BSON("" << "a" << "" << BSONNULL), pk1 },
+            };
+            const size_t n = sizeof(keys) / sizeof(keys[0]);
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = 0; j < n; j++) {
+                    const Key lKey(keys[i][0], &keys[i][1], d);
+                    const Key rKey(keys[j][0], &keys[j][1], d);
+                    const Key lV1(keys[i][0], &keys[i][1]);
+                    const Key rV1(keys[j][0], &keys[j][1]);
+                    const int expected = sign((int) i - (int) j);
+                    ASSERT_EQUALS(expected, Key::woCompare(lKey, rKey, ordering));
+                    ASSERT_EQUALS(expected, Key::woCompare(lV1, rV1, ordering));
+                    // Mixed formats decode to BSON and agree.
+                    ASSERT_EQUALS(expected, Key::woCompare(lKey, rV1, ordering));
+                    ASSERT_EQUALS(expected, Key::woCompare(lV1, rKey, ordering));
+                }
+            }
+        }
+    };
+
+    // Keys with a value that has no memcmp encoding use the version 1 format,
+    // and still sort correctly against memcmp keys.
+    class Fallback : public Base {
+    public:
+        void run() {
+            const BSONObj keyPattern = BSON("a" << 1);
+            scoped_ptr<Descriptor> dp(descriptor(keyPattern));
+            const Descriptor &d = *dp;
+            const Ordering &ordering = d.ordering();
+            const BSONObj pk = BSON("" << 1);
+            const BSONObj objectPK = BSON("" << BSON("x" << 1));
+
+            const Key number(BSON("" << 5), &pk, d);
+            const Key str(BSON("" << "a"), &pk, d);
+            const Key object(BSON("" << BSON("x" << 1)), &pk, d);
+            const Key timestamp(BSONObjBuilder().appendTimestamp("", 1000ULL).obj(), &pk, d);
+            const Key numberObjectPK(BSON("" << 5), &objectPK, d);
+            ASSERT(MemcmpKey::isMemcmpFormat(number.buf()));
+            ASSERT(!MemcmpKey::isMemcmpFormat(object.buf()));
+            ASSERT(!MemcmpKey::isMemcmpFormat(timestamp.buf()));
+            ASSERT(!MemcmpKey::isMemcmpFormat(numberObjectPK.buf()));
+            ASSERT_EQUALS(BSON("" << BSON("x" << 1)), object.key());
+            ASSERT_EQUALS(objectPK, numberObjectPK.pk());
+
+            ASSERT_EQUALS(-1, Key::woCompare(number, str, ordering));
+            ASSERT_EQUALS(-1, Key::woCompare(str, object, ordering));
+            ASSERT_EQUALS(1, Key::woCompare(object, str, ordering));
+            ASSERT_EQUALS(-1, Key::woCompare(number, timestamp, ordering));
+            // Same key, pk 1 < pk { x: 1 }
+            ASSERT_EQUALS(-1, Key::woCompare(number, numberObjectPK, ordering));
+            ASSERT_EQUALS(1, Key::woCompare(numberObjectPK, number, ordering));
+        }
+    };
+
+    // Longs of magnitude 2^53 and above compare with doubles after rounding, so
+    // they use the version 1 format, and integral doubles that large decode as
+    // doubles: every comparison, in either format, still agrees with BSON.
+    class NumbersBeyondDoublePrecision : public Base {
+    public:
+        void run() {
+            const BSONObj keyPattern = BSON("a" << 1);
+            scoped_ptr<Descriptor> dp(descriptor(keyPattern));
+            const Descriptor &d = *dp;
+            const Ordering &ordering = d.ordering();
+            const long long twoTo53 = 1LL << 53;
+            const BSONObj values[] = {
+                BSON("" << std::numeric_limits<long long>::min()),
+                BSON("" << -9223372036854775808.0),
+                BSON("" << -twoTo53 - 1),
+                BSON("" << -9007199254740992.0),
+                BSON("" << -twoTo53 + 1),
+                BSON("" << 0),
+                BSON("" << twoTo53 - 1),
+                BSON("" << twoTo53),
+                BSON("" << 9007199254740992.0),
+                BSON("" << twoTo53 + 1),
+                BSON("" << 9007199254740994.0),
+                BSON("" << twoTo53 + 2),
+                BSON("" << 1152921504606846976.0),
+                BSON("" << std::numeric_limits<long long>::max()),
+                BSON("" << 9223372036854775808.0),
+            };
+            const size_t n = sizeof(values) / sizeof(values[0]);
+            const BSONObj pk = BSON("" << 1);
+
+            ASSERT(MemcmpKey::isMemcmpFormat(Key(BSON("" << twoTo53 - 1), NULL, d).buf()));
+            ASSERT(!MemcmpKey::isMemcmpFormat(Key(BSON("" << twoTo53), NULL, d).buf()));
+            ASSERT(!MemcmpKey::isMemcmpFormat(Key(BSON("" << -twoTo53), NULL, d).buf()));
+            const Key bigDouble(BSON("" << 9007199254740992.0), NULL, d);
+            ASSERT(MemcmpKey::isMemcmpFormat(bigDouble.buf()));
+            ASSERT_EQUALS(NumberDouble, bigDouble.key().firstElement().type());
+
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = 0; j < n; j++) {
+                    const int expected = sign(values[i].woCompare(values[j], ordering, false));
+                    const Key lKey(values[i], &pk, d);
+                    const Key rKey(values[j], &pk, d);
+                    const Key rV1(values[j], &pk);
+                    ASSERT_EQUALS(expected, Key::woCompare(lKey, rKey, ordering));
+                    ASSERT_EQUALS(expected, Key::woCompare(lKey, rV1, ordering));
+                }
+            }
+        }
+    };
+
+    // Not a correctness test: logs what the comparator costs with each key format.
+    class ComparatorBenchmark : public Base {
+    public:
+        void run() {
+            const BSONObj keyPattern = BSON("a" << 1 << "b" << -1);
+            const Descriptor v1(keyPattern);
+            scoped_ptr<Descriptor> v2(descriptor(keyPattern));
+            const int n = 1000;
+            const int iterations = 200;
+
+            vector<BSONObj> keys, pks;
+            for (int i = 0; i < n; i++) {
+                keys.push_back(BSON("" << (i % 37) << "" << ("user" + BSONObjBuilder::numStr(i % 101))));
+                pks.push_back(BSON("" << OID::gen()));
+            }
+            long long v1Micros = 0, v2Micros = 0;
+            long long v1Sum = 0, v2Sum = 0;
+            for (int pass = 0; pass < 2; pass++) {
+                const Descriptor &d = pass == 0 ? v1 : *v2;
+                vector<shared_ptr<Key> > sKeys;
+                for (int i = 0; i < n; i++) {
+                    sKeys.push_back(shared_ptr<Key>(new Key(keys[i], &pks[i], d)));
+                }
+                Timer t;
+                long long sum = 0;
+                for (int it = 0; it < iterations; it++) {
+                    for (int i = 1; i < n; i++) {
+                        sum += d.compareKeys(*sKeys[i - 1], *sKeys[i]);
+                    }
+                }
+                (pass == 0 ? v1Micros : v2Micros) = t.micros();
+                (pass == 0 ? v1Sum : v2Sum) = sum;
+            }
+            // Both formats must order the keys identically.
+            ASSERT_EQUALS(v1Sum, v2Sum);
+            const long long comparisons = (long long) iterations * (n - 1);
+            log() << "key comparator: " << comparisons << " comparisons, "
+                  << "version 1 keys " << v1Micros << "us, "
+                  << "memcmp keys " << v2Micros << "us" << endl;
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite("key") {}
+        void setupTests() {
+            add<DescriptorVersion>();
+            add<RoundTrip>();
+            add<CanonicalNumbers>();
+            add<OrderMatchesBson>();
+            add<CompoundAndPK>();
+            add<Fallback>();
+            add<NumbersBeyondDoublePrecision>();
+            add<ComparatorBenchmark>();
+        }
+    } myall;
+
+} // namespace KeyTests
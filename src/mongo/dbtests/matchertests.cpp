@@ -298,6 +298,44 @@ namespace MatcherTests {
         }
     };
 
+    /**
+     * A matcher evaluates its compiled program unless an elemMatchKey is requested, in which
+     * case it takes the general path.  Both must agree.
+     */
+    class CompiledMatchesGeneral {
+    public:
+        void run() {
+            const char *queries[] = {
+                "{a:1}", "{a:null}", "{a:{$ne:1}}", "{a:{$ne:null}}", "{a:{$gt:1,$lte:3}}",
+                "{a:{$in:[1,'x',null]}}", "{a:{$nin:[1,2]}}", "{a:{$in:[/^x/]}}", "{a:/^x/}",
+                "{a:{$not:/^x/}}", "{a:{$exists:true}}", "{a:{$exists:false}}", "{a:{$type:2}}",
+                "{a:{$mod:[2,1]}}", "{a:{$size:2}}", "{a:[1,2]}", "{a:{b:1}}",
+                "{a:{$elemMatch:{b:1}}}", "{a:{$elemMatch:{$gt:1}}}", "{a:{$not:{$gt:1}}}",
+                "{a:1,b:{$lt:5},c:{$exists:false}}", "{b:'x',a:{$gte:2}}", "{'':{$gt:0}}",
+                "{$or:[{a:1},{b:{$gt:2}}]}", "{$and:[{a:{$gt:0}},{a:{$lt:3}}]}",
+                "{f0:{$exists:true},f7:{$gte:0,$lt:100},f3:{$in:[1,2,3,4,5]},f9:/^abc/,"
+                "f5:{$ne:null}}"
+            };
+            const char *docs[] = {
+                "{}", "{a:1}", "{a:null}", "{a:2,b:1}", "{a:3,b:9,c:1}", "{a:'x'}", "{a:'yx'}",
+                "{a:[1,2]}", "{a:[3,4]}", "{a:[]}", "{a:[{b:1},{b:2}]}", "{a:{b:1}}",
+                "{a:[[1,2]]}", "{b:'x',a:2}", "{a:1,a:5}", "{'':1}", "{a:1.5}",
+                "{a:1.0,b:4}",
+                "{f0:0,f1:1,f2:2,f3:3,f4:4,f5:5,f6:6,f7:7,f8:8,f9:'abcdef'}",
+                "{f0:0,f1:1,f2:2,f3:3,f4:4,f5:null,f6:6,f7:7,f8:8,f9:'abcdef'}"
+            };
+            for( unsigned i = 0; i < sizeof( queries ) / sizeof( queries[ 0 ] ); ++i ) {
+                Matcher m( fromjson( queries[ i ] ) );
+                for( unsigned j = 0; j < sizeof( docs ) / sizeof( docs[ 0 ] ); ++j ) {
+                    BSONObj doc = fromjson( docs[ j ] );
+                    MatchDetails details;
+                    details.requestElemMatchKey();
+                    ASSERT_EQUALS( m.matches( doc, &details ), m.matches( doc ) );
+                }
+            }
+        }
+    };
+
     /**
      * Helper class to extract the top level equality fields of a matcher, which can serve as a
      * useful way to identify the matcher.
@@ -419,6 +457,7 @@ namespace MatcherTests {
             add<Covered::ElemMatchKeyIndexed>();
             add<Covered::ElemMatchKeyIndexedSingleKey>();
             add<AllTiming>();
+            add<CompiledMatchesGeneral>();
             add<Visit>();
             add<WithinBox>();
             add<WithinCenter>();
@@ -24,6 +24,10 @@
 
 #include "mongo/dbtests/dbtests.h"
 
+namespace mongo {
+    extern int planCacheMaxShapes;
+}
+
 namespace NamespaceTests {
 
     using boost::shared_ptr;
@@ -1087,6 +1091,90 @@ namespace NamespaceTests {
                 nsd()->getQueryCache().clearQueryCache();
                 assertCachedIndexKey( BSONObj() );
             }
+        };
+
+        /** The query plan cache keeps statistics for each query pattern. */
+        class QueryCacheStatistics : public CollectionTests::CachedPlanBase {
+        public:
+            void run() {
+                QueryCache &qc = nsd()->getQueryCache();
+                qc.clearQueryCache();
+                qc.registerCachedQueryPlanForPattern( _pattern,
+                        CachedQueryPlan( BSON( "a" << 1 ), 10, CandidatePlanCharacter( true, false ) ) );
+                // Runs of the cached plan are recorded, but don't move the nscanned it is
+                // measured against, however much it degrades.
+                for( int i = 1; i <= 20; ++i ) {
+                    qc.notePlanRun( _pattern, BSON( "a" << 1 ), 10 + i * 5, 100 + i );
+                }
+                // A run of a plan that is no longer cached is ignored.
+                qc.notePlanRun( _pattern, BSON( "b" << 1 ), 1000, 1000 );
+                ASSERT_EQUALS( 10, qc.cachedQueryPlanForPattern( _pattern ).nScanned() );
+                qc.noteReplan( _pattern );
+
+                BSONObj shape = onlyShape( qc );
+                ASSERT_EQUALS( BSON( "a" << 1 ), shape[ "plan" ].Obj() );
+                ASSERT_EQUALS( 1, shape[ "hits" ].numberLong() );
+                ASSERT_EQUALS( 1, shape[ "replans" ].numberLong() );
+                ASSERT_EQUALS( 20, shape[ "runs" ].numberLong() );
+                ASSERT_EQUALS( 10, shape[ "nscanned" ].numberLong() );
+                ASSERT_EQUALS( 110, shape[ "avgMicros" ].numberLong() );
+                // The most recent runs, oldest first.
+                BSONObj history = shape[ "nscannedHistory" ].Obj();
+                ASSERT_EQUALS( 8, history.nFields() );
+                ASSERT_EQUALS( 75, history.firstElement().numberLong() );
+                ASSERT_EQUALS( 110, history[ "7" ].numberLong() );
+
+                // A new plan starts a new nscanned history, but the shape's counters are kept.
+                qc.registerCachedQueryPlanForPattern( _pattern,
+                        CachedQueryPlan( BSON( "b" << 1 ), 5, CandidatePlanCharacter( true, false ) ) );
+                ASSERT_EQUALS( 5, qc.cachedQueryPlanForPattern( _pattern ).nScanned() );
+                shape = onlyShape( qc );
+                ASSERT_EQUALS( 2, shape[ "hits" ].numberLong() );
+                ASSERT_EQUALS( 1, shape[ "replans" ].numberLong() );
+                ASSERT_EQUALS( 0, shape[ "runs" ].numberLong() );
+                ASSERT_EQUALS( 0, shape[ "avgMicros" ].numberLong() );
+
+                qc.erase( _pattern );
+                ASSERT_EQUALS( 0U, qc.size() );
+                assertCachedIndexKey( BSONObj() );
+            }
+        private:
+            static BSONObj onlyShape( QueryCache &qc ) {
+                BSONArrayBuilder b;
+                qc.appendShapes( b );
+                BSONArray shapes = b.arr();
+                ASSERT_EQUALS( 1, shapes.nFields() );
+                return shapes.firstElement().Obj().getOwned();
+            }
+        };
+
+        /** The query plan cache evicts its least recently used patterns once full. */
+        class QueryCacheEviction : public CollectionTests::CachedPlanBase {
+        public:
+            QueryCacheEviction() : _oldMaxShapes( planCacheMaxShapes ) {
+            }
+            ~QueryCacheEviction() {
+                planCacheMaxShapes = _oldMaxShapes;
+            }
+            void run() {
+                QueryCache &qc = nsd()->getQueryCache();
+                qc.clearQueryCache();
+                // Two patterns per stripe.
+                planCacheMaxShapes = 32;
+                registerIndexKey( BSON( "a" << 1 ) );
+                for( int i = 0; i < 500; ++i ) {
+                    FieldRangeSet frs( ns(), BSON( BSONObjBuilder::numStr( i ) << 1 ), true, true );
+                    qc.registerCachedQueryPlanForPattern( QueryPattern( frs, BSONObj() ),
+                            CachedQueryPlan( BSON( "b" << 1 ), 1, CandidatePlanCharacter( true, false ) ) );
+                    ASSERT( qc.size() <= 32U );
+                    // Keep the first pattern in use, so it is never the one evicted.
+                    assertCachedIndexKey( BSON( "a" << 1 ) );
+                }
+                ASSERT( qc.size() > 16U );
+                qc.clearQueryCache();
+            }
+        private:
+            int _oldMaxShapes;
         };                                                                                         
         
     } // namespace CollectionTests
@@ -1137,6 +1225,8 @@ namespace NamespaceTests {
             add< IndexDetailsTests::IndexMissingField >();
             add< CollectionTests::SetIndexIsMultikey >();
             add< CollectionTests::ClearQueryCache >();
+            add< CollectionTests::QueryCacheStatistics >();
+            add< CollectionTests::QueryCacheEviction >();
         }
     } myall;
 } // namespace NamespaceTests
@@ -553,6 +553,7 @@ namespace QueryOptimizerTests {
                                                          BSON( "b" << 1 ), BSONObj() ) );
                 ASSERT( p->multikeyFrs().range( "a" ).universal() );
                 ASSERT_EQUALS( QueryPlan::Unhelpful, p->utility() );
+                ASSERT( p->skipScan() );
                 scoped_ptr<QueryPlan> p2( QueryPlan::make( nsd(), INDEXNO( "a" << 1 << "b" << 1 ),
                                                           FRSP( BSON( "b" << 1 << "c" << 1 ) ),
                                                           FRSP2( BSON( "b" << 1 << "c" << 1 ) ),
@@ -575,6 +576,36 @@ namespace QueryOptimizerTests {
                                                           BSONObj() ) );
                 ASSERT( p4->multikeyFrs().range( "b" ).universal() );
                 ASSERT_EQUALS( QueryPlan::Unhelpful, p4->utility() );
+                ASSERT( p4->skipScan() );
+            }
+        };
+
+        /** Only an equality after an unconstrained leading field makes for a skip scan. */
+        class SkipScan : public Base {
+        public:
+            void run() {
+                scoped_ptr<QueryPlan> p( QueryPlan::make( nsd(), INDEXNO( "a" << 1 << "b" << 1 ),
+                                                         FRSP( BSON( "b" << GT << 1 ) ),
+                                                         FRSP2( BSON( "b" << GT << 1 ) ),
+                                                         BSON( "b" << GT << 1 ), BSONObj() ) );
+                ASSERT_EQUALS( QueryPlan::Unhelpful, p->utility() );
+                ASSERT( !p->skipScan() );
+                scoped_ptr<QueryPlan> p2( QueryPlan::make( nsd(), INDEXNO( "a" << 1 << "b" << 1 ),
+                                                          FRSP( BSON( "b" << 1 ) ),
+                                                          FRSP2( BSON( "b" << 1 ) ),
+                                                          BSON( "b" << 1 ), BSON( "b" << 1 ) ) );
+                ASSERT_EQUALS( QueryPlan::Unhelpful, p2->utility() );
+                ASSERT( !p2->skipScan() );
+                scoped_ptr<QueryPlan> p3( QueryPlan::make( nsd(), INDEXNO( "a" << 1 << "b" << 1 << "c" << 1 ),
+                                                          FRSP( BSON( "c" << 1 ) ),
+                                                          FRSP2( BSON( "c" << 1 ) ),
+                                                          BSON( "c" << 1 ), BSONObj() ) );
+                ASSERT( p3->skipScan() );
+                scoped_ptr<QueryPlan> p4( QueryPlan::make( nsd(), INDEXNO( "a" << 1 ),
+                                                          FRSP( BSON( "b" << 1 ) ),
+                                                          FRSP2( BSON( "b" << 1 ) ),
+                                                          BSON( "b" << 1 ), BSONObj() ) );
+                ASSERT( !p4->skipScan() );
             }
         };
         
@@ -1083,6 +1114,43 @@ namespace QueryOptimizerTests {
             }
         };
 
+        /** A skip scan plan is only tried when no index helps, and races a table scan. */
+        class SkipScanIndex : public Base {
+        public:
+            void run() {
+                ensureIndex( ns(), BSON( "a" << 1 << "b" << 1 ), false, "a_1_b_1" );
+                shared_ptr<QueryPlanSet> qps = makeQps( BSON( "b" << 1 ) );
+                ASSERT_EQUALS( 2, qps->nPlans() );
+                ASSERT_EQUALS( 1, makeQps( BSON( "b" << GT << 1 ) )->nPlans() );
+                ensureIndex( ns(), BSON( "c" << 1 ), false, "c_1" );
+                ASSERT_EQUALS( 1, makeQps( BSON( "b" << 1 << "c" << 1 ) )->nPlans() );
+            }
+        };
+
+        class IntersectionPlan : public Base {
+        public:
+            void run() {
+                ensureIndex( ns(), BSON( "a" << 1 ), false, "a_1" );
+                ensureIndex( ns(), BSON( "b" << 1 ), false, "b_1" );
+                ensureIndex( ns(), BSON( "a" << 1 << "c" << 1 ), false, "a_1_c_1" );
+                shared_ptr<QueryPlanSet> qps = makeQps( BSON( "a" << 4 << "b" << 1 ) );
+                ASSERT_EQUALS( 4, qps->nPlans() );
+                const QueryPlan &intersection = *qps->plans().back();
+                ASSERT( intersection.intersection() );
+                ASSERT_EQUALS( fromjson( "{$intersect:[{a:1},{b:1}]}" ), intersection.indexKey() );
+                // {a:1,c:1} pins a field {a:1} doesn't, so it is intersected instead.
+                qps = makeQps( BSON( "a" << 4 << "b" << 1 << "c" << 2 ) );
+                ASSERT_EQUALS( fromjson( "{$intersect:[{a:1,c:1},{b:1}]}" ),
+                               qps->plans().back()->indexKey() );
+                // Only indexes whose every field is pinned keep their pks in order.
+                ASSERT_EQUALS( 3, makeQps( BSON( "a" << 4 << "b" << GT << 1 ) )->nPlans() );
+                ASSERT_EQUALS( 3, makeQps( fromjson( "{a:4,b:{$in:[1,2]}}" ) )->nPlans() );
+                // The intersection is in pk order.
+                ASSERT_EQUALS( 3, makeQps( BSON( "a" << 4 << "b" << 1 ),
+                                           BSON( "b" << 1 ) )->nPlans() );
+            }
+        };
+
         class FindOne : public Base {
         public:
             void run() {
@@ -1606,7 +1674,6 @@ namespace QueryOptimizerTests {
             {
                 Collection *d = getCollection(ns());
                 QueryCache &qc = d->getQueryCache();
-                QueryCache::Lock::Exclusive lk(qc);
                 qc.registerCachedQueryPlanForPattern( frs.pattern( BSON( "b" << 1 ) ),
                                                       CachedQueryPlan( BSON( "a" << 1 ), 0,
                                                       CandidatePlanCharacter( true, true ) ) );
@@ -1639,6 +1706,7 @@ namespace QueryOptimizerTests {
             add<QueryPlanTests::MatcherNecessary>();
             add<QueryPlanTests::MatcherNecessaryMultikey>();
             add<QueryPlanTests::Unhelpful>();
+            add<QueryPlanTests::SkipScan>();
             add<QueryPlanTests::KeyFieldsOnly>();
             add<QueryPlanTests::SparseExistsFalse>();
             add<QueryPlanTests::QueryBoundsExactOrderSuffix::Unindexed>();
@@ -1680,6 +1748,8 @@ namespace QueryOptimizerTests {
             add<QueryPlanSetTests::Count>();
             add<QueryPlanSetTests::QueryMissingNs>();
             add<QueryPlanSetTests::UnhelpfulIndex>();
+            add<QueryPlanSetTests::SkipScanIndex>();
+            add<QueryPlanSetTests::IntersectionPlan>();
             add<QueryPlanSetTests::FindOne>();
             add<QueryPlanSetTests::Delete>();
             add<QueryPlanSetTests::DeleteOneScan>();
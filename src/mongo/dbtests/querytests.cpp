@@ -1450,12 +1450,15 @@ namespace QueryTests {
             : ScanAndOrder( startFrom, limit, order, frs ) {
             }
             unsigned approxSize() const { return ScanAndOrder::approxSize(); }
+            void setMaxApproxSize(unsigned maxApproxSize) {
+                ScanAndOrder::setMaxApproxSize( maxApproxSize );
+            }
         };
         typedef TestableScanAndOrder Testable;
         
         class Base {
         protected:
-            void assertNumFilled( int expected, const Testable &t ) {
+            void assertNumFilled( int expected, Testable &t ) {
                 ASSERT_EQUALS( expected, t.size() );
                 BufBuilder bb;
                 int nout;
@@ -1500,7 +1503,72 @@ namespace QueryTests {
                 assertNumFilled( 1, t );
             }
         };
-        
+
+        /** Results that outgrow memory are written out in sorted runs and merged back. */
+        class Spill : public Base {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                Testable t( 0, 0, BSON( "a" << 1 ), frs );
+                t.setMaxApproxSize( 1000 );
+                ASSERT_THROWS( addMany( t ), UserException );
+
+                Testable spilling( 0, 0, BSON( "a" << 1 ), frs );
+                spilling.setMaxApproxSize( 1000 );
+                spilling.setSpillingAllowed( true );
+                addMany( spilling );
+                ASSERT( spilling.nSpills() > 1 );
+                ASSERT( spilling.peakApproxSize() < 1000 );
+
+                BufBuilder bb;
+                int nout;
+                spilling.fill( bb, 0, nout );
+                ASSERT_EQUALS( 200, nout );
+                const char *p = bb.buf();
+                for ( int i = 0; i < 200; ++i ) {
+                    BSONObj o( p );
+                    ASSERT_EQUALS( i / 2, o[ "a" ].numberInt() );
+                    // Equal keys keep the order they were added in.
+                    ASSERT_EQUALS( i % 2, o[ "b" ].numberInt() );
+                    p += o.objsize();
+                }
+                ASSERT( !spilling.sortedRemainder( 0 ) );
+            }
+        private:
+            void addMany( Testable &t ) {
+                for ( int b = 0; b < 2; ++b ) {
+                    for ( int i = 0; i < 100; ++i ) {
+                        t.add( BSON( "a" << ( i * 37 ) % 100 << "b" << b ) );
+                    }
+                }
+            }
+        };
+
+        /** With a limit, only the best results of the merged runs are returned. */
+        class SpillLimit : public Base {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                Testable t( 5, 10, BSON( "a" << -1 ), frs );
+                t.setMaxApproxSize( 200 );
+                t.setSpillingAllowed( true );
+                for ( int i = 0; i < 100; ++i ) {
+                    t.add( BSON( "a" << ( i * 37 ) % 100 ) );
+                }
+                ASSERT( t.nSpills() > 0 );
+                BufBuilder bb;
+                int nout;
+                t.fill( bb, 0, nout );
+                ASSERT_EQUALS( 10, nout );
+                const char *p = bb.buf();
+                for ( int i = 0; i < 10; ++i ) {
+                    BSONObj o( p );
+                    ASSERT_EQUALS( 94 - i, o[ "a" ].numberInt() );
+                    p += o.objsize();
+                }
+            }
+        };
+
     } // namespace ScanAndOrderTests
 
     class All : public Suite {
@@ -1569,6 +1637,8 @@ namespace QueryTests {
             
             add< ScanAndOrderTests::Unlimited >();
             add< ScanAndOrderTests::LimitOne >();
+            add< ScanAndOrderTests::Spill >();
+            add< ScanAndOrderTests::SpillLimit >();
         }
     } myall;
 
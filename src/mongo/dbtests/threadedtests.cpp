@@ -31,6 +31,7 @@
 #include "../util/concurrency/synchronization.h"
 #include "../util/concurrency/qlock.h"
 #include "dbtests.h"
+#include "mongo/db/admission_control.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/platform/atomic_word.h"
 
@@ -920,6 +921,126 @@ namespace ThreadedTests {
 
     };
 
+    // Shrinking a TicketHolder below what's in use holds back new tickets until enough come back.
+    class TicketHolderResize {
+    public:
+        void run() {
+            TicketHolder tickets( 3 );
+            ASSERT( tickets.tryAcquire() );
+            ASSERT( tickets.tryAcquire() );
+            tickets.resize( 1 );
+            ASSERT_EQUALS( 0 , tickets.available() );
+            ASSERT_EQUALS( 2 , tickets.used() );
+            ASSERT( ! tickets.tryAcquire() );
+            tickets.release();
+            ASSERT( ! tickets.tryAcquire() );
+            tickets.release();
+            ASSERT( tickets.tryAcquire() );
+            tickets.resize( 2 );
+            ASSERT_EQUALS( 1 , tickets.available() );
+            tickets.release();
+            ASSERT_EQUALS( 2 , tickets.available() );
+        }
+    };
+
+    // Many scans at once never run more than their reserved tickets plus their share of the pool,
+    // and never take the point reads' reserved tickets.
+    class AdmissionControlLimits : public ThreadedTest<10> {
+        static const int ops = 200;
+
+    public:
+        AdmissionControlLimits() : _running( 0 ) , _maxRunning( 0 ) {}
+
+        virtual void setup() {
+            _ac.setReserved( AdmissionControl::SCAN , 1 );
+            _ac.setSharedLimit( AdmissionControl::SCAN , 2 );
+            _ac.setSharedTickets( 4 );
+        }
+
+        virtual void subthread( int x ) {
+            for ( int i = 0; i < ops; i++ ) {
+                AdmissionControl::Ticket ticket;
+                ticket.acquire( _ac , AdmissionControl::SCAN );
+                const int running = _running.addAndFetch( 1 );
+                int max = _maxRunning.load();
+                while ( running > max ) {
+                    const int prev = _maxRunning.compareAndSwap( max , running );
+                    if ( prev == max ) break;
+                    max = prev;
+                }
+                ASSERT_LESS_THAN_OR_EQUALS( _ac.sharedHeld( AdmissionControl::SCAN ) , 2 );
+                sleepmicros( 100 );
+                _running.fetchAndSubtract( 1 );
+            }
+        }
+
+        virtual void validate() {
+            ASSERT_EQUALS( 3 , _maxRunning.load() );
+            ASSERT_EQUALS( 0 , _ac.sharedHeld( AdmissionControl::SCAN ) );
+            ASSERT_EQUALS( 0 , _ac.queueDepth( AdmissionControl::SCAN ) );
+
+            // the point reads' tickets were there all along
+            AdmissionControl::Ticket ticket;
+            ticket.acquire( _ac , AdmissionControl::POINT_READ );
+            ASSERT( ! ticket.shared() );
+        }
+
+    private:
+        AdmissionControl _ac;
+        AtomicInt32 _running;
+        AtomicInt32 _maxRunning;
+    };
+
+    // A returned shared ticket goes to a waiting point read before a waiting scan.
+    class AdmissionControlPriority {
+    public:
+        void run() {
+            AdmissionControl ac;
+            for ( int c = 0; c < AdmissionControl::NUM_OP_CLASSES; c++ ) {
+                ac.setReserved( AdmissionControl::OpClass( c ) , 0 );
+            }
+            ac.setSharedTickets( 1 );
+
+            AtomicInt32 admissions;
+            int order[ AdmissionControl::NUM_OP_CLASSES ] = { 0 };
+            scoped_ptr<AdmissionControl::Ticket> first( new AdmissionControl::Ticket() );
+            first->acquire( ac , AdmissionControl::SCAN );
+            ASSERT( first->shared() );
+
+            // the scan queues first
+            boost::thread scan( boost::bind( &AdmissionControlPriority::admit , &ac ,
+                                             AdmissionControl::SCAN , &admissions ,
+                                             &order[ AdmissionControl::SCAN ] ) );
+            waitForQueue( ac , AdmissionControl::SCAN );
+            boost::thread read( boost::bind( &AdmissionControlPriority::admit , &ac ,
+                                             AdmissionControl::POINT_READ , &admissions ,
+                                             &order[ AdmissionControl::POINT_READ ] ) );
+            waitForQueue( ac , AdmissionControl::POINT_READ );
+
+            first.reset();
+            read.join();
+            scan.join();
+            ASSERT_EQUALS( 1 , order[ AdmissionControl::POINT_READ ] );
+            ASSERT_EQUALS( 2 , order[ AdmissionControl::SCAN ] );
+            ASSERT_EQUALS( 0 , ac.queueDepth( AdmissionControl::SCAN ) );
+            ASSERT_EQUALS( 0 , ac.sharedHeld( AdmissionControl::SCAN ) );
+        }
+
+    private:
+        static void admit( AdmissionControl *ac , AdmissionControl::OpClass c ,
+                           AtomicInt32 *admissions , int *order ) {
+            AdmissionControl::Ticket ticket;
+            ticket.acquire( *ac , c );
+            *order = admissions->addAndFetch( 1 );
+        }
+
+        static void waitForQueue( AdmissionControl &ac , AdmissionControl::OpClass c ) {
+            while ( ac.queueDepth( c ) == 0 ) {
+                sleepmillis( 1 );
+            }
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "threading" ) { }
@@ -956,6 +1077,9 @@ namespace ThreadedTests {
 
             add< MongoMutexTest >();
             add< TicketHolderWaits >();
+            add< TicketHolderResize >();
+            add< AdmissionControlLimits >();
+            add< AdmissionControlPriority >();
         }
     } myall;
 }
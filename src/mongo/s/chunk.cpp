@@ -605,7 +605,8 @@ namespace mongo {
                                                         ""),
         _key(collDoc[CollectionType::keyPattern()].type() == Object ?
                                                         collDoc[CollectionType::keyPattern()].Obj().getOwned() :
-                                                        BSONObj()),
+                                                        BSONObj(),
+             collDoc[CollectionType::hashVersion()].numberInt()),
         _unique(collDoc[CollectionType::unique()].trueValue()),
         _chunkRanges(),
         _mutex("ChunkManager"),
@@ -671,6 +672,7 @@ namespace mongo {
                     const_cast<set<Shard>&>(_shards).swap(shards);
                     const_cast<ShardVersionMap&>(_shardVersions).swap(shardVersions);
                     const_cast<ChunkRangeManager&>(_chunkRanges).reloadAll(_chunkMap);
+                    const_cast<ChunkRoutingTable&>(_routingTable).reloadAll(_chunkMap);
 
                     // Once we load data, clear reference to old manager
                     _oldManager.reset();
@@ -1046,14 +1048,10 @@ namespace mongo {
 
     ChunkPtr ChunkManager::findIntersectingChunk( const BSONObj& point ) const {
         {
+            ChunkPtr c = _routingTable.upperBound( point );
             BSONObj foo;
-            ChunkPtr c;
-            {
-                ChunkMap::const_iterator it = _chunkMap.upper_bound( point );
-                if (it != _chunkMap.end()) {
-                    foo = it->first;
-                    c = it->second;
-                }
+            if ( c ) {
+                foo = c->getMax();
             }
 
             if ( c ) {
@@ -1294,6 +1292,10 @@ namespace mongo {
     void ChunkManager::getInfo( BSONObjBuilder& b ) const {
         b.append(CollectionType::keyPattern(), _key.key());
         b.appendBool(CollectionType::unique(), _unique);
+        if (_key.hashVersion() != 0) {
+            // left out otherwise, so older mongos can read collections sharded the old way
+            b.append(CollectionType::hashVersion(), _key.hashVersion());
+        }
         _version.addEpochToBSON(b, CollectionType::DEPRECATED_lastmod());
     }
 
@@ -1378,6 +1380,67 @@ namespace mongo {
         }
     }
 
+    void ChunkRoutingTable::reloadAll(const ChunkMap& chunks) {
+        _maxes.clear();
+        _chunks.clear();
+        _numericMaxes.clear();
+        _maxes.reserve(chunks.size());
+        _chunks.reserve(chunks.size());
+
+        _numeric = !chunks.empty();
+        for (ChunkMap::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+            _maxes.push_back(it->first);
+            _chunks.push_back(it->second);
+
+            const bool last = boost::next(it) == chunks.end();
+            const BSONElement e = it->first.firstElement();
+            if (it->first.nFields() != 1 || e.type() != (last ? MaxKey : NumberLong)) {
+                _numeric = false;
+            }
+            else if (!last) {
+                _numericMaxes.push_back(e._numberLong());
+            }
+        }
+        if (!_numeric) {
+            _numericMaxes.clear();
+        }
+    }
+
+    ChunkPtr ChunkRoutingTable::upperBound(const BSONObj& point) const {
+        if (_chunks.empty()) {
+            return ChunkPtr();
+        }
+
+        if (_numeric) {
+            const BSONElement e = point.firstElement();
+            if (e.type() == NumberLong && point.nFields() == 1) {
+                // Branch-free upper bound: halve the range with a conditional move each step,
+                // which a mispredicted branch would otherwise cost far more than.  Anything
+                // above every numeric max belongs to the last chunk, whose max is MaxKey.
+                const long long v = e._numberLong();
+                size_t n = _numericMaxes.size();
+                if (n == 0) {
+                    return _chunks[0];
+                }
+                const long long *base = &_numericMaxes[0];
+                while (n > 1) {
+                    const size_t half = n / 2;
+                    base = (base[half] <= v) ? base + half : base;
+                    n -= half;
+                }
+                const size_t i = (base - &_numericMaxes[0]) + (*base <= v ? 1 : 0);
+                return _chunks[i];
+            }
+        }
+
+        vector<BSONObj>::const_iterator it = std::upper_bound(_maxes.begin(), _maxes.end(),
+                                                              point, BSONObjCmp());
+        if (it == _maxes.end()) {
+            return ChunkPtr();
+        }
+        return _chunks[it - _maxes.begin()];
+    }
+
     int ChunkManager::getCurrentDesiredChunkSize() const {
         // split faster in early chunks helps spread out an initial load better
         const int minChunkSize = 1 << 20;  // 1 MBytes
@@ -316,6 +316,40 @@ namespace mongo {
         ChunkRangeMap _ranges;
     };
 
+    /**
+     * A flat copy of a ChunkManager's chunk map, used to route single points.
+     *
+     * The chunks sit in one sorted array by max key, so finding a point's chunk is a binary
+     * search over contiguous memory rather than a walk down the map's tree.  When every split
+     * point is a single NumberLong, as with a hashed shard key, the maxes are also kept as
+     * plain 64-bit integers and a NumberLong point is found without comparing any BSON.
+     *
+     * Like the rest of a ChunkManager it is built while the manager loads and never changes
+     * afterwards, so it is read without locking.
+     */
+    class ChunkRoutingTable {
+    public:
+        ChunkRoutingTable() : _numeric(false) {}
+
+        void reloadAll(const ChunkMap& chunks);
+
+        /** @return the chunk with the lowest max above point, like ChunkMap::upper_bound */
+        ChunkPtr upperBound(const BSONObj& point) const;
+
+        size_t size() const { return _chunks.size(); }
+
+        /** @return true if NumberLong points are routed by integer comparison */
+        bool isNumeric() const { return _numeric; }
+
+    private:
+        vector<BSONObj> _maxes;
+        vector<ChunkPtr> _chunks;
+
+        // When _numeric, every max but the last (MaxKey) as an integer.
+        vector<long long> _numericMaxes;
+        bool _numeric;
+    };
+
     /* config.sharding
          { ns: 'alleyinsider.fs.chunks' ,
            key: { ts : 1 } ,
@@ -452,6 +486,7 @@ namespace mongo {
 
         const ChunkMap _chunkMap;
         const ChunkRangeManager _chunkRanges;
+        const ChunkRoutingTable _routingTable;
 
         const set<Shard> _shards;
 
@@ -24,8 +24,11 @@
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/privilege.h"
+#include "mongo/db/client_basic.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/dbmessage.h"
+#include "mongo/db/hasher.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/stats/counters.h"
 
@@ -41,6 +44,7 @@
 #include "mongo/s/writeback_listener.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
 #include "mongo/util/stringutils.h"
@@ -441,6 +445,24 @@ namespace mongo {
                     }
                 }
 
+                // Which hash function a hashed shard key (and the index created for it) uses.
+                int hashVersion = HASH_VERSION_MD5;
+                BSONElement hashVersionElt = cmdObj["hashVersion"];
+                if ( hashVersionElt.ok() ) {
+                    if ( proposedKey.firstElementType() != mongo::String ) {
+                        errmsg = "hashVersion can only be given for a hashed shard key";
+                        return false;
+                    }
+                    if ( !hashVersionElt.isNumber() ||
+                         !isValidHashVersion( hashVersionElt.numberInt() ) ) {
+                        errmsg = str::stream() << "hashVersion must be " << HASH_VERSION_MD5
+                                               << " (md5) or " << HASH_VERSION_MURMUR3
+                                               << " (murmur3)";
+                        return false;
+                    }
+                    hashVersion = hashVersionElt.numberInt();
+                }
+
                 if ( NamespaceString::isSystem(ns) ) {
                     errmsg = "can't shard system namespaces";
                     return false;
@@ -503,7 +525,7 @@ namespace mongo {
                 auto_ptr<DBClientCursor> uniqueQueryResult =
                                 conn->get()->query( indexNS , uniqueQuery );
 
-                ShardKeyPattern proposedShardKey( proposedKey );
+                ShardKeyPattern proposedShardKey( proposedKey , hashVersion );
                 while ( uniqueQueryResult->more() ) {
                     BSONObj idx = uniqueQueryResult->next();
                     BSONObj currentKey = idx["key"].embeddedObject();
@@ -532,6 +554,16 @@ namespace mongo {
                     BSONObj currentKey = idx["key"].embeddedObject();
                     // Check 2.i. and 2.ii.
                     if ( ! idx["sparse"].trueValue() && proposedKey.isPrefixOf( currentKey ) ) {
+                        // A hashed index's keys must be hashed the same way as the shard key.
+                        if ( proposedKey.firstElementType() == mongo::String &&
+                             idx["hashVersion"].numberInt() != hashVersion ) {
+                            errmsg = str::stream() << "index " << currentKey << " has hashVersion "
+                                                   << idx["hashVersion"].numberInt()
+                                                   << ", shard with that hashVersion or drop the"
+                                                   << " index";
+                            conn->done();
+                            return false;
+                        }
                         BSONElement ce = cmdObj["clustering"];
                         if (idx["clustering"].trueValue()) {
                             if (ce.ok() && !ce.trueValue()) {
@@ -657,13 +689,29 @@ namespace mongo {
                     } else {
                         BSONElement ce = cmdObj["clustering"];
                         bool clustering = (ce.ok() ? ce.trueValue() : true);
-                        // call ensureIndex with cache=false, see SERVER-1691
-                        bool ensureSuccess = conn->get()->ensureIndex(ns,
-                                                                      proposedKey,
-                                                                      careAboutUnique,
-                                                                      clustering,
-                                                                      "",
-                                                                      false);
+                        bool ensureSuccess;
+                        if ( hashVersion != HASH_VERSION_MD5 ) {
+                            // ensureIndex has no way to pass the hash version
+                            BSONObjBuilder toSave;
+                            toSave.append( "ns" , ns );
+                            toSave.append( "key" , proposedKey );
+                            toSave.append( "name" , conn->get()->genIndexName( proposedKey ) );
+                            if ( clustering ) {
+                                toSave.appendBool( "clustering" , true );
+                            }
+                            toSave.append( "hashVersion" , hashVersion );
+                            conn->get()->insert( indexNS , toSave.obj() );
+                            ensureSuccess = conn->get()->getLastError().empty();
+                        }
+                        else {
+                            // call ensureIndex with cache=false, see SERVER-1691
+                            ensureSuccess = conn->get()->ensureIndex(ns,
+                                                                     proposedKey,
+                                                                     careAboutUnique,
+                                                                     clustering,
+                                                                     "",
+                                                                     false);
+                        }
                         if ( ! ensureSuccess ) {
                             errmsg = "ensureIndex failed to create index on primary shard";
                             conn->done();
@@ -746,7 +794,7 @@ namespace mongo {
 
                 tlog() << "CMD: shardcollection: " << cmdObj << endl;
 
-                config->shardCollection( ns , proposedKey , careAboutUnique , &initSplits );
+                config->shardCollection( ns , proposedShardKey , careAboutUnique , &initSplits );
 
                 result << "collectionsharded" << ns;
 
@@ -1373,6 +1421,9 @@ namespace mongo {
                 result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
                 result.appendNumber("maxMessageSizeBytes", MaxMessageSizeBytes);
                 result.appendDate("localTime", jsTime());
+                if ( networkMessageCompression ) {
+                    negotiateMessageCompression( cmdObj, ClientBasic::getCurrent()->port(), result );
+                }
 
                 return true;
             }
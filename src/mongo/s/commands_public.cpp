@@ -1870,6 +1870,14 @@ namespace mongo {
             BSONObjBuilder commandBuilder;
             pShardPipeline->toBson(&commandBuilder);
 
+            /*
+              Have the shards return cursors, so their output isn't limited
+              to one reply and is fetched as the merge below consumes it.
+            */
+            if (!pPipeline->isExplain()) {
+                commandBuilder.append("cursor", BSONObj());
+            }
+
             if (cmdObj.hasField("$queryOptions")) {
                 commandBuilder.append(cmdObj["$queryOptions"]);
             }
@@ -1888,9 +1896,12 @@ namespace mongo {
 
             // Run the command on the shards
             map<Shard, BSONObj> shardResults;
-            SHARDED->commandOp(dbName, shardedCommand, options, fullns, shardQuery, shardResults);
+            map<Shard, string> shardHosts;
+            SHARDED->commandOp(dbName, shardedCommand, options, fullns, shardQuery, shardResults,
+                               &shardHosts);
 
-            pPipeline->addInitialSource(DocumentSourceCommandShards::create(shardResults, pExpCtx));
+            pPipeline->addInitialSource(
+                DocumentSourceCommandShards::create(shardResults, shardHosts, pExpCtx));
 
             // Combine the shards' output and finish the pipeline
             pPipeline->stitch();
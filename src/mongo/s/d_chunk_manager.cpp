@@ -187,6 +187,7 @@ namespace mongo {
         uassert( 13542 , str::stream() << "collection doesn't have a key: " << collectionDoc , ! e.eoo() && e.isABSONObj() );
 
         _key = e.Obj().getOwned();
+        _hashVersion = collectionDoc[CollectionType::hashVersion()].numberInt();
     }
 
     void ShardChunkManager::_fillChunks( DBClientCursorInterface* cursor ) {
@@ -249,7 +250,7 @@ namespace mongo {
         if ( _rangesMap.size() == 0 )
             return false;
         
-        KeyPattern pat( _key );
+        KeyPattern pat( _key , _hashVersion );
         return _belongsToMe( cc->extractKey( pat ) );
     }
 
@@ -257,7 +258,7 @@ namespace mongo {
         if ( _rangesMap.size() == 0 )
             return false;
 
-        KeyPattern pat( _key );
+        KeyPattern pat( _key , _hashVersion );
         return _belongsToMe( pat.extractSingleKey( doc ) );
     }
 
@@ -309,7 +310,7 @@ namespace mongo {
     }
 
     bool ShardChunkManager::hasShardKey(const BSONObj &obj) {
-        ShardKeyPattern shardKey(_key);
+        ShardKeyPattern shardKey(_key, _hashVersion);
         return shardKey.hasShardKey(obj);
     }
 
@@ -335,6 +336,7 @@ namespace mongo {
 
         auto_ptr<ShardChunkManager> p( new ShardChunkManager );
         p->_key = this->_key;
+        p->_hashVersion = this->_hashVersion;
 
         if ( _chunksMap.size() == 1 ) {
             // if left with no chunks, just reset version
@@ -391,6 +393,7 @@ namespace mongo {
         auto_ptr<ShardChunkManager> p( new ShardChunkManager );
 
         p->_key = this->_key;
+        p->_hashVersion = this->_hashVersion;
         p->_chunksMap = this->_chunksMap;
         p->_chunksMap.insert( make_pair( min.getOwned() , max.getOwned() ) );
         p->_version = version;
@@ -426,6 +429,7 @@ namespace mongo {
         auto_ptr<ShardChunkManager> p( new ShardChunkManager );
 
         p->_key = this->_key;
+        p->_hashVersion = this->_hashVersion;
         p->_chunksMap = this->_chunksMap;
         p->_version = version; // will increment second, third, ... chunks below
 
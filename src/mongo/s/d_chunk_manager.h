@@ -137,6 +137,7 @@ namespace mongo {
         ChunkVersion getVersion() const { return _version; }
         ChunkVersion getCollVersion() const { return _collVersion; }
         BSONObj getKey() const { return _key.getOwned(); }
+        int getHashVersion() const { return _hashVersion; }
         unsigned getNumChunks() const { return _chunksMap.size(); }
 
         string toString() const;
@@ -154,6 +155,8 @@ namespace mongo {
 
         // key pattern for chunks under this range
         BSONObj _key;
+        // hash function of a hashed _key, see HashVersions
+        int _hashVersion;
 
         // a map from a min key into the chunk's (or range's) max boundary
         typedef map< BSONObj, BSONObj , BSONObjCmp > RangeMap;
@@ -172,7 +175,7 @@ namespace mongo {
         void _assertChunkExists( const BSONObj& min , const BSONObj& max ) const;
 
         /** can only be used in the cloning calls */
-        ShardChunkManager() {}
+        ShardChunkManager() : _hashVersion(0) {}
     };
 
 }  // namespace mongo
@@ -223,6 +223,11 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+
+        /** detaches the current thread's info without destroying it (may be NULL) */
+        static ShardedConnectionInfo* release();
+        /** makes info, from release(), the current thread's info */
+        static void attach( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
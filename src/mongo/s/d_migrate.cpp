@@ -215,8 +215,9 @@ namespace mongo {
     bool isInRange( const BSONObj& obj ,
                     const BSONObj& min ,
                     const BSONObj& max ,
-                    const BSONObj& shardKeyPattern ) {
-        ShardKeyPattern shardKey( shardKeyPattern );
+                    const BSONObj& shardKeyPattern ,
+                    int hashVersion = 0 ) {
+        ShardKeyPattern shardKey( shardKeyPattern , hashVersion );
         BSONObj k = shardKey.extractKey( obj );
         return k.woCompare( min ) >= 0 && k.woCompare( max ) < 0;
     }
@@ -241,7 +242,8 @@ namespace mongo {
         bool start( const std::string& ns ,
                     const BSONObj& min ,
                     const BSONObj& max ,
-                    const BSONObj& shardKeyPattern ) {
+                    const BSONObj& shardKeyPattern ,
+                    int hashVersion ) {
             scoped_lock l(_mutex); // reads and writes _active
 
             if (_active) {
@@ -256,6 +258,7 @@ namespace mongo {
             _min = min;
             _max = max;
             _shardKeyPattern = shardKeyPattern;
+            _hashVersion = hashVersion;
 
             _snapshotTaken = false;
             clearMigrateLog();
@@ -353,7 +356,7 @@ namespace mongo {
             }
 
             if (OplogHelpers::shouldLogOpForSharding(opstr)) {
-                return isInRange(obj, _min, _max, _shardKeyPattern);
+                return isInRange(obj, _min, _max, _shardKeyPattern, _hashVersion);
             }
             return false;
         }
@@ -636,6 +639,7 @@ namespace mongo {
         BSONObj _min;
         BSONObj _max;
         BSONObj _shardKeyPattern;
+        int _hashVersion;
 
         Collection *_migrateLogCollection;
         Collection *_migrateLogRefCollection;
@@ -660,8 +664,10 @@ namespace mongo {
         MigrateStatusHolder( const std::string& ns ,
                              const BSONObj& min ,
                              const BSONObj& max ,
-                             const BSONObj& shardKeyPattern ) {
-            _isAnotherMigrationActive = !migrateFromStatus.start(ns, min, max, shardKeyPattern);
+                             const BSONObj& shardKeyPattern ,
+                             int hashVersion ) {
+            _isAnotherMigrationActive = !migrateFromStatus.start(ns, min, max, shardKeyPattern,
+                                                                 hashVersion);
         }
         ~MigrateStatusHolder() {
             if (!_isAnotherMigrationActive) {
@@ -1067,7 +1073,8 @@ namespace mongo {
                 return false;
             }
 
-            MigrateStatusHolder statusHolder( ns , min , max , shardKeyPattern );
+            MigrateStatusHolder statusHolder( ns , min , max , shardKeyPattern ,
+                                              chunkManager->getHashVersion() );
             if (statusHolder.isAnotherMigrationActive()) {
                 errmsg = "moveChunk is already in progress from this shard";
                 return false;
@@ -2354,6 +2361,13 @@ namespace mongo {
             verify( ! isInRange( BSON( "x" << 3 ) , min , max , hashedKey ) );
             verify( ! isInRange( BSON( "x" << 4 ) , min2 , max2 , hashedKey ) );
 
+            BSONObj min3 = BSON( "x" << BSONElementHasher::hash64( obj.firstElement() , 0 ,
+                                                                   HASH_VERSION_MURMUR3 ) - 2 );
+            BSONObj max3 = BSON( "x" << BSONElementHasher::hash64( obj.firstElement() , 0 ,
+                                                                   HASH_VERSION_MURMUR3 ) + 2 );
+            verify( isInRange( BSON( "x" << 3 ) , min3 , max3 , hashedKey , HASH_VERSION_MURMUR3 ) );
+            verify( ! isInRange( BSON( "x" << 3 ) , min3 , max3 , hashedKey ) );
+
             LOG(1) << "isInRangeTest passed" << migrateLog;
         }
     } isInRangeTest;
@@ -189,6 +189,56 @@ namespace mongo {
         }
     } cmdCheckShardingIndex;
 
+    /**
+     * Measures how many bytes of an index there are per byte of documents, on a sample of up to
+     * sampleSize documents at the start of [min, max).  get_key_after_bytes counts the former.
+     *
+     * relativeError() is twice the standard error of the sampled ratio, as a fraction of it.  It
+     * is 0 when the sample is the whole range.
+     */
+    class IndexBytesSample {
+        long long _sampled;
+        double _scale;
+        double _relativeError;
+
+      public:
+        IndexBytesSample(Collection *cl, const IndexDetails &idx, const BSONObj &min, const BSONObj &max,
+                         int sampleSize)
+                : _sampled(0), _scale(1.0), _relativeError(0) {
+            const bool isPK = cl->isPKIndex(idx);
+            double docBytes = 0, idxBytes = 0;
+            double docSquares = 0, idxSquares = 0, products = 0;
+            shared_ptr<Cursor> c(Cursor::make(cl, idx, min, max, false, 1, sampleSize + 1));
+            for ( ; c->ok() && _sampled < sampleSize; c->advance()) {
+                const BSONObj pk = c->currPK();
+                const storage::Key key(c->currKey(), isPK ? NULL : &pk, idx.descriptor());
+                const double x = c->current().objsize();
+                const double y = key.size() + (isPK || idx.clustering() ? x : 0);
+                docBytes += x;
+                idxBytes += y;
+                docSquares += x * x;
+                idxSquares += y * y;
+                products += x * y;
+                _sampled++;
+            }
+            if (_sampled == 0) {
+                return;
+            }
+            _scale = idxBytes / docBytes;
+            if (c->ok()) {
+                // Variance of y - scale * x, the usual ratio estimator's.
+                const double n = _sampled;
+                const double residual = std::max(idxSquares - 2 * _scale * products + _scale * _scale * docSquares, 0.0)
+                                        / std::max(n - 1, 1.0);
+                _relativeError = 2 * sqrt(residual / n) / (docBytes / n) / _scale;
+            }
+        }
+
+        long long sampled() const { return _sampled; }
+        double scale() const { return _scale; }
+        double relativeError() const { return _relativeError; }
+    };
+
     class SplitVectorFinder {
         Collection *_cl;
         const IndexDetails* _idx;
@@ -201,19 +251,21 @@ namespace mongo {
         long long _justSkipped;
         bool _useCursor;
         BSONObj _lastSplitKey;
+        // Index bytes per document byte, get_key_after_bytes counts the former.
+        const double _bytesScale;
 
-        void isTooBigCallback(const storage::KeyV1 *endKey, BSONObj *endPK __attribute__((unused)), uint64_t skipped) {
+        void isTooBigCallback(const storage::Key *endKey, BSONObj *endPK __attribute__((unused)), uint64_t skipped) {
             if (endKey == NULL) {
                 return;
             }
-            const storage::KeyV1 max(_chunkMax.buf());
+            const storage::Key max(_chunkMax.buf(), false);
             const int c = endKey->woCompare(max, _ordering);
             if (c < 0) {
                 _chunkTooBig = true;
             }
         }
         
-        void getPointCallback(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+        void getPointCallback(const storage::Key *endKey, BSONObj *endPK, uint64_t skipped) {
             if (endKey == NULL) {
                 _doneFindingPoints = true;
                 return;
@@ -225,16 +277,16 @@ namespace mongo {
                 return;
             }
 
-            const storage::KeyV1 max(_chunkMax.buf());
+            const storage::Key max(_chunkMax.buf(), false);
             int c = endKey->woCompare(max, _ordering);
             if (c >= 0) {
                 _doneFindingPoints = true;
                 return;
             }
 
-            // This wastefully constructs two BSONs when we should be able to go straight from KeyV1
-            // format to a BSON with field names.  TODO: optimize it if it shows up in profiling.
-            BSONObj splitKey = _chunkPattern.prettyKey(endKey->toBson());
+            // This wastefully constructs two BSONs when we should be able to go straight from the
+            // key format to a BSON with field names.  TODO: optimize it if it shows up in profiling.
+            BSONObj splitKey = _chunkPattern.prettyKey(endKey->key());
             c = splitKey.woCompare(_lastSplitKey, _ordering);
             if (c < 0) {
                 stringstream ss;
@@ -256,8 +308,8 @@ namespace mongo {
                 // with that same key (or a few really big ones).  Since we can't split in the
                 // middle of them, we fall back to just using a cursor from this point forward.
                 if (!_idx->isIdIndex()) {
-                    _chunkMin.reset(*endKey, endPK);
-                    _justSkipped += skipped;
+                    _chunkMin.reset(endKey->key(), endPK, _idx->descriptor());
+                    _justSkipped += (long long) (skipped / _bytesScale);
                 }
                 _useCursor = true;
                 return;
@@ -269,7 +321,7 @@ namespace mongo {
             _splitPoints.push_back(_lastSplitKey);
             KeyPattern kp(_idx->keyPattern());
             BSONObj modSplitKey = KeyPattern::toKeyFormat(kp.extendRangeBound(_lastSplitKey, false));
-            _chunkMin.reset(modSplitKey, _idx->isIdIndex() ? NULL : &minKey);
+            _chunkMin.reset(modSplitKey, _idx->isIdIndex() ? NULL : &minKey, _idx->descriptor());
         }
 
         void slowFindSplitPoint(long long targetChunkSize) {
@@ -293,7 +345,7 @@ namespace mongo {
                         _splitPoints.push_back(_lastSplitKey);
                         KeyPattern kp(_idx->keyPattern());
                         BSONObj modSplitKey = KeyPattern::toKeyFormat(kp.extendRangeBound(_lastSplitKey, false));
-                        _chunkMin.reset(modSplitKey, _idx->isIdIndex() ? NULL : &minKey);
+                        _chunkMin.reset(modSplitKey, _idx->isIdIndex() ? NULL : &minKey, _idx->descriptor());
                         return;
                     }
                 }
@@ -304,20 +356,26 @@ namespace mongo {
         }
 
       public:
+        /**
+         * bytesScale is how many bytes of idx there are per byte of documents (see
+         * IndexBytesSample).  A clustering index holds the documents themselves, so it is a
+         * little over 1 there, and less for a secondary index.
+         */
         SplitVectorFinder(Collection *cl, const IndexDetails* idx, const BSONObj &chunkPattern, const BSONObj &min, const BSONObj &max,
-                          vector<BSONObj> &splitPoints)
+                          vector<BSONObj> &splitPoints, double bytesScale = 1.0)
                 : _cl(cl),
                   _idx(idx),
                   _chunkPattern(chunkPattern.getOwned()),
                   _ordering(Ordering::make(_idx->keyPattern())),
-                  _chunkMin(min, _idx->isIdIndex() ? NULL : &minKey),
-                  _chunkMax(max, _idx->isIdIndex() ? NULL : &maxKey),
+                  _chunkMin(min, _idx->isIdIndex() ? NULL : &minKey, _idx->descriptor()),
+                  _chunkMax(max, _idx->isIdIndex() ? NULL : &maxKey, _idx->descriptor()),
                   _splitPoints(splitPoints),
                   _chunkTooBig(false),
                   _doneFindingPoints(false),
                   _justSkipped(0),
                   _useCursor(false),
-                  _lastSplitKey()
+                  _lastSplitKey(),
+                  _bytesScale(bytesScale)
         {
             massert(16799, "shard key pattern must be a prefix of the index key pattern", chunkPattern.isPrefixOf(_idx->keyPattern()));
         }
@@ -327,7 +385,7 @@ namespace mongo {
             SplitVectorFinder &_finder;
           public:
             IsTooBigCallback(SplitVectorFinder &finder) : _finder(finder) {}
-            void operator()(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+            void operator()(const storage::Key *endKey, BSONObj *endPK, uint64_t skipped) {
                 _finder.isTooBigCallback(endKey, endPK, skipped);
             }
         };
@@ -335,7 +393,7 @@ namespace mongo {
             SplitVectorFinder &_finder;
           public:
             GetPointCallback(SplitVectorFinder &finder) : _finder(finder) {}
-            void operator()(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+            void operator()(const storage::Key *endKey, BSONObj *endPK, uint64_t skipped) {
                 _finder.getPointCallback(endKey, endPK, skipped);
             }
         };
@@ -353,7 +411,7 @@ namespace mongo {
             massert(17237, "bug: failed to dynamically cast IndexDetails to IndexDetailsBase", idxBase != NULL);
             {
                 IsTooBigCallback cb(*this);
-                idxBase->getKeyAfterBytes(_chunkMin, maxChunkSize, cb);
+                idxBase->getKeyAfterBytes(_chunkMin, (uint64_t) (maxChunkSize * _bytesScale), cb);
             }
             if (!_chunkTooBig) {
                 return;
@@ -378,7 +436,7 @@ namespace mongo {
                         _useCursor = false;
                     }
                     else {
-                        idxBase->getKeyAfterBytes(_chunkMin, targetChunkSize, cb);
+                        idxBase->getKeyAfterBytes(_chunkMin, (uint64_t) (targetChunkSize * _bytesScale), cb);
                     }
                 }
             }
@@ -399,6 +457,9 @@ namespace mongo {
                  "  \n"
                  "  { splitVector : \"blog.post\" , keyPattern:{x:1} , min:{x:10} , max:{x:20}, force: true }\n"
                  "  'force' will produce one split point even if data is small; defaults to false\n"
+                 "  Split points are estimated from index statistics unless 'exact: true' is given,\n"
+                 "  with 'errorBound' the expected error in bytes of each chunk's size, from a sample\n"
+                 "  of 'sampleSize' documents (default 100)\n"
                  "NOTE: This command may take a while to run";
         }
         virtual void addRequiredPrivileges(const std::string& dbname,
@@ -500,11 +561,26 @@ namespace mongo {
                 }
             }
 
-            if (!forceMedianSplit && idx->clustering()) {
-                SplitVectorFinder finder(cl, idx, keyPattern, min, max, splitKeys);
+            // By default, split points come from get_key_after_bytes, which walks the index's
+            // subtree sizes instead of reading every document in the chunk.  Its byte counts are
+            // of the index, so they are converted to document bytes with the ratio measured on a
+            // sample at the start of the chunk.  exact:true reads the chunk instead.
+            const bool exact = jsobj["exact"].trueValue();
+            if (!forceMedianSplit && !exact && dynamic_cast<const IndexDetailsBase *>(idx) != NULL) {
+                int sampleSize = jsobj["sampleSize"].numberInt();
+                if (sampleSize <= 0) {
+                    sampleSize = 100;
+                }
+                const IndexBytesSample sample(cl, *idx, min, max, sampleSize);
+                SplitVectorFinder finder(cl, idx, keyPattern, min, max, splitKeys, sample.scale());
                 finder.find(maxChunkSize, maxSplitPoints);
+                result.appendBool("estimated", true);
+                result.appendNumber("sampleSize", sample.sampled());
+                // Bound on how far each chunk's size may be from the maxChunkSize / 2 aimed for.
+                result.appendNumber("errorBound", (long long) (sample.relativeError() * maxChunkSize / 2));
             } else {
-                // Haven't implemented a better version using get_key_after_bytes yet, do the slow thing
+                // Read the chunk: asked to, or a median split that needs the chunk's size first,
+                // or a partitioned collection, whose indexes can't get_key_after_bytes.
                 CollectionData::Stats stats;
                 cl->fillCollectionStats(stats, NULL, 1);
                 const long long recCount = stats.count;
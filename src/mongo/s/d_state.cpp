@@ -378,6 +378,15 @@ namespace mongo {
         _tl.reset();
     }
 
+    ShardedConnectionInfo* ShardedConnectionInfo::release() {
+        return _tl.release();
+    }
+
+    void ShardedConnectionInfo::attach( ShardedConnectionInfo* info ) {
+        verify( _tl.get() == NULL );
+        _tl.reset( info );
+    }
+
     const ConfigVersion ShardedConnectionInfo::getVersion( const string& ns ) const {
         NSVersionMap::const_iterator it = _versions.find( ns );
         if ( it != _versions.end() ) {
@@ -162,6 +162,7 @@ namespace mongo {
 
     // this gets called when new fails to allocate memory
     void my_new_handler() {
+        flushAsyncLog();
         rawOut( "out of memory, printing stack and exiting:" );
         printStackTrace();
         ::_exit(EXIT_ABRUPT);
@@ -277,6 +278,8 @@ using namespace mongo;
 
 static bool runMongosServer( bool doUpgrade ) {
     setupSignalHandlers();
+    if (!initializeAsyncLogging())
+        ::_exit(EXIT_BADOPTIONS);
     setThreadName( "mongosMain" );
     printShardingVersionInfo( false );
 
@@ -605,8 +608,10 @@ void mongo::dbexit( ExitCode rc, const char *why ) {
     // Need to make sure coverage data is properly flushed before exit.
     // It appears that ::_exit() does not do this.
     log() << "calling regular ::exit() so coverage data may flush..." << endl;
+    flushAsyncLog();
     ::exit(rc);
 #else
+    flushAsyncLog();
     ::_exit(rc);
 #endif
 }
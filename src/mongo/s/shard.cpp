@@ -29,6 +29,7 @@
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/privilege.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/server_parameters.h"
@@ -439,6 +440,15 @@ namespace mongo {
                                           << conn->getServerAddress() << causedBy( err ), result );
         }
 
+        if ( networkMessageCompression && conn->type() == ConnectionString::MASTER ) {
+            // covers mongos to shard traffic and, on shards, the migration connections
+            // that carry _migrateClone and _transferMods
+            DBClientConnection* masterConn = dynamic_cast<DBClientConnection*>( conn );
+            if ( masterConn ) {
+                masterConn->negotiateCompression();
+            }
+        }
+
         if ( _shardedConnections && versionManager.isVersionableCB( conn ) ) {
 
             // We must initialize sharding on all connections, so that we get exceptions if sharding is enabled on
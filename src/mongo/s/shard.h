@@ -227,6 +227,7 @@ namespace mongo {
     };
 
     class ChunkManager;
+    class ClientConnections;
     typedef shared_ptr<const ChunkManager> ChunkManagerPtr;
 
     class ShardConnection : public AScopedConnection {
@@ -324,6 +325,18 @@ namespace mongo {
          */
         static void forgetNS( const string& ns );
 
+        /**
+         * Takes the current thread's cached connections off it, so that the client connection
+         * they belong to can be served by another thread.  @return NULL if there are none.
+         */
+        static ClientConnections* releaseThreadConnections();
+
+        /** Makes cc, from releaseThreadConnections(), the current thread's cached connections. */
+        static void attachThreadConnections( ClientConnections* cc );
+
+        /** Destroys cc, from releaseThreadConnections(), returning its connections to the pool. */
+        static void destroyThreadConnections( ClientConnections* cc );
+
     private:
         void _init();
         void _finishInit();
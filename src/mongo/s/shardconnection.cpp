@@ -100,7 +100,8 @@ namespace mongo {
 
     /**
      * holds all the actual db connections for a client to various servers
-     * 1 per thread, so doesn't have to be thread safe
+     * 1 per thread, so doesn't have to be thread safe.  A client connection served by a pool of
+     * threads carries its own from thread to thread (see ShardConnection::releaseThreadConnections)
      */
     class ClientConnections : boost::noncopyable {
     public:
@@ -500,4 +501,17 @@ namespace mongo {
     void ShardConnection::forgetNS( const string& ns ) {
         ClientConnections::threadInstance()->forgetNS( ns );
     }
+
+    ClientConnections* ShardConnection::releaseThreadConnections() {
+        return ClientConnections::_perThread.release();
+    }
+
+    void ShardConnection::attachThreadConnections( ClientConnections* cc ) {
+        verify( ClientConnections::_perThread.get() == NULL );
+        ClientConnections::_perThread.reset( cc );
+    }
+
+    void ShardConnection::destroyThreadConnections( ClientConnections* cc ) {
+        delete cc;
+    }
 }
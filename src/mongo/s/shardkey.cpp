@@ -26,7 +26,8 @@
 
 namespace mongo {
 
-    ShardKeyPattern::ShardKeyPattern( BSONObj p ) : pattern( p.getOwned() ) {
+    ShardKeyPattern::ShardKeyPattern( BSONObj p , int hashVersion ) :
+        pattern( p.getOwned() , hashVersion ) {
         pattern.toBSON().getFieldNames( patternfields );
 
         BSONObjBuilder min;
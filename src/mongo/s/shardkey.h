@@ -32,7 +32,8 @@ namespace mongo {
     */
     class ShardKeyPattern {
     public:
-        ShardKeyPattern( BSONObj p = BSONObj() );
+        /** hashVersion is the hash function of a hashed shard key, see HashVersions. */
+        ShardKeyPattern( BSONObj p = BSONObj() , int hashVersion = 0 );
 
         /**
            global min is the lowest possible value for this key
@@ -73,6 +74,8 @@ namespace mongo {
 
         BSONObj key() const { return pattern.toBSON(); }
 
+        int hashVersion() const { return pattern.hashVersion(); }
+
         string toString() const;
 
         BSONObj extractKey(const BSONObj& from) const;
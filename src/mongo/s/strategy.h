@@ -34,9 +34,14 @@ namespace mongo {
 
         void insert( const Shard& shard , const char * ns , const BSONObj& obj , int flags=0 , bool safe=false );
 
+        /**
+         * Runs command on every shard the filter targets.  If hosts is given, it gets the
+         * host that answered for each shard, which for a slaveOk command may be a secondary.
+         */
         virtual void commandOp( const string& db, const BSONObj& command, int options,
                                 const string& versionedNS, const BSONObj& filter,
-                                map<Shard,BSONObj>& results )
+                                map<Shard,BSONObj>& results,
+                                map<Shard,string>* hosts = NULL )
         {
             // Only call this from sharded, for now.
             // TODO:  Refactor all this.
@@ -148,7 +148,8 @@ namespace mongo {
 
         virtual void commandOp( const string& db, const BSONObj& command, int options,
                                 const string& versionedNS, const BSONObj& filter,
-                                map<Shard,BSONObj>& results )
+                                map<Shard,BSONObj>& results,
+                                map<Shard,string>* hosts )
         {
 
             QuerySpec qSpec(db + ".$cmd", command, BSONObj(), 0, 1, options);
@@ -162,7 +163,11 @@ namespace mongo {
             cursor.getQueryShards( shards );
 
             for( set<Shard>::iterator i = shards.begin(), end = shards.end(); i != end; ++i ){
-                results[ *i ] = cursor.getShardCursor( *i )->peekFirst().getOwned();
+                DBClientCursorPtr shardCursor = cursor.getShardCursor( *i );
+                results[ *i ] = shardCursor->peekFirst().getOwned();
+                if ( hosts ) {
+                    ( *hosts )[ *i ] = shardCursor->originalHost();
+                }
             }
 
         }
@@ -530,6 +535,18 @@ namespace mongo {
 
             bool continueOnError = flags & InsertOption_ContinueOnError;
 
+            if (continueOnError) {
+                // Without ordering to preserve, documents for different shards don't have to
+                // wait for each other.
+                ChunkManagerPtr manager;
+                ShardPtr primary;
+                grid.getDBConfig(ns)->getChunkManagerOrPrimary(ns, manager, primary);
+                if (manager) {
+                    _insertToAllShards(ns, d, flags, r);
+                    return;
+                }
+            }
+
             // Sanity check, probably not needed but for safety
             int retries = 0;
 
@@ -781,6 +798,233 @@ namespace mongo {
             }
         }
 
+        // The documents of a continue-on-error insert headed for one shard.
+        struct ShardInserts {
+            ShardPtr shard;
+            vector<BSONObj> inserts;
+            map<ChunkPtr, int> chunkData;
+            int size;
+
+            ShardInserts() : size(0) {}
+        };
+
+        /**
+         * Splits docs by the shard each belongs on, under the current chunk manager (or the
+         * primary, if the collection isn't sharded anymore), which is returned in manager.  Each shard gets at most
+         * BSONObjMaxUserSize / 2 bytes, the rest stay in docs, in order, for the next round.
+         *
+         * Documents without the shard key are dropped from docs and the last such error is
+         * recorded in errCode / errMsg, as _getNextInsertGroup would, including the one reload
+         * of the config data allowed per batch.
+         */
+        void _targetInserts(const string& ns, vector<BSONObj>& docs, bool& reloadedConfig,
+                            ChunkManagerPtr& manager, map<string, ShardInserts>& byShard,
+                            int& errCode, string& errMsg) {
+            ShardPtr primary;
+            grid.getDBConfig(ns)->getChunkManagerOrPrimary(ns, manager, primary);
+
+            byShard.clear();
+            vector<BSONObj> leftover;
+            for (vector<BSONObj>::iterator it = docs.begin(); it != docs.end(); ++it) {
+                BSONObj o = *it;
+
+                if (manager && !manager->hasShardKey(o)) {
+                    bool bad = true;
+                    if (manager->getShardKey().partOfShardKey("_id") && !o.hasField("_id")) {
+                        BSONObjBuilder b;
+                        b.appendOID("_id", 0, true);
+                        b.appendElements(o);
+                        o = b.obj();
+                        bad = !manager->hasShardKey(o);
+                    }
+
+                    if (bad && !reloadedConfig) {
+                        // Same as _getNextInsertGroup: we may just be stale, reload once.
+                        warning() << "shard key mismatch for insert " << o
+                                  << ", expected values for " << manager->getShardKey()
+                                  << ", reloading config data to ensure not stale" << endl;
+                        grid.getDBConfig(ns)->getChunkManagerIfExists(ns, true);
+                        reloadedConfig = true;
+                        _targetInserts(ns, docs, reloadedConfig, manager, byShard, errCode, errMsg);
+                        return;
+                    }
+
+                    if (bad) {
+                        _sleepForVerifiedLocalError();
+                        log() << "tried to insert object with no valid shard key for "
+                              << manager->getShardKey() << " : " << o << endl;
+                        errCode = 8011;
+                        errMsg = str::stream() << "tried to insert object with no valid shard key for "
+                                               << manager->getShardKey().toString()
+                                               << " : " << o.toString();
+                        continue;
+                    }
+                }
+
+                const int objSize = o.objsize();
+                verify( objSize <= BSONObjMaxUserSize );
+
+                ChunkPtr chunk;
+                if (manager) {
+                    chunk = manager->findChunkForDoc(o);
+                    o = manager->getShardKey().moveToFront(o);
+                }
+                const Shard shard = manager ? chunk->getShard() : *primary;
+
+                ShardInserts& group = byShard[shard.getName()];
+                // Insert at least one document, but otherwise no more than 8MB of data,
+                // otherwise the WBL will not work.
+                if (!group.inserts.empty() && group.size + objSize > BSONObjMaxUserSize / 2) {
+                    leftover.push_back(o);
+                    continue;
+                }
+                if (!group.shard) {
+                    group.shard.reset(new Shard(shard));
+                }
+                group.inserts.push_back(o);
+                group.size += objSize;
+                if (chunk) {
+                    group.chunkData[chunk] += objSize;
+                }
+            }
+            docs.swap(leftover);
+        }
+
+        /**
+         * Inserts a continue-on-error batch into a sharded collection.  Rather than sending one
+         * run of documents for the same shard at a time, and waiting on getLastError between
+         * runs, every shard is sent all of its documents at once, so a batch spread over N
+         * shards costs one round trip instead of N (or one per document, with a hashed key).
+         *
+         * The version of every shard is checked before anything is sent, so a stale config
+         * just retargets what hasn't been sent yet.  Batches of more than 8MB for one shard
+         * take several rounds, with an intermediate getLastError between them, as before.
+         *
+         * As with the serial path, the client's getLastError sees the errors of the last round
+         * (from every shard it went to), a mongos error (no shard key) is thrown in preference
+         * to those, and errors from earlier rounds are only logged.
+         */
+        void _insertToAllShards(const string& ns, DbMessage& d, int flags, Request& r) {
+            vector<BSONObj> docs;
+            while (d.moreJSObjs()) {
+                docs.push_back(d.nextJsObj());
+            }
+
+            bool reloadedConfig = false;
+            int mongosErrCode = 0;
+            string mongosErr;
+            string lastRoundErr;
+            int retries = 0;
+
+            while (!docs.empty()) {
+                uassert( 17418, str::stream() << "too many retries during insert", retries < 30 );
+
+                ChunkManagerPtr manager;
+                map<string, ShardInserts> byShard;
+                vector<BSONObj> pending = docs;
+                _targetInserts(ns, pending, reloadedConfig, manager, byShard, mongosErrCode, mongosErr);
+                if (byShard.empty()) {
+                    docs.clear();
+                    break;
+                }
+
+                //
+                // CHECK VERSIONS, before sending anything, so a retry can't insert twice.
+                //
+
+                vector< shared_ptr<ShardConnection> > conns;
+                try {
+                    for (map<string, ShardInserts>::iterator it = byShard.begin(); it != byShard.end(); ++it) {
+                        conns.push_back(shared_ptr<ShardConnection>(new ShardConnection(*it->second.shard, ns, manager)));
+                        conns.back()->setVersion();
+                    }
+                }
+                catch (StaleConfigException& e) {
+                    for (vector< shared_ptr<ShardConnection> >::iterator it = conns.begin(); it != conns.end(); ++it) {
+                        (*it)->done();
+                    }
+                    _handleRetries("insert", retries, ns, byShard.begin()->second.inserts[0], e, r);
+                    retries++;
+                    continue;
+                }
+                catch (DBException& e) {
+                    for (vector< shared_ptr<ShardConnection> >::iterator it = conns.begin(); it != conns.end(); ++it) {
+                        (*it)->kill();
+                    }
+                    throw;
+                }
+                retries = 0;
+
+                //
+                // SEND EVERYTHING, then wait for all of it below (or in the client's GLE).
+                //
+
+                string sendErr;
+                size_t i = 0;
+                for (map<string, ShardInserts>::iterator it = byShard.begin(); it != byShard.end(); ++it, ++i) {
+                    ShardConnection& dbcon = *conns[i];
+                    LOG(5) << "inserting " << it->second.inserts.size() << " documents to shard "
+                           << it->first << endl;
+                    try {
+                        dbcon->insert(ns, it->second.inserts, flags);
+                        // Returning the connection is what makes the client's GLE check it.
+                        dbcon.done();
+                        globalOpCounters.gotInsert(it->second.inserts.size());
+                    }
+                    catch (DBException& e) {
+                        dbcon.kill();
+                        sendErr = str::stream() << "error inserting " << it->second.inserts.size()
+                                                << " documents to shard " << it->first
+                                                << causedBy(e);
+                        warning() << sendErr << endl;
+                    }
+                }
+
+                if (r.getClientInfo()->autoSplitOk()) {
+                    for (map<string, ShardInserts>::iterator it = byShard.begin(); it != byShard.end(); ++it) {
+                        for (map<ChunkPtr, int>::iterator c = it->second.chunkData.begin();
+                             c != it->second.chunkData.end(); ++c) {
+                            c->first->splitIfShould(c->second);
+                        }
+                    }
+                }
+
+                docs.swap(pending);
+                lastRoundErr = sendErr;
+
+                //
+                // CHECK INTERMEDIATE ERRORS, if another round (or a mongos error) would mask them.
+                //
+
+                if (!docs.empty() || !mongosErr.empty()) {
+                    ClientInfo* ci = r.getClientInfo();
+                    ci->newRequest();
+
+                    BSONObjBuilder gleB;
+                    string errMsg;
+                    ci->getLastError("admin", BSON( "getLastError" << 1 ), gleB, errMsg, false);
+                    BSONObj gle = gleB.obj();
+                    string insertErr = gle["err"].type() == String ? gle["err"].String() : errMsg;
+                    if (insertErr.empty()) {
+                        insertErr = sendErr;
+                    }
+                    if (!insertErr.empty()) {
+                        warning() << "swallowing exception during insert (continue on error set)"
+                                  << causedBy(insertErr) << endl;
+                    }
+                    ci->clearSinceLastGetError();
+                    lastRoundErr.clear();
+                }
+            }
+
+            if (!mongosErr.empty()) {
+                uasserted(mongosErrCode, str::stream() << "error preparing documents for insert"
+                                                        << causedBy(mongosErr));
+            }
+            // The client's GLE can't see a failure to send, report it now.
+            uassert(17419, lastRoundErr, lastRoundErr.empty());
+        }
+
         void _prepareUpdate(const string& ns,
                             const BSONObj& query,
                             const BSONObj& toUpdate,
@@ -28,6 +28,7 @@ namespace mongo {
     const BSONField<std::string> CollectionType::primary("primary");
     const BSONField<BSONObj> CollectionType::keyPattern("key");
     const BSONField<bool> CollectionType::unique("unique");
+    const BSONField<int> CollectionType::hashVersion("hashVersion", 0);
     const BSONField<Date_t> CollectionType::updatedAt("updatedAt");
     const BSONField<bool> CollectionType::noBalance("noBalance");
     const BSONField<OID> CollectionType::epoch("epoch");
@@ -75,7 +76,7 @@ namespace mongo {
 
         // Sharding related fields may only be set if the sharding key pattern is present, unless
         // we're dropped.
-        if ( ( _unique || _noBalance ) && ( !_isDroppedSet || !_dropped )
+        if ( ( _unique || _noBalance || _hashVersion ) && ( !_isDroppedSet || !_dropped )
             && ( _keyPattern.nFields() == 0 ) )
         {
             *errMsg = stream() << "missing " << keyPattern.name() << " field";
@@ -92,6 +93,7 @@ namespace mongo {
         if (_isPrimarySet) builder.append(primary(), _primary);
         if (_isKeyPatternSet) builder.append(keyPattern(), _keyPattern);
         if (_isUniqueSet) builder.append(unique(), _unique);
+        if (_isHashVersionSet) builder.append(hashVersion(), _hashVersion);
         if (_isUpdatedAtSet) builder.append(updatedAt(), _updatedAt);
         if (_isNoBalanceSet) builder.append(noBalance(), _noBalance);
 
@@ -130,6 +132,10 @@ namespace mongo {
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isUniqueSet = fieldState == FieldParser::FIELD_SET;
 
+        fieldState = FieldParser::extract(source, hashVersion, &_hashVersion, errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isHashVersionSet = fieldState == FieldParser::FIELD_SET;
+
         fieldState = FieldParser::extract(source, updatedAt, &_updatedAt, errMsg);
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isUpdatedAtSet = fieldState == FieldParser::FIELD_SET;
@@ -188,6 +194,9 @@ namespace mongo {
         _unique = false;
         _isUniqueSet = false;
 
+        _hashVersion = 0;
+        _isHashVersionSet = false;
+
         _updatedAt = 0ULL;
         _isUpdatedAtSet = false;
 
@@ -217,6 +226,9 @@ namespace mongo {
         other->_unique = _unique;
         other->_isUniqueSet = _isUniqueSet;
 
+        other->_hashVersion = _hashVersion;
+        other->_isHashVersionSet = _isHashVersionSet;
+
         other->_updatedAt = _updatedAt;
         other->_isUpdatedAtSet = _isUpdatedAtSet;
 
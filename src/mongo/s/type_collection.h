@@ -61,6 +61,7 @@ namespace mongo {
         static const BSONField<std::string> primary;
         static const BSONField<BSONObj> keyPattern;
         static const BSONField<bool> unique;
+        static const BSONField<int> hashVersion;
         static const BSONField<Date_t> updatedAt;
         static const BSONField<bool> noBalance;
         static const BSONField<OID> epoch;
@@ -221,6 +222,27 @@ namespace mongo {
                 return unique.getDefault();
             }
         }
+        void setHashVersion(int hashVersion) {
+            _hashVersion = hashVersion;
+            _isHashVersionSet = true;
+        }
+
+        void unsetHashVersion() { _isHashVersionSet = false; }
+
+        bool isHashVersionSet() const {
+            return _isHashVersionSet || hashVersion.hasDefault();
+        }
+
+        // Calling get*() methods when the member is not set and has no default results in undefined
+        // behavior
+        int getHashVersion() const {
+            if (_isHashVersionSet) {
+                return _hashVersion;
+            } else {
+                dassert(hashVersion.hasDefault());
+                return hashVersion.getDefault();
+            }
+        }
         void setNoBalance(bool noBalance) {
             _noBalance = noBalance;
             _isNoBalanceSet = true;
@@ -274,6 +296,8 @@ namespace mongo {
         bool _isKeyPatternSet;
         bool _unique;     // (O)  mandatory if sharded, index is unique
         bool _isUniqueSet;
+        int _hashVersion;     // (O)  hash function of a hashed shard key, see HashVersions
+        bool _isHashVersionSet;
         Date_t _updatedAt;     // (M)  last updated time
         bool _isUpdatedAtSet;
         bool _noBalance;     // (O)  optional if sharded, disable balancing
@@ -0,0 +1,148 @@
+/** @file batch_queue.h */
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    /** How big a batch of documents the tools send to the server in one insert message. */
+    const size_t ToolInsertBatchBytes = 8 * 1024 * 1024;
+
+    /**
+     * A bounded queue of batches, handed from the threads of one stage of a tool's pipeline
+     * (reading a file, parsing documents) to the threads of the next (parsing, inserting).
+     *
+     * Each of the producers must call producerDone() once it has pushed its last batch, after
+     * which pop() returns false once the queue drains.  Any thread may call abort(), which
+     * wakes everyone and makes every later push() and pop() throw with the given reason, so a
+     * failure at either end stops the whole pipeline instead of leaving threads blocked.
+     */
+    template <typename T>
+    class BatchQueue : boost::noncopyable {
+    public:
+        BatchQueue(size_t maxBatches, int producers) :
+            _lock("BatchQueue"),
+            _maxBatches(maxBatches),
+            _producers(producers),
+            _aborted(false) {
+        }
+
+        /** Queues batch, leaving it empty, and waits for room if the queue is full. */
+        void push(std::vector<T> &batch) {
+            if (batch.empty()) {
+                return;
+            }
+            scoped_lock lk(_lock);
+            while (!_aborted && _batches.size() >= _maxBatches) {
+                _cvNotFull.wait(lk.boost());
+            }
+            checkAborted();
+            _batches.push_back(std::vector<T>());
+            _batches.back().swap(batch);
+            _cvNotEmpty.notify_one();
+        }
+
+        /** @return false once every producer is done and everything queued has been popped. */
+        bool pop(std::vector<T> &batch) {
+            scoped_lock lk(_lock);
+            while (!_aborted && _batches.empty() && _producers > 0) {
+                _cvNotEmpty.wait(lk.boost());
+            }
+            checkAborted();
+            if (_batches.empty()) {
+                return false;
+            }
+            batch.clear();
+            batch.swap(_batches.front());
+            _batches.pop_front();
+            _cvNotFull.notify_one();
+            return true;
+        }
+
+        void producerDone() {
+            scoped_lock lk(_lock);
+            verify(_producers > 0);
+            if (--_producers == 0) {
+                _cvNotEmpty.notify_all();
+            }
+        }
+
+        /** Only the first reason given is kept, later ones are usually just fallout from it. */
+        void abort(const std::string &reason) {
+            scoped_lock lk(_lock);
+            if (!_aborted) {
+                _aborted = true;
+                _reason = reason;
+                _batches.clear();
+            }
+            _cvNotFull.notify_all();
+            _cvNotEmpty.notify_all();
+        }
+
+    private:
+        void checkAborted() const {
+            uassert(17404, _reason, !_aborted);
+        }
+
+        mongo::mutex _lock;
+        boost::condition _cvNotFull;
+        boost::condition _cvNotEmpty;
+        std::deque< std::vector<T> > _batches;
+        const size_t _maxBatches;
+        int _producers;
+        bool _aborted;
+        std::string _reason;
+    };
+
+    /** Collects documents into batches of about ToolInsertBatchBytes for a BatchQueue. */
+    class DocumentBatcher : boost::noncopyable {
+    public:
+        explicit DocumentBatcher(BatchQueue<BSONObj> &queue) : _queue(queue), _bytes(0) {}
+
+        /** Copies obj, the caller's buffer is usually reused for the next one. */
+        void add(const BSONObj &obj) {
+            _batch.push_back(obj.getOwned());
+            _bytes += obj.objsize();
+            if (_bytes >= ToolInsertBatchBytes) {
+                flush();
+            }
+        }
+
+        void flush() {
+            _queue.push(_batch);
+            _bytes = 0;
+        }
+
+    private:
+        BatchQueue<BSONObj> &_queue;
+        std::vector<BSONObj> _batch;
+        size_t _bytes;
+    };
+
+} // namespace mongo
@@ -20,6 +20,8 @@
 #include "mongo/pch.h"
 #include "mongo/db/json.h"
 #include "mongo/db/namespacestring.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/tools/batch_queue.h"
 #include "mongo/tools/tool.h"
 #include "mongo/util/text.h"
 #include "mongo/base/initializer.h"
@@ -29,7 +31,9 @@
 #include <iostream>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace mongo;
 using std::string;
@@ -49,8 +53,16 @@ class Import : public Tool {
     bool _doimport;
     bool _jsonArray;
     bool _doBulkLoad;
+    bool _stopOnError;
+    int _numParsingThreads;
     vector<string> _upsertFields;
     static const int BUF_SIZE;
+    boost::scoped_array<char> _lineBuffer;
+
+    // Shared by the threads of importPipelined.
+    AtomicUInt64 _parsed;
+    AtomicUInt64 _parseErrors;
+    AtomicUInt32 _stopping;
 
     void csvTokenizeRow(const string& row, vector<string>& tokens) {
         bool inQuotes = false;
@@ -170,13 +182,12 @@ class Import : public Tool {
     }
 
     /*
-     * Parses one object from the input file.  This usually corresponds to one line in the input
-     * file, unless the file is a CSV and contains a newline within a quoted string entry.
-     * Returns a true if a BSONObj was successfully created and false if not.
+     * Reads the text of one object from the input file.  This usually corresponds to one line in
+     * the input file, unless the file is a CSV and contains a newline within a quoted string
+     * entry.  Returns false if there was no object on the line.
      */
-    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
+    bool readRecord(istream* in, string& record, int& numBytesRead) {
+        char* line = _lineBuffer.get();
 
         numBytesRead = getLine(in, line);
         line += numBytesRead;
@@ -186,58 +197,73 @@ class Import : public Tool {
         }
         numBytesRead += strlen( line );
 
+        if (_type != CSV) {
+            record = line;
+            return true;
+        }
+
+        record.clear();
+        bool inside_quotes = false;
+        size_t last_quote = 0;
+        while (true) {
+            string lineStr(line);
+            // Deal with line breaks in quoted strings
+            last_quote = lineStr.find_first_of('"');
+            while (last_quote != string::npos) {
+                inside_quotes = !inside_quotes;
+                last_quote = lineStr.find_first_of('"', last_quote+1);
+            }
+
+            record.append(lineStr);
+
+            if (inside_quotes) {
+                record.append("\n");
+                line = _lineBuffer.get();
+                int num = getLine(in, line);
+                line += num;
+                numBytesRead += num;
+
+                uassert (15854, "CSV file ends while inside quoted field", line[0] != '\0');
+                numBytesRead += strlen( line );
+            } else {
+                break;
+            }
+        }
+        // now 'record' is string corresponding to one row of the CSV file
+        // (which may span multiple lines) and represents one BSONObj
+        return true;
+    }
+
+    /*
+     * Parses the text of one object, as read by readRecord.  Only the header line changes any
+     * state, so once it has been seen, several threads can parse at once.
+     */
+    void parseRecord(const string& record, BSONObj& o) {
         if (_type == JSON) {
             // Strip out trailing whitespace
-            char * end = ( line + strlen( line ) ) - 1;
-            while ( end >= line && isspace(*end) ) {
-                *end = 0;
+            size_t end = record.size();
+            while ( end > 0 && isspace(record[end - 1]) ) {
                 end--;
             }
             try {
-                o = fromjson( line );
+                o = fromjson( record.substr( 0 , end ) );
             } catch ( MsgAssertionException& e ) {
                 uasserted(13504, string("BSON representation of supplied JSON is too large: ") + e.what());
             }
-            return true;
+            return;
         }
 
         vector<string> tokens;
         if (_type == CSV) {
-            string row;
-            bool inside_quotes = false;
-            size_t last_quote = 0;
-            while (true) {
-                string lineStr(line);
-                // Deal with line breaks in quoted strings
-                last_quote = lineStr.find_first_of('"');
-                while (last_quote != string::npos) {
-                    inside_quotes = !inside_quotes;
-                    last_quote = lineStr.find_first_of('"', last_quote+1);
-                }
-
-                row.append(lineStr);
-
-                if (inside_quotes) {
-                    row.append("\n");
-                    int num = getLine(in, line);
-                    line += num;
-                    numBytesRead += num;
-
-                    uassert (15854, "CSV file ends while inside quoted field", line[0] != '\0');
-                    numBytesRead += strlen( line );
-                } else {
-                    break;
-                }
-            }
-            // now 'row' is string corresponding to one row of the CSV file
-            // (which may span multiple lines) and represents one BSONObj
-            csvTokenizeRow(row, tokens);
+            csvTokenizeRow(record, tokens);
         }
         else {  // _type == TSV
-            while (line[0] != '\t' && isspace(line[0])) { // Strip leading whitespace, but not tabs
-                line++;
+            size_t start = 0;
+            while (start < record.size() && record[start] != '\t' && isspace(record[start])) { // Strip leading whitespace, but not tabs
+                start++;
             }
 
+            const string line = record.substr(start);
             boost::split(tokens, line, boost::is_any_of(_sep));
         }
 
@@ -265,6 +291,18 @@ class Import : public Tool {
             }
         }
         o = b.obj();
+    }
+
+    /*
+     * Parses one object from the input file.
+     * Returns a true if a BSONObj was successfully created and false if not.
+     */
+    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
+        string record;
+        if (!readRecord(in, record, numBytesRead)) {
+            return false;
+        }
+        parseRecord(record, o);
         return true;
     }
 
@@ -281,6 +319,7 @@ public:
         ("upsertFields", po::value<string>(), "comma-separated fields for the query part of the upsert. You should make sure this is indexed" )
         ("stopOnError", "stop importing at first error rather than continuing" )
         ("jsonArray", "load a json array, not one item per line. Currently limited to 16MB." )
+        ("numParsingThreads", po::value<int>()->default_value(1), "number of threads parsing documents while another inserts them; with more than one, documents may be inserted out of order" )
         ;
         add_hidden_options()
         ("noimport", "don't actually import. useful for benchmarking parser" )
@@ -292,6 +331,9 @@ public:
         _upsert = false;
         _doimport = true;
         _jsonArray = false;
+        _stopOnError = false;
+        _numParsingThreads = 1;
+        _lineBuffer.reset(new char[BUF_SIZE+2]);
     }
     ;
     virtual void printExtraHelp( ostream & out ) {
@@ -321,6 +363,150 @@ public:
         return true;
     }
 
+    // How much input text a parser takes at a time.
+    static const size_t RecordBatchBytes = 1024 * 1024;
+
+    /*
+     * Imports everything left in the input, reading it on one thread, parsing it on
+     * _numParsingThreads others and inserting the documents in batches from this one, so the
+     * parsing, which is what usually limits an import, can use more than one core.
+     * Returns the number of objects read, including the header line.
+     */
+    int importPipelined(istream* in, const string& ns, ProgressMeter& pm, time_t start) {
+        int num = 0;
+        if ( _headerLine ) {
+            // The header changes how everything after it is parsed, so it has to come first.
+            string record;
+            int len = 0;
+            while ( in->rdstate() == 0 && !readRecord(in, record, len) ) {
+            }
+            if ( !record.empty() ) {
+                BSONObj o;
+                parseRecord(record, o);
+                pm.hit( len + 1 );
+                num++;
+            }
+            _headerLine = false;
+        }
+
+        BatchQueue<string> records(2 * _numParsingThreads, 1);
+        BatchQueue<BSONObj> docs(4, _numParsingThreads);
+        boost::thread_group threads;
+        threads.create_thread(boost::bind(&Import::readThread, this, in, boost::ref(pm), start,
+                                          boost::ref(records)));
+        for (int i = 0; i < _numParsingThreads; i++) {
+            threads.create_thread(boost::bind(&Import::parseThread, this, boost::ref(records),
+                                              boost::ref(docs)));
+        }
+
+        try {
+            vector<BSONObj> batch;
+            bool first = true;
+            while (docs.pop(batch)) {
+                if (!_doimport) {
+                    continue;
+                }
+                conn().insert(ns, batch, _stopOnError ? 0 : InsertOption_ContinueOnError);
+                if (first) {
+                    // we absolutely want to check the first and last op of the import.
+                    checkLastError();
+                    first = false;
+                }
+            }
+        }
+        catch (std::exception& e) {
+            records.abort(e.what());
+            docs.abort(e.what());
+            threads.join_all();
+            throw;
+        }
+        threads.join_all();
+        return num + _parsed.load();
+    }
+
+    void readThread(istream* in, ProgressMeter& pm, time_t start, BatchQueue<string>& records) {
+        try {
+            vector<string> batch;
+            size_t batchBytes = 0;
+            unsigned long long num = 0;
+            while ( in->rdstate() == 0 && !_stopping.load() ) {
+                string record;
+                int len = 0;
+                try {
+                    if (!readRecord(in, record, len)) {
+                        continue;
+                    }
+                }
+                catch ( std::exception& e ) {
+                    log() << "exception:" << e.what() << endl;
+                    _parseErrors.fetchAndAdd(1);
+                    if (_stopOnError) {
+                        _stopping.store(1);
+                    }
+                    continue;
+                }
+
+                batchBytes += record.size();
+                batch.push_back(string());
+                batch.back().swap(record);
+                if (batchBytes >= RecordBatchBytes) {
+                    records.push(batch);
+                    batchBytes = 0;
+                }
+
+                num++;
+                if ( pm.hit( len + 1 ) ) {
+                    log() << "\t\t\t" << num << "\t" << ( num / ( time(0) - start ) ) << "/second" << endl;
+                }
+            }
+            records.push(batch);
+        }
+        catch ( std::exception& e ) {
+            // Whatever stopped the import has already been reported.
+        }
+        records.producerDone();
+    }
+
+    void parseThread(BatchQueue<string>& records, BatchQueue<BSONObj>& docs) {
+        try {
+            DocumentBatcher batcher(docs);
+            vector<string> batch;
+            while (records.pop(batch)) {
+                for (vector<string>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                    if (_stopping.load()) {
+                        // Keep draining so the reader isn't left waiting for room.
+                        break;
+                    }
+                    BSONObj o;
+                    try {
+                        parseRecord(*it, o);
+                    }
+                    catch ( std::exception& e ) {
+                        noteParseError(e, *it);
+                        continue;
+                    }
+                    batcher.add(o);
+                    _parsed.fetchAndAdd(1);
+                }
+            }
+            batcher.flush();
+        }
+        catch ( std::exception& e ) {
+            records.abort(e.what());
+            docs.abort(e.what());
+        }
+        docs.producerDone();
+    }
+
+    void noteParseError(const std::exception& e, const string& record) {
+        log() << "exception:" << e.what() << endl;
+        log() << record << endl;
+        _parseErrors.fetchAndAdd(1);
+        if (_stopOnError) {
+            _stopping.store(1);
+        }
+    }
+
     int run() {
         string filename = getParam( "file" );
         long long fileSize = 0;
@@ -418,6 +604,15 @@ public:
             _jsonArray = true;
         }
 
+        // Upserts have to happen in order, and a JSON array is all one line.
+        const bool pipelined = !_upsert && !_jsonArray;
+        _numParsingThreads = getParam( "numParsingThreads" , 1 );
+        if (pipelined && _numParsingThreads < 1) {
+            error() << "--numParsingThreads must be at least 1" << endl;
+            return -1;
+        }
+        _stopOnError = hasParam("stopOnError");
+
         time_t start = time(0);
         LOG(1) << "filesize: " << fileSize << endl;
         ProgressMeter pm( fileSize );
@@ -437,74 +632,82 @@ public:
             NamespaceString n(ns);
             loader.reset(new RemoteLoader(conn(), n.db, n.coll, vector<BSONObj>(), BSONObj()));
         }
-        while ( _jsonArray || in->rdstate() == 0 ) {
-            try {
-                BSONObj o;
-                if (_jsonArray) {
-                    int bytesProcessed = 0;
-                    if (line == buffer.get()) { // Only read on first pass - the whole array must be on one line.
-                        bytesProcessed = getLine(in, line);
-                        line += bytesProcessed;
-                        len += bytesProcessed;
-                    }
-                    if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
+        if (pipelined) {
+            num = importPipelined(in, ns, pm, start);
+            errors = _parseErrors.load();
+            // Only the first batch was checked.
+            lastNumChecked = headerRows;
+        }
+        else {
+            while ( _jsonArray || in->rdstate() == 0 ) {
+                try {
+                    BSONObj o;
+                    if (_jsonArray) {
+                        int bytesProcessed = 0;
+                        if (line == buffer.get()) { // Only read on first pass - the whole array must be on one line.
+                            bytesProcessed = getLine(in, line);
+                            line += bytesProcessed;
+                            len += bytesProcessed;
+                        }
+                        if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
+                            len += bytesProcessed;
+                            break;
+                        }
                         len += bytesProcessed;
-                        break;
+                        line += bytesProcessed;
                     }
-                    len += bytesProcessed;
-                    line += bytesProcessed;
-                }
-                else {
-                    if (!parseRow(in, o, len)) {
-                        continue;
+                    else {
+                        if (!parseRow(in, o, len)) {
+                            continue;
+                        }
                     }
-                }
 
-                if ( _headerLine ) {
-                    _headerLine = false;
-                }
-                else if (_doimport) {
-                    bool doUpsert = _upsert;
-                    BSONObjBuilder b;
-                    if (_upsert) {
-                        for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
-                            BSONElement e = o.getFieldDotted(it->c_str());
-                            if (e.eoo()) {
-                                doUpsert = false;
-                                break;
+                    if ( _headerLine ) {
+                        _headerLine = false;
+                    }
+                    else if (_doimport) {
+                        bool doUpsert = _upsert;
+                        BSONObjBuilder b;
+                        if (_upsert) {
+                            for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
+                                BSONElement e = o.getFieldDotted(it->c_str());
+                                if (e.eoo()) {
+                                    doUpsert = false;
+                                    break;
+                                }
+                                b.appendAs(e, *it);
                             }
-                            b.appendAs(e, *it);
                         }
-                    }
 
-                    if (doUpsert) {
-                        conn().update(ns, Query(b.obj()), o, true);
-                    }
-                    else {
-                        conn().insert( ns.c_str() , o );
-                    }
+                        if (doUpsert) {
+                            conn().update(ns, Query(b.obj()), o, true);
+                        }
+                        else {
+                            conn().insert( ns.c_str() , o );
+                        }
 
-                    if( num < 10 ) { 
-                        // we absolutely want to check the first and last op of the batch. we do 
-                        // a few more as that won't be too time expensive.
-                        checkLastError();
-                        lastNumChecked = num;
+                        if( num < 10 ) { 
+                            // we absolutely want to check the first and last op of the batch. we do 
+                            // a few more as that won't be too time expensive.
+                            checkLastError();
+                            lastNumChecked = num;
+                        }
                     }
-                }
 
-                num++;
-            }
-            catch ( std::exception& e ) {
-                log() << "exception:" << e.what() << endl;
-                log() << line << endl;
-                errors++;
+                    num++;
+                }
+                catch ( std::exception& e ) {
+                    log() << "exception:" << e.what() << endl;
+                    log() << line << endl;
+                    errors++;
 
-                if (hasParam("stopOnError") || _jsonArray)
-                    break;
-            }
+                    if (hasParam("stopOnError") || _jsonArray)
+                        break;
+                }
 
-            if ( pm.hit( len + 1 ) ) {
-                log() << "\t\t\t" << num << "\t" << ( num / ( time(0) - start ) ) << "/second" << endl;
+                if ( pm.hit( len + 1 ) ) {
+                    log() << "\t\t\t" << num << "\t" << ( num / ( time(0) - start ) ) << "/second" << endl;
+                }
             }
         }
         if (loader) {
@@ -19,17 +19,21 @@
 
 #include "pch.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/filesystem/convenience.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/program_options.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
 #include <fcntl.h>
 #include <fstream>
 #include <set>
 
 #include "mongo/base/initializer.h"
 #include "mongo/db/namespacestring.h"
+#include "mongo/tools/batch_queue.h"
 #include "mongo/tools/tool.h"
 #include "mongo/util/stringutils.h"
 #include "mongo/db/json.h"
@@ -48,18 +52,32 @@ public:
     bool _restoreIndexes;
     int _w;
     bool _doBulkLoad;
+    int _numParallelCollections;
     string _curns;
     string _curdb;
-    string _curcoll;
     set<string> _users; // For restoring users with --drop
 
+    // A collection's dump, waiting for a thread to restore it.
+    struct CollectionFile {
+        boost::filesystem::path file;
+        string ns;
+        unsigned long long size;
+        // biggest first
+        bool operator<(const CollectionFile &other) const { return size > other.size; }
+    };
+    vector<CollectionFile> _queued;
+    mongo::mutex _queueMutex;
+    size_t _nextQueued;
+    string _failure;
+
     std::string _defaultCompression;
     BytesQuantity<int> _defaultPageSize;
     BytesQuantity<int> _defaultReadPageSize;
 
     Restore() : BSONTool( "restore" ),
         _drop(false), _restoreOptions(false), _restoreIndexes(false),
-        _w(0), _doBulkLoad(false) {
+        _w(0), _doBulkLoad(false), _numParallelCollections(1),
+        _queueMutex("Restore::_queued"), _nextQueued(0) {
         // Default values set here will show up in help text, but will supercede any default value
         // used when calling getParam below.
         add_options()
@@ -71,6 +89,7 @@ public:
         ("noIndexRestore" , "don't restore indexes")
         ("w" , po::value<int>()->default_value(0) , "minimum number of replicas per write. WARNING, setting w > 1 prevents the bulk load optimization." )
         ("noLoader", "don't use bulk loader")
+        ("numParallelCollections,j", po::value<int>()->default_value(1), "number of collections to restore in parallel, each on its own connection")
         ("defaultCompression", po::value(&_defaultCompression)->default_value(""), "default compression method to use for collections and indexes (unless otherwise specified in metadata.json)")
         ("defaultPageSize", po::value(&_defaultPageSize)->default_value(0), "default pageSize value to use for collections and indexes (unless otherwise specified in metadata.json)")
         ("defaultReadPageSize", po::value(&_defaultReadPageSize)->default_value(0), "default readPageSize value to use for collections and indexes (unless otherwise specified in metadata.json)")
@@ -113,6 +132,11 @@ public:
         if (hasParam( "noLoader" )) {
             _doBulkLoad = false;
         }
+        _numParallelCollections = getParam( "numParallelCollections" , 1 );
+        if (_numParallelCollections > 1 && hasParam( "dbpath" )) {
+            log() << "warning: --numParallelCollections is ignored with --dbpath" << endl;
+            _numParallelCollections = 1;
+        }
         if (hasParam( "keepIndexVersion" )) {
             log() << "warning: --keepIndexVersion is deprecated in TokuMX" << endl;
         }
@@ -133,6 +157,9 @@ public:
          * .bson file, or a single .bson file itself (a collection).
          */
         drillDown(root, _db != "", _coll != "", true);
+        if (!restoreQueued()) {
+            return -1;
+        }
         string err = conn().getLastError(_db == "" ? "admin" : _db);
         if (!err.empty()) {
             error() << err;
@@ -227,14 +254,86 @@ public:
 
         log() << "\tgoing into namespace [" << ns << "]" << endl;
 
+        // System collections (users in particular) are restored in order, on the main
+        // connection, the way they always have been.
+        if (_numParallelCollections > 1 && !isSystemNs(ns)) {
+            CollectionFile cf;
+            cf.file = root;
+            cf.ns = ns;
+            cf.size = boost::filesystem::file_size(root);
+            _queued.push_back(cf);
+            return;
+        }
+        restoreCollection(conn(), root, ns);
+    }
+
+    static bool isSystemNs(const string &ns) {
+        return startsWith(nsToCollectionSubstring(ns).toString(), "system.");
+    }
+
+    /**
+     * Restores the collections drillDown queued up, _numParallelCollections at a time.
+     * @return false if any of them failed, after letting the others that had started finish.
+     */
+    bool restoreQueued() {
+        if (_queued.empty()) {
+            return true;
+        }
+        std::sort(_queued.begin(), _queued.end());
+        const int nThreads = std::min((size_t) _numParallelCollections, _queued.size());
+        log() << "restoring " << _queued.size() << " collections with " << nThreads << " threads" << endl;
+
+        boost::thread_group threads;
+        for (int i = 0; i < nThreads; i++) {
+            threads.create_thread(boost::bind(&Restore::restoreThread, this));
+        }
+        threads.join_all();
+
+        if (!_failure.empty()) {
+            error() << "restore failed: " << _failure << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void restoreThread() {
+        try {
+            scoped_ptr<DBClientBase> c(openConnection());
+            while (true) {
+                CollectionFile cf;
+                {
+                    scoped_lock lk(_queueMutex);
+                    if (!_failure.empty() || _nextQueued == _queued.size()) {
+                        return;
+                    }
+                    cf = _queued[_nextQueued++];
+                }
+                restoreCollection(*c, cf.file, cf.ns);
+            }
+        }
+        catch (std::exception &e) {
+            scoped_lock lk(_queueMutex);
+            error() << "error restoring: " << e.what() << endl;
+            if (_failure.empty()) {
+                _failure = e.what();
+            }
+        }
+    }
+
+    /** Restores the dump in root into ns, using c for everything. */
+    void restoreCollection(DBClientBase &c, const boost::filesystem::path &root, const string &ns) {
+        string oldCollName = root.leaf().string(); // Name of the collection that was dumped from
+        oldCollName = oldCollName.substr( 0 , oldCollName.find_last_of( "." ) );
+        const NamespaceString nss(ns);
+
         if ( _drop ) {
             if (root.leaf() != "system.users.bson" ) {
-                log() << "\t dropping" << endl;
-                conn().dropCollection( ns );
+                log() << "\t dropping " << ns << endl;
+                c.dropCollection( ns );
             } else {
                 // Create map of the users currently in the DB
                 BSONObj fields = BSON("user" << 1);
-                scoped_ptr<DBClientCursor> cursor(conn().query(ns, Query(), 0, 0, &fields));
+                scoped_ptr<DBClientCursor> cursor(c.query(ns, Query(), 0, 0, &fields));
                 while (cursor->more()) {
                     BSONObj user = cursor->next();
                     _users.insert(user["user"].String());
@@ -256,15 +355,10 @@ public:
             }
         }
 
-        _curns = ns.c_str();
-        NamespaceString nss(_curns);
-        _curdb = nss.db;
-        _curcoll = nss.coll;
-
         // If drop is not used, warn if the collection exists.
         if (!_drop) {
-            scoped_ptr<DBClientCursor> cursor(conn().query(_curdb + ".system.namespaces",
-                                                            Query(BSON("name" << ns))));
+            scoped_ptr<DBClientCursor> cursor(c.query(nss.db + ".system.namespaces",
+                                                       Query(BSON("name" << ns))));
             if (cursor->more()) {
                 // collection already exists show warning
                 warning() << "Restoring to " << ns << " without dropping. Restored data "
@@ -278,10 +372,10 @@ public:
             const vector<BSONElement> indexElements = metadataObject["indexes"].Array();
             for (vector<BSONElement>::const_iterator it = indexElements.begin(); it != indexElements.end(); ++it) {
                 // Need to make sure the ns field gets updated to
-                // the proper _curdb + _curns value, if we're
+                // the proper nss value, if we're
                 // restoring to a different database.
                 // Also need to update the options with any defaults specified on the command line
-                indexes.push_back(updateOptions(renameIndexNs(it->Obj())));
+                indexes.push_back(updateOptions(renameIndexNs(nss, it->Obj())));
             }
         }
         const BSONObj options = updateOptions(_restoreOptions && metadataObject.hasField("options")
@@ -289,22 +383,22 @@ public:
                                               : BSONObj());
 
         if (_doBulkLoad && !options["partitioned"].trueValue()) {
-            RemoteLoader loader(conn(), _curdb, _curcoll, indexes, options);
-            processFile( root );
+            RemoteLoader loader(c, nss.db, nss.coll, indexes, options);
+            insertFile(c, root, nss);
             BSONObj res;
             bool ok = loader.commit(&res);
             if (!ok) {
-                error() << "Error committing load for " << _curdb << "." << _curcoll << ": " << res << endl;
+                error() << "Error committing load for " << ns << ": " << res << endl;
             }
         } else {
             // No bulk load. Create collection and indexes manually.
             if (!options.isEmpty()) {
-                createCollectionWithOptions(options, metadataObject);
+                createCollectionWithOptions(c, nss, options, metadataObject);
             }
             // Build indexes last - it's a little faster.
-            processFile( root );
+            insertFile(c, root, nss);
             for (vector<BSONObj>::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                createIndex(*it);
+                createIndex(c, nss, *it);
             }
         }
 
@@ -312,12 +406,72 @@ public:
             // Delete any users that used to exist but weren't in the dump file
             for (set<string>::iterator it = _users.begin(); it != _users.end(); ++it) {
                 BSONObj userMatch = BSON("user" << *it);
-                conn().remove(ns, Query(userMatch));
+                c.remove(ns, Query(userMatch));
             }
             _users.clear();
         }
     }
 
+    /**
+     * Inserts the documents in root into nss.  System collections go through gotObject one
+     * document at a time.  Everything else is read and validated on another thread while this
+     * one sends what was read so far in batches, so the tool keeps the server busy instead of
+     * alternating between reading and waiting for it.
+     */
+    void insertFile(DBClientBase &c, const boost::filesystem::path &root, const NamespaceString &nss) {
+        if (isSystemNs(nss.ns())) {
+            _curns = nss.ns();
+            _curdb = nss.db;
+            processFile( root );
+            return;
+        }
+
+        // A few batches in flight are enough to keep both sides busy.
+        BatchQueue<BSONObj> queue(4, 1);
+        boost::thread reader(boost::bind(&Restore::readFile, this, root, boost::ref(queue)));
+        try {
+            vector<BSONObj> batch;
+            while (queue.pop(batch)) {
+                // Like one insert per document, a bad document doesn't stop the rest.
+                c.insert(nss.ns(), batch, InsertOption_ContinueOnError);
+
+                // wait for inserts to propagate to "w" nodes (doesn't warn if w used without replset)
+                if ( _w > 0 ) {
+                    string err = c.getLastError(nss.db, false, false, _w);
+                    if (!err.empty()) {
+                        error() << err << endl;
+                    }
+                }
+            }
+        }
+        catch (std::exception &e) {
+            queue.abort(e.what());
+            reader.join();
+            throw;
+        }
+        reader.join();
+
+        if (&c != &conn()) {
+            // doRun only checks the main connection.
+            string err = c.getLastError(nss.db);
+            if (!err.empty()) {
+                error() << err << endl;
+            }
+        }
+    }
+
+    void readFile(const boost::filesystem::path &root, BatchQueue<BSONObj> &queue) {
+        try {
+            DocumentBatcher batcher(queue);
+            processFile(root, boost::bind(&DocumentBatcher::add, &batcher, _1));
+            batcher.flush();
+        }
+        catch (std::exception &e) {
+            queue.abort(e.what());
+        }
+        queue.producerDone();
+    }
+
     virtual void gotObject( const BSONObj& obj ) {
         StringData collstr = nsToCollectionSubstring(_curns);
         massert( 16910, "Shouldn't be inserting into system.indexes directly",
@@ -406,14 +560,14 @@ private:
         return nfields == obj2.nFields();
     }
 
-    void createCollectionWithOptions(BSONObj obj, BSONObj metadataObject) {
+    void createCollectionWithOptions(DBClientBase &c, const NamespaceString &nss, BSONObj obj, BSONObj metadataObject) {
         BSONObjIterator i(obj);
 
         // Rebuild obj as a command object for the "create" command.
         // - {create: <name>} comes first, where <name> is the new name for the collection
         // - elements with type Undefined get skipped over
         BSONObjBuilder bo;
-        bo.append("create", _curcoll);
+        bo.append("create", nss.coll);
         while (i.more()) {
             BSONElement e = i.next();
 
@@ -422,7 +576,7 @@ private:
             }
 
             if (e.type() == Undefined) {
-                log() << _curns << ": skipping undefined field: " << e.fieldName() << endl;
+                log() << nss.ns() << ": skipping undefined field: " << e.fieldName() << endl;
                 continue;
             }
 
@@ -431,17 +585,17 @@ private:
         obj = bo.obj();
 
         BSONObj fields = BSON("options" << 1);
-        scoped_ptr<DBClientCursor> cursor(conn().query(_curdb + ".system.namespaces", Query(BSON("name" << _curns)), 0, 0, &fields));
+        scoped_ptr<DBClientCursor> cursor(c.query(nss.db + ".system.namespaces", Query(BSON("name" << nss.ns())), 0, 0, &fields));
 
         bool createColl = true;
         if (cursor->more()) {
             createColl = false;
             if (metadataObject["partitioned"].trueValue()) {
-                log() << "Collection " << _curns << " already exists, so we will not be creating the automatic partitions" << endl;
+                log() << "Collection " << nss.ns() << " already exists, so we will not be creating the automatic partitions" << endl;
             }
             BSONObj nsObj = cursor->next();
             if (!nsObj.hasField("options") || !optionsSame(obj, nsObj["options"].Obj())) {
-                    log() << "WARNING: collection " << _curns << " exists with different options than are in the metadata.json file and not using --drop. Options in the metadata file will be ignored." << endl;
+                    log() << "WARNING: collection " << nss.ns() << " exists with different options than are in the metadata.json file and not using --drop. Options in the metadata file will be ignored." << endl;
             }
         }
 
@@ -450,10 +604,10 @@ private:
         }
 
         BSONObj info;
-        if (!conn().runCommand(_curdb, obj, info)) {
-            uasserted(15936, "Creating collection " + _curns + " failed. Errmsg: " + info["errmsg"].String());
+        if (!c.runCommand(nss.db, obj, info)) {
+            uasserted(15936, "Creating collection " + nss.ns() + " failed. Errmsg: " + info["errmsg"].String());
         } else {
-            log() << "\tCreated collection " << _curns << " with options: " << obj.jsonString() << endl;
+            log() << "\tCreated collection " << nss.ns() << " with options: " << obj.jsonString() << endl;
             if (metadataObject["partitionInfo"].trueValue()) {
                 BSONObj res;
                 BSONObjBuilder b;
@@ -462,20 +616,19 @@ private:
                 b.appendAs(pInfo["partitions"], "info");
                 BSONObj o = b.obj();
                 log() << "the obj, " << o << endl;
-                bool ok = conn().runCommand(_curdb, o, info);
+                bool ok = c.runCommand(nss.db, o, info);
                 log() << "ok: " << ok << "info: " << info << endl;
             }
         }
     }
 
-    BSONObj renameIndexNs(const BSONObj &orig) {
+    BSONObj renameIndexNs(const NamespaceString &nss, const BSONObj &orig) {
         BSONObjBuilder bo;
         BSONObjIterator i(orig);
         while ( i.more() ) {
             BSONElement e = i.next();
             if (strcmp(e.fieldName(), "ns") == 0) {
-                string s = _curdb + "." + _curcoll;
-                bo.append("ns", s);
+                bo.append("ns", nss.ns());
             }
             else if (strcmp(e.fieldName(), "v") != 0) { // Remove index version number
                 bo.append(e);
@@ -486,12 +639,12 @@ private:
 
     /* We must handle if the dbname or collection name is different at restore time than what was dumped.
      */
-    void createIndex(BSONObj indexObj) {
+    void createIndex(DBClientBase &c, const NamespaceString &nss, BSONObj indexObj) {
         LOG(0) << "\tCreating index: " << indexObj << endl;
-        conn().insert( _curdb + ".system.indexes" ,  indexObj );
+        c.insert( nss.db + ".system.indexes" ,  indexObj );
 
         // We're stricter about errors for indexes than for regular data
-        BSONObj err = conn().getLastErrorDetailed(_curdb, false, false, _w);
+        BSONObj err = c.getLastErrorDetailed(nss.db, false, false, _w);
 
         if (err.hasField("err") && !err["err"].isNull()) {
             if (err["err"].str() == "norepl" && _w > 1) {
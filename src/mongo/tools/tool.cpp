@@ -19,6 +19,7 @@
 
 #include "mongo/tools/tool.h"
 
+#include <boost/bind.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <fstream>
 #include <iostream>
@@ -33,6 +34,7 @@
 #include "mongo/db/storage/env.h"
 #include "mongo/platform/posix_fadvise.h"
 #include "mongo/util/password.h"
+#include "mongo/util/scopeguard.h"
 #include "mongo/util/version.h"
 
 using namespace std;
@@ -326,6 +328,20 @@ namespace mongo {
         return *_conn;
     }
 
+    DBClientBase* Tool::openConnection() {
+        uassert( 17405 , "can't open more connections with --dbpath" , ! hasParam( "dbpath" ) );
+
+        string errmsg;
+        ConnectionString cs = ConnectionString::parse( _host , errmsg );
+        uassert( 17406 , str::stream() << "invalid hostname [" << _host << "] " << errmsg , cs.isValid() );
+        auto_ptr<DBClientBase> c( cs.connect( errmsg ) );
+        uassert( 17407 , str::stream() << "couldn't connect to [" << _host << "] " << errmsg , c.get() );
+
+        if ( ! _username.empty() )
+            authenticate( *c );
+        return c.release();
+    }
+
     bool Tool::isMaster() {
         if ( hasParam("dbpath") ) {
             return true;
@@ -432,10 +448,14 @@ namespace mongo {
             return;
         }
 
-        _conn->auth( BSON( saslCommandPrincipalSourceFieldName << getAuthenticationDatabase() <<
-                           saslCommandPrincipalFieldName << _username <<
-                           saslCommandPasswordFieldName << _password  <<
-                           saslCommandMechanismFieldName << _authenticationMechanism ) );
+        authenticate( *_conn );
+    }
+
+    void Tool::authenticate( DBClientBase &c ) {
+        c.auth( BSON( saslCommandPrincipalSourceFieldName << getAuthenticationDatabase() <<
+                      saslCommandPrincipalFieldName << _username <<
+                      saslCommandPasswordFieldName << _password  <<
+                      saslCommandMechanismFieldName << _authenticationMechanism ) );
     }
 
     BSONTool::BSONTool( const char * name, DBAccess access , bool objcheck )
@@ -455,28 +475,42 @@ namespace mongo {
         else if ( hasParam( "noobjcheck" ) )
             _objcheck = false;
 
-        if ( hasParam( "filter" ) )
-            _matcher.reset( new Matcher( fromjson( getParam( "filter" ) ) ) );
+        if ( hasParam( "filter" ) ) {
+            _filter = fromjson( getParam( "filter" ) );
+            // Parse it once up front so a bad filter fails before any work is done.
+            Matcher m( _filter );
+        }
 
         return doRun();
     }
 
     long long BSONTool::processFile( const boost::filesystem::path& root ) {
         _fileName = root.string();
+        return processFile( root , boost::bind( &BSONTool::gotObject , this , _1 ) );
+    }
+
+    long long BSONTool::processFile( const boost::filesystem::path& root ,
+                                     const boost::function<void (const BSONObj &)> &gotObj ) {
+        const string fileName = root.string();
 
         unsigned long long fileLength = file_size( root );
 
         if ( fileLength == 0 ) {
-            out() << "file " << _fileName << " empty, skipping" << endl;
+            out() << "file " << fileName << " empty, skipping" << endl;
             return 0;
         }
 
 
-        FILE* file = fopen( _fileName.c_str() , "rb" );
+        FILE* file = fopen( fileName.c_str() , "rb" );
         if ( ! file ) {
-            log() << "error opening file: " << _fileName << " " << errnoWithDescription() << endl;
+            log() << "error opening file: " << fileName << " " << errnoWithDescription() << endl;
             return 0;
         }
+        // gotObj may throw, when a pipeline downstream of it fails.
+        ON_BLOCK_EXIT(fclose, file);
+
+        // Each call gets its own Matcher, so files can be processed on several threads.
+        scoped_ptr<Matcher> matcher( _filter.isEmpty() ? NULL : new Matcher( _filter ) );
 
 #ifdef POSIX_FADV_SEQUENTIAL
         posix_fadvise(fileno(file), 0, fileLength, POSIX_FADV_SEQUENTIAL);
@@ -523,8 +557,8 @@ namespace mongo {
                 }
             }
 
-            if ( _matcher.get() == 0 || _matcher->matches( o ) ) {
-                gotObject( o );
+            if ( ! matcher || matcher->matches( o ) ) {
+                gotObj( o );
                 processed++;
             }
 
@@ -534,11 +568,9 @@ namespace mongo {
             m.hit( o.objsize() );
         }
 
-        fclose( file );
-
         uassert( 10265 ,  "counts don't match" , m.done() == fileLength );
         (_usesstdout ? cout : cerr ) << m.hits() << " objects found" << endl;
-        if ( _matcher.get() )
+        if ( matcher )
             (_usesstdout ? cout : cerr ) << processed << " objects processed" << endl;
         return processed;
     }
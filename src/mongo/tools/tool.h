@@ -20,6 +20,7 @@
 
 #include <string>
 
+#include <boost/function.hpp>
 #include <boost/program_options.hpp>
 
 #if defined(_WIN32)
@@ -106,6 +107,13 @@ namespace mongo {
 
         mongo::DBClientBase &conn( bool slaveIfPaired = false );
 
+        /**
+         * Opens another connection to the server conn() is connected to, authenticated the same
+         * way, for tools that talk to the server from several threads.  The caller owns it.
+         * Not available with --dbpath.
+         */
+        mongo::DBClientBase *openConnection();
+
         string _name;
 
         string _db;
@@ -144,11 +152,12 @@ namespace mongo {
 
     private:
         void auth();
+        void authenticate( DBClientBase &c );
     };
 
     class BSONTool : public Tool {
         bool _objcheck;
-        auto_ptr<Matcher> _matcher;
+        BSONObj _filter;
 
     public:
         BSONTool( const char * name , DBAccess access=ALL, bool objcheck = true );
@@ -160,6 +169,14 @@ namespace mongo {
 
         long long processFile( const boost::filesystem::path& file );
 
+        /**
+         * Like processFile, but hands each object that passes --filter to gotObj instead of
+         * gotObject.  The object is only valid during the call.  Several threads may process
+         * different files at once.
+         */
+        long long processFile( const boost::filesystem::path& file,
+                               const boost::function<void (const BSONObj &)> &gotObj );
+
     };
 
 }
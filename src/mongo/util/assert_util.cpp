@@ -105,6 +105,7 @@ namespace mongo {
 #if defined(_DEBUG) || defined(_DURABLEDEFAULTON) || defined(_DURABLEDEFAULTOFF)
         // this is so we notice in buildbot
         log() << "\n\n***aborting after wassert() failure in a debug/test build\n\n" << endl;
+        flushAsyncLog();
         ::abort();
 #endif
     }
@@ -121,6 +122,7 @@ namespace mongo {
 #if defined(_DEBUG) || defined(_DURABLEDEFAULTON) || defined(_DURABLEDEFAULTOFF)
         // this is so we notice in buildbot
         log() << "\n\n***aborting after verify() failure as this is a debug/test build\n\n" << endl;
+        flushAsyncLog();
         ::abort();
 #endif
         throw e;
@@ -131,6 +133,7 @@ namespace mongo {
         logContext();
         breakpoint();
         log() << "\n\n***aborting after fassert() failure\n\n" << endl;
+        flushAsyncLog();
         ::abort();
     }
 
@@ -16,50 +16,67 @@
 
 #include <boost/thread/condition_variable.hpp>
 
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
-    class TicketHolder {
+    /**
+     * Hands out up to outof() tickets.
+     *
+     * Taking and returning a ticket is a single atomic operation on the number of available
+     * tickets.  The mutex and condition variable are only touched by threads that have to wait
+     * for a ticket, and by release() when someone is waiting.
+     */
+    class TicketHolder : boost::noncopyable {
     public:
-        TicketHolder( int num ) : _mutex("TicketHolder") {
-            _outof = num;
-            _num = num;
-        }
+        TicketHolder( int num ) : _outof( num ), _num( num ), _waiters( 0 ), _mutex("TicketHolder") {}
 
         bool tryAcquire() {
-            scoped_lock lk( _mutex );
-            return _tryAcquire();
+            int n = _num.load();
+            while ( n > 0 ) {
+                const int prev = _num.compareAndSwap( n , n - 1 );
+                if ( prev == n ) {
+                    return true;
+                }
+                n = prev;
+            }
+            return false;
         }
 
         void waitForTicket() {
-            scoped_lock lk( _mutex );
+            if ( tryAcquire() ) {
+                return;
+            }
 
-            while( ! _tryAcquire() ) {
+            scoped_lock lk( _mutex );
+            // Registered before the last tryAcquire: a release() either leaves a ticket we see,
+            // or sees us and notifies us under the mutex, once we are waiting.
+            _waiters.fetchAndAdd( 1 );
+            while( ! tryAcquire() ) {
                 _newTicket.wait( lk.boost() );
             }
+            _waiters.fetchAndSubtract( 1 );
         }
 
         void release() {
-            {
+            _num.fetchAndAdd( 1 );
+            if ( _waiters.load() > 0 ) {
                 scoped_lock lk( _mutex );
-                _num++;
+                _newTicket.notify_one();
             }
-            _newTicket.notify_one();
         }
 
+        /**
+         * Changes the number of tickets.  If more than newSize are in use, no more are handed out
+         * until enough of them are released.
+         */
         void resize( int newSize ) {
             {
                 scoped_lock lk( _mutex );
-
-                int used = _outof - _num;
-                if ( used > newSize ) {
-                    cout << "ERROR: can't resize since we're using (" << used << ") more than newSize(" << newSize << ")" << endl;
-                    return;
-                }
-
-                _outof = newSize;
-                _num = _outof - used;
+                const int delta = newSize - _outof.load();
+                _outof.store( newSize );
+                _num.fetchAndAdd( delta );
             }
 
             // Potentially wasteful, but easier to see is correct
@@ -67,30 +84,24 @@ namespace mongo {
         }
 
         int available() const {
-            return _num;
+            const int n = _num.load();
+            return n > 0 ? n : 0;
         }
 
         int used() const {
-            return _outof - _num;
+            return _outof.load() - _num.load();
         }
 
-        int outof() const { return _outof; }
-
-    private:
+        int outof() const { return _outof.load(); }
 
-        bool _tryAcquire(){
-            if ( _num <= 0 ) {
-                if ( _num < 0 ) {
-                    cerr << "DISASTER! in TicketHolder" << endl;
-                }
-                return false;
-            }
-            _num--;
-            return true;
-        }
+        /** @return how many threads are blocked in waitForTicket() */
+        int waiters() const { return _waiters.load(); }
 
-        int _outof;
-        int _num;
+    private:
+        AtomicInt32 _outof;
+        // may be negative after a resize below used()
+        AtomicInt32 _num;
+        AtomicInt32 _waiters;
         mongo::mutex _mutex;
         boost::condition_variable_any _newTicket;
     };
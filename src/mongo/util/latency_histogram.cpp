@@ -0,0 +1,159 @@
+// @file latency_histogram.cpp
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/latency_histogram.h"
+
+#include <cmath>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using namespace mongoutils;
+
+    LatencyHistogram::LatencyHistogram() : _count(0), _sum(0), _max(0) {
+        memset(_counts, 0, sizeof _counts);
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram &other) {
+        for (uint32_t i = 0; i < kNumBuckets; i++) {
+            _counts[i] += other._counts[i];
+        }
+        _count += other._count;
+        _sum += other._sum;
+        if (other._max > _max) {
+            _max = other._max;
+        }
+    }
+
+    uint32_t LatencyHistogram::bucketFor(uint64_t micros) {
+        if (micros < kSubBuckets) {
+            return micros;
+        }
+        if (micros >= (1ULL << kMaxBits)) {
+            return kNumBuckets - 1;
+        }
+        // exponent = floor(log2(micros)), at least kSubBucketBits here
+        int exponent = 0;
+        for (int shift = 32; shift > 0; shift >>= 1) {
+            if (micros >> (exponent + shift)) {
+                exponent += shift;
+            }
+        }
+        // the kSubBucketBits bits after the leading one pick the bucket within this power of two
+        const uint32_t sub = (micros >> (exponent - kSubBucketBits)) - kSubBuckets;
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+    }
+
+    uint64_t LatencyHistogram::bucketUpperBound(uint32_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        const int shift = bucket / kSubBuckets - 1;
+        const uint64_t lower = static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+        return lower + (1ULL << shift) - 1;
+    }
+
+    uint64_t LatencyHistogram::percentile(double p) const {
+        if (_count == 0) {
+            return 0;
+        }
+        // p is often not exactly representable (99.9), don't let that round the rank up by one
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100 * _count * (1 - 1e-12)));
+        if (rank < 1) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < kNumBuckets; i++) {
+            seen += _counts[i];
+            if (seen >= rank) {
+                return std::min(bucketUpperBound(i), _max);
+            }
+        }
+        return _max;
+    }
+
+    void LatencyHistogram::append(BSONObjBuilder &b, const std::vector<double> &percentiles) const {
+        b.appendNumber("count", static_cast<long long>(_count));
+        b.appendNumber("totalMicros", static_cast<long long>(_sum));
+        b.appendNumber("maxMicros", static_cast<long long>(_max));
+        BSONObjBuilder pb(b.subobjStart("percentiles"));
+        for (std::vector<double>::const_iterator it = percentiles.begin(); it != percentiles.end(); ++it) {
+            pb.appendNumber(string(str::stream() << "p" << *it), static_cast<long long>(percentile(*it)));
+        }
+        pb.done();
+    }
+
+    const std::vector<double> &LatencyHistogram::defaultPercentiles() {
+        static const double defaults[] = { 50, 95, 99, 99.9 };
+        static const std::vector<double> v(defaults, defaults + sizeof defaults / sizeof defaults[0]);
+        return v;
+    }
+
+    std::vector<double> LatencyHistogram::parsePercentiles(const BSONElement &e) {
+        if (e.eoo()) {
+            return defaultPercentiles();
+        }
+        uassert(17413, "percentiles must be an array of numbers", e.type() == Array);
+        std::vector<double> percentiles;
+        for (BSONObjIterator it(e.embeddedObject()); it.more(); ) {
+            BSONElement p = it.next();
+            uassert(17414, str::stream() << "percentiles must be numbers in (0, 100], not " << p,
+                    p.isNumber() && p.number() > 0 && p.number() <= 100);
+            percentiles.push_back(p.number());
+        }
+        return percentiles;
+    }
+
+    PartitionedLatencyHistogram::PartitionedLatencyHistogram() : _mutex("PartitionedLatencyHistogram") {}
+
+    PartitionedLatencyHistogram::~PartitionedLatencyHistogram() {
+        // Same as ~PartitionedCounter: detach the threads' states so that they don't touch us
+        // when their threads exit.
+        SimpleMutex::scoped_lock lk(_mutex);
+        for (std::list<ThreadState *>::iterator it = _threadStates.begin(); it != _threadStates.end(); ++it) {
+            (*it)->plh = NULL;
+        }
+    }
+
+    PartitionedLatencyHistogram::ThreadState::~ThreadState() {
+        if (plh != NULL) {
+            SimpleMutex::scoped_lock lk(plh->_mutex);
+            plh->_dead.merge(hist);
+            plh->_threadStates.remove(this);
+        }
+    }
+
+    PartitionedLatencyHistogram::ThreadState &PartitionedLatencyHistogram::newThreadState() {
+        _ts.reset(new ThreadState(this));
+        SimpleMutex::scoped_lock lk(_mutex);
+        _threadStates.push_back(_ts.get());
+        return *_ts;
+    }
+
+    void PartitionedLatencyHistogram::snapshot(LatencyHistogram &out) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        out.merge(_dead);
+        for (std::list<ThreadState *>::const_iterator it = _threadStates.begin(); it != _threadStates.end(); ++it) {
+            out.merge((*it)->hist);
+        }
+    }
+
+} // namespace mongo
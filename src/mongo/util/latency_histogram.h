@@ -0,0 +1,140 @@
+// @file latency_histogram.h
+
+/*    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <list>
+#include <vector>
+#include <boost/thread/tss.hpp>
+
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class BSONElement;
+    class BSONObjBuilder;
+
+    /**
+     * A log-linear histogram of latencies, in micros, from which percentiles can be read.
+     *
+     * Each power of two is split into kSubBuckets equal buckets, so a percentile is reported with
+     * at most 1/kSubBuckets relative error no matter how large it is, and values below
+     * kSubBuckets are exact.  Values up to 2^kMaxBits micros (about 19 hours) are bucketed, larger
+     * ones are counted in the last bucket.  The exact maximum is kept separately.
+     *
+     * Not thread safe; see PartitionedLatencyHistogram.
+     */
+    class LatencyHistogram {
+      public:
+        static const int kSubBucketBits = 3;
+        static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+        static const int kMaxBits = 36;
+        static const uint32_t kNumBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+        LatencyHistogram();
+
+        void record(uint64_t micros) {
+            _counts[bucketFor(micros)]++;
+            _count++;
+            _sum += micros;
+            if (micros > _max) {
+                _max = micros;
+            }
+        }
+
+        /** Adds all of other's values to this histogram. */
+        void merge(const LatencyHistogram &other);
+
+        uint64_t count() const { return _count; }
+        uint64_t sum() const { return _sum; }
+        uint64_t max() const { return _max; }
+
+        /**
+         * @return the smallest bucket upper bound that at least p percent of the values are at or
+         * below, or 0 if nothing was recorded.  Never more than max().
+         */
+        uint64_t percentile(double p) const;
+
+        /**
+         * Appends {count, totalMicros, maxMicros, percentiles: {p50: ..., p99.9: ...}} to b for
+         * each of percentiles, which are in (0, 100].
+         */
+        void append(BSONObjBuilder &b, const std::vector<double> &percentiles) const;
+
+        static uint32_t bucketFor(uint64_t micros);
+        /** @return the largest value that falls in bucket. */
+        static uint64_t bucketUpperBound(uint32_t bucket);
+
+        /** The percentiles reported when none are asked for: 50, 95, 99 and 99.9. */
+        static const std::vector<double> &defaultPercentiles();
+        /**
+         * Reads percentiles from an array of numbers, like a command's {percentiles: [50, 99]},
+         * or returns defaultPercentiles() if e is missing.  uasserts if a percentile is out of
+         * range.
+         */
+        static std::vector<double> parsePercentiles(const BSONElement &e);
+
+      private:
+        uint64_t _counts[kNumBuckets];
+        uint64_t _count;
+        uint64_t _sum;
+        uint64_t _max;
+    };
+
+    /**
+     * A LatencyHistogram that many threads record to at once.
+     *
+     * Like PartitionedCounter, each thread records into its own histogram and never touches
+     * memory shared with other threads, and reads, which are rare, merge all the threads'
+     * histograms.  A read may miss values being recorded concurrently, but never sees torn
+     * counts on the platforms we support.
+     */
+    class PartitionedLatencyHistogram : boost::noncopyable {
+      public:
+        PartitionedLatencyHistogram();
+        ~PartitionedLatencyHistogram();
+
+        void record(uint64_t micros) { ts().hist.record(micros); }
+
+        /** Merges everything recorded so far, by all threads, into out. */
+        void snapshot(LatencyHistogram &out) const;
+
+      private:
+        struct ThreadState : boost::noncopyable {
+            PartitionedLatencyHistogram *plh;
+            LatencyHistogram hist;
+            ThreadState(PartitionedLatencyHistogram *p) : plh(p) {}
+            ~ThreadState();
+        };
+        friend struct ThreadState;
+
+        ThreadState &ts() {
+            ThreadState *s = _ts.get();
+            return s != NULL ? *s : newThreadState();
+        }
+        ThreadState &newThreadState();
+
+        mutable SimpleMutex _mutex;
+        // values recorded by threads that have exited
+        LatencyHistogram _dead;
+        boost::thread_specific_ptr<ThreadState> _ts;
+        std::list<ThreadState *> _threadStates;
+    };
+
+} // namespace mongo
@@ -19,6 +19,11 @@
 
 #include "mongo/pch.h"
 
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/base/counter.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/platform/posix_fadvise.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/concurrency/threadlocal.h"
@@ -77,6 +82,8 @@ namespace mongo {
             return nullstream;
         if ( level > logLevel )
             return nullstream;
+        if ( level > 0 )
+            return Logstream::get().prolog().setVerbose();
         return Logstream::get().prolog();
     }
 
@@ -318,6 +325,267 @@ namespace mongo {
         }
     }
 
+    /**
+     * Bounded queue of formatted log lines that any number of threads push to without taking a
+     * lock (Vyukov's bounded MPMC array queue).  Each cell's sequence number says whose turn it
+     * is: pos when it's free for the producer of pos, pos + 1 once that line is in it.  Only one
+     * thread pops at a time, whoever holds the AsyncLog's consumer token.
+     */
+    class AsyncLogQueue : boost::noncopyable {
+    public:
+        struct Record {
+            LogLevel level;
+            Tee *tee;
+            string line;
+        };
+
+        explicit AsyncLogQueue(unsigned size) : _mask(size - 1), _cells(new Cell[size]) {
+            verify((size & _mask) == 0);
+            for (unsigned i = 0; i < size; i++) {
+                _cells[i].seq.store(i);
+            }
+        }
+
+        /** Moves r's line into the queue.  @return false if the queue is full. */
+        bool push(Record &r) {
+            uint64_t pos = _enqueuePos.loadRelaxed();
+            Cell *cell;
+            for (;;) {
+                cell = &_cells[pos & _mask];
+                const int64_t diff = static_cast<int64_t>(cell->seq.load() - pos);
+                if (diff == 0) {
+                    const uint64_t prev = _enqueuePos.compareAndSwap(pos, pos + 1);
+                    if (prev == pos) {
+                        break;
+                    }
+                    pos = prev;
+                }
+                else if (diff < 0) {
+                    // the consumer hasn't gotten to the line a lap ago
+                    return false;
+                }
+                else {
+                    pos = _enqueuePos.loadRelaxed();
+                }
+            }
+            cell->rec.level = r.level;
+            cell->rec.tee = r.tee;
+            cell->rec.line.swap(r.line);
+            cell->seq.store(pos + 1);
+            return true;
+        }
+
+        /** Only call with the consumer token.  @return false if the queue is empty. */
+        bool pop(Record &r) {
+            const uint64_t pos = _dequeuePos.loadRelaxed();
+            Cell *cell = &_cells[pos & _mask];
+            if (cell->seq.load() != pos + 1) {
+                return false;
+            }
+            r.level = cell->rec.level;
+            r.tee = cell->rec.tee;
+            r.line.swap(cell->rec.line);
+            // don't let a long line's buffer sit in the queue
+            string().swap(cell->rec.line);
+            _dequeuePos.store(pos + 1);
+            cell->seq.store(pos + _mask + 1);
+            return true;
+        }
+
+        /** A racy count of queued lines, good enough to decide what to drop. */
+        uint64_t approxSize() const {
+            const uint64_t dequeued = _dequeuePos.loadRelaxed();
+            return _enqueuePos.loadRelaxed() - dequeued;
+        }
+
+        uint64_t capacity() const { return _mask + 1; }
+
+    private:
+        struct Cell {
+            AtomicUInt64 seq;
+            Record rec;
+        };
+
+        const uint64_t _mask;
+        boost::scoped_array<Cell> _cells;
+        // apart so producers and the consumer don't share a cache line
+        CacheLinePadded<AtomicUInt64> _enqueuePos;
+        CacheLinePadded<AtomicUInt64> _dequeuePos;
+    };
+
+    /**
+     * The async logging backend: logging threads append to the queue, the writer thread drains
+     * it in batches, holding Logstream::mutex only while it writes and flushing the file once per
+     * batch.
+     */
+    class AsyncLog : boost::noncopyable {
+    public:
+        AsyncLog(unsigned size, AsyncLogOverflowPolicy policy)
+            : _queue(size), _policy(policy), _reportedDrops(0), _lastDropReport(0) {}
+
+        void append(LogLevel level, bool droppable, Tee *t, string &out) {
+            AsyncLogQueue::Record r;
+            r.level = level;
+            r.tee = t;
+            r.line.swap(out);
+            if (_policy == ASYNC_LOG_DROP_DEBUG && droppable &&
+                    _queue.approxSize() >= _queue.capacity() / 4 * 3) {
+                _dropped.increment();
+                return;
+            }
+            while (!_queue.push(r)) {
+                if ((_policy == ASYNC_LOG_DROP && level != LL_SEVERE) ||
+                    (_policy == ASYNC_LOG_DROP_DEBUG && droppable)) {
+                    _dropped.increment();
+                    return;
+                }
+                // help out rather than wait, which also keeps the writer from waiting on itself
+                if (!drain()) {
+                    sleepmicros(100);
+                }
+            }
+            wakeWriter();
+            if (level == LL_SEVERE) {
+                flush(false);
+            }
+        }
+
+        /**
+         * Waits for the queue to be written out.  When crashing, gives up after a second, and
+         * writes without Logstream::mutex if it can't get that within a second.
+         */
+        void flush(bool crashing) {
+            for (int waited = 0; !drain(crashing); waited++) {
+                if (waited >= 1000) {
+                    // the writer is stuck, or is us (crashing while writing)
+                    return;
+                }
+                sleepmillis(1);
+            }
+        }
+
+        void run() {
+            setThreadName("asyncLogWriter");
+            for (;;) {
+                if (_writerPaused.load()) {
+                    sleepmillis(10);
+                    continue;
+                }
+                drain();
+                reportDrops();
+                boost::mutex::scoped_lock lk(_wakeMutex);
+                _writerSleeping.store(1);
+                if (_queue.approxSize() == 0) {
+                    _wake.timed_wait(lk, boost::posix_time::milliseconds(100));
+                }
+                _writerSleeping.store(0);
+            }
+        }
+
+        long long dropped() const { return _dropped.get(); }
+
+        void setWriterPaused(bool paused) { _writerPaused.store(paused ? 1 : 0); }
+
+    private:
+        void wakeWriter() {
+            if (_writerSleeping.load() && _writerSleeping.compareAndSwap(1, 0) == 1) {
+                boost::mutex::scoped_lock lk(_wakeMutex);
+                _wake.notify_one();
+            }
+        }
+
+        /**
+         * Writes out everything in the queue.  @return false if another thread was already
+         * draining it.
+         */
+        bool drain(bool crashing = false) {
+            if (_consumer.compareAndSwap(0, 1) != 0) {
+                return false;
+            }
+            AsyncLogQueue::Record r;
+            if (_queue.pop(r)) {
+                if (crashing) {
+                    // don't hang a crashing thread on a mutex its own thread may hold
+                    mutex::try_lock lk(Logstream::mutex, 1000);
+                    write_inlock(r);
+                }
+                else {
+                    scoped_lock lk(Logstream::mutex);
+                    write_inlock(r);
+                }
+            }
+            _consumer.store(0);
+            return true;
+        }
+
+        /** Writes r and the rest of the queue.  Needs Logstream::mutex, unless crashing. */
+        void write_inlock(AsyncLogQueue::Record &r) {
+            do {
+                Logstream::_write(r.level, r.tee, r.line, false);
+            } while (_queue.pop(r));
+            fflush(Logstream::logfile);
+        }
+
+        void reportDrops() {
+            const long long dropped = _dropped.get();
+            if (dropped == _reportedDrops) {
+                return;
+            }
+            const time_t now = time(0);
+            if (now == _lastDropReport) {
+                return;
+            }
+            warning() << "async logging dropped " << dropped - _reportedDrops
+                      << " lines to keep up, " << dropped << " in total" << endl;
+            _reportedDrops = dropped;
+            _lastDropReport = now;
+        }
+
+        AsyncLogQueue _queue;
+        const AsyncLogOverflowPolicy _policy;
+        // 1 while a thread is draining the queue
+        AtomicUInt32 _consumer;
+        Counter64 _dropped;
+        // writer thread only
+        long long _reportedDrops;
+        time_t _lastDropReport;
+
+        AtomicUInt32 _writerSleeping;
+        // set by tests, see pauseAsyncLogWriter
+        AtomicUInt32 _writerPaused;
+        boost::mutex _wakeMutex;
+        boost::condition _wake;
+    };
+
+    // set once at startup, never freed
+    static AsyncLog *asyncLog = NULL;
+
+    void startAsyncLogging(unsigned queueSize, AsyncLogOverflowPolicy policy) {
+        verify(asyncLog == NULL);
+        unsigned size = 2;
+        while (size < queueSize) {
+            size <<= 1;
+        }
+        asyncLog = new AsyncLog(size, policy);
+        boost::thread writer(boost::bind(&AsyncLog::run, asyncLog));
+    }
+
+    void flushAsyncLog() {
+        if (asyncLog) {
+            asyncLog->flush(true);
+        }
+    }
+
+    long long asyncLogDropped() {
+        return asyncLog ? asyncLog->dropped() : 0;
+    }
+
+    void pauseAsyncLogWriter(bool paused) {
+        if (asyncLog) {
+            asyncLog->setWriterPaused(paused);
+        }
+    }
+
     void Logstream::flush(Tee *t) {
         const size_t MAX_LOG_LINE = 1024 * 10;
 
@@ -373,37 +641,46 @@ namespace mongo {
 
             string out( b.buf() , b.len() - 1);
 
-            scoped_lock lk(mutex);
-
-            if( t ) t->write(logLevel,out);
-            if ( globalTees ) {
-                for ( unsigned i=0; i<globalTees->size(); i++ )
-                    (*globalTees)[i]->write(logLevel,out);
+            if ( asyncLog ) {
+                asyncLog->append( logLevel, verbose || logLevel == LL_DEBUG, t, out );
             }
-#if defined(_WIN32)
-            int fd = fileno( logfile );
-            if ( _isatty( fd ) ) {
-                fflush( logfile );
-                writeUtf8ToWindowsConsole( out.data(), out.size() );
+            else {
+                scoped_lock lk(mutex);
+                _write( logLevel, t, out, true );
             }
+        }
+        _init();
+    }
+
+    void Logstream::_write(LogLevel level, Tee *t, const string& out, bool flushFile) {
+        if( t ) t->write(level,out);
+        if ( globalTees ) {
+            for ( unsigned i=0; i<globalTees->size(); i++ )
+                (*globalTees)[i]->write(level,out);
+        }
+#if defined(_WIN32)
+        int fd = fileno( logfile );
+        if ( _isatty( fd ) ) {
+            fflush( logfile );
+            writeUtf8ToWindowsConsole( out.data(), out.size() );
+        }
 #else
-            if ( isSyslog ) {
-                syslog( logLevelToSysLogLevel(logLevel) , "%s" , out.data() );
-            }
+        if ( isSyslog ) {
+            syslog( logLevelToSysLogLevel(level) , "%s" , out.data() );
+        }
 #endif
-            else if ( fwrite( out.data(), out.size(), 1, logfile ) ) {
+        else if ( fwrite( out.data(), out.size(), 1, logfile ) ) {
+            if ( flushFile )
                 fflush(logfile);
-            }
-            else {
-                int x = errno;
-                cout << "Failed to write to logfile: " << errnoWithDescription(x) << ": " << out << endl;
-            }
+        }
+        else {
+            int x = errno;
+            cout << "Failed to write to logfile: " << errnoWithDescription(x) << ": " << out << endl;
+        }
 #ifdef POSIX_FADV_DONTNEED
-            // This only applies to pages that have already been flushed
-            RARELY posix_fadvise(fileno(logfile), 0, 0, POSIX_FADV_DONTNEED);
+        // This only applies to pages that have already been flushed
+        RARELY posix_fadvise(fileno(logfile), 0, 0, POSIX_FADV_DONTNEED);
 #endif
-        }
-        _init();
     }
     
     void Logstream::removeGlobalTee( Tee * tee ) {
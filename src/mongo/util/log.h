@@ -240,12 +240,16 @@ namespace mongo {
     };
     extern Nullstream nullstream;
 
+    class AsyncLog;
+
     class Logstream : public Nullstream {
+        friend class AsyncLog;
         static mongo::mutex mutex;
         static int doneSetup;
         std::stringstream ss;
         int indent;
         LogLevel logLevel;
+        bool verbose; // from LOG(n) with n > 0, the first lines to drop when async logging is behind
         static FILE* logfile;
         static boost::scoped_ptr<std::ostream> stream;
         static std::vector<Tee*> * globalTees;
@@ -293,6 +297,11 @@ namespace mongo {
             return *this;
         }
 
+        inline Nullstream& setVerbose() {
+            verbose = true;
+            return *this;
+        }
+
         /** note these are virtual */
         Logstream& operator<<(const char *x) { ss << x; return *this; }
         Logstream& operator<<(const string& x) { ss << x; return *this; }
@@ -360,8 +369,12 @@ namespace mongo {
         void _init() {
             ss.str("");
             logLevel = LL_INFO;
+            verbose = false;
         }
 
+        /** Writes one formatted line to t, the global tees and the log file or syslog.  Caller locks. */
+        static void _write(LogLevel level, Tee *t, const string& out, bool flushFile);
+
     public:
         static Logstream& get();
     };
@@ -423,6 +436,8 @@ namespace mongo {
     inline Nullstream& logWithLevel( int level ) {
         if ( level > logLevel )
             return nullstream;
+        if ( level > 0 )
+            return Logstream::get().prolog().setVerbose();
         return Logstream::get().prolog();
     }
 
@@ -467,6 +482,42 @@ namespace mongo {
     bool initLogging( const string& logpath , bool append );
     bool rotateLogs();
 
+    /** What a thread does with a line when the async log queue has no room for it. */
+    enum AsyncLogOverflowPolicy {
+        // wait for the writer thread to make room
+        ASYNC_LOG_BLOCK,
+        // drop LL_DEBUG and verbose (LOG(n), n > 0) lines once the queue is 3/4 full, wait with
+        // anything else
+        ASYNC_LOG_DROP_DEBUG,
+        // drop anything but LL_SEVERE lines
+        ASYNC_LOG_DROP
+    };
+
+    /**
+     * From now on, logging threads only format their lines and put them in a bounded lock free
+     * queue of queueSize (rounded up to a power of two) lines, and a dedicated thread writes them
+     * to the tees, the log file or syslog.  LL_SEVERE lines are flushed before the logging thread
+     * goes on.  Call once, after forking and setting up signal handling.
+     */
+    void startAsyncLogging(unsigned queueSize, AsyncLogOverflowPolicy policy);
+
+    /**
+     * Writes out whatever is queued for async logging, for crash and exit paths.  Gives up after
+     * about a second if the writer thread is stuck (or is the caller), and writes without the log
+     * mutex if it can't get it within a second.  No-op if async logging was never started.
+     */
+    void flushAsyncLog();
+
+    /** Number of lines dropped by async logging because of its overflow policy. */
+    long long asyncLogDropped();
+
+    /**
+     * For tests: while paused, the async log writer thread leaves the queue alone, so it fills
+     * up and the overflow policy kicks in.  Logging threads still write the queue out
+     * themselves when they can't drop a line.
+     */
+    void pauseAsyncLogWriter(bool paused);
+
     std::string toUtf8String(const std::wstring& wide);
 
     /** output the error # and error message with prefix.
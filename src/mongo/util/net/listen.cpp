@@ -21,6 +21,7 @@
 #include "listen.h"
 #include "message_port.h"
 #include "mongo/base/owned_pointer_vector.h"
+#include "mongo/util/scopeguard.h"
 
 #ifndef _WIN32
 
@@ -41,6 +42,9 @@
 #ifdef __openbsd__
 # include <sys/uio.h>
 #endif
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
 
 #else
 
@@ -201,6 +205,71 @@ namespace mongo {
             return;
         }
 
+#if defined(__linux__)
+        _epollListen();
+#else
+        _selectListen();
+#endif
+    }
+
+#if defined(__linux__)
+    void Listener::_epollListen() {
+        // epoll has no limit on descriptor numbers, unlike select()
+        const int epfd = epoll_create(_socks.size());
+        if (epfd < 0) {
+            error() << "epoll_create() failure: " << errnoWithDescription() << warnings;
+            return;
+        }
+        ON_BLOCK_EXIT(::close, epfd);
+        for (vector<SOCKET>::iterator it=_socks.begin(), end=_socks.end(); it != end; ++it) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = *it;
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, *it, &ev) != 0) {
+                error() << "epoll_ctl() failure: " << errnoWithDescription() << warnings;
+                return;
+            }
+        }
+        scoped_array<struct epoll_event> events(new struct epoll_event[_socks.size()]);
+
+#ifdef MONGO_SSL
+        _logListen(_port, _ssl);
+#else
+        _logListen(_port, false);
+#endif
+
+        while ( ! inShutdown() ) {
+            const unsigned long long waitStart = curTimeMillis64();
+            const int ret = epoll_wait(epfd, events.get(), _socks.size(), 10);
+
+            if (ret == 0) {
+                _elapsedTime += max(10LL, (long long)(curTimeMillis64() - waitStart));
+                continue;
+            }
+
+            if (ret < 0) {
+                int x = errno;
+                if ( x == EINTR ) {
+                    log() << "epoll_wait() signal caught, continuing" << endl;
+                    continue;
+                }
+                if ( ! inShutdown() )
+                    log() << "epoll_wait() failure: ret=" << ret << " " << errnoWithDescription(x) << endl;
+                return;
+            }
+
+            _elapsedTime += max((long long)ret, (long long)(curTimeMillis64() - waitStart));
+
+            for (int i = 0; i < ret; i++) {
+                if (!_accept(events[i].data.fd)) {
+                    return;
+                }
+            }
+        }
+    }
+
+#else
+    void Listener::_selectListen() {
         SOCKET maxfd = 0; // needed for select()
         for (unsigned i = 0; i < _socks.size(); i++) {
             if (_socks[i] > maxfd)
@@ -233,11 +302,7 @@ namespace mongo {
             const int ret = select(maxfd+1, fds, NULL, NULL, &maxSelectTime);
 
             if (ret == 0) {
-#if defined(__linux__)
-                _elapsedTime += ( 10000 - maxSelectTime.tv_usec ) / 1000;
-#else
                 _elapsedTime += 10;
-#endif
                 continue;
             }
 
@@ -254,66 +319,70 @@ namespace mongo {
                 return;
             }
 
-#if defined(__linux__)
-            _elapsedTime += max(ret, (int)(( 10000 - maxSelectTime.tv_usec ) / 1000));
-#else
             _elapsedTime += ret; // assume 1ms to grab connection. very rough
-#endif
 
             for (vector<SOCKET>::iterator it=_socks.begin(), end=_socks.end(); it != end; ++it) {
                 if (! (FD_ISSET(*it, fds)))
                     continue;
-                SockAddr from;
-                int s = accept(*it, from.raw(), &from.addressSize);
-                if ( s < 0 ) {
-                    int x = errno; // so no global issues
-                    if (x == EBADF) {
-                        log() << "Port " << _port << " is no longer valid" << endl;
-                        return;
-                    }
-                    else if (x == ECONNABORTED) {
-                        log() << "Connection on port " << _port << " aborted" << endl;
-                        continue;
-                    }
-                    if ( x == 0 && inShutdown() ) {
-                        return;   // socket closed
-                    }
-                    if( !inShutdown() ) {
-                        log() << "Listener: accept() returns " << s << " " << errnoWithDescription(x) << endl;
-                        if (x == EMFILE || x == ENFILE) {
-                            // Connection still in listen queue but we can't accept it yet
-                            error() << "Out of file descriptors. Waiting one second before trying to accept more connections." << warnings;
-                            sleepsecs(1);
-                        }
-                    }
-                    continue;
+                if (!_accept(*it)) {
+                    return;
+                }
+            }
+        }
+    }
+#endif
+
+    bool Listener::_accept(SOCKET sock) {
+        SockAddr from;
+        int s = accept(sock, from.raw(), &from.addressSize);
+        if ( s < 0 ) {
+            int x = errno; // so no global issues
+            if (x == EBADF) {
+                log() << "Port " << _port << " is no longer valid" << endl;
+                return false;
+            }
+            else if (x == ECONNABORTED) {
+                log() << "Connection on port " << _port << " aborted" << endl;
+                return true;
+            }
+            if ( x == 0 && inShutdown() ) {
+                return false;   // socket closed
+            }
+            if( !inShutdown() ) {
+                log() << "Listener: accept() returns " << s << " " << errnoWithDescription(x) << endl;
+                if (x == EMFILE || x == ENFILE) {
+                    // Connection still in listen queue but we can't accept it yet
+                    error() << "Out of file descriptors. Waiting one second before trying to accept more connections." << warnings;
+                    sleepsecs(1);
                 }
-                if (from.getType() != AF_UNIX)
-                    disableNagle(s);
+            }
+            return true;
+        }
+        if (from.getType() != AF_UNIX)
+            disableNagle(s);
 
 #ifdef SO_NOSIGPIPE
-                // ignore SIGPIPE signals on osx, to avoid process exit
-                const int one = 1;
-                setsockopt( s , SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(int));
+        // ignore SIGPIPE signals on osx, to avoid process exit
+        const int one = 1;
+        setsockopt( s , SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(int));
 #endif
 
-                long long myConnectionNumber = globalConnectionNumber.addAndFetch(1);
+        long long myConnectionNumber = globalConnectionNumber.addAndFetch(1);
 
-                if ( _logConnect && ! cmdLine.quiet ){
-                    int conns = globalTicketHolder.used()+1;
-                    const char* word = (conns == 1 ? " connection" : " connections");
-                    log() << "connection accepted from " << from.toString() << " #" << myConnectionNumber << " (" << conns << word << " now open)" << endl;
-                }
-                
-                boost::shared_ptr<Socket> pnewSock( new Socket(s, from) );
+        if ( _logConnect && ! cmdLine.quiet ){
+            int conns = globalTicketHolder.used()+1;
+            const char* word = (conns == 1 ? " connection" : " connections");
+            log() << "connection accepted from " << from.toString() << " #" << myConnectionNumber << " (" << conns << word << " now open)" << endl;
+        }
+        
+        boost::shared_ptr<Socket> pnewSock( new Socket(s, from) );
 #ifdef MONGO_SSL
-                if (_ssl) {
-                    pnewSock->secureAccepted(_ssl);
-                }
-#endif
-                accepted( pnewSock , myConnectionNumber );
-            }
+        if (_ssl) {
+            pnewSock->secureAccepted(_ssl);
         }
+#endif
+        accepted( pnewSock , myConnectionNumber );
+        return true;
     }
 
 #else 
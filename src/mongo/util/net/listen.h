@@ -85,6 +85,16 @@ namespace mongo {
         
         void _logListen( int port , bool ssl );
 
+#if !defined(_WIN32)
+#if defined(__linux__)
+        void _epollListen();
+#else
+        void _selectListen();
+#endif
+        /** Accept a connection on sock.  @return false if the listener should stop. */
+        bool _accept(SOCKET sock);
+#endif
+
         static const Listener* _timeTracker;
         
         virtual bool useUnixSockets() const { return false; }
@@ -43,7 +43,8 @@ namespace mongo {
         dbQuery = 2004,
         dbGetMore = 2005,
         dbDelete = 2006,
-        dbKillCursors = 2007
+        dbKillCursors = 2007,
+        dbCompressed = 2012 /* wraps a message of another operation, see message_compressor.h */
     };
 
     bool doesOpGetAResponse( int op );
@@ -59,6 +60,7 @@ namespace mongo {
         case dbGetMore: return "getmore";
         case dbDelete: return "remove";
         case dbKillCursors: return "killcursors";
+        case dbCompressed: return "compressed";
         default:
             massert( 16141, str::stream() << "cannot translate opcode " << op, !op );
             return "";
@@ -74,6 +76,7 @@ namespace mongo {
         case dbQuery:
         case dbGetMore:
         case dbKillCursors:
+        case dbCompressed:
             return false;
 
         case dbUpdate:
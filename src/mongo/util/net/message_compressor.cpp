@@ -0,0 +1,214 @@
+// message_compressor.cpp
+
+/**
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_compressor.h"
+
+#include <zlib.h>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+
+    const char messageCompressionFieldName[] = "compression";
+
+    namespace {
+
+        /*
+          The body of a dbCompressed message is:
+              int32 operation of the wrapped message
+              int32 size of the wrapped message's body (without its header)
+              int8  MessageCompressor
+              the compressed body of the wrapped message
+          The header keeps the wrapped message's id and responseTo.
+         */
+        const int compressedPrefixSize = 4 + 4 + 1;
+
+        AtomicInt64 messagesCompressed;
+        AtomicInt64 bytesOutUncompressed;
+        AtomicInt64 bytesOutCompressed;
+        AtomicInt64 messagesDecompressed;
+        AtomicInt64 bytesInCompressed;
+        AtomicInt64 bytesInUncompressed;
+
+        const char* compressorName( MessageCompressor compressor ) {
+            switch ( compressor ) {
+            case MessageCompressor_Zlib: return "zlib";
+            default: return "none";
+            }
+        }
+
+        double ratio( long long uncompressed, long long compressed ) {
+            return compressed > 0 ? double( uncompressed ) / compressed : 0.0;
+        }
+
+    } // namespace
+
+    void appendSupportedMessageCompressors( BSONArrayBuilder& b ) {
+        b.append( compressorName( MessageCompressor_Zlib ) );
+    }
+
+    MessageCompressor chooseMessageCompressor( const BSONElement& e ) {
+        if ( e.type() != Array ) {
+            return MessageCompressor_None;
+        }
+        for ( BSONObjIterator it( e.Obj() ); it.more(); ) {
+            BSONElement name = it.next();
+            if ( name.type() == String && name.valuestr() == StringData( compressorName( MessageCompressor_Zlib ) ) ) {
+                return MessageCompressor_Zlib;
+            }
+        }
+        return MessageCompressor_None;
+    }
+
+    void negotiateMessageCompression( const BSONObj& cmdObj,
+                                      AbstractMessagingPort* port,
+                                      BSONObjBuilder& result ) {
+        if ( port == NULL ) {
+            return;
+        }
+        const MessageCompressor compressor = chooseMessageCompressor( cmdObj[messageCompressionFieldName] );
+        if ( compressor == MessageCompressor_None ) {
+            return;
+        }
+        port->setCompressor( compressor );
+        BSONArrayBuilder b( result.subarrayStart( messageCompressionFieldName ) );
+        b.append( compressorName( compressor ) );
+        b.done();
+    }
+
+    bool compressMessage( MessageCompressor compressor , Message& in , Message& out ) {
+        if ( compressor == MessageCompressor_None ||
+             in.size() < MessageCompressionMinBytes ||
+             in.operation() == dbCompressed ) {
+            return false;
+        }
+        verify( compressor == MessageCompressor_Zlib );
+
+        in.concat();
+        MsgData* md = in.singleData();
+        const int bodyLen = md->dataLen();
+
+        uLongf compressedLen = compressBound( bodyLen );
+        MsgData* cmd = (MsgData*) malloc( MsgDataHeaderSize + compressedPrefixSize + compressedLen );
+        verify( cmd );
+        ScopeGuard guard = MakeGuard( free, cmd );
+
+        char* p = cmd->_data;
+        const int operation = md->operation();
+        memcpy( p, &operation, 4 );
+        memcpy( p + 4, &bodyLen, 4 );
+        p[8] = static_cast<char>( compressor );
+
+        const int r = compress2( reinterpret_cast<Bytef*>( p + compressedPrefixSize ), &compressedLen,
+                                 reinterpret_cast<const Bytef*>( md->_data ), bodyLen,
+                                 Z_DEFAULT_COMPRESSION );
+        if ( r != Z_OK ) {
+            return false;
+        }
+        const int len = MsgDataHeaderSize + compressedPrefixSize + compressedLen;
+        if ( len >= md->len ) {
+            // not worth it
+            return false;
+        }
+
+        cmd->len = len;
+        cmd->id = md->id;
+        cmd->responseTo = md->responseTo;
+        cmd->setOperation( dbCompressed );
+
+        guard.Dismiss();
+        out.setData( cmd, true );
+
+        messagesCompressed.fetchAndAdd( 1 );
+        bytesOutUncompressed.fetchAndAdd( md->len );
+        bytesOutCompressed.fetchAndAdd( len );
+        return true;
+    }
+
+    void decompressMessage( Message& m ) {
+        MsgData* md = m.singleData();
+        verify( md->operation() == dbCompressed );
+        uassert( 17383, "compressed message is too short", md->dataLen() >= compressedPrefixSize );
+
+        int operation;
+        int bodyLen;
+        const char* p = md->_data;
+        memcpy( &operation, p, 4 );
+        memcpy( &bodyLen, p + 4, 4 );
+        const MessageCompressor compressor = static_cast<MessageCompressor>( p[8] );
+        uassert( 17384, str::stream() << "compressed message has bad uncompressed size " << bodyLen,
+                 bodyLen >= 0 && bodyLen <= MaxMessageSizeBytes - MsgDataHeaderSize );
+        uassert( 17385, str::stream() << "unknown message compressor " << int( compressor ),
+                 compressor == MessageCompressor_Zlib );
+
+        // MsgData always has room for at least 4 bytes of data
+        MsgData* out = (MsgData*) malloc( MsgDataHeaderSize + std::max( bodyLen, 4 ) );
+        verify( out );
+        ScopeGuard guard = MakeGuard( free, out );
+
+        uLongf uncompressedLen = bodyLen;
+        const int r = uncompress( reinterpret_cast<Bytef*>( out->_data ), &uncompressedLen,
+                                  reinterpret_cast<const Bytef*>( p + compressedPrefixSize ),
+                                  md->dataLen() - compressedPrefixSize );
+        uassert( 17386, str::stream() << "failed to decompress message, zlib error " << r,
+                 r == Z_OK && uncompressedLen == uLongf( bodyLen ) );
+
+        out->len = MsgDataHeaderSize + bodyLen;
+        out->id = md->id;
+        out->responseTo = md->responseTo;
+        out->setOperation( operation );
+
+        messagesDecompressed.fetchAndAdd( 1 );
+        bytesInCompressed.fetchAndAdd( md->len );
+        bytesInUncompressed.fetchAndAdd( out->len );
+
+        guard.Dismiss();
+        m.reset();
+        m.setData( out, true );
+    }
+
+    void appendMessageCompressionStats( BSONObjBuilder& b ) {
+        const long long inCompressed = bytesInCompressed.load();
+        const long long inUncompressed = bytesInUncompressed.load();
+        const long long outCompressed = bytesOutCompressed.load();
+        const long long outUncompressed = bytesOutUncompressed.load();
+        {
+            BSONObjBuilder in( b.subobjStart( "in" ) );
+            in.appendNumber( "messages", messagesDecompressed.load() );
+            in.appendNumber( "compressedBytes", inCompressed );
+            in.appendNumber( "uncompressedBytes", inUncompressed );
+            in.append( "ratio", ratio( inUncompressed, inCompressed ) );
+            in.done();
+        }
+        {
+            BSONObjBuilder out( b.subobjStart( "out" ) );
+            out.appendNumber( "messages", messagesCompressed.load() );
+            out.appendNumber( "compressedBytes", outCompressed );
+            out.appendNumber( "uncompressedBytes", outUncompressed );
+            out.append( "ratio", ratio( outUncompressed, outCompressed ) );
+            out.done();
+        }
+    }
+
+} // namespace mongo
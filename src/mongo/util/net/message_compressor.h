@@ -0,0 +1,79 @@
+// message_compressor.h
+
+/**
+ *    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mongo/pch.h"
+
+namespace mongo {
+
+    class AbstractMessagingPort;
+    class BSONArrayBuilder;
+    class BSONElement;
+    class BSONObj;
+    class BSONObjBuilder;
+    class Message;
+
+    /**
+     * Compressors for dbCompressed messages.  The value is the id sent on the
+     * wire, so existing values must not change.
+     */
+    enum MessageCompressor {
+        MessageCompressor_None = 0,
+        MessageCompressor_Zlib = 2
+    };
+
+    /** Messages smaller than this are always sent as they are. */
+    const int MessageCompressionMinBytes = 1024;
+
+    /** Field of isMaster listing the compressors a side supports, in preference order. */
+    extern const char messageCompressionFieldName[];
+
+    /** Appends the names of the compressors we support, in preference order. */
+    void appendSupportedMessageCompressors( BSONArrayBuilder& b );
+
+    /**
+     * @return the first compressor in the list of names e that we support, or
+     *         MessageCompressor_None
+     */
+    MessageCompressor chooseMessageCompressor( const BSONElement& e );
+
+    /**
+     * Server side of the isMaster handshake: if cmdObj offers compressors we
+     * support, replies to this client on port are compressed from now on, and
+     * the chosen compressor is appended to result.
+     */
+    void negotiateMessageCompression( const BSONObj& cmdObj,
+                                      AbstractMessagingPort* port,
+                                      BSONObjBuilder& result );
+
+    /**
+     * If in is large enough and compresses to something smaller, sets out to a
+     * dbCompressed message wrapping it, with the same id and responseTo.
+     * May concat() the buffers of in.
+     * @return true if out was set
+     */
+    bool compressMessage( MessageCompressor compressor , Message& in , Message& out );
+
+    /** Replaces a dbCompressed message with the message it wraps. */
+    void decompressMessage( Message& m );
+
+    /** Appends counters of compressed traffic, for serverStatus. */
+    void appendMessageCompressionStats( BSONObjBuilder& b );
+
+} // namespace mongo
@@ -126,18 +126,18 @@ namespace mongo {
     }
 
     MessagingPort::MessagingPort(int fd, const SockAddr& remote) 
-        : psock( new Socket( fd , remote ) ) , piggyBackData(0) {
+        : psock( new Socket( fd , remote ) ) , piggyBackData(0), _compressor(MessageCompressor_None) {
         ports.insert(this);
     }
 
     MessagingPort::MessagingPort( double timeout, int ll ) 
-        : psock( new Socket( timeout, ll ) ) {
+        : psock( new Socket( timeout, ll ) ), _compressor(MessageCompressor_None) {
         ports.insert(this);
         piggyBackData = 0;
     }
 
     MessagingPort::MessagingPort( boost::shared_ptr<Socket> sock )
-        : psock( sock ), piggyBackData( 0 ) {
+        : psock( sock ), piggyBackData( 0 ), _compressor( MessageCompressor_None ) {
         ports.insert(this);
     }
 
@@ -203,6 +203,17 @@ again:
 
             guard.Dismiss();
             m.setData(md, true);
+            if ( m.operation() == dbCompressed ) {
+                // either side may compress once compression was negotiated
+                try {
+                    decompressMessage( m );
+                }
+                catch ( const DBException& e ) {
+                    LOG(0) << "recv(): bad compressed message from " << remote() << ": " << e.what() << endl;
+                    m.reset();
+                    return false;
+                }
+            }
             return true;
 
         }
@@ -270,6 +281,13 @@ again:
             }
         }
 
+        Message compressed;
+        if ( compressMessage( _compressor, toSend, compressed ) ) {
+            // toSend keeps the original header, callers match replies against its id
+            compressed.send( *this, "say" );
+            return;
+        }
+
         toSend.send( *this, "say" );
     }
 
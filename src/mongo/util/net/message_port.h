@@ -19,6 +19,7 @@
 
 #include "sock.h"
 #include "message.h"
+#include "message_compressor.h"
 
 namespace mongo {
 
@@ -40,6 +41,9 @@ namespace mongo {
         long long connectionId() const { return _connectionId; }
         void setConnectionId( long long connectionId );
 
+        /** Messages sent after this call are compressed with compressor, when it helps. */
+        virtual void setCompressor( MessageCompressor compressor ) {}
+
     public:
         // TODO make this private with some helpers
 
@@ -119,9 +123,13 @@ namespace mongo {
             return psock->getSockCreationMicroSec();
         }
 
+        virtual void setCompressor( MessageCompressor compressor ) { _compressor = compressor; }
+
     private:
         
         PiggyBackData * piggyBackData;
+
+        MessageCompressor _compressor;
         
         // this is the parsed version of remote
         // mutable because its initialized only on call to remote()
@@ -30,7 +30,35 @@ namespace mongo {
 
     class MessageHandler {
     public:
+        /**
+         * State a handler keeps in thread locals for the connection it is
+         * serving.  Destroying it releases whatever the thread would have
+         * released when the connection's thread exited.
+         */
+        class ConnectionState {
+        public:
+            virtual ~ConnectionState() {}
+        };
+
         virtual ~MessageHandler() {}
+
+        /**
+         * whether connections may be served by a pool of threads, moving their
+         * state between threads with detachConnection() and attachConnection()
+         */
+        virtual bool canShareThreads() const { return false; }
+
+        /**
+         * called after serving a message on a pooled thread, to take the
+         * connection's state off the current thread.  caller owns the result
+         */
+        virtual ConnectionState* detachConnection() { return NULL; }
+
+        /**
+         * moves state from detachConnection() back onto the current thread,
+         * before serving the connection's next message
+         */
+        virtual void attachConnection( ConnectionState* state ) {}
         
         /**
          * called once when a socket is connected
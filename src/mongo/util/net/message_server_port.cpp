@@ -28,16 +28,443 @@
 
 #include "../../db/cmdline.h"
 #include "../../db/lasterror.h"
+#include "../../db/server_parameters.h"
 #include "../../db/stats/counters.h"
 #include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/net/message_compressor.h"
 #include "mongo/util/net/ssl_manager.h"
+#include "mongo/util/time_support.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
+# include <sys/epoll.h>
 # include <sys/resource.h>
 #endif
 
 namespace mongo {
 
+    // Number of threads serving client connections, woken by epoll when a
+    // connection has a request; more are started while they are all blocked.
+    // 0 (the default) means a thread per connection.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(connectionWorkerThreads, int, 0);
+
+#ifdef __linux__
+    /**
+     * Serves connections from a pool of worker threads.
+     *
+     * Idle connections sit in an epoll set, registered one-shot, and take no
+     * thread.  When one becomes readable the poll thread reads what it can
+     * without blocking, and only once it has a whole Message does it queue the
+     * connection for a worker, so a client that sends slowly doesn't hold a
+     * worker.  The worker passes the message to the handler with the
+     * connection's state attached to its thread, then detaches the state and
+     * re-arms the connection.  A connection is therefore only ever served by
+     * one worker at a time, and its requests stay in order.
+     *
+     * Requests can block on each other (a lock wait, an awaitData getMore, an
+     * operation waiting on another connection's transaction), so when requests
+     * are queued and no worker has taken one for a while the pool starts
+     * another worker, up to one per open connection.  Workers beyond the
+     * configured number exit after being idle for a while.
+     */
+    class ConnectionWorkerPool : boost::noncopyable {
+    public:
+        ConnectionWorkerPool( MessageHandler* handler , int numWorkers );
+
+        /** takes ownership of p, and of the connection ticket it holds */
+        void add( MessagingPort* p );
+
+    private:
+        /** everything the thread per connection kept on its stack */
+        struct Connection : boost::noncopyable {
+            explicit Connection( MessagingPort* p ) :
+                port( p ), connected( false ), closing( false ),
+                len( 0 ), lenRead( 0 ), data( NULL ), dataRead( 0 ), bytesIn( 0 ) {}
+            ~Connection() { free( data ); }
+
+            scoped_ptr<MessagingPort> port;
+            scoped_ptr<LastError> lastError;
+            scoped_ptr<MessageHandler::ConnectionState> state;
+            string threadName;
+            string otherSide;
+            bool connected;
+            // the client hung up, or sent something that isn't a message
+            bool closing;
+
+            // the message being read by the poll thread
+            int len;
+            int lenRead;
+            MsgData* data;
+            int dataRead;
+            long long bytesIn;
+            // the whole message, for a worker
+            Message message;
+        };
+
+        enum ReadResult { READ_MORE , READ_MESSAGE , READ_CLOSED };
+
+        void pollThread();
+        void workerThread();
+        /** starts another worker if requests are waiting and none has been taken for a while */
+        void growIfStalled();
+
+        /** reads from c without blocking until it has a whole message */
+        ReadResult readSome( Connection* c );
+        /** checks the length just read and makes room for the message, returns false to close */
+        bool startMessage( Connection* c );
+        /** hands c to a worker */
+        void queue( Connection* c );
+
+        /** serves the message read on c, returns false if c should be closed */
+        bool serve( Connection* c );
+        /** puts c back in the epoll set, closing it if that fails */
+        void rearm( Connection* c );
+        void close( Connection* c );
+
+        MessageHandler* const _handler;
+        const int _epfd;
+        const int _minWorkers;
+
+        boost::mutex _mutex;
+        boost::condition _readyNotEmpty;
+        std::deque<Connection*> _ready;
+        int _workers;
+        int _idleWorkers;
+        // when a worker last took a connection from _ready
+        unsigned long long _lastTakenMillis;
+    };
+
+    // how long queued requests wait on busy workers before the pool grows
+    static const unsigned long long connectionWorkerStallMillis = 100;
+    // how long a worker beyond connectionWorkerThreads waits for a request before exiting
+    static const int connectionWorkerIdleSecs = 10;
+
+    ConnectionWorkerPool::ConnectionWorkerPool( MessageHandler* handler , int numWorkers ) :
+        _handler( handler ),
+        _epfd( epoll_create( 1024 ) ),
+        _minWorkers( numWorkers ),
+        _workers( numWorkers ),
+        _idleWorkers( 0 ),
+        _lastTakenMillis( curTimeMillis64() ) {
+        massert( 17382 , str::stream() << "epoll_create failed: " << errnoWithDescription() ,
+                 _epfd >= 0 );
+        boost::thread poller( boost::bind( &ConnectionWorkerPool::pollThread , this ) );
+        for ( int i = 0; i < numWorkers; i++ ) {
+            boost::thread worker( boost::bind( &ConnectionWorkerPool::workerThread , this ) );
+        }
+    }
+
+    void ConnectionWorkerPool::add( MessagingPort* p ) {
+        Connection* c = new Connection( p );
+        c->threadName = "conn";
+        if ( p->connectionId() > 0 )
+            c->threadName = str::stream() << c->threadName << p->connectionId();
+        p->psock->setLogLevel(1);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.ptr = c;
+        if ( epoll_ctl( _epfd , EPOLL_CTL_ADD , p->psock->rawFD() , &ev ) != 0 ) {
+            const int x = errno;
+            delete c;
+            Listener::globalTicketHolder.release();
+            log() << "epoll_ctl failed, closing connection: " << errnoWithDescription( x ) << endl;
+        }
+    }
+
+    void ConnectionWorkerPool::rearm( Connection* c ) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.ptr = c;
+        if ( epoll_ctl( _epfd , EPOLL_CTL_MOD , c->port->psock->rawFD() , &ev ) != 0 ) {
+            log() << "epoll_ctl failed, closing connection " << c->otherSide << ": "
+                  << errnoWithDescription() << endl;
+            c->closing = true;
+            queue( c );
+        }
+    }
+
+    void ConnectionWorkerPool::pollThread() {
+        setThreadName( "connPoll" );
+        const int maxEvents = 256;
+        struct epoll_event events[maxEvents];
+        while ( ! inShutdown() ) {
+            const int n = epoll_wait( _epfd , events , maxEvents , 100 );
+            if ( n < 0 ) {
+                const int x = errno;
+                if ( x != EINTR ) {
+                    log() << "epoll_wait() failure: " << errnoWithDescription( x ) << endl;
+                    sleepmillis( 10 );
+                }
+                continue;
+            }
+
+            for ( int i = 0; i < n; i++ ) {
+                Connection* c = static_cast<Connection*>( events[i].data.ptr );
+                switch ( readSome( c ) ) {
+                case READ_MORE:
+                    rearm( c );
+                    break;
+                case READ_MESSAGE:
+                    queue( c );
+                    break;
+                case READ_CLOSED:
+                    // the handler may block in disconnected(), so a worker closes it
+                    c->closing = true;
+                    queue( c );
+                    break;
+                }
+            }
+
+            growIfStalled();
+        }
+    }
+
+    ConnectionWorkerPool::ReadResult ConnectionWorkerPool::readSome( Connection* c ) {
+        const int fd = c->port->psock->rawFD();
+        while ( true ) {
+            char* dest;
+            int want;
+            if ( c->lenRead < 4 ) {
+                dest = reinterpret_cast<char*>( &c->len ) + c->lenRead;
+                want = 4 - c->lenRead;
+            }
+            else {
+                dest = reinterpret_cast<char*>( c->data ) + c->dataRead;
+                want = c->len - c->dataRead;
+            }
+
+            const ssize_t got = ::recv( fd , dest , want , MSG_DONTWAIT );
+            if ( got == 0 ) {
+                return READ_CLOSED;
+            }
+            if ( got < 0 ) {
+                const int x = errno;
+                if ( x == EINTR )
+                    continue;
+                if ( x == EAGAIN || x == EWOULDBLOCK )
+                    return READ_MORE;
+                LOG( c->port->psock->getLogLevel() ) << "recv() error from " << c->otherSide
+                                                     << ": " << errnoWithDescription( x ) << endl;
+                return READ_CLOSED;
+            }
+            c->bytesIn += got;
+
+            if ( c->lenRead < 4 ) {
+                c->lenRead += got;
+                if ( c->lenRead == 4 && ! startMessage( c ) ) {
+                    return READ_CLOSED;
+                }
+                continue;
+            }
+
+            c->dataRead += got;
+            if ( c->dataRead == c->len ) {
+                c->message.setData( c->data , true );
+                c->data = NULL;
+                c->lenRead = 0;
+                c->dataRead = 0;
+                if ( c->message.operation() == dbCompressed ) {
+                    // either side may compress once compression was negotiated
+                    try {
+                        decompressMessage( c->message );
+                    }
+                    catch ( const DBException& e ) {
+                        LOG(0) << "recv(): bad compressed message from " << c->otherSide
+                               << ": " << e.what() << endl;
+                        c->message.reset();
+                        return READ_CLOSED;
+                    }
+                }
+                return READ_MESSAGE;
+            }
+        }
+    }
+
+    bool ConnectionWorkerPool::startMessage( Connection* c ) {
+        const int len = c->len;
+        MessagingPort* p = c->port.get();
+        if ( len < 16 || len > MaxMessageSizeBytes ) { // messages must be large enough for headers
+            if ( len == -1 ) {
+                // Endian check from the client, after connecting, to see what mode server is
+                // running in.  Four bytes fit in a new connection's send buffer.
+                unsigned foo = 0x10203040;
+                p->send( (char *) &foo, 4, "endian" );
+                c->lenRead = 0;
+                return true;
+            }
+
+            if ( len == 542393671 ) {
+                // an http GET
+                LOG( p->psock->getLogLevel() ) << "looks like you're trying to access db over http on native driver port.  please add 1000 for webserver" << endl;
+                string msg = "You are trying to access MongoDB on the native driver port. For http diagnostic access, add 1000 to the port number\n";
+                stringstream ss;
+                ss << "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: " << msg.size() << "\r\n\r\n" << msg;
+                string s = ss.str();
+                ::send( p->psock->rawFD() , s.c_str() , s.size() , MSG_DONTWAIT | MSG_NOSIGNAL );
+                return false;
+            }
+            LOG(0) << "recv(): message len " << len << " is too large. "
+                   << "Max is " << MaxMessageSizeBytes << endl;
+            return false;
+        }
+
+        int z = (len+1023)&0xfffffc00;
+        verify(z>=len);
+        c->data = (MsgData *) malloc(z);
+        verify(c->data);
+        c->data->len = len;
+        c->dataRead = 4;
+        return true;
+    }
+
+    void ConnectionWorkerPool::queue( Connection* c ) {
+        boost::mutex::scoped_lock lk( _mutex );
+        _ready.push_back( c );
+        _readyNotEmpty.notify_one();
+    }
+
+    void ConnectionWorkerPool::growIfStalled() {
+        {
+            boost::mutex::scoped_lock lk( _mutex );
+            if ( _ready.empty() || _idleWorkers > 0 ||
+                 curTimeMillis64() - _lastTakenMillis < connectionWorkerStallMillis ||
+                 _workers >= Listener::globalTicketHolder.used() ) {
+                return;
+            }
+            _workers++;
+            // don't start another until this one has had a chance to take a request
+            _lastTakenMillis = curTimeMillis64();
+        }
+        LOG(1) << "all connection workers are busy, starting another" << endl;
+        try {
+            boost::thread worker( boost::bind( &ConnectionWorkerPool::workerThread , this ) );
+        }
+        catch ( boost::thread_resource_error& ) {
+            log() << "can't create new connection worker thread" << endl;
+            boost::mutex::scoped_lock lk( _mutex );
+            _workers--;
+        }
+    }
+
+    void ConnectionWorkerPool::workerThread() {
+        setThreadName( "connWorker" );
+        while ( true ) {
+            Connection* c;
+            {
+                boost::mutex::scoped_lock lk( _mutex );
+                _idleWorkers++;
+                while ( _ready.empty() ) {
+                    const bool woken = _readyNotEmpty.timed_wait(
+                            lk , boost::posix_time::seconds( connectionWorkerIdleSecs ) );
+                    if ( ! woken && _ready.empty() && _workers > _minWorkers ) {
+                        _idleWorkers--;
+                        _workers--;
+                        return;
+                    }
+                }
+                _idleWorkers--;
+                c = _ready.front();
+                _ready.pop_front();
+                _lastTakenMillis = curTimeMillis64();
+            }
+
+            setThreadName( c->threadName.c_str() );
+            if ( ! c->closing && serve( c ) ) {
+                rearm( c );
+            }
+            else {
+                close( c );
+            }
+            setThreadName( "connWorker" );
+        }
+    }
+
+    bool ConnectionWorkerPool::serve( Connection* c ) {
+        MessagingPort* p = c->port.get();
+        bool keep = false;
+        try {
+            if ( ! c->connected ) {
+                c->lastError.reset( new LastError() );
+                lastError.reset( c->lastError.get() );
+                c->otherSide = p->psock->remoteString();
+                c->connected = true;
+                _handler->connected( p );
+            }
+            else {
+                lastError.reset( c->lastError.get() );
+                _handler->attachConnection( c->state.get() );
+                c->state.reset();
+            }
+
+            p->psock->clearCounters();
+            if ( inShutdown() ) {
+                p->shutdown();
+            }
+            else {
+                _handler->process( c->message , p , c->lastError.get() );
+                networkCounter.hit( c->bytesIn , p->psock->getBytesOut() );
+                keep = true;
+            }
+        }
+        catch ( AssertionException& e ) {
+            log() << "AssertionException handling request, closing client connection: " << e << endl;
+            p->shutdown();
+        }
+        catch ( SocketException& e ) {
+            log() << "SocketException handling request, closing client connection: " << e << endl;
+            p->shutdown();
+        }
+        catch ( const DBException& e ) { // must be right above std::exception to avoid catching subclasses
+            log() << "DBException handling request, closing client connection: " << e << endl;
+            p->shutdown();
+        }
+        catch ( std::exception &e ) {
+            error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+            dbexit( EXIT_UNCAUGHT );
+        }
+        catch ( ... ) {
+            error() << "Uncaught exception, terminating" << endl;
+            dbexit( EXIT_UNCAUGHT );
+        }
+
+        c->message.reset();
+        c->bytesIn = 0;
+        if ( keep ) {
+            c->state.reset( _handler->detachConnection() );
+            lastError.release();
+        }
+        return keep;
+    }
+
+    void ConnectionWorkerPool::close( Connection* c ) {
+        if ( c->closing ) {
+            if( !cmdLine.quiet ){
+                int conns = Listener::globalTicketHolder.used()-1;
+                const char* word = (conns == 1 ? " connection" : " connections");
+                log() << "end connection " << ( c->connected ? c->otherSide : c->port->psock->remoteString() )
+                      << " (" << conns << word << " now open)" << endl;
+            }
+            c->port->shutdown();
+        }
+        if ( c->connected ) {
+            if ( c->state ) {
+                // closed after its state was detached
+                lastError.reset( c->lastError.get() );
+                _handler->attachConnection( c->state.get() );
+                c->state.reset();
+            }
+            _handler->disconnected( c->port.get() );
+            // destroy the state the handler left on this thread
+            c->state.reset( _handler->detachConnection() );
+            c->state.reset();
+            lastError.release();
+        }
+        epoll_ctl( _epfd , EPOLL_CTL_DEL , c->port->psock->rawFD() , NULL );
+        delete c;
+        Listener::globalTicketHolder.release();
+    }
+#endif
+
     class PortMessageServer : public MessageServer , public Listener {
     public:
         /**
@@ -64,6 +491,13 @@ namespace mongo {
                 return;
             }
 
+#ifdef __linux__
+            if ( _workerPool ) {
+                _workerPool->add( p );
+                return;
+            }
+#endif
+
             try {
 #ifndef __linux__  // TODO: consider making this ifdef _WIN32
                 {
@@ -130,6 +564,25 @@ namespace mongo {
         }
 
         void run() {
+#ifdef __linux__
+            if ( connectionWorkerThreads > 0 ) {
+                if ( ! _handler->canShareThreads() ) {
+                    log() << "connectionWorkerThreads is not supported by this server, "
+                          << "using a thread per connection" << endl;
+                }
+#ifdef MONGO_SSL
+                else if ( cmdLine.sslOnNormalPorts ) {
+                    log() << "connectionWorkerThreads is not supported with SSL, "
+                          << "using a thread per connection" << endl;
+                }
+#endif
+                else {
+                    log() << "serving connections with " << connectionWorkerThreads
+                          << " worker threads" << endl;
+                    _workerPool.reset( new ConnectionWorkerPool( _handler , connectionWorkerThreads ) );
+                }
+            }
+#endif
             initAndListen();
         }
 
@@ -137,6 +590,9 @@ namespace mongo {
 
     private:
         MessageHandler* _handler;
+#ifdef __linux__
+        scoped_ptr<ConnectionWorkerPool> _workerPool;
+#endif
 
         /**
          * Simple holder for threadRun parameters. Should not destroy the objects it holds -
@@ -235,6 +235,9 @@ namespace mongo {
             return _fdCreationMicroSec;
         }
 
+        /** @return the underlying file descriptor, for registering with epoll */
+        int rawFD() const { return _fd; }
+
     private:
         void _init();
 
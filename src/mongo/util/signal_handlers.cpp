@@ -104,6 +104,7 @@ namespace mongo {
     }
 
     void printStackAndExit( int signalNum ) {
+        flushAsyncLog();
         int fd = Logstream::getLogDesc();
 
         if ( fd >= 0 ) {